@@ -448,7 +448,7 @@ static enum rq_end_io_ret nvme_uring_cmd_end_io(struct request *req,
 	if (blk_rq_is_poll(req)) {
 		if (pdu->bio)
 			blk_rq_unmap_user(pdu->bio);
-		io_uring_cmd_iopoll_done(ioucmd, pdu->result, pdu->status);
+		io_uring_cmd_iopoll_done(ioucmd, pdu->status, pdu->result);
 	} else {
 		io_uring_cmd_do_in_task_lazy(ioucmd, nvme_uring_task_cb);
 	}
@@ -32,6 +32,9 @@
 #include <linux/bit_spinlock.h>
 #include <linux/rculist_bl.h>
 #include <linux/list_lru.h>
+#include <linux/vmalloc.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include "internal.h"
 #include "mount.h"
 
@@ -96,22 +99,92 @@ EXPORT_SYMBOL(slash_name);
  * information, yet avoid using a prime hash-size or similar.
  */
 
-static unsigned int __read_mostly d_hash_shift ;
+struct d_hash_table {
+	struct hlist_bl_head	*buckets;
+	unsigned int		shift;		/* 32 - log2(nr of buckets) */
+};
+
+/* The table sized at boot from dhash_entries= */
+static struct d_hash_table d_hash_boot;
 
 /**
  *  struct dentry.d_hash 为 hash 节点
  *  系统为 dentry 结构的hash表，
  *  利用 文件路径快速查 hash 表 dentry_hashtable
  *  可以快速找到与之对应的 inode 结构
+ *
+ *  The table is replaced as a whole when it is resized, see
+ *  d_hash_resize().  While a resize is running, buckets of dentry_hashtable
+ *  below d_hash_migrated have been moved to d_hash_future.
  */
-static struct hlist_bl_head __read_mostly*dentry_hashtable ;/* 目录的哈希表 */
+static struct d_hash_table __rcu __read_mostly *dentry_hashtable =
+	RCU_INITIALIZER(&d_hash_boot);
+static struct d_hash_table __rcu *d_hash_future;
+static unsigned int d_hash_migrated;
 
 /**
  * 获取 dentry_hashtable 桶中的一项
+ *
+ * For lockless lookups under rcu_read_lock().  A lookup racing with a
+ * resize may miss its dentry; the resize moves dentries with rename_lock
+ * held for write, so d_lookup() and d_alloc_parallel() retry exactly as
+ * they do for a concurrent d_move().
  */
 static inline struct hlist_bl_head *d_hash(unsigned int hash)
 {
-	return dentry_hashtable + (hash >> d_hash_shift);
+	struct d_hash_table *tbl = rcu_dereference(dentry_hashtable);
+	unsigned int idx = hash >> tbl->shift;
+
+	if (unlikely(rcu_access_pointer(d_hash_future))) {
+		struct d_hash_table *future = rcu_dereference(d_hash_future);
+
+		if (future && idx < smp_load_acquire(&d_hash_migrated))
+			return future->buckets + (hash >> future->shift);
+	}
+	return tbl->buckets + idx;
+}
+
+/*
+ * Lock the bucket a dentry with @hash lives in, for adding or removing it.
+ * The resize moves a bucket and advances d_hash_migrated with the old
+ * bucket locked, so once that lock is held the table state says where the
+ * chain is.  d_hash_future is read before re-checking dentry_hashtable,
+ * pairing with the order in which the resize publishes the new table.
+ */
+static struct hlist_bl_head *d_hash_lock(unsigned int hash)
+{
+	struct d_hash_table *tbl, *future;
+	struct hlist_bl_head *b;
+	unsigned int idx;
+
+	rcu_read_lock();
+again:
+	tbl = rcu_dereference(dentry_hashtable);
+	idx = hash >> tbl->shift;
+	b = tbl->buckets + idx;
+	hlist_bl_lock(b);
+
+	future = rcu_dereference(d_hash_future);
+	if (future && idx >= READ_ONCE(d_hash_migrated))
+		future = NULL;
+	smp_rmb();
+	if (unlikely(tbl != rcu_access_pointer(dentry_hashtable))) {
+		hlist_bl_unlock(b);
+		goto again;
+	}
+
+	if (unlikely(future)) {
+		hlist_bl_unlock(b);
+		b = future->buckets + (hash >> future->shift);
+		hlist_bl_lock(b);
+	}
+	return b;
+}
+
+static inline void d_hash_unlock(struct hlist_bl_head *b)
+{
+	hlist_bl_unlock(b);
+	rcu_read_unlock();
 }
 
 #define IN_LOOKUP_SHIFT 10
@@ -146,6 +219,22 @@ struct dentry_stat_t dentry_stat = {
 static DEFINE_PER_CPU(long, nr_dentry);
 static DEFINE_PER_CPU(long, nr_dentry_unused);
 static DEFINE_PER_CPU(long, nr_dentry_negative);
+static atomic_long_t nr_dentry_negative_pruned;
+
+/*
+ * fs.negative-dentry-limit: how many unused negative dentries a superblock
+ * may keep on its LRU before the oldest ones are reclaimed, 0 for no limit.
+ */
+unsigned long __read_mostly sysctl_negative_dentry_limit;
+
+static long get_nr_dentry(void)
+{
+	int i;
+	long sum = 0;
+	for_each_possible_cpu(i)
+		sum += per_cpu(nr_dentry, i);
+	return sum < 0 ? 0 : sum;
+}
 
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 
@@ -161,15 +250,6 @@ static DEFINE_PER_CPU(long, nr_dentry_negative);
  * glommer: See cffbc8a for details, and if you ever intend to change this,
  * please update all vfs counters to match.
  */
-static long get_nr_dentry(void)
-{
-	int i;
-	long sum = 0;
-	for_each_possible_cpu(i)
-		sum += per_cpu(nr_dentry, i);
-	return sum < 0 ? 0 : sum;
-}
-
 static long get_nr_dentry_unused(void)
 {
 	int i;
@@ -226,6 +306,7 @@ int proc_nr_dentry(struct ctl_table *table, int write, void *buffer,
 	dentry_stat.nr_dentry = get_nr_dentry();
 	dentry_stat.nr_unused = get_nr_dentry_unused();
 	dentry_stat.nr_negative = get_nr_dentry_negative();
+	dentry_stat.nr_negative_pruned = atomic_long_read(&nr_dentry_negative_pruned);
 	return proc_doulongvec_minmax(table, write, buffer, lenp, ppos);
 }
 #endif
@@ -391,6 +472,22 @@ __d_set_inode_and_type(struct dentry *dentry,
 	smp_store_release(&dentry->d_flags, flags);
 }
 
+/*
+ * Negative dentries on the LRU are counted globally for dentry-state and
+ * per superblock for negative-dentry-limit.
+ */
+static inline void d_negative_inc(struct dentry *dentry)
+{
+	this_cpu_inc(nr_dentry_negative);
+	percpu_counter_inc(&dentry->d_sb->s_nr_dentry_negative);
+}
+
+static inline void d_negative_dec(struct dentry *dentry)
+{
+	this_cpu_dec(nr_dentry_negative);
+	percpu_counter_dec(&dentry->d_sb->s_nr_dentry_negative);
+}
+
 static inline void __d_clear_type_and_inode(struct dentry *dentry)
 {
 	unsigned flags = READ_ONCE(dentry->d_flags);
@@ -403,7 +500,7 @@ static inline void __d_clear_type_and_inode(struct dentry *dentry)
 	 *
 	 */
 	if (dentry->d_flags & DCACHE_LRU_LIST)
-		this_cpu_inc(nr_dentry_negative);
+		d_negative_inc(dentry);
 }
 
 /**
@@ -493,11 +590,16 @@ static void d_lru_add(struct dentry *dentry)
 	 * @brief
 	 */
 	if (d_is_negative(dentry)) {
-		this_cpu_inc(nr_dentry_negative);
+		struct super_block *sb = dentry->d_sb;
+		unsigned long limit = READ_ONCE(sysctl_negative_dentry_limit);
+
+		d_negative_inc(dentry);
 		/**
-		 * 可以在这里添加 对 negative dentry 的处理？
-		 *
+		 * 超过 negative-dentry-limit，后台回收最老的 negative dentry
 		 */
+		if (limit &&
+		    percpu_counter_read_positive(&sb->s_nr_dentry_negative) > limit)
+			sb_queue_negative_dentry_prune(sb);
 	}
 	/**
 	 * @brief 添加到 LRU 链表
@@ -517,7 +619,7 @@ static void d_lru_del(struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	/**
 	 * @brief 从链表中删除
 	 *
@@ -558,7 +660,7 @@ static void d_lru_isolate(struct list_lru_one *lru, struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	list_lru_isolate(lru, &dentry->d_lru);
 }
 
@@ -581,10 +683,10 @@ static void d_lru_shrink_move(struct list_lru_one *lru, struct dentry *dentry,
 	/**
 	 * @brief 如果是 negative dentry
 	 *
-	 * @return if() this_cpu_dec(nr_dentry_negative)
+	 * @return if() d_negative_dec(dentry)
 	 */
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	/**
 	 * @brief 从 LRU 移动到 list
 	 *
@@ -617,20 +719,23 @@ static void ___d_drop(struct dentry *dentry)
 	 * with the exception of those newly allocated by
 	 * d_obtain_root, which are always IS_ROOT:
 	 */
-	if (unlikely(IS_ROOT(dentry)))
+	if (unlikely(IS_ROOT(dentry))) {
 		b = &dentry->d_sb->s_roots;
-	else
-		/**
-		 * 从 dentry_hashtable 桶中获取 一项
-		 */
-		b = d_hash(dentry->d_name.hash);
+		hlist_bl_lock(b);
+		__hlist_bl_del(&dentry->d_hash);
+		hlist_bl_unlock(b);
+		return;
+	}
 
-	hlist_bl_lock(b);
+	/**
+	 * 从 dentry_hashtable 桶中获取 一项
+	 */
+	b = d_hash_lock(dentry->d_name.hash);
     /**
      *  从 dentry_hashtable 中删除
      */
 	__hlist_bl_del(&dentry->d_hash);
-	hlist_bl_unlock(b);
+	d_hash_unlock(b);
 }
 
 void __d_drop(struct dentry *dentry)
@@ -1572,6 +1677,90 @@ void shrink_dcache_sb(struct super_block *sb)
 }
 EXPORT_SYMBOL(shrink_dcache_sb);
 
+struct negative_prune {
+	struct list_head dispose;
+	long nr;
+	long want;
+};
+
+static enum lru_status
+dentry_lru_isolate_negative(struct list_head *item,
+		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
+{
+	struct negative_prune *np = arg;
+	struct dentry	*dentry = container_of(item, struct dentry, d_lru);
+
+	/* done, list_lru_walk() can't be stopped early */
+	if (np->nr >= np->want)
+		return LRU_SKIP;
+
+	if (!spin_trylock(&dentry->d_lock))
+		return LRU_SKIP;
+
+	/* leave positive dentries where they are, their aging is not ours */
+	if (!d_is_negative(dentry)) {
+		spin_unlock(&dentry->d_lock);
+		return LRU_SKIP;
+	}
+
+	if (dentry->d_lockref.count) {
+		d_lru_isolate(lru, dentry);
+		spin_unlock(&dentry->d_lock);
+		return LRU_REMOVED;
+	}
+
+	if (dentry->d_flags & DCACHE_REFERENCED) {
+		dentry->d_flags &= ~DCACHE_REFERENCED;
+		spin_unlock(&dentry->d_lock);
+		return LRU_ROTATE;
+	}
+
+	d_lru_shrink_move(lru, dentry, &np->dispose);
+	np->nr++;
+	spin_unlock(&dentry->d_lock);
+
+	return LRU_REMOVED;
+}
+
+/**
+ * prune_negative_dentries - enforce negative-dentry-limit on a superblock
+ * @sb: superblock
+ *
+ * Reclaim the oldest unused negative dentries of @sb until it is comfortably
+ * below the limit, so PATH searches and config probing can't grow the hash
+ * chains until memory pressure kicks in.  Run from the work queued by
+ * d_lru_add(), with s_umount held for read.
+ */
+void prune_negative_dentries(struct super_block *sb)
+{
+	unsigned long limit = READ_ONCE(sysctl_negative_dentry_limit);
+	unsigned long target;
+	struct negative_prune np;
+	s64 nr;
+
+	if (!limit)
+		return;
+
+	/* leave some room so the next few lookups don't requeue us */
+	target = limit - limit / 8;
+	nr = percpu_counter_sum_positive(&sb->s_nr_dentry_negative);
+	if (nr <= target)
+		return;
+
+	INIT_LIST_HEAD(&np.dispose);
+	np.nr = 0;
+	np.want = nr - target;
+	/*
+	 * One pass, as skipped positives stay at the head of the LRU.  Recently
+	 * used negatives are rotated to the tail on their first visit, allow
+	 * for seeing those twice.
+	 */
+	list_lru_walk(&sb->s_dentry_lru, dentry_lru_isolate_negative,
+		      &np, 2 * list_lru_count(&sb->s_dentry_lru));
+	shrink_dentry_list(&np.dispose);
+	atomic_long_add(np.nr, &nr_dentry_negative_pruned);
+}
+
 /**
  * enum d_walk_ret - action to talke during tree walk
  * @D_WALK_CONTINUE:	contrinue walk
@@ -2308,7 +2497,7 @@ static void __d_instantiate(struct dentry *dentry, struct inode *inode)
 	 * Decrement negative dentry count if it was in the LRU list.
 	 */
 	if (dentry->d_flags & DCACHE_LRU_LIST)
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 
 	/**
 	 * @brief
@@ -2746,7 +2935,7 @@ EXPORT_SYMBOL(d_lookup);
 struct dentry *__d_lookup(const struct dentry *parent, const struct qstr *name)
 {
 	unsigned int hash = name->hash;
-	struct hlist_bl_head *b = d_hash(hash);
+	struct hlist_bl_head *b;
 	struct hlist_bl_node *node;
 	struct dentry *found = NULL;
 	struct dentry *dentry;
@@ -2773,6 +2962,7 @@ struct dentry *__d_lookup(const struct dentry *parent, const struct qstr *name)
 	 */
 	rcu_read_lock();
 
+	b = d_hash(hash);
 	hlist_bl_for_each_entry_rcu(dentry, node, b, d_hash) {
 
 		if (dentry->d_name.hash != hash)
@@ -2864,16 +3054,226 @@ void d_delete(struct dentry * dentry)
 }
 EXPORT_SYMBOL(d_delete);
 
+/*
+ * Online resizing of the dentry hash.
+ *
+ * Every D_HASH_CHECK_INTERVAL insertions on a CPU, compare the number of
+ * dentries with the number of buckets and queue a resize when chains
+ * average more than two entries, or when the table has grown past the boot
+ * size and is less than 1/8 used.  The resize allocates a table for about
+ * one dentry per bucket and moves the old buckets over in batches.
+ */
+#define D_HASH_CHECK_INTERVAL	1024
+#define D_HASH_MIGRATE_BATCH	256
+#define D_HASH_MAX_BITS		30
+#define D_HASH_HIST_BINS	8
+
+static DEFINE_PER_CPU(unsigned int, d_hash_inserts);
+static DEFINE_MUTEX(d_hash_resize_mutex);
+static unsigned long d_hash_resizes;
+
+static unsigned int d_hash_target_bits(void)
+{
+	unsigned int bits = order_base_2(get_nr_dentry());
+
+	return clamp_t(unsigned int, bits, 32 - d_hash_boot.shift,
+		       D_HASH_MAX_BITS);
+}
+
+static void d_hash_resize_workfn(struct work_struct *work);
+static DECLARE_WORK(d_hash_resize_work, d_hash_resize_workfn);
+
+static void d_hash_check_load(void)
+{
+	unsigned long nr = get_nr_dentry();
+	unsigned int shift, bits;
+
+	rcu_read_lock();
+	shift = rcu_dereference(dentry_hashtable)->shift;
+	rcu_read_unlock();
+	bits = 32 - shift;
+
+	if ((nr > (2UL << bits) && bits < D_HASH_MAX_BITS) ||
+	    (shift < d_hash_boot.shift && nr < (1UL << bits) / 8))
+		queue_work(system_unbound_wq, &d_hash_resize_work);
+}
+
+static struct d_hash_table *d_hash_alloc(unsigned int bits)
+{
+	struct d_hash_table *tbl = kmalloc(sizeof(*tbl), GFP_KERNEL);
+
+	if (!tbl)
+		return NULL;
+	tbl->buckets = vzalloc(array_size(1UL << bits,
+					  sizeof(struct hlist_bl_head)));
+	if (!tbl->buckets) {
+		kfree(tbl);
+		return NULL;
+	}
+	tbl->shift = 32 - bits;
+	return tbl;
+}
+
+static void d_hash_free(struct d_hash_table *tbl)
+{
+	/* a boot table from memblock can't be given back */
+	if (is_vmalloc_addr(tbl->buckets))
+		vfree(tbl->buckets);
+	if (tbl != &d_hash_boot)
+		kfree(tbl);
+}
+
+/* Move the dentries of a locked old bucket to their buckets in @future */
+static void d_hash_migrate_bucket(struct hlist_bl_head *old,
+				  struct d_hash_table *future)
+{
+	struct hlist_bl_node *node;
+
+	while ((node = hlist_bl_first(old)) != NULL) {
+		struct dentry *dentry = hlist_bl_entry(node, struct dentry,
+						       d_hash);
+		struct hlist_bl_head *b;
+
+		b = future->buckets + (dentry->d_name.hash >> future->shift);
+		/* keeps d_hash.pprev set, so d_unhashed() doesn't flicker */
+		__hlist_bl_del(node);
+		hlist_bl_lock(b);
+		hlist_bl_add_head_rcu(node, b);
+		hlist_bl_unlock(b);
+	}
+}
+
+static void d_hash_resize(struct d_hash_table *future)
+{
+	struct d_hash_table *old;
+	unsigned long i, nr;
+
+	old = rcu_dereference_protected(dentry_hashtable,
+				lockdep_is_held(&d_hash_resize_mutex));
+	nr = 1UL << (32 - old->shift);
+
+	WRITE_ONCE(d_hash_migrated, 0);
+	rcu_assign_pointer(d_hash_future, future);
+
+	for (i = 0; i < nr; ) {
+		unsigned long end = min(i + D_HASH_MIGRATE_BATCH, nr);
+
+		/* lookups that raced with the move retry like after d_move() */
+		write_seqlock(&rename_lock);
+		for (; i < end; i++) {
+			struct hlist_bl_head *b = old->buckets + i;
+
+			hlist_bl_lock(b);
+			d_hash_migrate_bucket(b, future);
+			smp_store_release(&d_hash_migrated, i + 1);
+			hlist_bl_unlock(b);
+		}
+		write_sequnlock(&rename_lock);
+		cond_resched();
+	}
+
+	/* d_hash_lock() reads d_hash_future before dentry_hashtable */
+	write_seqlock(&rename_lock);
+	rcu_assign_pointer(dentry_hashtable, future);
+	smp_wmb();
+	RCU_INIT_POINTER(d_hash_future, NULL);
+	write_sequnlock(&rename_lock);
+
+	synchronize_rcu();
+	d_hash_free(old);
+	d_hash_resizes++;
+}
+
+static void d_hash_resize_workfn(struct work_struct *work)
+{
+	struct d_hash_table *tbl, *future;
+	unsigned int bits;
+
+	mutex_lock(&d_hash_resize_mutex);
+	tbl = rcu_dereference_protected(dentry_hashtable,
+				lockdep_is_held(&d_hash_resize_mutex));
+	bits = d_hash_target_bits();
+	if (bits == 32 - tbl->shift)
+		goto out;
+
+	future = d_hash_alloc(bits);
+	if (!future) {
+		pr_warn_ratelimited("VFS: can't resize dentry hash to %u buckets\n",
+				    1U << bits);
+		goto out;
+	}
+	d_hash_resize(future);
+out:
+	mutex_unlock(&d_hash_resize_mutex);
+}
+
+#ifdef CONFIG_DEBUG_FS
+/* /sys/kernel/debug/dcache/hash_stats: size and chain length histogram */
+static int d_hash_stats_show(struct seq_file *m, void *v)
+{
+	unsigned long hist[D_HASH_HIST_BINS] = { 0 };
+	unsigned long i, nr, entries = 0, longest = 0;
+	struct d_hash_table *tbl;
+	int bin;
+
+	mutex_lock(&d_hash_resize_mutex);
+	tbl = rcu_dereference_protected(dentry_hashtable,
+				lockdep_is_held(&d_hash_resize_mutex));
+	nr = 1UL << (32 - tbl->shift);
+	for (i = 0; i < nr; i++) {
+		struct hlist_bl_node *node;
+		struct dentry *dentry;
+		unsigned long len = 0;
+
+		rcu_read_lock();
+		hlist_bl_for_each_entry_rcu(dentry, node, tbl->buckets + i, d_hash)
+			len++;
+		rcu_read_unlock();
+
+		entries += len;
+		longest = max(longest, len);
+		hist[min_t(int, fls_long(len), D_HASH_HIST_BINS - 1)]++;
+		if (!(i % D_HASH_CHECK_INTERVAL))
+			cond_resched();
+	}
+	seq_printf(m, "buckets: %lu\nboot buckets: %lu\nresizes: %lu\n",
+		   nr, 1UL << (32 - d_hash_boot.shift), d_hash_resizes);
+	mutex_unlock(&d_hash_resize_mutex);
+
+	seq_printf(m, "entries: %lu\nlongest chain: %lu\n", entries, longest);
+	seq_puts(m, "chain length histogram:\n");
+	seq_printf(m, "  %6s: %lu\n", "0", hist[0]);
+	for (bin = 1; bin < D_HASH_HIST_BINS - 1; bin++)
+		seq_printf(m, "  %3lu-%-3lu: %lu\n", 1UL << (bin - 1),
+			   (1UL << bin) - 1, hist[bin]);
+	seq_printf(m, "  %5lu+: %lu\n", 1UL << (bin - 1), hist[bin]);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(d_hash_stats);
+
+static int __init d_hash_debugfs_init(void)
+{
+	struct dentry *dir = debugfs_create_dir("dcache", NULL);
+
+	debugfs_create_file("hash_stats", 0400, dir, NULL, &d_hash_stats_fops);
+	return 0;
+}
+late_initcall(d_hash_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
+
 /**
  * 添加 dentry 到 dentry_hashtable 中
  */
 static void __d_rehash(struct dentry *entry)
 {
-	struct hlist_bl_head *b = d_hash(entry->d_name.hash);
+	struct hlist_bl_head *b = d_hash_lock(entry->d_name.hash);
 
-	hlist_bl_lock(b);
 	hlist_bl_add_head_rcu(&entry->d_hash, b);
-	hlist_bl_unlock(b);
+	d_hash_unlock(b);
+
+	if (unlikely(!(this_cpu_inc_return(d_hash_inserts) &
+		       (D_HASH_CHECK_INTERVAL - 1))))
+		d_hash_check_load();
 }
 
 /**
@@ -3596,17 +3996,17 @@ static void __init dcache_init_early(void)
      *  每个文件都有 dentry 结构，所以说也不能叫做 目录哈希表
      *      荣涛 2021年11月13日21:41:03
      */
-	dentry_hashtable =
+	d_hash_boot.buckets =
 		alloc_large_system_hash("Dentry cache",
 					sizeof(struct hlist_bl_head),
 					dhash_entries,
 					13,
 					HASH_EARLY | HASH_ZERO,
-					&d_hash_shift,
+					&d_hash_boot.shift,
 					NULL,
 					0,
 					0);
-	d_hash_shift = 32 - d_hash_shift;
+	d_hash_boot.shift = 32 - d_hash_boot.shift;
 }
 /**
  * 文件目录缓存
@@ -3626,17 +4026,17 @@ static void __init dcache_init(void)
 	if (!hashdist)
 		return;
 
-	dentry_hashtable =
+	d_hash_boot.buckets =
 		alloc_large_system_hash("Dentry cache",
 					sizeof(struct hlist_bl_head),
 					dhash_entries,
 					13,
 					HASH_ZERO,
-					&d_hash_shift,
+					&d_hash_boot.shift,
 					NULL,
 					0,
 					0);
-	d_hash_shift = 32 - d_hash_shift;
+	d_hash_boot.shift = 32 - d_hash_boot.shift;
 }
 
 /* SLAB cache for __getname() consumers */
@@ -279,6 +279,12 @@ struct eventpoll {/* 这个结构是：file->pivate_data */
      */
 	/* used to track busy poll napi_id */
 	unsigned int napi_id;   /* 追踪忙碌 poll napi_id */
+	/* busy poll timeout, 0 falls back to net.core.busy_poll */
+	u32 busy_poll_usecs;
+	/* busy poll packet budget */
+	u16 busy_poll_budget;
+	/* keep device irqs deferred while busy polling */
+	bool prefer_busy_poll;
 #endif
 
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
@@ -469,11 +475,34 @@ static inline int ep_events_available(struct eventpoll *ep)
 /**
  *
  */
+/*
+ * Per epoll busy poll timeout, set with EPIOCSPARAMS. Falls back to the
+ * global net.core.busy_poll if the instance has none.
+ */
+static bool busy_loop_ep_timeout(unsigned long start_time,
+				 struct eventpoll *ep)
+{
+	unsigned long bp_usec = READ_ONCE(ep->busy_poll_usecs);
+
+	if (bp_usec) {
+		unsigned long end_time = start_time + bp_usec;
+		unsigned long now = busy_loop_current_time();
+
+		return time_after(now, end_time);
+	}
+	return busy_loop_timeout(start_time);
+}
+
+static bool ep_busy_loop_on(struct eventpoll *ep)
+{
+	return !!READ_ONCE(ep->busy_poll_usecs) || net_busy_loop_on();
+}
+
 static bool ep_busy_loop_end(void *p, unsigned long start_time)
 {
 	struct eventpoll *ep = p;
 
-	return ep_events_available(ep) /* 有可用的 event */|| busy_loop_timeout(start_time)/* 已超时 */;
+	return ep_events_available(ep) /* 有可用的 event */|| busy_loop_ep_timeout(start_time, ep)/* 已超时 */;
 }
 
 /*
@@ -489,15 +518,21 @@ static bool ep_busy_loop_end(void *p, unsigned long start_time)
 static void ep_busy_loop(struct eventpoll *ep, int nonblock)
 {
 	unsigned int napi_id = READ_ONCE(ep->napi_id);/* 获取 NAPI ID */
+	u16 budget = READ_ONCE(ep->busy_poll_budget);
+	bool prefer_busy_poll = READ_ONCE(ep->prefer_busy_poll);
+
+	if (!budget)
+		budget = BUSY_POLL_BUDGET;
 
     /**
      *  是否开启了 busy poll
      */
-	if ((napi_id >= MIN_NAPI_ID) && net_busy_loop_on())
+	if ((napi_id >= MIN_NAPI_ID) && ep_busy_loop_on(ep))
         /**
          *
          */
-		napi_busy_loop(napi_id, nonblock ? NULL : ep_busy_loop_end, ep);
+		napi_busy_loop(napi_id, nonblock ? NULL : ep_busy_loop_end, ep,
+			       prefer_busy_poll, budget);
 }
 
 static inline void ep_reset_busy_poll_napi_id(struct eventpoll *ep)
@@ -511,13 +546,13 @@ static inline void ep_reset_busy_poll_napi_id(struct eventpoll *ep)
  */
 static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
 {
-	struct eventpoll *ep;
+	struct eventpoll *ep = epi->ep;
 	unsigned int napi_id;
 	struct socket *sock;
 	struct sock *sk;
 	int err;
 
-	if (!net_busy_loop_on())
+	if (!ep_busy_loop_on(ep))
 		return;
 
     /**
@@ -538,7 +573,6 @@ static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
      *  读取 NAPI ID
      */
 	napi_id = READ_ONCE(sk->sk_napi_id);
-	ep = epi->ep;
 
 	/* Non-NAPI IDs can be rejected
 	 *	or
@@ -551,8 +585,58 @@ static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
 	ep->napi_id = napi_id;
 }
 
+static long ep_eventpoll_bp_ioctl(struct file *file, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct eventpoll *ep = file->private_data;
+	void __user *uarg = (void __user *)arg;
+	struct epoll_params epoll_params;
+
+	switch (cmd) {
+	case EPIOCSPARAMS:
+		if (copy_from_user(&epoll_params, uarg, sizeof(epoll_params)))
+			return -EFAULT;
+
+		/* pad byte must be zero */
+		if (epoll_params.__pad)
+			return -EINVAL;
+
+		if (epoll_params.busy_poll_usecs > S32_MAX)
+			return -EINVAL;
+
+		if (epoll_params.prefer_busy_poll > 1)
+			return -EINVAL;
+
+		/* large budgets let one poller starve the softirq path */
+		if (epoll_params.busy_poll_budget > NAPI_POLL_WEIGHT &&
+		    !capable(CAP_NET_ADMIN))
+			return -EPERM;
+
+		WRITE_ONCE(ep->busy_poll_usecs, epoll_params.busy_poll_usecs);
+		WRITE_ONCE(ep->busy_poll_budget, epoll_params.busy_poll_budget);
+		WRITE_ONCE(ep->prefer_busy_poll, epoll_params.prefer_busy_poll);
+		return 0;
+	case EPIOCGPARAMS:
+		memset(&epoll_params, 0, sizeof(epoll_params));
+		epoll_params.busy_poll_usecs = READ_ONCE(ep->busy_poll_usecs);
+		epoll_params.busy_poll_budget = READ_ONCE(ep->busy_poll_budget);
+		epoll_params.prefer_busy_poll = READ_ONCE(ep->prefer_busy_poll);
+		if (copy_to_user(uarg, &epoll_params, sizeof(epoll_params)))
+			return -EFAULT;
+		return 0;
+	default:
+		return -ENOIOCTLCMD;
+	}
+}
+
 #else
 
+static inline long ep_eventpoll_bp_ioctl(struct file *file, unsigned int cmd,
+					 unsigned long arg)
+{
+	return -EOPNOTSUPP;
+}
+
 #endif /* CONFIG_NET_RX_BUSY_POLL */
 
 /**
@@ -1110,6 +1194,18 @@ static __poll_t ep_eventpoll_poll(struct file *file, poll_table *wait)
 	return ep_scan_ready_list(ep, ep_read_events_proc, &depth, depth, false);
 }
 
+static long ep_eventpoll_ioctl(struct file *file, unsigned int cmd,
+			       unsigned long arg)
+{
+	switch (cmd) {
+	case EPIOCSPARAMS:
+	case EPIOCGPARAMS:
+		return ep_eventpoll_bp_ioctl(file, cmd, arg);
+	default:
+		return -EINVAL;
+	}
+}
+
 #ifdef CONFIG_PROC_FS
 static void ep_show_fdinfo(struct seq_file *m, struct file *f)/* 向 proc 文件系统写数据 */
 {
@@ -1149,6 +1245,8 @@ static const struct file_operations eventpoll_fops/* epoll 文件操作 */ = {
      */
 	eventpoll_fops.poll		    = ep_eventpoll_poll,    /* vfs_poll */
 	eventpoll_fops.llseek		= noop_llseek,  /* file->f_pos */
+	eventpoll_fops.unlocked_ioctl	= ep_eventpoll_ioctl,
+	eventpoll_fops.compat_ioctl	= compat_ptr_ioctl,
 };
 
 /*
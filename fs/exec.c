@@ -27,6 +27,7 @@
 #include <linux/slab.h>
 #include <linux/file.h>
 #include <linux/fdtable.h>
+#include <linux/prctl.h>
 #include <linux/mm.h>
 #include <linux/vmacache.h>
 #include <linux/stat.h>
@@ -1315,6 +1316,8 @@ int begin_new_exec(struct linux_binprm * bprm)  /* execve() */
 	 */
 
 	do_close_on_exec(me->files);
+	/* the new program expects POSIX fd numbers */
+	files_set_fd_alloc(me->files, PR_FD_ALLOC_LOWEST);
 
 	if (bprm->secureexec) {
 		/* Make sure parent cannot signal privileged process. */
@@ -112,6 +112,10 @@ struct ext4_fc_stats {
 	unsigned long fc_num_commits;
 	unsigned long fc_ineligible_commits;
 	unsigned long fc_numblks;
+	/* last recovery, time in ns */
+	unsigned long fc_replayed_tags;
+	u64 fc_replay_scan_time;
+	u64 fc_replay_time;
 };
 
 #define EXT4_FC_REPLAY_REALLOC_INCREMENT	4
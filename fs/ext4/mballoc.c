@@ -149,6 +149,19 @@
  * can be used for allocation. ext4_mb_good_group explains how the groups are
  * checked.
  *
+ * With the "mb_optimize_scan" mount option, cr 0 and cr 1 don't walk the
+ * groups linearly.  Initialized groups are kept on lists indexed by the
+ * order of their largest free extent (sbi->s_mb_largest_free_orders) and
+ * in an rb tree sorted by average free fragment size
+ * (sbi->s_mb_avg_fragment_size_root), both updated whenever the buddy of
+ * a group changes.  After the goal group, cr 0 picks a group from the
+ * first non-empty list of order >= ac_2order and cr 1 picks the group
+ * with the smallest average fragment size that still fits the request, so
+ * a suitable group is found without checking every group on large file
+ * systems.  Groups whose buddy isn't loaded yet are only found by cr 2/3.
+ * The effectiveness can be followed in /proc/fs/ext4/<partition>/mb_stats
+ * with /sys/fs/ext4/<partition>/mb_stats enabled.
+ *
  * Both the prealloc space are getting populated as above. So for the first
  * request we will hit the buddy cache which will result in this prealloc
  * space getting filled. The prealloc space is then later used for the
@@ -740,23 +753,89 @@ static void ext4_mb_mark_free_simple(struct super_block *sb,
 
 /*
  * Cache the order of the largest free extent we have available in this block
- * group.
+ * group, and keep the group on the matching cr 0 list.
  */
 static void
 mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 {
-	int i;
-	int bits;
-
-	grp->bb_largest_free_order = -1; /* uninit */
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int old = grp->bb_largest_free_order;
+	int i, new = -1; /* uninit */
 
-	bits = sb->s_blocksize_bits + 1;
-	for (i = bits; i >= 0; i--) {
+	for (i = MB_NUM_ORDERS(sb) - 1; i >= 0; i--) {
 		if (grp->bb_counters[i] > 0) {
-			grp->bb_largest_free_order = i;
+			new = i;
 			break;
 		}
 	}
+
+	if (!test_opt2(sb, MB_OPTIMIZE_SCAN)) {
+		grp->bb_largest_free_order = new;
+		return;
+	}
+
+	if (new == old && !list_empty(&grp->bb_largest_free_order_node))
+		return;
+
+	if (old >= 0 && !list_empty(&grp->bb_largest_free_order_node)) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[old]);
+		list_del_init(&grp->bb_largest_free_order_node);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[old]);
+	}
+	grp->bb_largest_free_order = new;
+	if (new >= 0 && grp->bb_free) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[new]);
+		list_add_tail(&grp->bb_largest_free_order_node,
+			      &sbi->s_mb_largest_free_orders[new]);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[new]);
+	}
+}
+
+static inline ext4_grpblk_t mb_avg_fragment_size(struct ext4_group_info *grp)
+{
+	return grp->bb_fragments ? grp->bb_free / grp->bb_fragments : 0;
+}
+
+/*
+ * Reposition the group in the cr 1 tree after its free space or number of
+ * fragments changed.  Groups without free space are left out.
+ */
+static void
+mb_update_avg_fragment_size(struct super_block *sb, struct ext4_group_info *grp)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct rb_node **n, *parent = NULL;
+	ext4_grpblk_t avg;
+
+	if (!test_opt2(sb, MB_OPTIMIZE_SCAN))
+		return;
+
+	write_lock(&sbi->s_mb_rb_lock);
+	if (!RB_EMPTY_NODE(&grp->bb_avg_fragment_size_rb)) {
+		rb_erase(&grp->bb_avg_fragment_size_rb,
+			 &sbi->s_mb_avg_fragment_size_root);
+		RB_CLEAR_NODE(&grp->bb_avg_fragment_size_rb);
+	}
+
+	if (grp->bb_free && grp->bb_fragments) {
+		avg = mb_avg_fragment_size(grp);
+		n = &sbi->s_mb_avg_fragment_size_root.rb_node;
+		while (*n) {
+			struct ext4_group_info *cur;
+
+			parent = *n;
+			cur = rb_entry(parent, struct ext4_group_info,
+				       bb_avg_fragment_size_rb);
+			if (avg < mb_avg_fragment_size(cur))
+				n = &(*n)->rb_left;
+			else
+				n = &(*n)->rb_right;
+		}
+		rb_link_node(&grp->bb_avg_fragment_size_rb, parent, n);
+		rb_insert_color(&grp->bb_avg_fragment_size_rb,
+				&sbi->s_mb_avg_fragment_size_root);
+	}
+	write_unlock(&sbi->s_mb_rb_lock);
 }
 
 static noinline_for_stack
@@ -806,6 +885,7 @@ void ext4_mb_generate_buddy(struct super_block *sb,
 					EXT4_GROUP_INFO_BBITMAP_CORRUPT);
 	}
 	mb_set_largest_free_order(sb, grp);
+	mb_update_avg_fragment_size(sb, grp);
 
 	clear_bit(EXT4_GROUP_INFO_NEED_INIT_BIT, &(grp->bb_state));
 
@@ -1536,6 +1616,7 @@ static void mb_free_blocks(struct inode *inode, struct ext4_buddy *e4b,
 
 done:
 	mb_set_largest_free_order(sb, e4b->bd_info);
+	mb_update_avg_fragment_size(sb, e4b->bd_info);
 	mb_check_buddy(e4b);
 }
 
@@ -1671,6 +1752,7 @@ static int mb_mark_used(struct ext4_buddy *e4b, struct ext4_free_extent *ex)
 		e4b->bd_info->bb_counters[ord]++;
 	}
 	mb_set_largest_free_order(e4b->bd_sb, e4b->bd_info);
+	mb_update_avg_fragment_size(e4b->bd_sb, e4b->bd_info);
 
 	ext4_set_bits(e4b->bd_bitmap, ex->fe_start, len0);
 	mb_check_buddy(e4b);
@@ -2165,6 +2247,8 @@ static int ext4_mb_good_group_nolock(struct ext4_allocation_context *ac,
 	ext4_grpblk_t free;
 	int ret = 0;
 
+	if (sbi->s_mb_stats)
+		atomic64_inc(&sbi->s_bal_cX_groups_considered[ac->ac_criteria]);
 	if (should_lock)
 		ext4_lock_group(sb, group);
 	free = grp->bb_free;
@@ -2289,11 +2373,139 @@ void ext4_mb_prefetch_fini(struct super_block *sb, ext4_group_t group,
 	}
 }
 
+static inline bool should_optimize_scan(struct ext4_allocation_context *ac)
+{
+	if (!test_opt2(ac->ac_sb, MB_OPTIMIZE_SCAN))
+		return false;
+	if (ac->ac_criteria >= 2)
+		return false;
+	/* the lists don't know about s_blockfile_groups */
+	if (!ext4_test_inode_flag(ac->ac_inode, EXT4_INODE_EXTENTS))
+		return false;
+	return true;
+}
+
+/*
+ * cr 0: pick the first group on the list of the smallest order that can hold
+ * the request.  A group that turned out to be unusable is moved to another
+ * list by mb_set_largest_free_order() if its buddy changed meanwhile.
+ */
+static void ext4_mb_choose_next_group_cr0(struct ext4_allocation_context *ac,
+					  int *new_cr, ext4_group_t *group)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(ac->ac_sb);
+	struct ext4_group_info *iter, *grp = NULL;
+	int i;
+
+	if (unlikely(sbi->s_mb_stats && (ac->ac_flags & EXT4_MB_CR_OPTIMIZED)))
+		atomic_inc(&sbi->s_bal_cr0_bad_suggestions);
+
+	for (i = ac->ac_2order; i < MB_NUM_ORDERS(ac->ac_sb); i++) {
+		if (list_empty(&sbi->s_mb_largest_free_orders[i]))
+			continue;
+		read_lock(&sbi->s_mb_largest_free_orders_locks[i]);
+		list_for_each_entry(iter, &sbi->s_mb_largest_free_orders[i],
+				    bb_largest_free_order_node) {
+			if (ext4_mb_good_group(ac, iter->bb_group, 0)) {
+				grp = iter;
+				break;
+			}
+		}
+		read_unlock(&sbi->s_mb_largest_free_orders_locks[i]);
+		if (grp)
+			break;
+	}
+
+	if (!grp) {
+		*new_cr = 1;
+		return;
+	}
+	*group = grp->bb_group;
+	ac->ac_last_optimal_group = *group;
+	ac->ac_flags |= EXT4_MB_CR_OPTIMIZED;
+}
+
+/*
+ * cr 1: pick the group with the smallest average fragment size that is
+ * still >= the goal length.  If the previous pick didn't satisfy the
+ * request and its buddy didn't change, continue after it instead of
+ * scanning it again.
+ */
+static void ext4_mb_choose_next_group_cr1(struct ext4_allocation_context *ac,
+					  int *new_cr, ext4_group_t *group)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(ac->ac_sb);
+	struct ext4_group_info *cur, *grp = NULL;
+	struct rb_node *n, *found = NULL;
+
+	read_lock(&sbi->s_mb_rb_lock);
+	if (ac->ac_flags & EXT4_MB_CR_OPTIMIZED) {
+		if (sbi->s_mb_stats)
+			atomic_inc(&sbi->s_bal_cr1_bad_suggestions);
+		cur = ext4_get_group_info(ac->ac_sb, ac->ac_last_optimal_group);
+		if (!RB_EMPTY_NODE(&cur->bb_avg_fragment_size_rb))
+			found = rb_next(&cur->bb_avg_fragment_size_rb);
+	}
+
+	if (!found) {
+		n = sbi->s_mb_avg_fragment_size_root.rb_node;
+		while (n) {
+			cur = rb_entry(n, struct ext4_group_info,
+				       bb_avg_fragment_size_rb);
+			if (mb_avg_fragment_size(cur) >= ac->ac_g_ex.fe_len) {
+				found = n;
+				n = n->rb_left;
+			} else {
+				n = n->rb_right;
+			}
+		}
+	}
+
+	for (n = found; n; n = rb_next(n)) {
+		cur = rb_entry(n, struct ext4_group_info,
+			       bb_avg_fragment_size_rb);
+		if (ext4_mb_good_group(ac, cur->bb_group, 1)) {
+			grp = cur;
+			break;
+		}
+	}
+	read_unlock(&sbi->s_mb_rb_lock);
+
+	if (!grp) {
+		*new_cr = 2;
+		return;
+	}
+	*group = grp->bb_group;
+	ac->ac_last_optimal_group = *group;
+	ac->ac_flags |= EXT4_MB_CR_OPTIMIZED;
+}
+
+/*
+ * Pick the group to try after @group at the current criteria, or move on to
+ * the next criteria in @new_cr if the optimized scan has nothing left.
+ */
+static void ext4_mb_choose_next_group(struct ext4_allocation_context *ac,
+				      int *new_cr, ext4_group_t *group)
+{
+	*new_cr = ac->ac_criteria;
+
+	if (!should_optimize_scan(ac)) {
+		/* the caller wraps around at ngroups */
+		(*group)++;
+		return;
+	}
+
+	if (*new_cr == 0)
+		ext4_mb_choose_next_group_cr0(ac, new_cr, group);
+	else
+		ext4_mb_choose_next_group_cr1(ac, new_cr, group);
+}
+
 static noinline_for_stack int
 ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 {
 	ext4_group_t prefetch_grp = 0, ngroups, group, i;
-	int cr = -1;
+	int cr = -1, new_cr;
 	int err = 0, first_err = 0;
 	unsigned int nr = 0, prefetch_ios = 0;
 	struct ext4_sb_info *sbi;
@@ -2359,6 +2571,7 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 repeat:
 	for (; cr < 4 && ac->ac_status == AC_STATUS_CONTINUE; cr++) {
 		ac->ac_criteria = cr;
+		ac->ac_flags &= ~EXT4_MB_CR_OPTIMIZED;
 		/*
 		 * searching for the right group start
 		 * from the goal value specified
@@ -2366,9 +2579,16 @@ repeat:
 		group = ac->ac_g_ex.fe_group;
 		prefetch_grp = group;
 
-		for (i = 0; i < ngroups; group++, i++) {
+		for (i = 0, new_cr = cr; i < ngroups; i++,
+		     ext4_mb_choose_next_group(ac, &new_cr, &group)) {
 			int ret = 0;
 			cond_resched();
+			if (new_cr != cr) {
+				if (sbi->s_mb_stats)
+					atomic64_inc(&sbi->s_bal_cX_failed[cr]);
+				cr = new_cr;
+				goto repeat;
+			}
 			/*
 			 * Artificially restricted ngroups for non-extent
 			 * files makes group > ngroups possible on first loop.
@@ -2439,6 +2659,9 @@ repeat:
 			if (ac->ac_status != AC_STATUS_CONTINUE)
 				break;
 		}
+		/* Processed all groups and haven't found blocks */
+		if (sbi->s_mb_stats && i == ngroups)
+			atomic64_inc(&sbi->s_bal_cX_failed[cr]);
 	}
 
 	if (ac->ac_b_ex.fe_len > 0 && ac->ac_status != AC_STATUS_FOUND &&
@@ -2567,6 +2790,59 @@ const struct seq_operations ext4_mb_seq_groups_ops = {
 	.show   = ext4_mb_seq_groups_show,
 };
 
+int ext4_seq_mb_stats_show(struct seq_file *seq, void *offset)
+{
+	struct super_block *sb = seq->private;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int cr;
+
+	seq_puts(seq, "mballoc:\n");
+	if (!sbi->s_mb_stats) {
+		seq_puts(seq, "\tmb stats collection turned off.\n");
+		seq_puts(seq, "\tTo enable, please write \"1\" to sysfs file mb_stats.\n");
+		return 0;
+	}
+	seq_printf(seq, "\treqs: %u\n", atomic_read(&sbi->s_bal_reqs));
+	seq_printf(seq, "\tsuccess: %u\n", atomic_read(&sbi->s_bal_success));
+	seq_printf(seq, "\tallocated: %u\n",
+		   atomic_read(&sbi->s_bal_allocated));
+	seq_printf(seq, "\textents_scanned: %u\n",
+		   atomic_read(&sbi->s_bal_ex_scanned));
+	seq_printf(seq, "\t\tgoal_hits: %u\n", atomic_read(&sbi->s_bal_goals));
+	seq_printf(seq, "\t\t2^n_hits: %u\n", atomic_read(&sbi->s_bal_2orders));
+	seq_printf(seq, "\t\tbreaks: %u\n", atomic_read(&sbi->s_bal_breaks));
+	seq_printf(seq, "\t\tlost: %u\n",
+		   atomic_read(&sbi->s_mb_lost_chunks));
+
+	seq_printf(seq, "\toptimize_scan: %d\n",
+		   test_opt2(sb, MB_OPTIMIZE_SCAN) ? 1 : 0);
+	for (cr = 0; cr < 4; cr++) {
+		seq_printf(seq, "\tcr%d_stats:\n", cr);
+		seq_printf(seq, "\t\thits: %lld\n",
+			   atomic64_read(&sbi->s_bal_cX_hits[cr]));
+		seq_printf(seq, "\t\tgroups_considered: %lld\n",
+			   atomic64_read(&sbi->s_bal_cX_groups_considered[cr]));
+		seq_printf(seq, "\t\tuseless_loops: %lld\n",
+			   atomic64_read(&sbi->s_bal_cX_failed[cr]));
+		if (cr == 0)
+			seq_printf(seq, "\t\tbad_suggestions: %u\n",
+				   atomic_read(&sbi->s_bal_cr0_bad_suggestions));
+		else if (cr == 1)
+			seq_printf(seq, "\t\tbad_suggestions: %u\n",
+				   atomic_read(&sbi->s_bal_cr1_bad_suggestions));
+	}
+
+	seq_printf(seq, "\tbuddies_generated: %lu\n",
+		   sbi->s_mb_buddies_generated);
+	seq_printf(seq, "\tbuddies_time_used: %llu\n",
+		   sbi->s_mb_generation_time);
+	seq_printf(seq, "\tpreallocated: %u\n",
+		   atomic_read(&sbi->s_mb_preallocated));
+	seq_printf(seq, "\tdiscarded: %u\n",
+		   atomic_read(&sbi->s_mb_discarded));
+	return 0;
+}
+
 static struct kmem_cache *get_groupinfo_cache(int blocksize_bits)
 {
 	int cache_index = blocksize_bits - EXT4_MIN_BLOCK_LOG_SIZE;
@@ -2669,7 +2945,10 @@ int ext4_mb_add_groupinfo(struct super_block *sb, ext4_group_t group,
 	INIT_LIST_HEAD(&meta_group_info[i]->bb_prealloc_list);
 	init_rwsem(&meta_group_info[i]->alloc_sem);
 	meta_group_info[i]->bb_free_root = RB_ROOT;
+	INIT_LIST_HEAD(&meta_group_info[i]->bb_largest_free_order_node);
+	RB_CLEAR_NODE(&meta_group_info[i]->bb_avg_fragment_size_rb);
 	meta_group_info[i]->bb_largest_free_order = -1;  /* uninit */
+	meta_group_info[i]->bb_group = group;
 
 	mb_group_bb_bitmap_alloc(sb, meta_group_info[i], group);
 	return 0;
@@ -2857,7 +3136,28 @@ int ext4_mb_init(struct super_block *sb)
 		offset_incr = offset_incr >> 1;
 		max = max >> 1;
 		i++;
-	} while (i <= sb->s_blocksize_bits + 1);
+	} while (i < MB_NUM_ORDERS(sb));
+
+	sbi->s_mb_avg_fragment_size_root = RB_ROOT;
+	rwlock_init(&sbi->s_mb_rb_lock);
+	sbi->s_mb_largest_free_orders =
+		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(struct list_head),
+			      GFP_KERNEL);
+	if (!sbi->s_mb_largest_free_orders) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	sbi->s_mb_largest_free_orders_locks =
+		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(rwlock_t),
+			      GFP_KERNEL);
+	if (!sbi->s_mb_largest_free_orders_locks) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < MB_NUM_ORDERS(sb); i++) {
+		INIT_LIST_HEAD(&sbi->s_mb_largest_free_orders[i]);
+		rwlock_init(&sbi->s_mb_largest_free_orders_locks[i]);
+	}
 
 	spin_lock_init(&sbi->s_md_lock);
 	spin_lock_init(&sbi->s_bal_lock);
@@ -2922,6 +3222,10 @@ out_free_locality_groups:
 	free_percpu(sbi->s_locality_groups);
 	sbi->s_locality_groups = NULL;
 out:
+	kfree(sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = NULL;
+	kfree(sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = NULL;
 	kfree(sbi->s_mb_offsets);
 	sbi->s_mb_offsets = NULL;
 	kfree(sbi->s_mb_maxs);
@@ -2978,6 +3282,8 @@ int ext4_mb_release(struct super_block *sb)
 		kvfree(group_info);
 		rcu_read_unlock();
 	}
+	kfree(sbi->s_mb_largest_free_orders);
+	kfree(sbi->s_mb_largest_free_orders_locks);
 	kfree(sbi->s_mb_offsets);
 	kfree(sbi->s_mb_maxs);
 	iput(sbi->s_buddy_cache);
@@ -2995,6 +3301,14 @@ int ext4_mb_release(struct super_block *sb)
 				atomic_read(&sbi->s_bal_2orders),
 				atomic_read(&sbi->s_bal_breaks),
 				atomic_read(&sbi->s_mb_lost_chunks));
+		ext4_msg(sb, KERN_INFO,
+		       "mballoc: cr0 %lld hits/%lld failed, cr1 %lld hits/%lld failed, %u/%u bad suggestions",
+				atomic64_read(&sbi->s_bal_cX_hits[0]),
+				atomic64_read(&sbi->s_bal_cX_failed[0]),
+				atomic64_read(&sbi->s_bal_cX_hits[1]),
+				atomic64_read(&sbi->s_bal_cX_failed[1]),
+				atomic_read(&sbi->s_bal_cr0_bad_suggestions),
+				atomic_read(&sbi->s_bal_cr1_bad_suggestions));
 		ext4_msg(sb, KERN_INFO,
 		       "mballoc: %lu generated and it took %Lu",
 				sbi->s_mb_buddies_generated,
@@ -3604,6 +3918,8 @@ static void ext4_mb_collect_stats(struct ext4_allocation_context *ac)
 			atomic_inc(&sbi->s_bal_goals);
 		if (ac->ac_found > sbi->s_mb_max_to_scan)
 			atomic_inc(&sbi->s_bal_breaks);
+		if (ac->ac_status == AC_STATUS_FOUND)
+			atomic64_inc(&sbi->s_bal_cX_hits[ac->ac_criteria]);
 	}
 
 	if (ac->ac_op == EXT4_MB_HISTORY_ALLOC)
@@ -20,6 +20,7 @@
 #include <linux/spinlock.h>
 #include <linux/rcupdate.h>
 #include <linux/close_range.h>
+#include <linux/prctl.h>
 #include <net/sock.h>
 
 unsigned int __read_mostly sysctl_nr_open  = 1024*1024;//cat /proc/sys/fs/nr_open
@@ -67,24 +68,63 @@ static void copy_fd_bitmaps(struct fdtable *nfdt, struct fdtable *ofdt,
 	memset((char *)nfdt->full_fds_bits + cpy, 0, set);
 }
 
+/* file pointers copied per file_lock hold while expanding a table */
+#define FDTABLE_COPY_CHUNK	8192
+
 /*
  * Copy all file descriptors from the old table to the new, expanded table and
- * clear the extra space.  Called with the files spinlock held for write.
+ * clear the extra space.  Called with the files spinlock held for write and
+ * resize_in_progress set.
+ *
+ * The fd array of a process with millions of files is tens of megabytes, so
+ * it is copied in chunks with file_lock dropped in between; fd_slot_assign()
+ * mirrors changes to already copied slots into the new table meanwhile.  The
+ * bitmaps are an eighth of that and are copied at the end in one go.
  */
-static void copy_fdtable(struct fdtable *nfdt, struct fdtable *ofdt)
+static void copy_fdtable(struct files_struct *files, struct fdtable *nfdt,
+			 struct fdtable *ofdt)
+	__releases(files->file_lock)
+	__acquires(files->file_lock)
 {
-	size_t cpy, set;
+	unsigned int copied, n;
+	size_t set;
 
 	BUG_ON(nfdt->max_fds < ofdt->max_fds);
 
-	cpy = ofdt->max_fds * sizeof(struct file *);
+	files->resize_fdt = nfdt;
+	for (copied = 0; copied < ofdt->max_fds; copied += n) {
+		n = min_t(unsigned int, ofdt->max_fds - copied, FDTABLE_COPY_CHUNK);
+		memcpy(nfdt->fd + copied, ofdt->fd + copied,
+		       n * sizeof(struct file *));
+		files->resize_copied = copied + n;
+		if (copied + n < ofdt->max_fds) {
+			spin_unlock(&files->file_lock);
+			cond_resched();
+			spin_lock(&files->file_lock);
+		}
+	}
+	files->resize_fdt = NULL;
+	files->resize_copied = 0;
+
 	set = (nfdt->max_fds - ofdt->max_fds) * sizeof(struct file *);
-	memcpy(nfdt->fd, ofdt->fd, cpy);
-	memset((char *)nfdt->fd + cpy, 0, set);
+	memset(nfdt->fd + ofdt->max_fds, 0, set);
 
 	copy_fd_bitmaps(nfdt, ofdt, ofdt->max_fds);
 }
 
+/*
+ * Set an fd slot of the current table with file_lock held, see
+ * copy_fdtable().
+ */
+static inline void fd_slot_assign(struct files_struct *files,
+				  struct fdtable *fdt, unsigned int fd,
+				  struct file *file)
+{
+	rcu_assign_pointer(fdt->fd[fd], file);
+	if (unlikely(files->resize_fdt) && fd < files->resize_copied)
+		rcu_assign_pointer(files->resize_fdt->fd[fd], file);
+}
+
 static struct fdtable * alloc_fdtable(unsigned int nr)
 {
 	struct fdtable *fdt;
@@ -176,7 +216,7 @@ static int expand_fdtable(struct files_struct *files, unsigned int nr)
 	}
 	cur_fdt = files_fdtable(files);
 	BUG_ON(nr < cur_fdt->max_fds);
-	copy_fdtable(new_fdt, cur_fdt);
+	copy_fdtable(files, new_fdt, cur_fdt);
 	rcu_assign_pointer(files->fdt, new_fdt);
 	if (cur_fdt != &files->fdtab)
 		call_rcu(&cur_fdt->rcu, free_fdtable_rcu);
@@ -228,15 +268,19 @@ repeat:
 	return expanded;
 }
 
+/*
+ * Atomic: alloc_fd_reserved() updates bits of its fds without file_lock,
+ * possibly in the same word.
+ */
 static inline void __set_close_on_exec(unsigned int fd, struct fdtable *fdt)
 {
-	__set_bit(fd, fdt->close_on_exec);
+	set_bit(fd, fdt->close_on_exec);
 }
 
 static inline void __clear_close_on_exec(unsigned int fd, struct fdtable *fdt)
 {
 	if (test_bit(fd, fdt->close_on_exec))
-		__clear_bit(fd, fdt->close_on_exec);
+		clear_bit(fd, fdt->close_on_exec);
 }
 
 static inline void __set_open_fd(unsigned int fd, struct fdtable *fdt)
@@ -300,6 +344,16 @@ struct files_struct *dup_fd(struct files_struct *oldf, unsigned int max_fds, int
 	newf->resize_in_progress = false;
 	init_waitqueue_head(&newf->resize_wait);
 	newf->next_fd = 0;
+	newf->resize_fdt = NULL;
+	newf->resize_copied = 0;
+	/*
+	 * the allocation policy is inherited across fork(), the reserved fds
+	 * are not; execve() goes back to PR_FD_ALLOC_LOWEST
+	 */
+	RCU_INIT_POINTER(newf->fd_reserve, NULL);
+	if (rcu_access_pointer(oldf->fd_reserve))
+		RCU_INIT_POINTER(newf->fd_reserve,
+				 alloc_percpu(struct fd_reserve));
 	new_fdt = &newf->fdtab;
 	new_fdt->max_fds = NR_OPEN_DEFAULT;
 	new_fdt->close_on_exec = newf->close_on_exec_init;
@@ -373,6 +427,7 @@ struct files_struct *dup_fd(struct files_struct *oldf, unsigned int max_fds, int
 	return newf;
 
 out_release:
+	free_percpu(rcu_dereference_raw(newf->fd_reserve));
 	kmem_cache_free(files_cachep, newf);
 out:
 	return NULL;
@@ -434,6 +489,7 @@ void put_files_struct(struct files_struct *files)
 		/* free the arrays if they are not embedded */
 		if (fdt != &files->fdtab)
 			__free_fdtable(fdt);
+		free_percpu(rcu_dereference_raw(files->fd_reserve));
 		kmem_cache_free(files_cachep, files);
 	}
 }
@@ -484,6 +540,12 @@ static unsigned int find_next_fd(struct fdtable *fdt, unsigned int start)
 	unsigned int maxfd = fdt->max_fds;
 	unsigned int maxbit = maxfd / BITS_PER_LONG;
 	unsigned int bitbit = start / BITS_PER_LONG;
+	unsigned int bit = start % BITS_PER_LONG;
+	unsigned long word = ~fdt->open_fds[bitbit] >> bit;
+
+	/* usually there is a free fd in the word next_fd points into */
+	if (word)
+		return start + __ffs(word);
 
 	bitbit = find_next_zero_bit(fdt->full_fds_bits, maxbit, bitbit) * BITS_PER_LONG;
 	if (bitbit > maxfd)
@@ -493,11 +555,134 @@ static unsigned int find_next_fd(struct fdtable *fdt, unsigned int start)
 	return find_next_zero_bit(fdt->open_fds, maxfd, start);
 }
 
+/*
+ * PR_FD_ALLOC_PERCPU: open() and friends may return any free fd, so each CPU
+ * takes all free fds of one open_fds word with file_lock held, and hands them
+ * out without it.  Until then they look like fds between alloc and
+ * fd_install() and fork() doesn't copy them, but dup2() onto one takes it back
+ * from the reservation.  The mask is only changed atomically, as dup2() can do
+ * that from another CPU.  The mode survives fork() but not execve(), which
+ * drops the reservations.
+ */
+static int alloc_fd_reserved(struct files_struct *files, unsigned int end,
+			     unsigned int flags)
+{
+	struct fd_reserve __percpu *pcp;
+	struct fd_reserve *r;
+	struct fdtable *fdt;
+	unsigned long mask;
+	unsigned int fd;
+
+	rcu_read_lock_sched();
+	pcp = rcu_dereference_sched(files->fd_reserve);
+	/* expand_fdtable() copies close_on_exec, see __fd_install() */
+	if (!pcp || unlikely(files->resize_in_progress))
+		goto fallback;
+	r = this_cpu_ptr(pcp);
+	do {
+		mask = READ_ONCE(r->mask);
+		if (!mask)
+			goto fallback;
+		fd = r->base + __ffs(mask);
+		/* RLIMIT_NOFILE was lowered, let the locked path drop the reserve */
+		if (fd >= end)
+			goto fallback;
+	} while (cmpxchg(&r->mask, mask, mask & (mask - 1)) != mask);
+
+	/* coupled with smp_wmb() in expand_fdtable() */
+	smp_rmb();
+	fdt = rcu_dereference_sched(files->fdt);
+	if (flags & O_CLOEXEC)
+		__set_close_on_exec(fd, fdt);
+	else
+		__clear_close_on_exec(fd, fdt);
+	rcu_read_unlock_sched();
+	return fd;
+
+fallback:
+	rcu_read_unlock_sched();
+	return -EAGAIN;
+}
+
+/* Give the unused fds of a reservation back.  Called with file_lock held. */
+static void fd_reserve_release(struct files_struct *files,
+			       struct fd_reserve *r)
+{
+	struct fdtable *fdt = files_fdtable(files);
+	unsigned long mask = xchg(&r->mask, 0);
+
+	while (mask) {
+		unsigned int fd = r->base + __ffs(mask);
+
+		__clear_open_fd(fd, fdt);
+		if (fd < files->next_fd)
+			files->next_fd = fd;
+		mask &= mask - 1;
+	}
+}
+
+/*
+ * Take @fd, which is marked open but has no file, back if it's still in the
+ * reservation of some CPU.  Called with file_lock held, which keeps ->base
+ * stable.
+ */
+static bool fd_reserve_reclaim(struct files_struct *files, unsigned int fd)
+{
+	struct fd_reserve __percpu *pcp;
+	unsigned int base = round_down(fd, BITS_PER_LONG);
+	int cpu;
+
+	pcp = rcu_dereference_protected(files->fd_reserve,
+					lockdep_is_held(&files->file_lock));
+	if (!pcp)
+		return false;
+
+	for_each_possible_cpu(cpu) {
+		struct fd_reserve *r = per_cpu_ptr(pcp, cpu);
+
+		if (r->base == base && test_and_clear_bit(fd - base, &r->mask))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Reserve the other free fds in the word of @fd, which was just allocated, for
+ * this CPU.  Called with file_lock held.
+ */
+static void fd_reserve_refill(struct files_struct *files, struct fdtable *fdt,
+			      unsigned int fd, unsigned int end)
+{
+	struct fd_reserve __percpu *pcp;
+	struct fd_reserve *r;
+	unsigned int word = fd / BITS_PER_LONG;
+	unsigned int base = word * BITS_PER_LONG;
+	unsigned long mask;
+
+	pcp = rcu_dereference_protected(files->fd_reserve,
+					lockdep_is_held(&files->file_lock));
+	if (!pcp)
+		return;
+
+	r = get_cpu_ptr(pcp);
+	fd_reserve_release(files, r);
+	mask = ~fdt->open_fds[word];
+	if (end - base < BITS_PER_LONG)
+		mask &= BIT(end - base) - 1;
+	if (mask) {
+		fdt->open_fds[word] |= mask;
+		__set_bit(word, fdt->full_fds_bits);
+		r->base = base;
+		r->mask = mask;
+	}
+	put_cpu_ptr(pcp);
+}
+
 /*
  * allocate a file descriptor, mark it busy.分配一个 FD
  */
-int __alloc_fd(struct files_struct *files,
-	       unsigned start, unsigned end, unsigned flags)
+static int do_alloc_fd(struct files_struct *files, unsigned int start,
+		       unsigned int end, unsigned int flags, bool reserve)
 {
 	unsigned int fd;
 	int error;
@@ -550,12 +735,14 @@ repeat:
 		__set_close_on_exec(fd, fdt);
 	else
 		__clear_close_on_exec(fd, fdt);
+	if (reserve)
+		fd_reserve_refill(files, fdt, fd, end);
 	error = fd;
 #if 1
 	/* Sanity check 健全检测 */
 	if (rcu_access_pointer(fdt->fd[fd]) != NULL) {
 		printk(KERN_WARNING "alloc_fd: slot %d not NULL!\n", fd);
-		rcu_assign_pointer(fdt->fd[fd], NULL);
+		fd_slot_assign(files, fdt, fd, NULL);
 	}
 #endif
 
@@ -564,6 +751,12 @@ out:
 	return error;
 }
 
+int __alloc_fd(struct files_struct *files,
+	       unsigned start, unsigned end, unsigned flags)
+{
+	return do_alloc_fd(files, start, end, flags, false);
+}
+
 static int alloc_fd(unsigned start, unsigned flags)
 {
 	return __alloc_fd(current->files, start, rlimit(RLIMIT_NOFILE), flags);
@@ -574,8 +767,14 @@ static int alloc_fd(unsigned start, unsigned flags)
  */
 int __get_unused_fd_flags(unsigned flags, unsigned long nofile)
 {
+	struct files_struct *files = current->files;
+	int fd;
+
+	fd = alloc_fd_reserved(files, nofile, flags);
+	if (fd >= 0)
+		return fd;
 	/* 分配一个 FD */
-	return __alloc_fd(current->files, 0, nofile, flags);
+	return do_alloc_fd(files, 0, nofile, flags, true);
 }
 
 /**
@@ -608,6 +807,52 @@ void put_unused_fd(unsigned int fd)
 
 EXPORT_SYMBOL(put_unused_fd);
 
+int files_set_fd_alloc(struct files_struct *files, unsigned long mode)
+{
+	struct fd_reserve __percpu *pcp, *old;
+	int cpu;
+
+	switch (mode) {
+	case PR_FD_ALLOC_PERCPU:
+		pcp = alloc_percpu(struct fd_reserve);
+		if (!pcp)
+			return -ENOMEM;
+		spin_lock(&files->file_lock);
+		old = rcu_dereference_protected(files->fd_reserve,
+					lockdep_is_held(&files->file_lock));
+		if (!old)
+			rcu_assign_pointer(files->fd_reserve, pcp);
+		spin_unlock(&files->file_lock);
+		if (old)
+			free_percpu(pcp);
+		return 0;
+	case PR_FD_ALLOC_LOWEST:
+		spin_lock(&files->file_lock);
+		old = rcu_dereference_protected(files->fd_reserve,
+					lockdep_is_held(&files->file_lock));
+		RCU_INIT_POINTER(files->fd_reserve, NULL);
+		spin_unlock(&files->file_lock);
+		if (!old)
+			return 0;
+
+		/* wait for alloc_fd_reserved() callers still using it */
+		synchronize_rcu();
+		spin_lock(&files->file_lock);
+		for_each_possible_cpu(cpu)
+			fd_reserve_release(files, per_cpu_ptr(old, cpu));
+		spin_unlock(&files->file_lock);
+		free_percpu(old);
+		return 0;
+	}
+	return -EINVAL;
+}
+
+int files_get_fd_alloc(struct files_struct *files)
+{
+	return rcu_access_pointer(files->fd_reserve) ?
+		PR_FD_ALLOC_PERCPU : PR_FD_ALLOC_LOWEST;
+}
+
 /*
  * Install a file pointer in the fd array.
  *
@@ -644,7 +889,7 @@ void __fd_install(struct files_struct *files, unsigned int fd,
          */
 		fdt = files_fdtable(files); /* fdt = files->fdt */
 		BUG_ON(fdt->fd[fd] != NULL);
-		rcu_assign_pointer(fdt->fd[fd], file);/* fdt->fd[fd] = file */
+		fd_slot_assign(files, fdt, fd, file);/* fdt->fd[fd] = file */
 		spin_unlock(&files->file_lock);
 		return;
 	}
@@ -687,7 +932,7 @@ static struct file *pick_file(struct files_struct *files, unsigned fd)
 	file = fdt->fd[fd];
 	if (!file)
 		goto out_unlock;
-	rcu_assign_pointer(fdt->fd[fd], NULL);
+	fd_slot_assign(files, fdt, fd, NULL);
 	__put_unused_fd(files, fd);
 
 out_unlock:
@@ -810,7 +1055,7 @@ int __close_fd_get_file(unsigned int fd, struct file **res)
 	file = fdt->fd[fd];
 	if (!file)
 		goto out_unlock;
-	rcu_assign_pointer(fdt->fd[fd], NULL);
+	fd_slot_assign(files, fdt, fd, NULL);
 	__put_unused_fd(files, fd);
 	spin_unlock(&files->file_lock);
 	get_file(file);
@@ -847,7 +1092,7 @@ void do_close_on_exec(struct files_struct *files)
 			file = fdt->fd[fd];
 			if (!file)
 				continue;
-			rcu_assign_pointer(fdt->fd[fd], NULL);
+			fd_slot_assign(files, fdt, fd, NULL);
 			__put_unused_fd(files, fd);
 			spin_unlock(&files->file_lock);
 			filp_close(file, files);
@@ -1044,10 +1289,10 @@ __releases(&files->file_lock)
 	 */
 	fdt = files_fdtable(files);
 	tofree = fdt->fd[fd];
-	if (!tofree && fd_is_open(fd, fdt))
+	if (!tofree && fd_is_open(fd, fdt) && !fd_reserve_reclaim(files, fd))
 		goto Ebusy;
 	get_file(file);
-	rcu_assign_pointer(fdt->fd[fd], file);
+	fd_slot_assign(files, fdt, fd, file);
 	__set_open_fd(fd, fdt);
 	if (flags & O_CLOEXEC)
 		__set_close_on_exec(fd, fdt);
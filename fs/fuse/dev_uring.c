@@ -0,0 +1,723 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE request transport over io_uring.
+ *
+ * Instead of reading requests from /dev/fuse and writing replies back, the
+ * server parks IORING_OP_URING_CMD commands on the device, one per buffer,
+ * on the queue of each CPU.  A request issued on a CPU is copied into the
+ * buffer of a command parked on that CPU's queue, which completes the
+ * command.  The server replies by submitting the next command on the same
+ * buffer, which commits the reply and parks the buffer for the next request.
+ *
+ * Each queue has its own lock, so neither the fiq lock nor a read/write
+ * system call is on the request path.  FORGET and INTERRUPT requests and
+ * notifications still go through /dev/fuse.
+ */
+
+#include "fuse_i.h"
+#include "fuse_dev_i.h"
+#include "dev_uring_i.h"
+
+#include <linux/uio.h>
+#include <linux/compat.h>
+#include <linux/io_uring/cmd.h>
+
+/* header and payload buffer */
+#define FUSE_URING_IOV_SEGS 2
+
+struct fuse_uring_pdu {
+	struct fuse_ring_ent *ent;
+};
+
+static struct fuse_ring_ent *uring_cmd_to_ring_ent(struct io_uring_cmd *cmd)
+{
+	struct fuse_uring_pdu *pdu =
+		io_uring_cmd_to_pdu(cmd, struct fuse_uring_pdu);
+
+	return pdu->ent;
+}
+
+static void uring_cmd_set_ring_ent(struct io_uring_cmd *cmd,
+				   struct fuse_ring_ent *ent)
+{
+	struct fuse_uring_pdu *pdu =
+		io_uring_cmd_to_pdu(cmd, struct fuse_uring_pdu);
+
+	pdu->ent = ent;
+}
+
+static struct fuse_ring *fuse_uring_create(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL_ACCOUNT);
+	if (!ring)
+		return NULL;
+
+	ring->queues = kcalloc(nr_cpu_ids, sizeof(struct fuse_ring_queue *),
+			       GFP_KERNEL_ACCOUNT);
+	if (!ring->queues) {
+		kfree(ring);
+		return NULL;
+	}
+
+	ring->fc = fc;
+	ring->nr_queues = nr_cpu_ids;
+	ring->max_payload_sz = max_t(size_t, FUSE_MIN_READ_BUFFER,
+				     max_t(size_t, fc->max_write,
+					   fc->max_pages << PAGE_SHIFT));
+
+	spin_lock(&fc->lock);
+	if (fc->ring) {
+		/* another queue registered first */
+		spin_unlock(&fc->lock);
+		kfree(ring->queues);
+		kfree(ring);
+		return fc->ring;
+	}
+	WRITE_ONCE(fc->ring, ring);
+	spin_unlock(&fc->lock);
+
+	return ring;
+}
+
+static struct fuse_ring_queue *fuse_uring_create_queue(struct fuse_ring *ring,
+						       unsigned int qid)
+{
+	struct fuse_conn *fc = ring->fc;
+	struct fuse_ring_queue *queue;
+	struct list_head *pq;
+
+	queue = kzalloc(sizeof(*queue), GFP_KERNEL_ACCOUNT);
+	pq = kcalloc(FUSE_PQ_HASH_SIZE, sizeof(struct list_head), GFP_KERNEL);
+	if (!queue || !pq) {
+		kfree(queue);
+		kfree(pq);
+		return NULL;
+	}
+
+	queue->ring = ring;
+	queue->qid = qid;
+	queue->fpq.processing = pq;
+	fuse_pqueue_init(&queue->fpq);
+	INIT_LIST_HEAD(&queue->ent_avail_queue);
+	INIT_LIST_HEAD(&queue->fuse_req_queue);
+	INIT_LIST_HEAD(&queue->ent_list);
+
+	spin_lock(&fc->lock);
+	if (ring->queues[qid]) {
+		spin_unlock(&fc->lock);
+		kfree(pq);
+		kfree(queue);
+		return ring->queues[qid];
+	}
+	/* fuse_uring_abort() only sees queues published before it */
+	if (!fc->connected) {
+		queue->stopped = true;
+		queue->fpq.connected = 0;
+	}
+	WRITE_ONCE(ring->queues[qid], queue);
+	spin_unlock(&fc->lock);
+
+	return queue;
+}
+
+static void fuse_uring_ent_avail(struct fuse_ring_ent *ent,
+				 struct fuse_ring_queue *queue)
+{
+	ent->fuse_req = NULL;
+	ent->state = FRRS_AVAILABLE;
+	list_move(&ent->list, &queue->ent_avail_queue);
+}
+
+/*
+ * Assign @req to @ent.  The request stays locked until it is copied, so an
+ * abort leaves it to fuse_uring_prepare_send() to end it.  Called with
+ * fpq.lock held.
+ */
+static void fuse_uring_add_req_to_ring_ent(struct fuse_ring_ent *ent,
+					   struct fuse_req *req)
+{
+	struct fuse_ring_queue *queue = ent->queue;
+
+	clear_bit(FR_PENDING, &req->flags);
+	set_bit(FR_LOCKED, &req->flags);
+	list_move(&req->list, &queue->fpq.io);
+	list_del_init(&ent->list);
+	req->ring_entry = ent;
+	ent->fuse_req = req;
+	ent->state = FRRS_FUSE_REQ;
+}
+
+/* Copy the request header and arguments into the server's buffers */
+static int fuse_uring_copy_to_ring(struct fuse_ring_ent *ent,
+				   struct fuse_req *req)
+{
+	struct fuse_args *args = req->args;
+	struct fuse_uring_ent_in_out ent_in_out = {
+		.commit_id = req->in.h.unique,
+	};
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	struct iovec iov;
+	unsigned int payload_sz;
+	int err;
+
+	payload_sz = req->in.h.len - sizeof(struct fuse_in_header);
+	if (payload_sz > ent->payload_sz) {
+		/* SETXATTR is special, since it may contain too large data */
+		req->out.h.error = args->opcode == FUSE_SETXATTR ?
+			-E2BIG : -EIO;
+		return -EINVAL;
+	}
+
+	err = import_single_range(READ, ent->payload, payload_sz, &iov, &iter);
+	if (err)
+		return err;
+
+	fuse_copy_init(&cs, 1, &iter);
+	cs.req = req;
+	err = fuse_copy_args(&cs, args->in_numargs, args->in_pages,
+			     (struct fuse_arg *) args->in_args, 0);
+	fuse_copy_finish(&cs);
+	if (err)
+		return err;
+
+	ent_in_out.payload_sz = payload_sz;
+	if (copy_to_user(&ent->headers->in_out, &req->in.h,
+			 sizeof(req->in.h)) ||
+	    copy_to_user(&ent->headers->ring_ent_in_out, &ent_in_out,
+			 sizeof(ent_in_out)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*
+ * Copy the request of @ent to the server and hash it on the processing
+ * list, as fuse_dev_do_read() does.  On failure the request is ended and
+ * the entry has no request.
+ */
+static int fuse_uring_prepare_send(struct fuse_ring_ent *ent, bool cancel)
+{
+	struct fuse_ring_queue *queue = ent->queue;
+	struct fuse_pqueue *fpq = &queue->fpq;
+	struct fuse_req *req = ent->fuse_req;
+	int err;
+
+	err = cancel ? -ECANCELED : fuse_uring_copy_to_ring(ent, req);
+
+	spin_lock(&fpq->lock);
+	clear_bit(FR_LOCKED, &req->flags);
+	if (!fpq->connected)
+		err = -ENOTCONN;
+	if (err) {
+		if (!req->out.h.error)
+			req->out.h.error = -EIO;
+		if (!test_bit(FR_PRIVATE, &req->flags))
+			list_del_init(&req->list);
+		ent->fuse_req = NULL;
+		spin_unlock(&fpq->lock);
+
+		fuse_request_end(req);
+		return err;
+	}
+	list_move_tail(&req->list,
+		       &fpq->processing[fuse_req_hash(req->in.h.unique)]);
+	set_bit(FR_SENT, &req->flags);
+	ent->state = FRRS_USERSPACE;
+	ent->cmd = NULL;
+	spin_unlock(&fpq->lock);
+
+	/* matches barrier in request_wait_answer() */
+	smp_mb__after_atomic();
+	if (test_bit(FR_INTERRUPTED, &req->flags))
+		fuse_queue_interrupt(req);
+
+	return 0;
+}
+
+/*
+ * Hand the next waiting request to @ent, or park its command.  Runs in the
+ * server's task, so the request is copied right away.
+ */
+static void fuse_uring_next_fuse_req(struct fuse_ring_ent *ent,
+				     struct fuse_ring_queue *queue,
+				     unsigned int issue_flags)
+{
+	struct io_uring_cmd *cmd = ent->cmd;
+	struct fuse_req *req;
+
+	/* a completed command must never be on the cancel list */
+	io_uring_cmd_mark_cancelable(cmd, issue_flags);
+retry:
+	spin_lock(&queue->fpq.lock);
+	if (unlikely(queue->stopped)) {
+		ent->cmd = NULL;
+		ent->state = FRRS_INVALID;
+		spin_unlock(&queue->fpq.lock);
+		io_uring_cmd_done(cmd, -ENOTCONN, 0, issue_flags);
+		return;
+	}
+	req = list_first_entry_or_null(&queue->fuse_req_queue,
+				       struct fuse_req, list);
+	if (!req) {
+		fuse_uring_ent_avail(ent, queue);
+		spin_unlock(&queue->fpq.lock);
+		return;
+	}
+	fuse_uring_add_req_to_ring_ent(ent, req);
+	spin_unlock(&queue->fpq.lock);
+
+	if (fuse_uring_prepare_send(ent, false))
+		goto retry;
+
+	io_uring_cmd_done(cmd, 0, 0, issue_flags);
+}
+
+/* Runs in the server's task to copy a request queued from another task */
+static void fuse_uring_send_in_task(struct io_uring_cmd *cmd,
+				    unsigned int issue_flags)
+{
+	struct fuse_ring_ent *ent = uring_cmd_to_ring_ent(cmd);
+	/* no server mm to copy into, run from the io-wq fallback */
+	bool cancel = issue_flags & IO_URING_F_TASK_DEAD;
+
+	if (fuse_uring_prepare_send(ent, cancel)) {
+		if (!cancel) {
+			fuse_uring_next_fuse_req(ent, ent->queue, issue_flags);
+			return;
+		}
+		spin_lock(&ent->queue->fpq.lock);
+		ent->cmd = NULL;
+		ent->state = FRRS_INVALID;
+		spin_unlock(&ent->queue->fpq.lock);
+		io_uring_cmd_done(cmd, -ECANCELED, 0, issue_flags);
+		return;
+	}
+
+	io_uring_cmd_done(cmd, 0, 0, issue_flags);
+}
+
+/*
+ * Queue a request on the ring queue of the current CPU.  Returns false if
+ * the ring was stopped, the request is then left to the fiq.
+ */
+bool fuse_uring_queue_fuse_req(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_ring *ring = fc->ring;
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent = NULL;
+
+	queue = READ_ONCE(ring->queues[raw_smp_processor_id()]);
+
+	req->in.h.len = sizeof(struct fuse_in_header) +
+		fuse_len_args(req->args->in_numargs,
+			      (struct fuse_arg *) req->args->in_args);
+
+	spin_lock(&queue->fpq.lock);
+	if (unlikely(queue->stopped)) {
+		spin_unlock(&queue->fpq.lock);
+		return false;
+	}
+	req->ring_queue = queue;
+	set_bit(FR_URING, &req->flags);
+	list_add_tail(&req->list, &queue->fuse_req_queue);
+	ent = list_first_entry_or_null(&queue->ent_avail_queue,
+				       struct fuse_ring_ent, list);
+	if (ent)
+		fuse_uring_add_req_to_ring_ent(ent, req);
+	spin_unlock(&queue->fpq.lock);
+
+	if (ent)
+		io_uring_cmd_do_in_task_lazy(ent->cmd, fuse_uring_send_in_task);
+
+	return true;
+}
+
+bool fuse_uring_remove_pending_req(struct fuse_req *req)
+{
+	struct fuse_ring_queue *queue = req->ring_queue;
+	bool removed = false;
+
+	spin_lock(&queue->fpq.lock);
+	if (test_bit(FR_PENDING, &req->flags)) {
+		list_del(&req->list);
+		removed = true;
+	}
+	spin_unlock(&queue->fpq.lock);
+
+	return removed;
+}
+
+/*
+ * Find a request the server is processing on any ring queue, for interrupt
+ * replies, which still come in through /dev/fuse.  Returns it with a
+ * reference held.
+ */
+struct fuse_req *fuse_uring_find_req(struct fuse_conn *fc, u64 unique)
+{
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+	struct fuse_req *req = NULL;
+	unsigned int qid;
+
+	if (!ring)
+		return NULL;
+
+	for (qid = 0; qid < ring->nr_queues && !req; qid++) {
+		struct fuse_ring_queue *queue = READ_ONCE(ring->queues[qid]);
+
+		if (!queue)
+			continue;
+		spin_lock(&queue->fpq.lock);
+		req = fuse_request_find(&queue->fpq, unique);
+		if (req)
+			refcount_inc(&req->count);
+		spin_unlock(&queue->fpq.lock);
+	}
+
+	return req;
+}
+
+/* Copy the reply from the server's buffers and end the request */
+static void fuse_uring_commit(struct fuse_ring_ent *ent, struct fuse_req *req)
+{
+	struct fuse_pqueue *fpq = &ent->queue->fpq;
+	struct fuse_uring_ent_in_out ent_in_out;
+	struct fuse_out_header oh;
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	struct iovec iov;
+	int err;
+
+	err = -EFAULT;
+	if (copy_from_user(&oh, &ent->headers->in_out, sizeof(oh)) ||
+	    copy_from_user(&ent_in_out, &ent->headers->ring_ent_in_out,
+			   sizeof(ent_in_out)))
+		goto out;
+
+	err = -EINVAL;
+	if (oh.unique != req->in.h.unique ||
+	    oh.error <= -1000 || oh.error > 0 ||
+	    ent_in_out.payload_sz > ent->payload_sz ||
+	    oh.len != sizeof(oh) + ent_in_out.payload_sz)
+		goto out;
+
+	req->out.h = oh;
+	if (oh.error) {
+		err = ent_in_out.payload_sz ? -EINVAL : 0;
+		goto out;
+	}
+
+	err = import_single_range(WRITE, ent->payload, ent_in_out.payload_sz,
+				  &iov, &iter);
+	if (err)
+		goto out;
+
+	fuse_copy_init(&cs, 0, &iter);
+	cs.req = req;
+	err = fuse_copy_out_args(&cs, req->args, oh.len);
+	fuse_copy_finish(&cs);
+out:
+	spin_lock(&fpq->lock);
+	clear_bit(FR_LOCKED, &req->flags);
+	if (fpq->connected && err)
+		req->out.h.error = -EIO;
+	if (!test_bit(FR_PRIVATE, &req->flags))
+		list_del_init(&req->list);
+	ent->fuse_req = NULL;
+	spin_unlock(&fpq->lock);
+
+	fuse_request_end(req);
+}
+
+static struct fuse_ring_queue *fuse_uring_get_queue(struct fuse_ring *ring,
+						    unsigned int qid)
+{
+	if (qid >= ring->nr_queues || !cpu_possible(qid))
+		return NULL;
+
+	return READ_ONCE(ring->queues[qid]);
+}
+
+static int fuse_uring_commit_fetch(struct io_uring_cmd *cmd,
+				   unsigned int issue_flags,
+				   struct fuse_conn *fc)
+{
+	const struct fuse_uring_cmd_req *cmd_req = io_uring_sqe_cmd(cmd->sqe);
+	u64 commit_id = READ_ONCE(cmd_req->commit_id);
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent;
+	struct fuse_pqueue *fpq;
+	struct fuse_req *req;
+
+	if (!ring)
+		return -EINVAL;
+
+	queue = fuse_uring_get_queue(ring, READ_ONCE(cmd_req->qid));
+	if (!queue)
+		return -EINVAL;
+	fpq = &queue->fpq;
+
+	spin_lock(&fpq->lock);
+	req = NULL;
+	if (fpq->connected)
+		req = fuse_request_find(fpq, commit_id);
+	if (!req) {
+		spin_unlock(&fpq->lock);
+		return -ENOENT;
+	}
+	ent = req->ring_entry;
+	if (WARN_ON_ONCE(ent->state != FRRS_USERSPACE)) {
+		spin_unlock(&fpq->lock);
+		return -EIO;
+	}
+	clear_bit(FR_SENT, &req->flags);
+	list_move(&req->list, &fpq->io);
+	set_bit(FR_LOCKED, &req->flags);
+	ent->state = FRRS_COMMIT;
+	ent->cmd = cmd;
+	spin_unlock(&fpq->lock);
+
+	uring_cmd_set_ring_ent(cmd, ent);
+	fuse_uring_commit(ent, req);
+	fuse_uring_next_fuse_req(ent, queue, issue_flags);
+
+	return -EIOCBQUEUED;
+}
+
+static struct fuse_ring_ent *
+fuse_uring_create_ring_ent(struct io_uring_cmd *cmd,
+			   struct fuse_ring_queue *queue)
+{
+	struct fuse_ring *ring = queue->ring;
+	struct iovec iov[FUSE_URING_IOV_SEGS];
+	struct fuse_ring_ent *ent;
+	struct iovec *iovp;
+
+	if (READ_ONCE(cmd->sqe->len) != FUSE_URING_IOV_SEGS)
+		return ERR_PTR(-EINVAL);
+
+	iovp = iovec_from_user(u64_to_user_ptr(READ_ONCE(cmd->sqe->addr)),
+			       FUSE_URING_IOV_SEGS, FUSE_URING_IOV_SEGS, iov,
+			       in_compat_syscall());
+	if (IS_ERR(iovp))
+		return ERR_CAST(iovp);
+
+	if (iov[0].iov_len < sizeof(struct fuse_uring_req_header) ||
+	    iov[1].iov_len < ring->max_payload_sz)
+		return ERR_PTR(-EINVAL);
+
+	ent = kzalloc(sizeof(*ent), GFP_KERNEL_ACCOUNT);
+	if (!ent)
+		return ERR_PTR(-ENOMEM);
+
+	INIT_LIST_HEAD(&ent->list);
+	ent->queue = queue;
+	ent->headers = iov[0].iov_base;
+	ent->payload = iov[1].iov_base;
+	ent->payload_sz = iov[1].iov_len;
+	ent->cmd = cmd;
+
+	return ent;
+}
+
+static int fuse_uring_register(struct io_uring_cmd *cmd,
+			       unsigned int issue_flags, struct fuse_conn *fc)
+{
+	const struct fuse_uring_cmd_req *cmd_req = io_uring_sqe_cmd(cmd->sqe);
+	unsigned int qid = READ_ONCE(cmd_req->qid);
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent;
+
+	/*
+	 * Requests are copied from task_work of the registering task, the SQ
+	 * thread runs that without the server's mm.
+	 */
+	if (issue_flags & IO_URING_F_SQPOLL)
+		return -EINVAL;
+
+	if (!ring) {
+		ring = fuse_uring_create(fc);
+		if (!ring)
+			return -ENOMEM;
+	}
+
+	if (qid >= ring->nr_queues || !cpu_possible(qid))
+		return -EINVAL;
+
+	queue = READ_ONCE(ring->queues[qid]);
+	if (!queue) {
+		queue = fuse_uring_create_queue(ring, qid);
+		if (!queue)
+			return -ENOMEM;
+	}
+
+	ent = fuse_uring_create_ring_ent(cmd, queue);
+	if (IS_ERR(ent))
+		return PTR_ERR(ent);
+
+	spin_lock(&queue->fpq.lock);
+	if (queue->stopped) {
+		spin_unlock(&queue->fpq.lock);
+		kfree(ent);
+		return -ENOTCONN;
+	}
+	list_add_tail(&ent->ent_entry, &queue->ent_list);
+	spin_unlock(&queue->fpq.lock);
+
+	uring_cmd_set_ring_ent(cmd, ent);
+	fuse_uring_next_fuse_req(ent, queue, issue_flags);
+
+	/* requests take the ring once every CPU has a queue to go to */
+	spin_lock(&fc->lock);
+	if (!queue->registered) {
+		queue->registered = true;
+		if (++ring->nr_queues_registered == num_possible_cpus())
+			smp_store_release(&ring->ready, true);
+	}
+	spin_unlock(&fc->lock);
+
+	return -EIOCBQUEUED;
+}
+
+/* The ring or the server's task is going away, complete a parked command */
+static void fuse_uring_cancel(struct io_uring_cmd *cmd,
+			      unsigned int issue_flags)
+{
+	struct fuse_ring_ent *ent = uring_cmd_to_ring_ent(cmd);
+	struct fuse_ring_queue *queue = ent->queue;
+	bool need_cmd_done = false;
+
+	spin_lock(&queue->fpq.lock);
+	if (ent->state == FRRS_AVAILABLE && ent->cmd == cmd) {
+		list_del_init(&ent->list);
+		ent->cmd = NULL;
+		ent->state = FRRS_INVALID;
+		need_cmd_done = true;
+	}
+	spin_unlock(&queue->fpq.lock);
+
+	/* otherwise a request is on its way and completes the command */
+	if (need_cmd_done)
+		io_uring_cmd_done(cmd, -ENOTCONN, 0, issue_flags);
+}
+
+int fuse_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
+{
+	const struct fuse_uring_cmd_req *cmd_req = io_uring_sqe_cmd(cmd->sqe);
+	struct fuse_dev *fud;
+	struct fuse_conn *fc;
+
+	if (unlikely(issue_flags & IO_URING_F_CANCEL)) {
+		fuse_uring_cancel(cmd, issue_flags);
+		return 0;
+	}
+
+	/* struct fuse_uring_cmd_req doesn't fit a 64 byte SQE */
+	if (!(issue_flags & IO_URING_F_SQE128))
+		return -EINVAL;
+
+	if (READ_ONCE(cmd_req->flags))
+		return -EINVAL;
+
+	fud = fuse_get_dev(cmd->file);
+	if (!fud)
+		return -EPERM;
+	fc = fud->fc;
+
+	/* max_write and max_pages are known once INIT negotiated the ring */
+	if (!fc->initialized || !fc->io_uring)
+		return -EOPNOTSUPP;
+
+	if (!fc->connected)
+		return -ENOTCONN;
+
+	switch (cmd->cmd_op) {
+	case FUSE_IO_URING_CMD_REGISTER:
+		return fuse_uring_register(cmd, issue_flags, fc);
+
+	case FUSE_IO_URING_CMD_COMMIT_AND_FETCH:
+		return fuse_uring_commit_fetch(cmd, issue_flags, fc);
+
+	default:
+		return -EINVAL;
+	}
+}
+
+/*
+ * Called from fuse_abort_conn(): end the requests on the ring and complete
+ * the parked commands.  Entries stay allocated until fuse_uring_destruct(),
+ * commands still on their way to the server complete on their own.
+ */
+void fuse_uring_abort(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+	unsigned int qid;
+
+	if (!ring)
+		return;
+
+	for (qid = 0; qid < ring->nr_queues; qid++) {
+		struct fuse_ring_queue *queue = READ_ONCE(ring->queues[qid]);
+		struct fuse_ring_ent *ent, *next;
+		struct fuse_req *req;
+		LIST_HEAD(to_end);
+		LIST_HEAD(to_cancel);
+
+		if (!queue)
+			continue;
+
+		spin_lock(&queue->fpq.lock);
+		queue->stopped = true;
+		fuse_abort_pqueue(&queue->fpq, &to_end);
+		list_for_each_entry(req, &queue->fuse_req_queue, list)
+			clear_bit(FR_PENDING, &req->flags);
+		list_splice_tail_init(&queue->fuse_req_queue, &to_end);
+		list_for_each_entry(ent, &queue->ent_avail_queue, list)
+			ent->state = FRRS_INVALID;
+		list_splice_init(&queue->ent_avail_queue, &to_cancel);
+		spin_unlock(&queue->fpq.lock);
+
+		fuse_dev_end_requests(&to_end);
+
+		list_for_each_entry_safe(ent, next, &to_cancel, list) {
+			struct io_uring_cmd *cmd = ent->cmd;
+
+			list_del_init(&ent->list);
+			ent->cmd = NULL;
+			io_uring_cmd_done(cmd, -ENOTCONN, 0, 0);
+		}
+	}
+}
+
+void fuse_uring_destruct(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = fc->ring;
+	unsigned int qid;
+
+	if (!ring)
+		return;
+
+	for (qid = 0; qid < ring->nr_queues; qid++) {
+		struct fuse_ring_queue *queue = ring->queues[qid];
+		struct fuse_ring_ent *ent, *next;
+
+		if (!queue)
+			continue;
+
+		WARN_ON(!list_empty(&queue->ent_avail_queue));
+		WARN_ON(!list_empty(&queue->fuse_req_queue));
+
+		list_for_each_entry_safe(ent, next, &queue->ent_list, ent_entry)
+			kfree(ent);
+		kfree(queue->fpq.processing);
+		kfree(queue);
+	}
+
+	kfree(ring->queues);
+	kfree(ring);
+	fc->ring = NULL;
+}
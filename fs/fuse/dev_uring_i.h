@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: GPL-2.0
+ *
+ * FUSE: Filesystem in Userspace
+ *
+ * Per-CPU request queues of the io_uring transport, see dev_uring.c
+ */
+#ifndef _FS_FUSE_DEV_URING_I_H
+#define _FS_FUSE_DEV_URING_I_H
+
+#include "fuse_i.h"
+
+struct io_uring_cmd;
+
+enum fuse_ring_ent_state {
+	/* no command, the server submitted none or it was canceled */
+	FRRS_INVALID = 0,
+	/* command parked, waiting for a request */
+	FRRS_AVAILABLE,
+	/* request assigned, being copied to the server */
+	FRRS_FUSE_REQ,
+	/* request handed to the server, waiting for its commit */
+	FRRS_USERSPACE,
+	/* reply being copied from the server */
+	FRRS_COMMIT,
+};
+
+/** A buffer registered by the server, and the command it is parked with */
+struct fuse_ring_ent {
+	/* header and payload buffers in the server */
+	struct fuse_uring_req_header __user *headers;
+	void __user *payload;
+	size_t payload_sz;
+
+	struct fuse_ring_queue *queue;
+
+	/* command to complete with the next request */
+	struct io_uring_cmd *cmd;
+
+	/* request being copied or processed */
+	struct fuse_req *fuse_req;
+
+	enum fuse_ring_ent_state state;
+
+	/* entry on queue->ent_avail_queue while FRRS_AVAILABLE */
+	struct list_head list;
+
+	/* entry on queue->ent_list until the ring is destroyed */
+	struct list_head ent_entry;
+};
+
+struct fuse_ring_queue {
+	struct fuse_ring *ring;
+	unsigned int qid;
+
+	/*
+	 * fpq.lock protects the whole queue.  As for /dev/fuse, requests
+	 * being copied are on fpq.io and requests the server is working on
+	 * are hashed on fpq.processing.
+	 */
+	struct fuse_pqueue fpq;
+
+	/* entries with a parked command */
+	struct list_head ent_avail_queue;
+
+	/* requests waiting for an entry */
+	struct list_head fuse_req_queue;
+
+	/* all entries registered on the queue */
+	struct list_head ent_list;
+
+	/* at least one entry was registered, protected by fc->lock */
+	bool registered;
+
+	/* connection aborted, no new requests or entries */
+	bool stopped;
+};
+
+/** io_uring transport of a connection */
+struct fuse_ring {
+	struct fuse_conn *fc;
+
+	/* one queue per possible CPU, indexed by CPU id */
+	unsigned int nr_queues;
+	struct fuse_ring_queue **queues;
+
+	/* largest argument size of a request or reply */
+	size_t max_payload_sz;
+
+	/* queues with at least one entry, protected by fc->lock */
+	unsigned int nr_queues_registered;
+
+	/* every queue has an entry, requests go through the ring */
+	bool ready;
+};
+
+#ifdef CONFIG_FUSE_IO_URING
+
+int fuse_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags);
+bool fuse_uring_queue_fuse_req(struct fuse_conn *fc, struct fuse_req *req);
+bool fuse_uring_remove_pending_req(struct fuse_req *req);
+struct fuse_req *fuse_uring_find_req(struct fuse_conn *fc, u64 unique);
+
+static inline bool fuse_uring_ready(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+
+	/* pairs with smp_store_release() in fuse_uring_register() */
+	return ring && smp_load_acquire(&ring->ready);
+}
+
+#else /* CONFIG_FUSE_IO_URING */
+
+static inline bool fuse_uring_queue_fuse_req(struct fuse_conn *fc,
+					     struct fuse_req *req)
+{
+	return false;
+}
+
+static inline bool fuse_uring_remove_pending_req(struct fuse_req *req)
+{
+	return false;
+}
+
+static inline struct fuse_req *fuse_uring_find_req(struct fuse_conn *fc,
+						   u64 unique)
+{
+	return NULL;
+}
+
+static inline bool fuse_uring_ready(struct fuse_conn *fc)
+{
+	return false;
+}
+
+#endif /* CONFIG_FUSE_IO_URING */
+
+#endif /* _FS_FUSE_DEV_URING_I_H */
@@ -136,6 +136,7 @@ int fuse_do_open(struct fuse_mount *fm, u64 nodeid, struct file *file,
 	struct fuse_conn *fc = fm->fc;
 	struct fuse_file *ff;
 	int opcode = isdir ? FUSE_OPENDIR : FUSE_OPEN;
+	int backing_id = 0;
 
 	ff = fuse_file_alloc(fm);
 	if (!ff)
@@ -152,7 +153,7 @@ int fuse_do_open(struct fuse_mount *fm, u64 nodeid, struct file *file,
 		if (!err) {
 			ff->fh = outarg.fh;
 			ff->open_flags = outarg.open_flags;
-
+			backing_id = outarg.backing_id;
 		} else if (err != -ENOSYS) {
 			fuse_file_free(ff);
 			return err;
@@ -165,9 +166,19 @@ int fuse_do_open(struct fuse_mount *fm, u64 nodeid, struct file *file,
 	}
 
 	if (isdir)
-		ff->open_flags &= ~FOPEN_DIRECT_IO;
+		ff->open_flags &= ~(FOPEN_DIRECT_IO | FOPEN_PASSTHROUGH);
 
 	ff->nodeid = nodeid;
+
+	if (ff->open_flags & FOPEN_PASSTHROUGH) {
+		int err = fuse_file_passthrough_open(file, ff,
+						     backing_id);
+
+		if (err) {
+			fuse_sync_release(NULL, ff, file->f_flags);
+			return err;
+		}
+	}
 	file->private_data = ff;
 
 	return 0;
@@ -246,6 +257,12 @@ int fuse_open_common(struct inode *inode, struct file *file, bool isdir)
 	}
 
 	err = fuse_do_open(fm, get_node_id(inode), file, isdir);
+	if (!err && !isdir) {
+		err = fuse_file_io_open(file, inode);
+		if (err)
+			fuse_sync_release(get_fuse_inode(inode),
+					  file->private_data, file->f_flags);
+	}
 	if (!err)
 		fuse_finish_open(inode, file);
 
@@ -268,6 +285,11 @@ static void fuse_prepare_release(struct fuse_inode *fi, struct fuse_file *ff,
 	struct fuse_release_args *ra = ff->release_args;
 
 	/* Inode is NULL on error path of fuse_create_open() */
+	if (likely(fi))
+		fuse_file_io_release(ff, &fi->inode);
+	if (IS_ENABLED(CONFIG_FUSE_PASSTHROUGH))
+		fuse_passthrough_release(ff);
+
 	if (likely(fi)) {
 		spin_lock(&fi->lock);
 		list_del(&ff->write_entry);
@@ -1564,6 +1586,9 @@ static ssize_t fuse_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	if (FUSE_IS_DAX(inode))
 		return fuse_dax_read_iter(iocb, to);
 
+	if (fuse_file_passthrough(ff))
+		return fuse_passthrough_read_iter(iocb, to);
+
 	if (!(ff->open_flags & FOPEN_DIRECT_IO))
 		return fuse_cache_read_iter(iocb, to);
 	else
@@ -1582,6 +1607,9 @@ static ssize_t fuse_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	if (FUSE_IS_DAX(inode))
 		return fuse_dax_write_iter(iocb, from);
 
+	if (fuse_file_passthrough(ff))
+		return fuse_passthrough_write_iter(iocb, from);
+
 	if (!(ff->open_flags & FOPEN_DIRECT_IO))
 		return fuse_cache_write_iter(iocb, from);
 	else
@@ -2346,6 +2374,9 @@ static int fuse_file_mmap(struct file *file, struct vm_area_struct *vma)
 	if (FUSE_IS_DAX(file_inode(file)))
 		return fuse_dax_mmap(file, vma);
 
+	if (fuse_file_passthrough(ff))
+		return fuse_passthrough_mmap(file, vma);
+
 	if (ff->open_flags & FOPEN_DIRECT_IO) {
 		/* Can't provide the coherency needed for MAP_SHARED */
 		if (vma->vm_flags & VM_MAYSHARE)
@@ -3472,6 +3503,7 @@ void fuse_init_file_inode(struct inode *inode)
 	INIT_LIST_HEAD(&fi->write_files);
 	INIT_LIST_HEAD(&fi->queued_writes);
 	fi->writectr = 0;
+	fi->iocachectr = 0;
 	init_waitqueue_head(&fi->page_waitq);
 	fi->writepages = RB_ROOT;
 
@@ -31,6 +31,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/refcount.h>
 #include <linux/user_namespace.h>
+#include <linux/idr.h>
 
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
@@ -107,6 +108,11 @@ struct fuse_inode {
 			 * (FUSE_NOWRITE) means more writes are blocked */
 			int writectr;
 
+			/* Opens using the page cache if positive, opens
+			 * in passthrough mode if negative.  Protected by
+			 * fi->lock */
+			int iocachectr;
+
 			/* Waitq for writepage completion */
 			wait_queue_head_t page_waitq;
 
@@ -233,6 +239,17 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	/** Backing file that read/write/mmap are passed through to */
+	struct file *passthrough;
+
+	/** Credentials of the server that registered the backing file */
+	const struct cred *cred;
+
+	/** Counted in fuse_inode->iocachectr */
+	bool iomode_counted:1;
+#endif
 };
 
 /** One input argument of a request */
@@ -320,6 +337,7 @@ struct fuse_io_priv {
  * FR_FINISHED:		request is finished
  * FR_PRIVATE:		request is on private list
  * FR_ASYNC:		request is asynchronous
+ * FR_URING:		request is queued on an io_uring queue, not the fiq
  */
 enum fuse_req_flag {
 	FR_ISREPLY,
@@ -334,6 +352,7 @@ enum fuse_req_flag {
 	FR_FINISHED,
 	FR_PRIVATE,
 	FR_ASYNC,
+	FR_URING,
 };
 
 /**
@@ -380,6 +399,12 @@ struct fuse_req {
 
 	/** fuse_mount this request belongs to */
 	struct fuse_mount *fm;
+
+#ifdef CONFIG_FUSE_IO_URING
+	/** io_uring queue and entry the request is sent through */
+	struct fuse_ring_queue *ring_queue;
+	struct fuse_ring_ent *ring_entry;
+#endif
 };
 
 struct fuse_iqueue;
@@ -430,8 +455,8 @@ struct fuse_iqueue {
 	/** Readers of the connection are waiting on this */
 	wait_queue_head_t waitq;
 
-	/** The next unique request id */
-	u64 reqctr;
+	/** The next unique request id, also used by the io_uring queues */
+	atomic64_t reqctr;
 
 	/** The list of pending requests */
 	struct list_head pending;
@@ -747,6 +772,15 @@ struct fuse_conn {
 	/* Auto-mount submounts announced by the server */
 	unsigned int auto_submounts:1;
 
+	/* Passthrough I/O to backing files negotiated */
+	unsigned int passthrough:1;
+
+	/** Maximum stacking depth of the passthrough backing files */
+	int max_stack_depth;
+
+	/* io_uring transport negotiated */
+	unsigned int io_uring:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -788,6 +822,16 @@ struct fuse_conn {
 	struct fuse_conn_dax *dax;
 #endif
 
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	/** IDR of backing files registered with FUSE_DEV_IOC_BACKING_OPEN */
+	struct idr backing_files_map;
+#endif
+
+#ifdef CONFIG_FUSE_IO_URING
+	/** Per-CPU request queues of the io_uring transport */
+	struct fuse_ring *ring;
+#endif
+
 	/** List of filesystems using this connection */
 	struct list_head mounts;
 };
@@ -1050,6 +1094,7 @@ struct fuse_dev *fuse_dev_alloc_install(struct fuse_conn *fc);
 struct fuse_dev *fuse_dev_alloc(void);
 void fuse_dev_install(struct fuse_dev *fud, struct fuse_conn *fc);
 void fuse_dev_free(struct fuse_dev *fud);
+void fuse_pqueue_init(struct fuse_pqueue *fpq);
 void fuse_send_init(struct fuse_mount *fm);
 
 /**
@@ -1222,4 +1267,75 @@ void fuse_dax_inode_cleanup(struct inode *inode);
 bool fuse_dax_check_alignment(struct fuse_conn *fc, unsigned int map_alignment);
 void fuse_dax_cancel_work(struct fuse_conn *fc);
 
+/* passthrough.c */
+
+/** Backing file registered by the server, looked up by backing_id */
+struct fuse_backing {
+	struct file *file;
+	const struct cred *cred;
+
+	/** refcount */
+	refcount_t count;
+	struct rcu_head rcu;
+};
+
+static inline struct file *fuse_file_passthrough(struct fuse_file *ff)
+{
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	return ff->passthrough;
+#else
+	return NULL;
+#endif
+}
+
+int fuse_passthrough_open(struct file *file, struct fuse_file *ff,
+			  int backing_id);
+
+/*
+ * Hook up the backing file of an open the server replied to with
+ * FOPEN_PASSTHROUGH.  The flag is ignored unless FUSE_PASSTHROUGH was
+ * negotiated.
+ */
+static inline int fuse_file_passthrough_open(struct file *file,
+					     struct fuse_file *ff,
+					     int backing_id)
+{
+	if (!(ff->open_flags & FOPEN_PASSTHROUGH))
+		return 0;
+
+	if (!IS_ENABLED(CONFIG_FUSE_PASSTHROUGH) || !ff->fm->fc->passthrough) {
+		ff->open_flags &= ~FOPEN_PASSTHROUGH;
+		return 0;
+	}
+	return fuse_passthrough_open(file, ff, backing_id);
+}
+
+void fuse_backing_files_init(struct fuse_conn *fc);
+void fuse_backing_files_free(struct fuse_conn *fc);
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map);
+int fuse_backing_close(struct fuse_conn *fc, int backing_id);
+
+void fuse_passthrough_release(struct fuse_file *ff);
+#ifdef CONFIG_FUSE_PASSTHROUGH
+int fuse_file_io_open(struct file *file, struct inode *inode);
+void fuse_file_io_release(struct fuse_file *ff, struct inode *inode);
+#else
+static inline int fuse_file_io_open(struct file *file, struct inode *inode)
+{
+	return 0;
+}
+static inline void fuse_file_io_release(struct fuse_file *ff,
+					struct inode *inode)
+{
+}
+#endif
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *iter);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *iter);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
+/* dev_uring.c */
+
+void fuse_uring_abort(struct fuse_conn *fc);
+void fuse_uring_destruct(struct fuse_conn *fc);
+
 #endif /* _FS_FUSE_I_H */
@@ -0,0 +1,347 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE passthrough to backing file.
+ *
+ * The server registers an open file with FUSE_DEV_IOC_BACKING_OPEN and
+ * names the returned backing_id in the reply to FUSE_OPEN/FUSE_CREATE.
+ * read_iter, write_iter and mmap on the fuse file are then performed on a
+ * private open of the backing file, with the server's credentials, without
+ * a round trip through the server.  An inode is either open in passthrough
+ * mode or through the page cache, opens of the other kind fail with
+ * -ETXTBSY.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/uio.h>
+#include <linux/cred.h>
+#include <linux/mman.h>
+
+static struct fuse_backing *fuse_backing_get(struct fuse_backing *fb)
+{
+	if (fb && refcount_inc_not_zero(&fb->count))
+		return fb;
+	return NULL;
+}
+
+static void fuse_backing_free(struct fuse_backing *fb)
+{
+	if (fb->file)
+		fput(fb->file);
+	put_cred(fb->cred);
+	kfree_rcu(fb, rcu);
+}
+
+static void fuse_backing_put(struct fuse_backing *fb)
+{
+	if (fb && refcount_dec_and_test(&fb->count))
+		fuse_backing_free(fb);
+}
+
+static struct fuse_backing *fuse_backing_lookup(struct fuse_conn *fc,
+						int backing_id)
+{
+	struct fuse_backing *fb;
+
+	rcu_read_lock();
+	fb = idr_find(&fc->backing_files_map, backing_id);
+	fb = fuse_backing_get(fb);
+	rcu_read_unlock();
+
+	return fb;
+}
+
+void fuse_backing_files_init(struct fuse_conn *fc)
+{
+	idr_init(&fc->backing_files_map);
+}
+
+void fuse_backing_files_free(struct fuse_conn *fc)
+{
+	struct fuse_backing *fb;
+	int id;
+
+	idr_for_each_entry(&fc->backing_files_map, fb, id)
+		fuse_backing_put(fb);
+	idr_destroy(&fc->backing_files_map);
+}
+
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map)
+{
+	struct file *file;
+	struct super_block *backing_sb;
+	struct fuse_backing *fb;
+	int res;
+
+	/*
+	 * The backing file is not visible to lsof and friends while it is
+	 * only referenced from the fuse connection, keep this privileged.
+	 */
+	if (!fc->passthrough || !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (map->flags || map->padding)
+		return -EINVAL;
+
+	file = fget(map->fd);
+	if (!file)
+		return -EBADF;
+
+	res = -EINVAL;
+	if (!S_ISREG(file_inode(file)->i_mode))
+		goto out_fput;
+
+	res = -EOPNOTSUPP;
+	if (!file->f_op->read_iter || !file->f_op->write_iter)
+		goto out_fput;
+
+	/* don't allow unbounded stacking, e.g. fuse on top of itself */
+	backing_sb = file_inode(file)->i_sb;
+	res = -ELOOP;
+	if (backing_sb->s_stack_depth >= fc->max_stack_depth)
+		goto out_fput;
+
+	res = -ENOMEM;
+	fb = kmalloc(sizeof(*fb), GFP_KERNEL);
+	if (!fb)
+		goto out_fput;
+
+	fb->file = file;
+	fb->cred = get_current_cred();
+	refcount_set(&fb->count, 1);
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->lock);
+	res = idr_alloc_cyclic(&fc->backing_files_map, fb, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->lock);
+	idr_preload_end();
+
+	if (res < 0)
+		fuse_backing_free(fb);
+	return res;
+
+out_fput:
+	fput(file);
+	return res;
+}
+
+int fuse_backing_close(struct fuse_conn *fc, int backing_id)
+{
+	struct fuse_backing *fb;
+
+	if (!fc->passthrough || !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (backing_id <= 0)
+		return -EINVAL;
+
+	spin_lock(&fc->lock);
+	fb = idr_remove(&fc->backing_files_map, backing_id);
+	spin_unlock(&fc->lock);
+	if (!fb)
+		return -ENOENT;
+
+	/* files already opened in passthrough mode keep their own reference */
+	fuse_backing_put(fb);
+	return 0;
+}
+
+int fuse_passthrough_open(struct file *file, struct fuse_file *ff,
+			  int backing_id)
+{
+	struct fuse_conn *fc = ff->fm->fc;
+	struct fuse_backing *fb;
+	struct file *backing_file;
+	int err;
+
+	if (backing_id <= 0)
+		return -EINVAL;
+
+	fb = fuse_backing_lookup(fc, backing_id);
+	if (!fb)
+		return -ENOENT;
+
+	/* the fuse open can't get more access than the server's file has */
+	err = -EACCES;
+	if (((file->f_mode & FMODE_READ) && !(fb->file->f_mode & FMODE_READ)) ||
+	    ((file->f_mode & FMODE_WRITE) && !(fb->file->f_mode & FMODE_WRITE)))
+		goto out;
+
+	/*
+	 * Open a private instance so the file position, O_APPEND and
+	 * O_DIRECT of this open don't leak into the server's file.
+	 */
+	backing_file = dentry_open(&fb->file->f_path,
+				   file->f_flags & ~(O_CREAT | O_EXCL |
+						     O_NOCTTY | O_TRUNC),
+				   fb->cred);
+	err = PTR_ERR(backing_file);
+	if (IS_ERR(backing_file))
+		goto out;
+
+	ff->passthrough = backing_file;
+	ff->cred = get_cred(fb->cred);
+	err = 0;
+out:
+	fuse_backing_put(fb);
+	return err;
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (!ff->passthrough)
+		return;
+
+	fput(ff->passthrough);
+	ff->passthrough = NULL;
+	put_cred(ff->cred);
+	ff->cred = NULL;
+}
+
+/*
+ * Passthrough opens bypass the fuse page cache, so they can't coexist with
+ * opens of the same inode that use it: the first kind to open an inode
+ * excludes the other until its last open is released.
+ */
+int fuse_file_io_open(struct file *file, struct inode *inode)
+{
+	struct fuse_file *ff = file->private_data;
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	bool passthrough = ff->open_flags & FOPEN_PASSTHROUGH;
+	int err = 0;
+
+	if (!ff->fm->fc->passthrough || !S_ISREG(inode->i_mode))
+		return 0;
+
+	spin_lock(&fi->lock);
+	if (passthrough ? fi->iocachectr > 0 : fi->iocachectr < 0)
+		err = -ETXTBSY;
+	else
+		fi->iocachectr += passthrough ? -1 : 1;
+	spin_unlock(&fi->lock);
+	if (err)
+		return err;
+	ff->iomode_counted = true;
+
+	/* drop what earlier opens through the page cache left behind */
+	if (passthrough && inode->i_mapping->nrpages) {
+		filemap_write_and_wait(inode->i_mapping);
+		invalidate_inode_pages2(inode->i_mapping);
+	}
+	return 0;
+}
+
+void fuse_file_io_release(struct fuse_file *ff, struct inode *inode)
+{
+	struct fuse_inode *fi = get_fuse_inode(inode);
+
+	if (!ff->iomode_counted)
+		return;
+
+	spin_lock(&fi->lock);
+	fi->iocachectr += (ff->open_flags & FOPEN_PASSTHROUGH) ? 1 : -1;
+	spin_unlock(&fi->lock);
+	ff->iomode_counted = false;
+}
+
+static rwf_t fuse_iocb_to_rwf(int ifl)
+{
+	rwf_t flags = 0;
+
+	if (ifl & IOCB_NOWAIT)
+		flags |= RWF_NOWAIT;
+	if (ifl & IOCB_HIPRI)
+		flags |= RWF_HIPRI;
+	if (ifl & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (ifl & IOCB_SYNC)
+		flags |= RWF_SYNC;
+
+	return flags;
+}
+
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *iter)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = fuse_file_passthrough(ff);
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(iter))
+		return 0;
+
+	old_cred = override_creds(ff->cred);
+	ret = vfs_iter_read(backing_file, iter, &iocb->ki_pos,
+			    fuse_iocb_to_rwf(iocb->ki_flags));
+	revert_creds(old_cred);
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *iter)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = fuse_file_passthrough(ff);
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(iter))
+		return 0;
+
+	if (iocb->ki_flags & IOCB_NOWAIT) {
+		if (!inode_trylock(inode))
+			return -EAGAIN;
+	} else {
+		inode_lock(inode);
+	}
+
+	old_cred = override_creds(ff->cred);
+	file_start_write(backing_file);
+	ret = vfs_iter_write(backing_file, iter, &iocb->ki_pos,
+			     fuse_iocb_to_rwf(iocb->ki_flags));
+	file_end_write(backing_file);
+	revert_creds(old_cred);
+
+	/* the backing file changed size and times behind the server's back */
+	if (ret > 0)
+		fuse_write_update_size(inode, iocb->ki_pos);
+	fuse_invalidate_attr(inode);
+	inode_unlock(inode);
+
+	return ret;
+}
+
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = fuse_file_passthrough(ff);
+	const struct cred *old_cred;
+	int ret;
+
+	if (!backing_file->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	vma->vm_file = get_file(backing_file);
+
+	old_cred = override_creds(ff->cred);
+	ret = call_mmap(vma->vm_file, vma);
+	revert_creds(old_cred);
+
+	if (ret) {
+		/* Drop reference count from new vm_file value */
+		vma->vm_file = file;
+		fput(backing_file);
+	} else {
+		/* Drop reference count from previous vm_file value */
+		fput(file);
+	}
+
+	return ret;
+}
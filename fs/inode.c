@@ -21,6 +21,9 @@
 #include <linux/ratelimit.h>
 #include <linux/list_lru.h>
 #include <linux/iversion.h>
+#include <linux/vmalloc.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <trace/events/writeback.h>
 #include "internal.h"
 
@@ -36,7 +39,7 @@
  * bdi->wb.list_lock protects:
  *   bdi->wb.b_{dirty,io,more_io,dirty_time}, inode->i_io_list
  * inode_hash_lock protects:
- *   inode_hashtable, inode->i_hash
+ *   inode_hashtable, i_hash_future, i_hash_migrated, inode->i_hash
  *
  * Lock ordering:
  *
@@ -55,10 +58,30 @@
  *   inode_hash_lock
  */
 
-static unsigned int __read_mostly i_hash_mask ;
-static unsigned int __read_mostly i_hash_shift ;
-static struct hlist_head __read_mostly *inode_hashtable ;   /* inode 的哈希表 */
+struct inode_hash_table {
+	struct hlist_head	*buckets;
+	unsigned int		shift;		/* log2(nr of buckets) */
+	unsigned int		mask;
+};
+
+/* The table sized at boot from ihash_entries= */
+static struct inode_hash_table i_hash_boot;
+
+/*
+ * inode 的哈希表
+ *
+ * Replaced as a whole when it is resized, see inode_hash_resize().  While
+ * a resize is running, buckets of inode_hashtable below i_hash_migrated
+ * have been moved to i_hash_future.  Lockless lookups retry on
+ * inode_hash_seq, which the resize bumps around every batch it moves.
+ */
+static struct inode_hash_table __rcu __read_mostly *inode_hashtable =
+	RCU_INITIALIZER(&i_hash_boot);
+static struct inode_hash_table __rcu *i_hash_future;
+static unsigned long i_hash_migrated;
 static __cacheline_aligned_in_smp DEFINE_SPINLOCK(inode_hash_lock);
+static seqcount_spinlock_t inode_hash_seq =
+	SEQCNT_SPINLOCK_ZERO(inode_hash_seq, &inode_hash_lock);
 
 /*
  * Empty aops. Can be used for the cases where the user does not
@@ -197,6 +220,7 @@ int inode_init_always(struct super_block *sb, struct inode *inode)
 #ifdef CONFIG_FS_POSIX_ACL
 	inode->i_acl = inode->i_default_acl = ACL_NOT_CACHED;
 #endif
+	inode->i_exec_cache = NULL;
 
 #ifdef CONFIG_FSNOTIFY
 	inode->i_fsnotify_mask = 0;
@@ -270,6 +294,7 @@ void __destroy_inode(struct inode *inode)
 	if (inode->i_default_acl && !is_uncached_acl(inode->i_default_acl))
 		posix_acl_release(inode->i_default_acl);
 #endif
+	inode_exec_cache_free(inode);
 	this_cpu_dec(nr_inodes);
 }
 EXPORT_SYMBOL(__destroy_inode);
@@ -475,16 +500,40 @@ static inline void inode_sb_list_del(struct inode *inode)
 	}
 }
 
-static unsigned long hash(struct super_block *sb, unsigned long hashval)
+static unsigned long hash(const struct inode_hash_table *tbl,
+			  struct super_block *sb, unsigned long hashval)
 {
 	unsigned long tmp;
 
 	tmp = (hashval * (unsigned long)sb) ^ (GOLDEN_RATIO_PRIME + hashval) /
 			L1_CACHE_BYTES;
-	tmp = tmp ^ ((tmp ^ GOLDEN_RATIO_PRIME) >> i_hash_shift);
-	return tmp & i_hash_mask;
+	tmp = tmp ^ ((tmp ^ GOLDEN_RATIO_PRIME) >> tbl->shift);
+	return tmp & tbl->mask;
+}
+
+/*
+ * Hash chain for @hashval.  Stable while inode_hash_lock is held; lockless
+ * callers must hold rcu_read_lock() and recheck inode_hash_seq.
+ */
+static struct hlist_head *inode_hash_bucket(struct super_block *sb,
+					    unsigned long hashval)
+{
+	struct inode_hash_table *tbl, *future;
+	unsigned long idx;
+
+	tbl = rcu_dereference_check(inode_hashtable,
+				    lockdep_is_held(&inode_hash_lock));
+	idx = hash(tbl, sb, hashval);
+
+	future = rcu_dereference_check(i_hash_future,
+				       lockdep_is_held(&inode_hash_lock));
+	if (unlikely(future) && idx < READ_ONCE(i_hash_migrated))
+		return future->buckets + hash(future, sb, hashval);
+	return tbl->buckets + idx;
 }
 
+static void inode_hash_check_load(void);
+
 /**
  *	__insert_inode_hash - hash an inode
  *	@inode: unhashed inode
@@ -495,13 +544,14 @@ static unsigned long hash(struct super_block *sb, unsigned long hashval)
  */
 void __insert_inode_hash(struct inode *inode, unsigned long hashval)
 {
-	struct hlist_head *b = inode_hashtable + hash(inode->i_sb, hashval);
-
 	spin_lock(&inode_hash_lock);
 	spin_lock(&inode->i_lock);
-	hlist_add_head_rcu(&inode->i_hash, b);
+	inode->i_hashval = hashval;
+	hlist_add_head_rcu(&inode->i_hash,
+			   inode_hash_bucket(inode->i_sb, hashval));
 	spin_unlock(&inode->i_lock);
 	spin_unlock(&inode_hash_lock);
+	inode_hash_check_load();
 }
 EXPORT_SYMBOL(__insert_inode_hash);
 
@@ -819,14 +869,15 @@ static void __wait_on_freeing_inode(struct inode *inode);
  * Called with the inode lock held.
  */
 static struct inode *find_inode(struct super_block *sb,
-				struct hlist_head *head,
+				unsigned long hashval,
 				int (*test)(struct inode *, void *),
 				void *data)
 {
 	struct inode *inode = NULL;
 
 repeat:
-	hlist_for_each_entry(inode, head, i_hash) {
+	/* the hash may have been resized while we waited */
+	hlist_for_each_entry(inode, inode_hash_bucket(sb, hashval), i_hash) {
 		if (inode->i_sb != sb)
 			continue;
 		if (!test(inode, data))
@@ -852,12 +903,12 @@ repeat:
  * iget_locked for details.
  */
 static struct inode *find_inode_fast(struct super_block *sb,
-				struct hlist_head *head, unsigned long ino)
+				unsigned long ino)
 {
 	struct inode *inode = NULL;
 
 repeat:
-	hlist_for_each_entry(inode, head, i_hash) {
+	hlist_for_each_entry(inode, inode_hash_bucket(sb, ino), i_hash) {
 		if (inode->i_ino != ino)
 			continue;
 		if (inode->i_sb != sb)
@@ -1084,13 +1135,12 @@ struct inode *inode_insert5(struct inode *inode, unsigned long hashval,
 			    int (*test)(struct inode *, void *),
 			    int (*set)(struct inode *, void *), void *data)
 {
-	struct hlist_head *head = inode_hashtable + hash(inode->i_sb, hashval);
 	struct inode *old;
 	bool creating = inode->i_state & I_CREATING;
 
 again:
 	spin_lock(&inode_hash_lock);
-	old = find_inode(inode->i_sb, head, test, data);
+	old = find_inode(inode->i_sb, hashval, test, data);
 	if (unlikely(old)) {
 		/*
 		 * Uhhuh, somebody else created the same inode under us.
@@ -1118,13 +1168,17 @@ again:
 	 */
 	spin_lock(&inode->i_lock);
 	inode->i_state |= I_NEW;
-	hlist_add_head_rcu(&inode->i_hash, head);
+	inode->i_hashval = hashval;
+	hlist_add_head_rcu(&inode->i_hash,
+			   inode_hash_bucket(inode->i_sb, hashval));
 	spin_unlock(&inode->i_lock);
 	if (!creating)
 		inode_sb_list_add(inode);
 unlock:
 	spin_unlock(&inode_hash_lock);
 
+	if (inode)
+		inode_hash_check_load();
 	return inode;
 }
 EXPORT_SYMBOL(inode_insert5);
@@ -1184,11 +1238,10 @@ EXPORT_SYMBOL(iget5_locked);
  */
 struct inode *iget_locked(struct super_block *sb, unsigned long ino)
 {
-	struct hlist_head *head = inode_hashtable + hash(sb, ino);
 	struct inode *inode;
 again:
 	spin_lock(&inode_hash_lock);
-	inode = find_inode_fast(sb, head, ino);
+	inode = find_inode_fast(sb, ino);
 	spin_unlock(&inode_hash_lock);
 	if (inode) {
 		if (IS_ERR(inode))
@@ -1207,15 +1260,18 @@ again:
 
 		spin_lock(&inode_hash_lock);
 		/* We released the lock, so.. */
-		old = find_inode_fast(sb, head, ino);
+		old = find_inode_fast(sb, ino);
 		if (!old) {
 			inode->i_ino = ino;
 			spin_lock(&inode->i_lock);
 			inode->i_state = I_NEW;
-			hlist_add_head_rcu(&inode->i_hash, head);
+			inode->i_hashval = ino;
+			hlist_add_head_rcu(&inode->i_hash,
+					   inode_hash_bucket(sb, ino));
 			spin_unlock(&inode->i_lock);
 			inode_sb_list_add(inode);
 			spin_unlock(&inode_hash_lock);
+			inode_hash_check_load();
 
 			/* Return the locked inode with I_NEW set, the
 			 * caller is responsible for filling in the contents
@@ -1252,13 +1308,17 @@ EXPORT_SYMBOL(iget_locked);
  */
 static int test_inode_iunique(struct super_block *sb, unsigned long ino)
 {
-	struct hlist_head *b = inode_hashtable + hash(sb, ino);
 	struct inode *inode;
+	unsigned int seq;
 
-	hlist_for_each_entry_rcu(inode, b, i_hash) {
-		if (inode->i_ino == ino && inode->i_sb == sb)
-			return 0;
-	}
+	do {
+		seq = read_seqcount_begin(&inode_hash_seq);
+		hlist_for_each_entry_rcu(inode, inode_hash_bucket(sb, ino),
+					 i_hash) {
+			if (inode->i_ino == ino && inode->i_sb == sb)
+				return 0;
+		}
+	} while (read_seqcount_retry(&inode_hash_seq, seq));
 	return 1;
 }
 
@@ -1339,11 +1399,10 @@ EXPORT_SYMBOL(igrab);
 struct inode *ilookup5_nowait(struct super_block *sb, unsigned long hashval,
 		int (*test)(struct inode *, void *), void *data)
 {
-	struct hlist_head *head = inode_hashtable + hash(sb, hashval);
 	struct inode *inode;
 
 	spin_lock(&inode_hash_lock);
-	inode = find_inode(sb, head, test, data);
+	inode = find_inode(sb, hashval, test, data);
 	spin_unlock(&inode_hash_lock);
 
 	return IS_ERR(inode) ? NULL : inode;
@@ -1394,11 +1453,10 @@ EXPORT_SYMBOL(ilookup5);
  */
 struct inode *ilookup(struct super_block *sb, unsigned long ino)
 {
-	struct hlist_head *head = inode_hashtable + hash(sb, ino);
 	struct inode *inode;
 again:
 	spin_lock(&inode_hash_lock);
-	inode = find_inode_fast(sb, head, ino);
+	inode = find_inode_fast(sb, ino);
 	spin_unlock(&inode_hash_lock);
 
 	if (inode) {
@@ -1443,12 +1501,11 @@ struct inode *find_inode_nowait(struct super_block *sb,
 					     void *),
 				void *data)
 {
-	struct hlist_head *head = inode_hashtable + hash(sb, hashval);
 	struct inode *inode, *ret_inode = NULL;
 	int mval;
 
 	spin_lock(&inode_hash_lock);
-	hlist_for_each_entry(inode, head, i_hash) {
+	hlist_for_each_entry(inode, inode_hash_bucket(sb, hashval), i_hash) {
 		if (inode->i_sb != sb)
 			continue;
 		mval = match(inode, hashval, data);
@@ -1488,18 +1545,22 @@ EXPORT_SYMBOL(find_inode_nowait);
 struct inode *find_inode_rcu(struct super_block *sb, unsigned long hashval,
 			     int (*test)(struct inode *, void *), void *data)
 {
-	struct hlist_head *head = inode_hashtable + hash(sb, hashval);
 	struct inode *inode;
+	unsigned int seq;
 
 	RCU_LOCKDEP_WARN(!rcu_read_lock_held(),
 			 "suspicious find_inode_rcu() usage");
 
-	hlist_for_each_entry_rcu(inode, head, i_hash) {
-		if (inode->i_sb == sb &&
-		    !(READ_ONCE(inode->i_state) & (I_FREEING | I_WILL_FREE)) &&
-		    test(inode, data))
-			return inode;
-	}
+	do {
+		seq = read_seqcount_begin(&inode_hash_seq);
+		hlist_for_each_entry_rcu(inode, inode_hash_bucket(sb, hashval),
+					 i_hash) {
+			if (inode->i_sb == sb &&
+			    !(READ_ONCE(inode->i_state) & (I_FREEING | I_WILL_FREE)) &&
+			    test(inode, data))
+				return inode;
+		}
+	} while (read_seqcount_retry(&inode_hash_seq, seq));
 	return NULL;
 }
 EXPORT_SYMBOL(find_inode_rcu);
@@ -1526,18 +1587,22 @@ EXPORT_SYMBOL(find_inode_rcu);
 struct inode *find_inode_by_ino_rcu(struct super_block *sb,
 				    unsigned long ino)
 {
-	struct hlist_head *head = inode_hashtable + hash(sb, ino);
 	struct inode *inode;
+	unsigned int seq;
 
 	RCU_LOCKDEP_WARN(!rcu_read_lock_held(),
 			 "suspicious find_inode_by_ino_rcu() usage");
 
-	hlist_for_each_entry_rcu(inode, head, i_hash) {
-		if (inode->i_ino == ino &&
-		    inode->i_sb == sb &&
-		    !(READ_ONCE(inode->i_state) & (I_FREEING | I_WILL_FREE)))
-		    return inode;
-	}
+	do {
+		seq = read_seqcount_begin(&inode_hash_seq);
+		hlist_for_each_entry_rcu(inode, inode_hash_bucket(sb, ino),
+					 i_hash) {
+			if (inode->i_ino == ino &&
+			    inode->i_sb == sb &&
+			    !(READ_ONCE(inode->i_state) & (I_FREEING | I_WILL_FREE)))
+			    return inode;
+		}
+	} while (read_seqcount_retry(&inode_hash_seq, seq));
 	return NULL;
 }
 EXPORT_SYMBOL(find_inode_by_ino_rcu);
@@ -1546,12 +1611,11 @@ int insert_inode_locked(struct inode *inode)
 {
 	struct super_block *sb = inode->i_sb;
 	ino_t ino = inode->i_ino;
-	struct hlist_head *head = inode_hashtable + hash(sb, ino);
 
 	while (1) {
 		struct inode *old = NULL;
 		spin_lock(&inode_hash_lock);
-		hlist_for_each_entry(old, head, i_hash) {
+		hlist_for_each_entry(old, inode_hash_bucket(sb, ino), i_hash) {
 			if (old->i_ino != ino)
 				continue;
 			if (old->i_sb != sb)
@@ -1566,9 +1630,12 @@ int insert_inode_locked(struct inode *inode)
 		if (likely(!old)) {
 			spin_lock(&inode->i_lock);
 			inode->i_state |= I_NEW | I_CREATING;
-			hlist_add_head_rcu(&inode->i_hash, head);
+			inode->i_hashval = ino;
+			hlist_add_head_rcu(&inode->i_hash,
+					   inode_hash_bucket(sb, ino));
 			spin_unlock(&inode->i_lock);
 			spin_unlock(&inode_hash_lock);
+			inode_hash_check_load();
 			return 0;
 		}
 		if (unlikely(old->i_state & I_CREATING)) {
@@ -1927,11 +1994,7 @@ static int __remove_privs(struct dentry *dentry, int kill)
 	return notify_change(dentry, &newattrs, NULL);
 }
 
-/*
- * Remove special file priviledges (suid, capabilities) when file is written
- * to or truncated.
- */
-int file_remove_privs(struct file *file)
+static int __file_remove_privs(struct file *file, unsigned int flags)
 {
 	struct dentry *dentry = file_dentry(file);
 	struct inode *inode = file_inode(file);
@@ -1950,83 +2013,138 @@ int file_remove_privs(struct file *file)
 	kill = dentry_needs_remove_privs(dentry);
 	if (kill < 0)
 		return kill;
-	if (kill)
+	if (kill) {
+		if (flags & IOCB_NOWAIT)
+			return -EAGAIN;
 		error = __remove_privs(dentry, kill);
+	}
 	if (!error)
 		inode_has_no_xattr(inode);
 
 	return error;
 }
-EXPORT_SYMBOL(file_remove_privs);
 
-/**
- *	file_update_time	-	update mtime and ctime time
- *	@file: file accessed
- *
- *	Update the mtime and ctime members of an inode and mark the inode
- *	for writeback.  Note that this function is meant exclusively for
- *	usage in the file write path of filesystems, and filesystems may
- *	choose to explicitly ignore update via this function with the
- *	S_NOCMTIME inode flag, e.g. for network filesystem where these
- *	timestamps are handled by the server.  This can return an error for
- *	file systems who need to allocate space in order to update an inode.
+/*
+ * Remove special file priviledges (suid, capabilities) when file is written
+ * to or truncated.
  */
+int file_remove_privs(struct file *file)
+{
+	return __file_remove_privs(file, 0);
+}
+EXPORT_SYMBOL(file_remove_privs);
 
-int file_update_time(struct file *file)
+/* returns the S_* mask of timestamps that need updating, 0 if none */
+static int inode_needs_update_time(struct inode *inode, struct timespec64 *now)
 {
-	struct inode *inode = file_inode(file);
-	struct timespec64 now;
 	int sync_it = 0;
-	int ret;
 
 	/* First try to exhaust all avenues to not sync */
 	if (IS_NOCMTIME(inode))
 		return 0;
 
-	now = current_time(inode);
-	if (!timespec64_equal(&inode->i_mtime, &now))
+	*now = current_time(inode);
+	if (!timespec64_equal(&inode->i_mtime, now))
 		sync_it = S_MTIME;
 
-	if (!timespec64_equal(&inode->i_ctime, &now))
+	if (!timespec64_equal(&inode->i_ctime, now))
 		sync_it |= S_CTIME;
 
 	if (IS_I_VERSION(inode) && inode_iversion_need_inc(inode))
 		sync_it |= S_VERSION;
 
-	if (!sync_it)
-		return 0;
+	return sync_it;
+}
+
+static int __file_update_time(struct file *file, struct timespec64 *now,
+			      int sync_mode)
+{
+	struct inode *inode = file_inode(file);
+	int ret;
 
 	/* Finally allowed to write? Takes lock. */
 	if (__mnt_want_write_file(file))
 		return 0;
 
-	ret = update_time(inode, &now, sync_it);
+	ret = update_time(inode, now, sync_mode);
 	__mnt_drop_write_file(file);
 
 	return ret;
 }
+
+/**
+ *	file_update_time	-	update mtime and ctime time
+ *	@file: file accessed
+ *
+ *	Update the mtime and ctime members of an inode and mark the inode
+ *	for writeback.  Note that this function is meant exclusively for
+ *	usage in the file write path of filesystems, and filesystems may
+ *	choose to explicitly ignore update via this function with the
+ *	S_NOCMTIME inode flag, e.g. for network filesystem where these
+ *	timestamps are handled by the server.  This can return an error for
+ *	file systems who need to allocate space in order to update an inode.
+ */
+
+int file_update_time(struct file *file)
+{
+	struct timespec64 now;
+	int sync_it;
+
+	sync_it = inode_needs_update_time(file_inode(file), &now);
+	if (sync_it <= 0)
+		return sync_it;
+
+	return __file_update_time(file, &now, sync_it);
+}
 EXPORT_SYMBOL(file_update_time);
 
-/* Caller must hold the file's inode lock */
-int file_modified(struct file *file)
+static int file_modified_flags(struct file *file, int flags)
 {
-	int err;
+	struct timespec64 now;
+	int err, sync_it;
 
 	/*
 	 * Clear the security bits if the process is not being run by root.
 	 * This keeps people from modifying setuid and setgid binaries.
 	 */
-	err = file_remove_privs(file);
+	err = __file_remove_privs(file, flags);
 	if (err)
 		return err;
 
 	if (unlikely(file->f_mode & FMODE_NOCMTIME))
 		return 0;
 
-	return file_update_time(file);
+	sync_it = inode_needs_update_time(file_inode(file), &now);
+	if (sync_it <= 0)
+		return sync_it;
+	/* updating the timestamps may start a transaction */
+	if (flags & IOCB_NOWAIT)
+		return -EAGAIN;
+
+	return __file_update_time(file, &now, sync_it);
+}
+
+/* Caller must hold the file's inode lock */
+int file_modified(struct file *file)
+{
+	return file_modified_flags(file, 0);
 }
 EXPORT_SYMBOL(file_modified);
 
+/**
+ *	kiocb_modified	-	file_modified() for a write iocb
+ *	@iocb: iocb of the write
+ *
+ *	Same as file_modified(), but returns -EAGAIN instead of blocking if
+ *	IOCB_NOWAIT is set and privileges or timestamps need updating.
+ *	Caller must hold the file's inode lock.
+ */
+int kiocb_modified(struct kiocb *iocb)
+{
+	return file_modified_flags(iocb->ki_filp, iocb->ki_flags);
+}
+EXPORT_SYMBOL(kiocb_modified);
+
 int inode_needs_sync(struct inode *inode)
 {
 	if (IS_SYNC(inode))
@@ -2061,6 +2179,207 @@ static void __wait_on_freeing_inode(struct inode *inode)
 	spin_lock(&inode_hash_lock);
 }
 
+/*
+ * Online resizing of the inode hash.
+ *
+ * Checked every I_HASH_CHECK_INTERVAL hash insertions on a CPU: grow once
+ * there are more than two inodes per bucket, shrink back towards the boot
+ * size once less than 1/8 of the buckets would be used.  Inodes are moved
+ * by the hash value they were inserted with, kept in inode->i_hashval.
+ */
+#define I_HASH_CHECK_INTERVAL	1024
+#define I_HASH_MIGRATE_BATCH	256
+#define I_HASH_MAX_BITS		30
+#define I_HASH_HIST_BINS	8
+
+static DEFINE_PER_CPU(unsigned int, i_hash_inserts);
+static DEFINE_MUTEX(inode_hash_resize_mutex);
+static unsigned long i_hash_resizes;
+
+static void inode_hash_resize_workfn(struct work_struct *work);
+static DECLARE_WORK(inode_hash_resize_work, inode_hash_resize_workfn);
+
+static unsigned int inode_hash_target_bits(void)
+{
+	unsigned int bits = order_base_2(get_nr_inodes());
+
+	return clamp_t(unsigned int, bits, i_hash_boot.shift, I_HASH_MAX_BITS);
+}
+
+static void inode_hash_check_load(void)
+{
+	unsigned long nr;
+	unsigned int bits;
+
+	if (likely(this_cpu_inc_return(i_hash_inserts) &
+		   (I_HASH_CHECK_INTERVAL - 1)))
+		return;
+
+	nr = get_nr_inodes();
+	rcu_read_lock();
+	bits = rcu_dereference(inode_hashtable)->shift;
+	rcu_read_unlock();
+
+	if ((nr > (2UL << bits) && bits < I_HASH_MAX_BITS) ||
+	    (bits > i_hash_boot.shift && nr < (1UL << bits) / 8))
+		queue_work(system_unbound_wq, &inode_hash_resize_work);
+}
+
+static struct inode_hash_table *inode_hash_alloc(unsigned int bits)
+{
+	struct inode_hash_table *tbl = kmalloc(sizeof(*tbl), GFP_KERNEL);
+
+	if (!tbl)
+		return NULL;
+	tbl->buckets = vzalloc(array_size(1UL << bits,
+					  sizeof(struct hlist_head)));
+	if (!tbl->buckets) {
+		kfree(tbl);
+		return NULL;
+	}
+	tbl->shift = bits;
+	tbl->mask = (1U << bits) - 1;
+	return tbl;
+}
+
+static void inode_hash_free(struct inode_hash_table *tbl)
+{
+	/* only a hashdist boot table came from vmalloc */
+	if (is_vmalloc_addr(tbl->buckets))
+		vfree(tbl->buckets);
+	if (tbl != &i_hash_boot)
+		kfree(tbl);
+}
+
+static void inode_hash_resize(struct inode_hash_table *future)
+{
+	struct inode_hash_table *old;
+	unsigned long i, nr;
+
+	old = rcu_dereference_protected(inode_hashtable,
+				lockdep_is_held(&inode_hash_resize_mutex));
+	nr = old->mask + 1UL;
+
+	spin_lock(&inode_hash_lock);
+	WRITE_ONCE(i_hash_migrated, 0);
+	rcu_assign_pointer(i_hash_future, future);
+	spin_unlock(&inode_hash_lock);
+
+	for (i = 0; i < nr; ) {
+		unsigned long end = min(i + I_HASH_MIGRATE_BATCH, nr);
+
+		spin_lock(&inode_hash_lock);
+		write_seqcount_begin(&inode_hash_seq);
+		for (; i < end; i++) {
+			struct hlist_node *next;
+			struct inode *inode;
+
+			hlist_for_each_entry_safe(inode, next, old->buckets + i,
+						  i_hash) {
+				struct hlist_head *b = future->buckets +
+					hash(future, inode->i_sb, inode->i_hashval);
+
+				spin_lock(&inode->i_lock);
+				hlist_del_rcu(&inode->i_hash);
+				hlist_add_head_rcu(&inode->i_hash, b);
+				spin_unlock(&inode->i_lock);
+			}
+		}
+		WRITE_ONCE(i_hash_migrated, i);
+		write_seqcount_end(&inode_hash_seq);
+		spin_unlock(&inode_hash_lock);
+		cond_resched();
+	}
+
+	spin_lock(&inode_hash_lock);
+	write_seqcount_begin(&inode_hash_seq);
+	rcu_assign_pointer(inode_hashtable, future);
+	RCU_INIT_POINTER(i_hash_future, NULL);
+	write_seqcount_end(&inode_hash_seq);
+	spin_unlock(&inode_hash_lock);
+
+	/* lockless lookups may still be walking the old chains */
+	synchronize_rcu();
+	inode_hash_free(old);
+	i_hash_resizes++;
+}
+
+static void inode_hash_resize_workfn(struct work_struct *work)
+{
+	struct inode_hash_table *tbl, *future;
+	unsigned int bits;
+
+	mutex_lock(&inode_hash_resize_mutex);
+	tbl = rcu_dereference_protected(inode_hashtable,
+				lockdep_is_held(&inode_hash_resize_mutex));
+	bits = inode_hash_target_bits();
+	if (bits == tbl->shift)
+		goto out;
+
+	future = inode_hash_alloc(bits);
+	if (!future) {
+		pr_warn_ratelimited("VFS: can't resize inode hash to %u buckets\n",
+				    1U << bits);
+		goto out;
+	}
+	inode_hash_resize(future);
+out:
+	mutex_unlock(&inode_hash_resize_mutex);
+}
+
+#ifdef CONFIG_DEBUG_FS
+/* /sys/kernel/debug/icache/hash_stats */
+static int inode_hash_stats_show(struct seq_file *m, void *v)
+{
+	unsigned long hist[I_HASH_HIST_BINS] = { 0 };
+	unsigned long i, entries = 0, longest = 0;
+	struct inode_hash_table *tbl;
+	int bin;
+
+	mutex_lock(&inode_hash_resize_mutex);
+	tbl = rcu_dereference_protected(inode_hashtable,
+				lockdep_is_held(&inode_hash_resize_mutex));
+	for (i = 0; i <= tbl->mask; i++) {
+		struct inode *inode;
+		unsigned long len = 0;
+
+		rcu_read_lock();
+		hlist_for_each_entry_rcu(inode, tbl->buckets + i, i_hash)
+			len++;
+		rcu_read_unlock();
+
+		entries += len;
+		longest = max(longest, len);
+		hist[min_t(int, fls_long(len), I_HASH_HIST_BINS - 1)]++;
+		if (!(i % I_HASH_CHECK_INTERVAL))
+			cond_resched();
+	}
+	seq_printf(m, "buckets: %lu\nboot buckets: %lu\nresizes: %lu\n",
+		   tbl->mask + 1UL, i_hash_boot.mask + 1UL, i_hash_resizes);
+	mutex_unlock(&inode_hash_resize_mutex);
+
+	seq_printf(m, "entries: %lu\nlongest chain: %lu\n", entries, longest);
+	seq_puts(m, "chain length histogram:\n");
+	seq_printf(m, "  %6s: %lu\n", "0", hist[0]);
+	for (bin = 1; bin < I_HASH_HIST_BINS - 1; bin++)
+		seq_printf(m, "  %3lu-%-3lu: %lu\n", 1UL << (bin - 1),
+			   (1UL << bin) - 1, hist[bin]);
+	seq_printf(m, "  %5lu+: %lu\n", 1UL << (bin - 1), hist[bin]);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(inode_hash_stats);
+
+static int __init inode_hash_debugfs_init(void)
+{
+	struct dentry *dir = debugfs_create_dir("icache", NULL);
+
+	debugfs_create_file("hash_stats", 0400, dir, NULL,
+			    &inode_hash_stats_fops);
+	return 0;
+}
+late_initcall(inode_hash_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
+
 static __initdata unsigned long ihash_entries;
 static int __init set_ihash_entries(char *str)
 {
@@ -2082,14 +2401,14 @@ void __init inode_init_early(void)
 	if (hashdist)
 		return;
 
-	inode_hashtable =/* inode 哈希表  */
+	i_hash_boot.buckets =/* inode 哈希表  */
 		alloc_large_system_hash("Inode-cache",
 					sizeof(struct hlist_head),
 					ihash_entries,
 					14,
 					HASH_EARLY | HASH_ZERO,
-					&i_hash_shift,
-					&i_hash_mask,
+					&i_hash_boot.shift,
+					&i_hash_boot.mask,
 					0,
 					0);
 }
@@ -2108,14 +2427,14 @@ void __init inode_init(void)    /* inod 缓存 */
 	if (!hashdist)
 		return;
 
-	inode_hashtable =
+	i_hash_boot.buckets =
 		alloc_large_system_hash("Inode-cache",
 					sizeof(struct hlist_head),
 					ihash_entries,
 					14,
 					HASH_ZERO,
-					&i_hash_shift,
-					&i_hash_mask,
+					&i_hash_boot.shift,
+					&i_hash_boot.mask,
 					0,
 					0);
 }
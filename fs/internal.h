@@ -55,10 +55,22 @@ extern int finish_clean_context(struct fs_context *fc);
  */
 extern int filename_lookup(int dfd, struct filename *name, unsigned flags,
 			   struct path *path, struct path *root);
+int filename_lookup_in(const struct path *dir, struct filename *name,
+		       unsigned flags, struct path *path);
 extern int vfs_path_lookup(struct dentry *, struct vfsmount *,
 			   const char *, unsigned int, struct path *);
-long do_rmdir(int dfd, struct filename *name);
-long do_unlinkat(int dfd, struct filename *name);
+long do_rmdir(int dfd, struct filename *name, unsigned int lookup_flags);
+long do_unlinkat(int dfd, struct filename *name, unsigned int lookup_flags);
+long do_mkdirat(int dfd, struct filename *name, umode_t mode,
+		unsigned int lookup_flags);
+long do_symlinkat(struct filename *from, int newdfd, struct filename *to,
+		  unsigned int lookup_flags);
+int do_linkat(int olddfd, struct filename *old, int newdfd,
+	      struct filename *new, int flags, unsigned int lookup_flags);
+void inode_exec_cache_free(struct inode *inode);
+int do_renameat2(int olddfd, struct filename *from, int newdfd,
+		 struct filename *to, unsigned int flags,
+		 unsigned int lookup_flags);
 int may_linkat(struct path *link);
 
 /*
@@ -96,6 +108,7 @@ extern struct file *alloc_empty_file_noaccount(int, const struct cred *);
  */
 extern int reconfigure_super(struct fs_context *);
 extern bool trylock_super(struct super_block *sb);
+extern void sb_queue_negative_dentry_prune(struct super_block *sb);
 extern struct super_block *user_get_super(dev_t);
 extern bool mount_capable(struct fs_context *);
 
@@ -141,6 +154,7 @@ extern int invalidate_inodes(struct super_block *, bool);
  */
 extern int d_set_mounted(struct dentry *dentry);
 extern long prune_dcache_sb(struct super_block *sb, struct shrink_control *sc);
+extern void prune_negative_dentries(struct super_block *sb);
 extern struct dentry *d_alloc_cursor(struct dentry *);
 extern struct dentry * d_alloc_pseudo(struct super_block *, const struct qstr *);
 extern char *simple_dname(struct dentry *, char *, int);
@@ -20,6 +20,7 @@
 #include <linux/blk-cgroup.h>
 #include <linux/audit.h>
 #include <linux/cpu.h>
+#include <linux/seq_file.h>
 
 #include "../kernel/sched/sched.h"
 #include "io-wq.h"
@@ -83,6 +84,7 @@ struct io_wqe_acct {
 enum {
 	IO_WQ_ACCT_BOUND,
 	IO_WQ_ACCT_UNBOUND,
+	IO_WQ_ACCT_NR,
 };
 
 /*
@@ -97,7 +99,9 @@ struct io_wqe {
 	} ____cacheline_aligned_in_smp;
 
 	int node;
-	struct io_wqe_acct acct[2];
+	struct io_wqe_acct acct[IO_WQ_ACCT_NR];
+	/* CPUs the workers of this node run on, see io_wqe_update_cpumask() */
+	cpumask_var_t cpu_mask;
 
 	struct hlist_nulls_head free_list;
 	struct list_head all_list;
@@ -124,6 +128,15 @@ struct io_wq {
 	struct hlist_node cpuhp_node;
 
 	refcount_t use_refs;
+
+	/* RLIMIT_NPROC of the creator, caps unbound workers across the user */
+	unsigned long nproc_limit;
+
+	/* serializes worker affinity changes against worker creation */
+	struct mutex aff_lock;
+	/* set through io_wq_cpu_affinity(), else workers follow their node */
+	cpumask_var_t aff_mask;
+	bool has_aff_mask;
 };
 
 static enum cpuhp_state io_wq_online;
@@ -676,6 +689,25 @@ void io_wq_worker_sleeping(struct task_struct *tsk)
 	raw_spin_unlock_irq(&wqe->lock);
 }
 
+/*
+ * Workers run on the CPUs of their node, intersected with the affinity mask
+ * of the io_wq if one was set. If that leaves nothing, the node's work is
+ * run on any CPU of the affinity mask instead.
+ */
+static void io_wqe_update_cpumask(struct io_wqe *wqe)
+{
+	struct io_wq *wq = wqe->wq;
+	const struct cpumask *node_mask = cpu_possible_mask;
+
+	if (wqe->node != NUMA_NO_NODE)
+		node_mask = cpumask_of_node(wqe->node);
+
+	if (!wq->has_aff_mask)
+		cpumask_copy(wqe->cpu_mask, node_mask);
+	else if (!cpumask_and(wqe->cpu_mask, wq->aff_mask, node_mask))
+		cpumask_copy(wqe->cpu_mask, wq->aff_mask);
+}
+
 static bool create_io_worker(struct io_wq *wq, struct io_wqe *wqe, int index)
 {
 	struct io_wqe_acct *acct = &wqe->acct[index];
@@ -696,8 +728,9 @@ static bool create_io_worker(struct io_wq *wq, struct io_wqe *wqe, int index)
 		kfree(worker);
 		return false;
 	}
-	kthread_bind_mask(worker->task, cpumask_of_node(wqe->node));
 
+	mutex_lock(&wq->aff_lock);
+	kthread_bind_mask(worker->task, wqe->cpu_mask);
 	raw_spin_lock_irq(&wqe->lock);
 	hlist_nulls_add_head_rcu(&worker->nulls_node, &wqe->free_list);
 	list_add_tail_rcu(&worker->all_list, &wqe->all_list);
@@ -708,6 +741,7 @@ static bool create_io_worker(struct io_wq *wq, struct io_wqe *wqe, int index)
 		worker->flags |= IO_WORKER_F_FIXED;
 	acct->nr_workers++;
 	raw_spin_unlock_irq(&wqe->lock);
+	mutex_unlock(&wq->aff_lock);
 
 	if (index == IO_WQ_ACCT_UNBOUND)
 		atomic_inc(&wq->user->processes);
@@ -850,7 +884,7 @@ static bool io_wq_can_queue(struct io_wqe *wqe, struct io_wqe_acct *acct,
 	if (free_worker)
 		return true;
 
-	if (atomic_read(&wqe->wq->user->processes) >= acct->max_workers &&
+	if (atomic_read(&wqe->wq->user->processes) >= wqe->wq->nproc_limit &&
 	    !(capable(CAP_SYS_RESOURCE) || capable(CAP_SYS_ADMIN)))
 		return false;
 
@@ -1112,8 +1146,13 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 
 	/* caller must already hold a reference to this */
 	wq->user = data->user;
+	if (wq->user)
+		wq->nproc_limit = task_rlimit(current, RLIMIT_NPROC);
+	mutex_init(&wq->aff_lock);
 
 	ret = -ENOMEM;
+	if (!alloc_cpumask_var(&wq->aff_mask, GFP_KERNEL))
+		goto err;
 	for_each_node(node) {
 		struct io_wqe *wqe;
 		int alloc_node = node;
@@ -1125,14 +1164,14 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 			goto err;
 		wq->wqes[node] = wqe;
 		wqe->node = alloc_node;
+		if (!alloc_cpumask_var(&wqe->cpu_mask, GFP_KERNEL))
+			goto err;
 		wqe->acct[IO_WQ_ACCT_BOUND].max_workers = bounded;
 		atomic_set(&wqe->acct[IO_WQ_ACCT_BOUND].nr_running, 0);
-		if (wq->user) {
-			wqe->acct[IO_WQ_ACCT_UNBOUND].max_workers =
-					task_rlimit(current, RLIMIT_NPROC);
-		}
+		wqe->acct[IO_WQ_ACCT_UNBOUND].max_workers = wq->nproc_limit;
 		atomic_set(&wqe->acct[IO_WQ_ACCT_UNBOUND].nr_running, 0);
 		wqe->wq = wq;
+		io_wqe_update_cpumask(wqe);
 		raw_spin_lock_init(&wqe->lock);
 		INIT_WQ_LIST(&wqe->work_list);
 		INIT_HLIST_NULLS_HEAD(&wqe->free_list, 0);
@@ -1158,8 +1197,13 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 	complete(&wq->done);
 err:
 	cpuhp_state_remove_instance_nocalls(io_wq_online, &wq->cpuhp_node);
-	for_each_node(node)
+	for_each_node(node) {
+		if (!wq->wqes[node])
+			continue;
+		free_cpumask_var(wq->wqes[node]->cpu_mask);
 		kfree(wq->wqes[node]);
+	}
+	free_cpumask_var(wq->aff_mask);
 err_wqes:
 	kfree(wq->wqes);
 err_wq:
@@ -1192,8 +1236,11 @@ static void __io_wq_destroy(struct io_wq *wq)
 
 	wait_for_completion(&wq->done);
 
-	for_each_node(node)
+	for_each_node(node) {
+		free_cpumask_var(wq->wqes[node]->cpu_mask);
 		kfree(wq->wqes[node]);
+	}
+	free_cpumask_var(wq->aff_mask);
 	kfree(wq->wqes);
 	kfree(wq);
 }
@@ -1216,24 +1263,130 @@ static bool io_wq_worker_affinity(struct io_worker *worker, void *data)
 	struct rq *rq;
 
 	rq = task_rq_lock(task, &rf);
-	do_set_cpus_allowed(task, cpumask_of_node(worker->wqe->node));
+	do_set_cpus_allowed(task, worker->wqe->cpu_mask);
 	task->flags |= PF_NO_SETAFFINITY;
 	task_rq_unlock(rq, task, &rf);
 	return false;
 }
 
-static int io_wq_cpu_online(unsigned int cpu, struct hlist_node *node)
+static void io_wq_update_affinity(struct io_wq *wq)
+	__must_hold(&wq->aff_lock)
 {
-	struct io_wq *wq = hlist_entry_safe(node, struct io_wq, cpuhp_node);
-	int i;
+	int node;
+
+	for_each_node(node)
+		io_wqe_update_cpumask(wq->wqes[node]);
 
 	rcu_read_lock();
-	for_each_node(i)
-		io_wq_for_each_worker(wq->wqes[i], io_wq_worker_affinity, NULL);
+	for_each_node(node)
+		io_wq_for_each_worker(wq->wqes[node], io_wq_worker_affinity, NULL);
 	rcu_read_unlock();
+}
+
+static int io_wq_cpu_online(unsigned int cpu, struct hlist_node *node)
+{
+	struct io_wq *wq = hlist_entry_safe(node, struct io_wq, cpuhp_node);
+
+	mutex_lock(&wq->aff_lock);
+	io_wq_update_affinity(wq);
+	mutex_unlock(&wq->aff_lock);
+	return 0;
+}
+
+/*
+ * Restrict the workers of @wq to @mask, or let them follow their NUMA node
+ * again if @mask is NULL. Workers still prefer the CPUs of their own node
+ * within @mask, so punted work stays close to the memory it was queued from.
+ */
+int io_wq_cpu_affinity(struct io_wq *wq, const struct cpumask *mask)
+{
+	if (mask && !cpumask_intersects(mask, cpu_online_mask))
+		return -EINVAL;
+
+	mutex_lock(&wq->aff_lock);
+	wq->has_aff_mask = mask != NULL;
+	if (mask)
+		cpumask_copy(wq->aff_mask, mask);
+	io_wq_update_affinity(wq);
+	mutex_unlock(&wq->aff_lock);
 	return 0;
 }
 
+/*
+ * Set the per-node limits for bounded and unbounded workers to @new_count,
+ * leaving a limit alone if its entry is zero. Returns the previous limits in
+ * @new_count. Lowering a limit doesn't kill busy workers, surplus ones exit
+ * once they idle out.
+ */
+int io_wq_max_workers(struct io_wq *wq, int *new_count)
+{
+	int prev[IO_WQ_ACCT_NR] = { 0, };
+	bool first_node = true;
+	int i, node;
+
+	BUILD_BUG_ON((int) IO_WQ_ACCT_BOUND   != (int) IO_WQ_BOUND);
+	BUILD_BUG_ON((int) IO_WQ_ACCT_UNBOUND != (int) IO_WQ_UNBOUND);
+
+	for (i = 0; i < IO_WQ_ACCT_NR; i++) {
+		if (new_count[i] > task_rlimit(current, RLIMIT_NPROC))
+			new_count[i] = task_rlimit(current, RLIMIT_NPROC);
+	}
+
+	for_each_node(node) {
+		struct io_wqe *wqe = wq->wqes[node];
+
+		raw_spin_lock_irq(&wqe->lock);
+		for (i = 0; i < IO_WQ_ACCT_NR; i++) {
+			struct io_wqe_acct *acct = &wqe->acct[i];
+
+			if (first_node)
+				prev[i] = acct->max_workers;
+			if (new_count[i])
+				acct->max_workers = new_count[i];
+		}
+		raw_spin_unlock_irq(&wqe->lock);
+		first_node = false;
+	}
+
+	for (i = 0; i < IO_WQ_ACCT_NR; i++)
+		new_count[i] = prev[i];
+	return 0;
+}
+
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m)
+{
+	int node;
+
+	mutex_lock(&wq->aff_lock);
+	if (wq->has_aff_mask)
+		seq_printf(m, "IoWqCpus:\t%*pbl\n", cpumask_pr_args(wq->aff_mask));
+	else
+		seq_puts(m, "IoWqCpus:\tnode\n");
+
+	for_each_node(node) {
+		struct io_wqe *wqe = wq->wqes[node];
+		struct io_wqe_acct acct[IO_WQ_ACCT_NR];
+		bool stalled;
+
+		raw_spin_lock_irq(&wqe->lock);
+		memcpy(acct, wqe->acct, sizeof(acct));
+		stalled = wqe->flags & IO_WQE_FLAG_STALLED;
+		raw_spin_unlock_irq(&wqe->lock);
+
+		seq_printf(m, "IoWqNode%d:\tbound %u/%u running %d, unbound %u/%u running %d%s, cpus %*pbl\n",
+			   node,
+			   acct[IO_WQ_ACCT_BOUND].nr_workers,
+			   acct[IO_WQ_ACCT_BOUND].max_workers,
+			   atomic_read(&acct[IO_WQ_ACCT_BOUND].nr_running),
+			   acct[IO_WQ_ACCT_UNBOUND].nr_workers,
+			   acct[IO_WQ_ACCT_UNBOUND].max_workers,
+			   atomic_read(&acct[IO_WQ_ACCT_UNBOUND].nr_running),
+			   stalled ? ", stalled" : "",
+			   cpumask_pr_args(wqe->cpu_mask));
+	}
+	mutex_unlock(&wq->aff_lock);
+}
+
 static __init int io_wq_init(void)
 {
 	int ret;
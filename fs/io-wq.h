@@ -4,6 +4,13 @@
 #include <linux/io_uring.h>
 
 struct io_wq;
+struct seq_file;
+
+/* order of the limits passed to io_wq_max_workers() */
+enum {
+	IO_WQ_BOUND,
+	IO_WQ_UNBOUND,
+};
 
 enum {
 	IO_WQ_WORK_CANCEL	= 1,
@@ -139,6 +146,10 @@ enum io_wq_cancel io_wq_cancel_cb(struct io_wq *wq, work_cancel_fn *cancel,
 
 struct task_struct *io_wq_get_task(struct io_wq *wq);
 
+int io_wq_cpu_affinity(struct io_wq *wq, const struct cpumask *mask);
+int io_wq_max_workers(struct io_wq *wq, int *new_count);
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m);
+
 #if defined(CONFIG_IO_WQ)
 extern void io_wq_worker_sleeping(struct task_struct *);
 extern void io_wq_worker_running(struct task_struct *);
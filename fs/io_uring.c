@@ -71,6 +71,7 @@
 #include <linux/sizes.h>
 #include <linux/hugetlb.h>
 #include <linux/highmem.h>
+#include <linux/vmalloc.h>
 #include <linux/namei.h>
 #include <linux/fsnotify.h>
 #include <linux/fadvise.h>
@@ -80,6 +81,7 @@
 #include <linux/task_work.h>
 #include <linux/pagemap.h>
 #include <linux/io_uring.h>
+#include <linux/io_uring/cmd.h>
 #include <linux/blk-cgroup.h>
 #include <linux/audit.h>
 
@@ -226,6 +228,15 @@ struct io_buffer {
 	__u16 bid;
 };
 
+/* provided buffer group backed by a ring mapped from userspace */
+struct io_buffer_ring {
+	struct io_uring_buf_ring *br;
+	struct page **pages;
+	int nr_pages;
+	__u16 head;
+	__u16 mask;
+};
+
 struct io_restriction {
 	DECLARE_BITMAP(register_op, IORING_REGISTER_LAST);
 	DECLARE_BITMAP(sqe_op, IORING_OP_LAST);
@@ -295,6 +306,7 @@ struct io_ring_ctx {
 		struct list_head	defer_list;
 		struct list_head	timeout_list;
 		struct list_head	cq_overflow_list;
+		struct list_head	cq_notif_overflow_list;
 
 		wait_queue_head_t	inflight_wait;
         /**
@@ -362,6 +374,7 @@ struct io_ring_ctx {
 #endif
 
 	struct idr		io_buffer_idr;
+	struct idr		io_buf_ring_idr;
 
 	struct idr		personality_idr;
 
@@ -380,8 +393,18 @@ struct io_ring_ctx {
 	struct {
 		struct mutex		uring_lock;
 		wait_queue_head_t	wait;
+		/*
+		 * IORING_SETUP_DEFER_TASKRUN task_work, run by submitter_task
+		 * from io_cqring_wait(). local_work_task is set while it does
+		 * so with uring_lock held.
+		 */
+		struct llist_head	work_llist;
+		struct task_struct	*local_work_task;
 	} /* ____cacheline_aligned_in_smp---*/;
 
+	/* if IORING_SETUP_SINGLE_ISSUER, the only task allowed to enter */
+	struct task_struct	*submitter_task;
+
 	struct {
 		spinlock_t		completion_lock;
 
@@ -398,6 +421,13 @@ struct io_ring_ctx {
 
 		spinlock_t		inflight_lock;
 		struct list_head	inflight_list;
+
+		/*
+		 * uring_cmds the driver holds on to indefinitely, canceled via
+		 * ->uring_cmd(IO_URING_F_CANCEL) on exit. Protected by
+		 * ->completion_lock.
+		 */
+		struct hlist_head	cancelable_uring_cmd;
 	} /* ____cacheline_aligned_in_smp---*/;
 
 	struct delayed_work		file_put_work;
@@ -491,7 +521,11 @@ struct io_sr_msg {
 	int				msg_flags;
 	int				bgid;
 	size_t				len;
-	struct io_buffer		*kbuf;
+	union {
+		struct io_buffer	*kbuf;
+		/* buffer picked from a ring mapped group */
+		void __user		*ubuf;
+	};
 };
 
 struct io_open {
@@ -559,6 +593,60 @@ struct io_statx {
 	struct statx __user		*buffer;
 };
 
+struct io_rename {
+	struct file			*file;
+	int				old_dfd;
+	int				new_dfd;
+	struct filename			*oldpath;
+	struct filename			*newpath;
+	int				flags;
+};
+
+struct io_unlink {
+	struct file			*file;
+	int				dfd;
+	int				flags;
+	struct filename			*filename;
+};
+
+struct io_mkdir {
+	struct file			*file;
+	int				dfd;
+	umode_t				mode;
+	struct filename			*filename;
+};
+
+/* IORING_OP_LINKAT and IORING_OP_SYMLINKAT */
+struct io_hardlink {
+	struct file			*file;
+	int				old_dfd;
+	int				new_dfd;
+	struct filename			*oldpath;
+	struct filename			*newpath;
+	int				flags;
+};
+
+struct io_sendzc {
+	struct file			*file;
+	void __user			*buf;
+	size_t				len;
+	u16				flags;
+	unsigned int			msg_flags;
+};
+
+/*
+ * Notification of a zero-copy send, released by the network stack once it
+ * no longer references the pages. If the CQ ring is full it waits on
+ * ctx->cq_notif_overflow_list, there's no request left to park.
+ */
+struct io_sendzc_notif {
+	struct ubuf_info		uarg;
+	struct io_ring_ctx		*ctx;
+	u64				user_data;
+	u32				res;
+	struct list_head		list;
+};
+
 struct io_completion {
 	struct file			*file;
 	struct list_head		list;
@@ -606,6 +694,9 @@ enum {
 	REQ_F_NO_FILE_TABLE_BIT,
 	REQ_F_WORK_INITIALIZED_BIT,
 	REQ_F_LTIMEOUT_ACTIVE_BIT,
+	REQ_F_APOLL_MULTISHOT_BIT,
+	REQ_F_BUFFER_RING_BIT,
+	REQ_F_CANCELABLE_BIT,
 
 	/* not a real bit, just to check we're not overflowing the space */
 	__REQ_F_LAST_BIT,
@@ -651,6 +742,12 @@ enum {
 	REQ_F_WORK_INITIALIZED	= BIT(REQ_F_WORK_INITIALIZED_BIT),
 	/* linked timeout is active, i.e. prepared by link's head */
 	REQ_F_LTIMEOUT_ACTIVE	= BIT(REQ_F_LTIMEOUT_ACTIVE_BIT),
+	/* stays armed on poll and posts a CQE per event */
+	REQ_F_APOLL_MULTISHOT	= BIT(REQ_F_APOLL_MULTISHOT_BIT),
+	/* selected buffer came from a ring mapped group, bid in buf_index */
+	REQ_F_BUFFER_RING	= BIT(REQ_F_BUFFER_RING_BIT),
+	/* parked uring_cmd on ctx->cancelable_uring_cmd */
+	REQ_F_CANCELABLE	= BIT(REQ_F_CANCELABLE_BIT),
 };
 
 struct async_poll {
@@ -685,6 +782,12 @@ struct io_kiocb {
 		struct io_splice	splice;
 		struct io_provide_buf	pbuf;
 		struct io_statx		statx;
+		struct io_sendzc	sendzc;
+		struct io_uring_cmd	uring_cmd;
+		struct io_rename	rename;
+		struct io_unlink	unlink;
+		struct io_mkdir		mkdir;
+		struct io_hardlink	hardlink;
 		/* use only after cleaning per-op data, see io_clean_op() */
 		struct io_completion	compl;
 	};
@@ -703,6 +806,8 @@ struct io_kiocb {
 	refcount_t			refs;
 	struct task_struct		*task;
 	u64				user_data;
+	/* IORING_SETUP_CQE32: big_cqe[0] of the completion */
+	u64				cqe_extra;
 
 	struct list_head		link_list;
 
@@ -723,7 +828,12 @@ struct io_kiocb {
      *  or set by `__io_async_wake()`
      */
 	struct callback_head		task_work;
-	/* for polled requests, i.e. IORING_OP_POLL_ADD and async armed poll */
+	/* ctx->work_llist entry for IORING_SETUP_DEFER_TASKRUN */
+	struct llist_node		work_node;
+	/*
+	 * for polled requests, i.e. IORING_OP_POLL_ADD and async armed poll,
+	 * and for cancelable uring_cmds on ctx->cancelable_uring_cmd
+	 */
 	struct hlist_node		hash_node;
 	struct async_poll		*apoll;
 	struct io_wq_work		work;
@@ -736,6 +846,8 @@ struct io_defer_entry {
 };
 
 #define IO_IOPOLL_BATCH			8
+/* CQEs a multishot request posts in one issue before it yields */
+#define IO_MULTISHOT_MAX_RETRY		32
 
 struct io_comp_state {
 	unsigned int		nr;
@@ -961,6 +1073,39 @@ static const struct io_op_def io_op_defs[] = {
 		.hash_reg_file		= 1,
 		.unbound_nonreg_file	= 1,
 	},
+	[IORING_OP_SEND_ZC] = {
+		.needs_file		= 1,
+		.unbound_nonreg_file	= 1,
+		.pollout		= 1,
+		.work_flags		= IO_WQ_WORK_MM | IO_WQ_WORK_BLKCG,
+	},
+	[IORING_OP_URING_CMD] = {
+		.needs_file		= 1,
+		.unbound_nonreg_file	= 1,
+		.needs_async_data	= 1,
+		.async_size		= 2 * sizeof(struct io_uring_sqe),
+		.work_flags		= IO_WQ_WORK_MM | IO_WQ_WORK_BLKCG,
+	},
+	[IORING_OP_RENAMEAT] = {
+		.work_flags		= IO_WQ_WORK_FILES | IO_WQ_WORK_FS |
+						IO_WQ_WORK_BLKCG,
+	},
+	[IORING_OP_UNLINKAT] = {
+		.work_flags		= IO_WQ_WORK_FILES | IO_WQ_WORK_FS |
+						IO_WQ_WORK_BLKCG,
+	},
+	[IORING_OP_MKDIRAT] = {
+		.work_flags		= IO_WQ_WORK_FILES | IO_WQ_WORK_FS |
+						IO_WQ_WORK_BLKCG,
+	},
+	[IORING_OP_SYMLINKAT] = {
+		.work_flags		= IO_WQ_WORK_FILES | IO_WQ_WORK_FS |
+						IO_WQ_WORK_BLKCG,
+	},
+	[IORING_OP_LINKAT] = {
+		.work_flags		= IO_WQ_WORK_FILES | IO_WQ_WORK_FS |
+						IO_WQ_WORK_BLKCG,
+	},
 };
 
 enum io_mem_account {
@@ -1205,12 +1350,15 @@ static struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_LIST_HEAD(&ctx->sqd_list);
 	init_waitqueue_head(&ctx->cq_wait);
 	INIT_LIST_HEAD(&ctx->cq_overflow_list);
+	INIT_LIST_HEAD(&ctx->cq_notif_overflow_list);
 	init_completion(&ctx->ref_comp);
 	init_completion(&ctx->sq_thread_comp);
 	idr_init(&ctx->io_buffer_idr);
+	idr_init(&ctx->io_buf_ring_idr);
 	idr_init(&ctx->personality_idr);
 	mutex_init(&ctx->uring_lock);
 	init_waitqueue_head(&ctx->wait);
+	init_llist_head(&ctx->work_llist);
 	spin_lock_init(&ctx->completion_lock);
 	INIT_LIST_HEAD(&ctx->iopoll_list);
 	INIT_LIST_HEAD(&ctx->defer_list);
@@ -1218,6 +1366,7 @@ static struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	init_waitqueue_head(&ctx->inflight_wait);
 	spin_lock_init(&ctx->inflight_lock);
 	INIT_LIST_HEAD(&ctx->inflight_list);
+	INIT_HLIST_HEAD(&ctx->cancelable_uring_cmd);
 	INIT_DELAYED_WORK(&ctx->file_put_work, io_file_put_work);
 	init_llist_head(&ctx->file_put_llist);
 	return ctx;
@@ -1611,7 +1760,20 @@ static struct io_uring_cqe *io_get_cqring(struct io_ring_ctx *ctx)
 		return NULL;
 
 	ctx->cached_cq_tail++;
-	return &rings->cqes[tail & ctx->cq_mask];
+	tail &= ctx->cq_mask;
+	/* a 32 byte CQE takes up two slots of the array */
+	if (ctx->flags & IORING_SETUP_CQE32)
+		tail <<= 1;
+	return &rings->cqes[tail];
+}
+
+static inline void io_fill_cqe_extra(struct io_ring_ctx *ctx,
+				     struct io_uring_cqe *cqe, u64 extra)
+{
+	if (ctx->flags & IORING_SETUP_CQE32) {
+		WRITE_ONCE(cqe->big_cqe[0], extra);
+		WRITE_ONCE(cqe->big_cqe[1], 0);
+	}
 }
 
 static inline bool io_should_trigger_evfd(struct io_ring_ctx *ctx)
@@ -1639,9 +1801,15 @@ static void io_cqring_ev_posted(struct io_ring_ctx *ctx)
 		eventfd_signal(ctx->cq_ev_fd, 1);
 }
 
+static inline bool io_cqring_has_overflow(struct io_ring_ctx *ctx)
+{
+	return !list_empty(&ctx->cq_overflow_list) ||
+	       !list_empty(&ctx->cq_notif_overflow_list);
+}
+
 static void io_cqring_mark_overflow(struct io_ring_ctx *ctx)
 {
-	if (list_empty(&ctx->cq_overflow_list)) {
+	if (!io_cqring_has_overflow(ctx)) {
 		clear_bit(0, &ctx->sq_check_overflow);
 		clear_bit(0, &ctx->cq_check_overflow);
 		ctx->rings->sq_flags &= ~IORING_SQ_CQ_OVERFLOW;
@@ -1674,15 +1842,34 @@ static bool io_match_files(struct io_kiocb *req,
 	return false;
 }
 
+/*
+ * A notification must not overtake the send CQE it belongs to. Requests with
+ * the same user_data may match too, that only holds the notification longer.
+ */
+static bool io_sendzc_send_overflowed(struct io_ring_ctx *ctx,
+				      struct io_sendzc_notif *notif)
+{
+	struct io_kiocb *req;
+
+	list_for_each_entry(req, &ctx->cq_overflow_list, compl.list) {
+		if (req->opcode == IORING_OP_SEND_ZC &&
+		    req->user_data == notif->user_data)
+			return true;
+	}
+	return false;
+}
+
 /* Returns true if there are no backlogged entries after the flush */
 static bool __io_cqring_overflow_flush(struct io_ring_ctx *ctx, bool force,
 				       struct task_struct *tsk,
 				       struct files_struct *files)
 {
 	struct io_rings *rings = ctx->rings;
+	struct io_sendzc_notif *notif, *ntmp;
 	struct io_kiocb *req, *tmp;
 	struct io_uring_cqe *cqe;
 	unsigned long flags;
+	LIST_HEAD(notifs);
 	LIST_HEAD(list);
 
 	if (!force) {
@@ -1709,6 +1896,34 @@ static bool __io_cqring_overflow_flush(struct io_ring_ctx *ctx, bool force,
 			WRITE_ONCE(cqe->user_data, req->user_data);
 			WRITE_ONCE(cqe->res, req->result);
 			WRITE_ONCE(cqe->flags, req->compl.cflags);
+			io_fill_cqe_extra(ctx, cqe, req->cqe_extra);
+		} else {
+			ctx->cached_cq_overflow++;
+			WRITE_ONCE(ctx->rings->cq_overflow,
+				   ctx->cached_cq_overflow);
+		}
+	}
+
+	/*
+	 * Notifications carry no task, so a task cancel doesn't select them:
+	 * post those whose send CQE isn't queued anymore, and drop them only
+	 * once the ring is going away.
+	 */
+	list_for_each_entry_safe(notif, ntmp, &ctx->cq_notif_overflow_list,
+				 list) {
+		if (io_sendzc_send_overflowed(ctx, notif))
+			continue;
+
+		cqe = io_get_cqring(ctx);
+		if (!cqe && !ctx->cq_overflow_flushed)
+			break;
+
+		list_move(&notif->list, &notifs);
+		if (cqe) {
+			WRITE_ONCE(cqe->user_data, notif->user_data);
+			WRITE_ONCE(cqe->res, notif->res);
+			WRITE_ONCE(cqe->flags, IORING_CQE_F_NOTIF);
+			io_fill_cqe_extra(ctx, cqe, 0);
 		} else {
 			ctx->cached_cq_overflow++;
 			WRITE_ONCE(ctx->rings->cq_overflow,
@@ -1727,6 +1942,10 @@ static bool __io_cqring_overflow_flush(struct io_ring_ctx *ctx, bool force,
 		list_del(&req->compl.list);
 		io_put_req(req);
 	}
+	list_for_each_entry_safe(notif, ntmp, &notifs, list) {
+		kfree(notif);
+		percpu_ref_put(&ctx->refs);
+	}
 
 	return cqe != NULL;
 }
@@ -1762,6 +1981,7 @@ static void __io_cqring_fill_event(struct io_kiocb *req, long res, long cflags)
 		WRITE_ONCE(cqe->user_data, req->user_data);
 		WRITE_ONCE(cqe->res, res);
 		WRITE_ONCE(cqe->flags, cflags);
+		io_fill_cqe_extra(ctx, cqe, req->cqe_extra);
 	} else if (ctx->cq_overflow_flushed ||
 		   atomic_read(&req->task->io_uring->in_idle)) {
 		/*
@@ -1772,7 +1992,7 @@ static void __io_cqring_fill_event(struct io_kiocb *req, long res, long cflags)
 		ctx->cached_cq_overflow++;
 		WRITE_ONCE(ctx->rings->cq_overflow, ctx->cached_cq_overflow);
 	} else {
-		if (list_empty(&ctx->cq_overflow_list)) {
+		if (!io_cqring_has_overflow(ctx)) {
 			set_bit(0, &ctx->sq_check_overflow);
 			set_bit(0, &ctx->cq_check_overflow);
 			ctx->rings->sq_flags |= IORING_SQ_CQ_OVERFLOW;
@@ -1790,6 +2010,49 @@ static void io_cqring_fill_event(struct io_kiocb *req, long res)
 	__io_cqring_fill_event(req, res, 0);
 }
 
+/*
+ * Post a CQE for one event of a multishot request, flagged with
+ * IORING_CQE_F_MORE as the request stays armed. The request can't be parked
+ * on the overflow list while it's still in use, so this fails if the CQ ring
+ * is full or overflowed and the caller then completes the request instead.
+ */
+static bool io_cqring_post_multishot(struct io_kiocb *req, long res,
+				     long cflags)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_uring_cqe *cqe = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->completion_lock, flags);
+	if (!io_cqring_has_overflow(ctx))
+		cqe = io_get_cqring(ctx);
+	if (cqe) {
+		trace_io_uring_complete(ctx, req->user_data, res);
+		WRITE_ONCE(cqe->user_data, req->user_data);
+		WRITE_ONCE(cqe->res, res);
+		WRITE_ONCE(cqe->flags, cflags | IORING_CQE_F_MORE);
+		io_fill_cqe_extra(ctx, cqe, 0);
+		io_commit_cqring(ctx);
+	}
+	spin_unlock_irqrestore(&ctx->completion_lock, flags);
+
+	if (cqe)
+		io_cqring_ev_posted(ctx);
+	return cqe != NULL;
+}
+
+/*
+ * A multishot request that keeps finding data would otherwise starve other
+ * requests and task_work of the submitting task, so after a bounded number
+ * of CQEs it is reissued from task_work instead.
+ */
+static void io_multishot_requeue(struct io_kiocb *req)
+{
+	/* the reissue drops a submit reference of its own */
+	refcount_inc(&req->refs);
+	io_req_task_queue(req);
+}
+
 static void io_cqring_add_event(struct io_kiocb *req, long res, long cflags)
 {
 	struct io_ring_ctx *ctx = req->ctx;
@@ -2057,6 +2320,70 @@ static struct io_kiocb *io_req_find_next(struct io_kiocb *req)
 		return NULL;
 	return __io_req_find_next(req);
 }
+/*
+ * Hand IORING_SETUP_DEFER_TASKRUN work back to the regular task_work path, for
+ * when the submitter won't be running it from io_cqring_wait(): the ctx refs
+ * are being killed for quiesce or teardown, or the task is going away. If the
+ * submitter can't take task_work anymore, the io-wq manager runs it instead,
+ * the handlers cancel themselves there as they can't get at the mm.
+ */
+static void io_move_local_work(struct io_ring_ctx *ctx)
+{
+	struct task_struct *tsk = ctx->submitter_task;
+	struct llist_node *node;
+
+	node = llist_reverse_order(llist_del_all(&ctx->work_llist));
+	while (node) {
+		struct io_kiocb *req = container_of(node, struct io_kiocb,
+						    work_node);
+
+		node = node->next;
+		if (!task_work_add(tsk, &req->task_work, TWA_SIGNAL)) {
+			wake_up_process(tsk);
+		} else {
+			struct task_struct *wq_tsk;
+
+			wq_tsk = io_wq_get_task(ctx->io_wq);
+			task_work_add(wq_tsk, &req->task_work, TWA_NONE);
+			wake_up_process(wq_tsk);
+		}
+	}
+}
+
+/*
+ * Run IORING_SETUP_DEFER_TASKRUN work queued by io_req_task_work_add(). Only
+ * the submitter task may call this. The whole batch runs under one uring_lock
+ * acquisition, handlers resubmitting requests see local_work_task and don't
+ * take it again.
+ */
+static bool io_run_local_work(struct io_ring_ctx *ctx)
+{
+	struct llist_node *node;
+	bool ran = false;
+
+	if (llist_empty(&ctx->work_llist))
+		return false;
+
+	__set_current_state(TASK_RUNNING);
+	mutex_lock(&ctx->uring_lock);
+	WRITE_ONCE(ctx->local_work_task, current);
+	while ((node = llist_del_all(&ctx->work_llist)) != NULL) {
+		/* run in queueing order */
+		node = llist_reverse_order(node);
+		while (node) {
+			struct io_kiocb *req = container_of(node,
+						struct io_kiocb, work_node);
+
+			node = node->next;
+			req->task_work.func(&req->task_work);
+		}
+		ran = true;
+	}
+	WRITE_ONCE(ctx->local_work_task, NULL);
+	mutex_unlock(&ctx->uring_lock);
+	return ran;
+}
+
 /**
  *
  */
@@ -2070,6 +2397,26 @@ static int io_req_task_work_add(struct io_kiocb *req, bool twa_signal_ok)
 	if (tsk->flags & PF_EXITING)
 		return -ESRCH;
 
+	/*
+	 * Don't interrupt the submitter, queue the work on the ring and just
+	 * wake it if it's waiting for completions. The llist_add() is a full
+	 * barrier, pairing with the one between percpu_ref_kill() and
+	 * io_move_local_work(): either we see the ref dying and move the work
+	 * ourselves, or the killer finds it on the list.
+	 */
+	if ((ctx->flags & IORING_SETUP_DEFER_TASKRUN) &&
+	    tsk == ctx->submitter_task) {
+		if (llist_add(&req->work_node, &ctx->work_llist)) {
+			if (waitqueue_active(&ctx->wait))
+				wake_up(&ctx->wait);
+			if (waitqueue_active(&ctx->cq_wait))
+				wake_up_interruptible(&ctx->cq_wait);
+		}
+		if (unlikely(percpu_ref_is_dying(&ctx->refs)))
+			io_move_local_work(ctx);
+		return 0;
+	}
+
 	/*
 	 * SQPOLL kernel thread doesn't need notification, just a wakeup. For
 	 * all other cases, use TWA_SIGNAL unconditionally to ensure we're
@@ -2116,13 +2463,17 @@ static void io_req_task_cancel(struct callback_head *cb)
 static void __io_req_task_submit(struct io_kiocb *req)
 {
 	struct io_ring_ctx *ctx = req->ctx;
+	/* io_run_local_work() already holds it */
+	bool locked = READ_ONCE(ctx->local_work_task) == current;
 
-	mutex_lock(&ctx->uring_lock);
+	if (!locked)
+		mutex_lock(&ctx->uring_lock);
 	if (!ctx->sqo_dead && !__io_sq_thread_acquire_mm(ctx))
 		__io_queue_sqe(req, NULL);
 	else
 		__io_req_task_cancel(req, -EFAULT);
-	mutex_unlock(&ctx->uring_lock);
+	if (!locked)
+		mutex_unlock(&ctx->uring_lock);
 }
 
 static void io_req_task_submit(struct callback_head *cb)
@@ -2330,6 +2681,13 @@ static unsigned int io_put_kbuf(struct io_kiocb *req, struct io_buffer *kbuf)
 {
 	unsigned int cflags;
 
+	if (req->flags & REQ_F_BUFFER_RING) {
+		cflags = req->buf_index << IORING_CQE_BUFFER_SHIFT;
+		cflags |= IORING_CQE_F_BUFFER;
+		req->flags &= ~(REQ_F_BUFFER_SELECTED | REQ_F_BUFFER_RING);
+		return cflags;
+	}
+
 	cflags = kbuf->bid << IORING_CQE_BUFFER_SHIFT;
 	cflags |= IORING_CQE_F_BUFFER;
 	req->flags &= ~REQ_F_BUFFER_SELECTED;
@@ -2395,7 +2753,9 @@ static void io_iopoll_complete(struct io_ring_ctx *ctx, unsigned int *nr_events,
 		int cflags = 0;
 
 		req = list_first_entry(done, struct io_kiocb, inflight_entry);
-		if (READ_ONCE(req->result) == -EAGAIN) {
+		/* commands aren't reissued, -EAGAIN is just their result */
+		if (READ_ONCE(req->result) == -EAGAIN &&
+		    req->opcode != IORING_OP_URING_CMD) {
 			req->result = 0;
 			req->iopoll_completed = 0;
 			list_move_tail(&req->inflight_entry, &again);
@@ -2452,7 +2812,12 @@ static int io_do_iopoll(struct io_ring_ctx *ctx, unsigned int *nr_events,
 		if (!list_empty(&done))
 			break;
 
-		ret = kiocb->ki_filp->f_op->iopoll(kiocb, spin);
+		if (req->opcode == IORING_OP_URING_CMD) {
+			ret = req->file->f_op->uring_cmd_iopoll(&req->uring_cmd,
+					NULL, spin ? 0 : BLK_POLL_ONESHOT);
+		} else {
+			ret = kiocb->ki_filp->f_op->iopoll(kiocb, spin);
+		}
 		if (ret < 0)
 			break;
 
@@ -2561,6 +2926,7 @@ static int io_iopoll_check(struct io_ring_ctx *ctx, long min)
 		if (!(++iters & 7)) {
 			mutex_unlock(&ctx->uring_lock);
 			io_run_task_work();
+			io_run_local_work(ctx);
 			mutex_lock(&ctx->uring_lock);
 		}
 
@@ -2926,21 +3292,19 @@ static void kiocb_done(struct kiocb *kiocb, ssize_t ret,
 		io_rw_done(kiocb, ret);
 }
 
-static ssize_t io_import_fixed(struct io_kiocb *req, int rw,
-			       struct iov_iter *iter)
+static ssize_t __io_import_fixed(struct io_kiocb *req, int rw,
+				 struct iov_iter *iter, u64 buf_addr,
+				 size_t len)
 {
 	struct io_ring_ctx *ctx = req->ctx;
-	size_t len = req->rw.len;
 	struct io_mapped_ubuf *imu;
 	u16 index, buf_index = req->buf_index;
 	size_t offset;
-	u64 buf_addr;
 
 	if (unlikely(buf_index >= ctx->nr_user_bufs))
 		return -EFAULT;
 	index = array_index_nospec(buf_index, ctx->nr_user_bufs);
 	imu = &ctx->user_bufs[index];
-	buf_addr = req->rw.addr;
 
 	/* overflow */
 	if (buf_addr + len < buf_addr)
@@ -2994,6 +3358,12 @@ static ssize_t io_import_fixed(struct io_kiocb *req, int rw,
 	return len;
 }
 
+static ssize_t io_import_fixed(struct io_kiocb *req, int rw,
+			       struct iov_iter *iter)
+{
+	return __io_import_fixed(req, rw, iter, req->rw.addr, req->rw.len);
+}
+
 static void io_ring_submit_unlock(struct io_ring_ctx *ctx, bool needs_lock)
 {
 	if (needs_lock)
@@ -3012,54 +3382,103 @@ static void io_ring_submit_lock(struct io_ring_ctx *ctx, bool needs_lock)
 		mutex_lock(&ctx->uring_lock);
 }
 
-static struct io_buffer *io_buffer_select(struct io_kiocb *req, size_t *len,
-					  int bgid, struct io_buffer *kbuf,
-					  bool needs_lock)
+/*
+ * Take the next buffer of a ring mapped group. Its entry is copied out as
+ * the application may reuse the slot as soon as head has moved past it.
+ */
+static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
+					  struct io_buffer_ring *bl)
+{
+	struct io_uring_buf *buf;
+	__u16 head = bl->head;
+	__u32 buf_len;
+
+	/* pairs with the store-release of tail by the application */
+	if (smp_load_acquire(&bl->br->tail) == head)
+		return ERR_PTR(-ENOBUFS);
+
+	buf = &bl->br->bufs[head & bl->mask];
+	buf_len = READ_ONCE(buf->len);
+	if (*len > buf_len)
+		*len = buf_len;
+	req->buf_index = READ_ONCE(buf->bid);
+	req->flags |= REQ_F_BUFFER_RING;
+	bl->head = head + 1;
+	return u64_to_user_ptr(READ_ONCE(buf->addr));
+}
+
+/*
+ * Pick a buffer from group @bgid and clamp *len to its size. For a list based
+ * group the buffer is returned in @kbuf, for a ring mapped one the request is
+ * marked REQ_F_BUFFER_RING and @kbuf is set to NULL.
+ */
+static void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
+				     int bgid, struct io_buffer **kbuf,
+				     bool needs_lock)
 {
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_buffer_ring *bl;
 	struct io_buffer *head;
+	void __user *buf;
 
-	if (req->flags & REQ_F_BUFFER_SELECTED)
-		return kbuf;
+	io_ring_submit_lock(ctx, needs_lock);
 
-	io_ring_submit_lock(req->ctx, needs_lock);
+	lockdep_assert_held(&ctx->uring_lock);
 
-	lockdep_assert_held(&req->ctx->uring_lock);
+	*kbuf = NULL;
+	bl = idr_find(&ctx->io_buf_ring_idr, bgid);
+	if (bl) {
+		buf = io_ring_buffer_select(req, len, bl);
+		goto out;
+	}
 
-	head = idr_find(&req->ctx->io_buffer_idr, bgid);
+	head = idr_find(&ctx->io_buffer_idr, bgid);
 	if (head) {
 		if (!list_empty(&head->list)) {
-			kbuf = list_last_entry(&head->list, struct io_buffer,
+			*kbuf = list_last_entry(&head->list, struct io_buffer,
 							list);
-			list_del(&kbuf->list);
+			list_del(&(*kbuf)->list);
 		} else {
-			kbuf = head;
-			idr_remove(&req->ctx->io_buffer_idr, bgid);
+			*kbuf = head;
+			idr_remove(&ctx->io_buffer_idr, bgid);
 		}
-		if (*len > kbuf->len)
-			*len = kbuf->len;
+		if (*len > (*kbuf)->len)
+			*len = (*kbuf)->len;
+		buf = u64_to_user_ptr((*kbuf)->addr);
 	} else {
-		kbuf = ERR_PTR(-ENOBUFS);
+		buf = ERR_PTR(-ENOBUFS);
 	}
+out:
+	io_ring_submit_unlock(ctx, needs_lock);
 
-	io_ring_submit_unlock(req->ctx, needs_lock);
-
-	return kbuf;
+	return buf;
 }
 
 static void __user *io_rw_buffer_select(struct io_kiocb *req, size_t *len,
 					bool needs_lock)
 {
 	struct io_buffer *kbuf;
-	u16 bgid;
+	void __user *buf;
 
-	kbuf = (struct io_buffer *) (unsigned long) req->rw.addr;
-	bgid = req->buf_index;
-	kbuf = io_buffer_select(req, len, bgid, kbuf, needs_lock);
-	if (IS_ERR(kbuf))
-		return kbuf;
-	req->rw.addr = (u64) (unsigned long) kbuf;
+	if (req->flags & REQ_F_BUFFER_SELECTED) {
+		if (req->flags & REQ_F_BUFFER_RING)
+			return u64_to_user_ptr(req->rw.addr);
+		kbuf = (struct io_buffer *) (unsigned long) req->rw.addr;
+		return u64_to_user_ptr(kbuf->addr);
+	}
+
+	buf = io_buffer_select(req, len, req->buf_index, &kbuf, needs_lock);
+	if (IS_ERR(buf))
+		return buf;
+	if (kbuf) {
+		req->rw.addr = (u64) (unsigned long) kbuf;
+	} else {
+		/* ring buffers have no kbuf, keep the buffer itself */
+		req->rw.addr = (u64) (unsigned long) buf;
+		req->rw.len = *len;
+	}
 	req->flags |= REQ_F_BUFFER_SELECTED;
-	return u64_to_user_ptr(kbuf->addr);
+	return buf;
 }
 
 #ifdef CONFIG_COMPAT
@@ -3113,6 +3532,11 @@ static ssize_t __io_iov_buffer_select(struct io_kiocb *req, struct iovec *iov,
 static ssize_t io_iov_buffer_select(struct io_kiocb *req, struct iovec *iov,
 				    bool needs_lock)
 {
+	if (req->flags & REQ_F_BUFFER_RING) {
+		iov[0].iov_base = u64_to_user_ptr(req->rw.addr);
+		iov[0].iov_len = req->rw.len;
+		return 0;
+	}
 	if (req->flags & REQ_F_BUFFER_SELECTED) {
 		struct io_buffer *kbuf;
 
@@ -3605,7 +4029,8 @@ static int io_write(struct io_kiocb *req, bool force_nonblock,
 
 	/* file path doesn't support NOWAIT for non-direct_IO */
 	if (force_nonblock && !(kiocb->ki_flags & IOCB_DIRECT) &&
-	    (req->flags & REQ_F_ISREG))
+	    (req->flags & REQ_F_ISREG) &&
+	    !(req->file->f_mode & FMODE_BUF_WASYNC))
 		goto copy_iov;
 
 	ret = rw_verify_area(WRITE, req->file, io_kiocb_ppos(kiocb), iov_count);
@@ -3639,17 +4064,34 @@ static int io_write(struct io_kiocb *req, bool force_nonblock,
 	 */
 	if (ret2 == -EOPNOTSUPP && (kiocb->ki_flags & IOCB_NOWAIT))
 		ret2 = -EAGAIN;
-	/* no retry on NONBLOCK marked file */
-	if (ret2 == -EAGAIN && (req->file->f_flags & O_NONBLOCK))
+	/*
+	 * no retry on NONBLOCK marked file, but a regular file may just have
+	 * hit a page it can't get without blocking, that's punted as usual
+	 */
+	if (ret2 == -EAGAIN && (req->file->f_flags & O_NONBLOCK) &&
+	    !(req->flags & REQ_F_ISREG))
 		goto done;
 	if (!force_nonblock || ret2 != -EAGAIN) {
 		/* IOPOLL retry should happen for io-wq threads */
 		if ((req->ctx->flags & IORING_SETUP_IOPOLL) && ret2 == -EAGAIN)
 			goto copy_iov;
+		/*
+		 * A nonblocking buffered write may stop short when it runs into
+		 * a page it can't get without blocking, finish it from io-wq.
+		 */
+		if (force_nonblock && ret2 > 0 && ret2 < io_size &&
+		    !(kiocb->ki_flags & IOCB_DIRECT) &&
+		    (req->flags & REQ_F_ISREG))
+			goto short_write;
 done:
 		kiocb_done(kiocb, ret2, cs);
 	} else {
 copy_iov:
+		/* drop the freeze protection, the retry takes it again */
+		if (kiocb->ki_flags & IOCB_WRITE) {
+			kiocb_end_write(req);
+			kiocb->ki_flags &= ~IOCB_WRITE;
+		}
 		/* some cases will consume bytes even on error returns */
 		iov_iter_revert(iter, iov_count - iov_iter_count(iter));
 		ret = io_setup_async_rw(req, iovec, inline_vecs, iter, false);
@@ -3661,6 +4103,15 @@ out_free:
 	if (iovec)
 		kfree(iovec);
 	return ret;
+short_write:
+	/* keep the iterator where the write stopped, io-wq does the rest */
+	if (io_setup_async_rw(req, iovec, inline_vecs, iter, true))
+		goto done;
+	kiocb_end_write(req);
+	kiocb->ki_flags &= ~IOCB_WRITE;
+	rw = req->async_data;
+	rw->bytes_done += ret2;
+	return -EAGAIN;
 }
 
 static int __io_splice_prep(struct io_kiocb *req,
@@ -4101,6 +4552,10 @@ static int io_provide_buffers(struct io_kiocb *req, bool force_nonblock,
 
 	lockdep_assert_held(&ctx->uring_lock);
 
+	ret = -EEXIST;
+	if (idr_find(&ctx->io_buf_ring_idr, p->bgid))
+		goto out;
+
 	list = head = idr_find(&ctx->io_buffer_idr, p->bgid);
 
 	ret = io_add_buffers(p, &head);
@@ -4288,53 +4743,344 @@ static int io_statx(struct io_kiocb *req, bool force_nonblock)
 	return 0;
 }
 
-static int io_close_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+/*
+ * The namei helpers below consume the names they are passed. The inline
+ * attempt uses LOOKUP_CACHED and takes an extra reference, so that if the
+ * lookup or locking would block the request can still be punted to io-wq
+ * with its names intact.
+ */
+static inline void io_getname(struct filename *name)
 {
-	/*
-	 * If we queue this for async, it must not be cancellable. That would
-	 * leave the 'file' in an undeterminate state, and here need to modify
-	 * io_wq_work.flags, so initialize io_wq_work firstly.
-	 */
-	io_req_init_async(req);
+	name->refcnt++;
+}
+
+static int io_renameat_prep(struct io_kiocb *req,
+			    const struct io_uring_sqe *sqe)
+{
+	struct io_rename *ren = &req->rename;
+	const char __user *oldf, *newf;
 
 	if (unlikely(req->ctx->flags & (IORING_SETUP_IOPOLL|IORING_SETUP_SQPOLL)))
 		return -EINVAL;
-	if (sqe->ioprio || sqe->off || sqe->addr || sqe->len ||
-	    sqe->rw_flags || sqe->buf_index)
+	if (sqe->ioprio || sqe->buf_index)
 		return -EINVAL;
-	if (req->flags & REQ_F_FIXED_FILE)
+	if (unlikely(req->flags & REQ_F_FIXED_FILE))
 		return -EBADF;
 
-	req->close.fd = READ_ONCE(sqe->fd);
-	if ((req->file && req->file->f_op == &io_uring_fops))
-		return -EBADF;
+	ren->old_dfd = READ_ONCE(sqe->fd);
+	oldf = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	newf = u64_to_user_ptr(READ_ONCE(sqe->addr2));
+	ren->new_dfd = READ_ONCE(sqe->len);
+	ren->flags = READ_ONCE(sqe->rename_flags);
 
-	req->close.put_file = NULL;
+	ren->oldpath = getname(oldf);
+	if (IS_ERR(ren->oldpath))
+		return PTR_ERR(ren->oldpath);
+
+	ren->newpath = getname(newf);
+	if (IS_ERR(ren->newpath)) {
+		putname(ren->oldpath);
+		return PTR_ERR(ren->newpath);
+	}
+
+	req->flags |= REQ_F_NEED_CLEANUP;
 	return 0;
 }
 
-static int io_close(struct io_kiocb *req, bool force_nonblock,
-		    struct io_comp_state *cs)
+static int io_renameat(struct io_kiocb *req, bool force_nonblock)
 {
-	struct io_close *close = &req->close;
+	struct io_rename *ren = &req->rename;
 	int ret;
 
-	/* might be already done during nonblock submission */
-	if (!close->put_file) {
-		ret = __close_fd_get_file(close->fd, &close->put_file);
-		if (ret < 0)
-			return (ret == -ENOENT) ? -EBADF : ret;
+	if (force_nonblock) {
+		io_getname(ren->oldpath);
+		io_getname(ren->newpath);
+		ret = do_renameat2(ren->old_dfd, ren->oldpath, ren->new_dfd,
+				   ren->newpath, ren->flags, LOOKUP_CACHED);
+		if (ret == -EAGAIN)
+			return -EAGAIN;
+		putname(ren->oldpath);
+		putname(ren->newpath);
+	} else {
+		ret = do_renameat2(ren->old_dfd, ren->oldpath, ren->new_dfd,
+				   ren->newpath, ren->flags, 0);
 	}
 
-	/* if the file has a flush method, be safe and punt to async */
-	if (close->put_file->f_op->flush && force_nonblock) {
-		/* not safe to cancel at this point */
-		req->work.flags |= IO_WQ_WORK_NO_CANCEL;
-		/* was never set, but play safe */
-		req->flags &= ~REQ_F_NOWAIT;
-		/* avoid grabbing files - we don't need the files */
-		req->flags |= REQ_F_NO_FILE_TABLE;
-		return -EAGAIN;
+	req->flags &= ~REQ_F_NEED_CLEANUP;
+	if (ret < 0)
+		req_set_fail_links(req);
+	io_req_complete(req, ret);
+	return 0;
+}
+
+static int io_unlinkat_prep(struct io_kiocb *req,
+			    const struct io_uring_sqe *sqe)
+{
+	struct io_unlink *un = &req->unlink;
+	const char __user *fname;
+
+	if (unlikely(req->ctx->flags & (IORING_SETUP_IOPOLL|IORING_SETUP_SQPOLL)))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->off || sqe->len || sqe->buf_index)
+		return -EINVAL;
+	if (unlikely(req->flags & REQ_F_FIXED_FILE))
+		return -EBADF;
+
+	un->dfd = READ_ONCE(sqe->fd);
+
+	un->flags = READ_ONCE(sqe->unlink_flags);
+	if (un->flags & ~AT_REMOVEDIR)
+		return -EINVAL;
+
+	fname = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	un->filename = getname(fname);
+	if (IS_ERR(un->filename))
+		return PTR_ERR(un->filename);
+
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return 0;
+}
+
+static int io_unlinkat(struct io_kiocb *req, bool force_nonblock)
+{
+	struct io_unlink *un = &req->unlink;
+	unsigned int lookup_flags = 0;
+	int ret;
+
+	if (force_nonblock) {
+		io_getname(un->filename);
+		lookup_flags = LOOKUP_CACHED;
+	}
+
+	if (un->flags & AT_REMOVEDIR)
+		ret = do_rmdir(un->dfd, un->filename, lookup_flags);
+	else
+		ret = do_unlinkat(un->dfd, un->filename, lookup_flags);
+
+	if (force_nonblock) {
+		if (ret == -EAGAIN)
+			return -EAGAIN;
+		putname(un->filename);
+	}
+
+	req->flags &= ~REQ_F_NEED_CLEANUP;
+	if (ret < 0)
+		req_set_fail_links(req);
+	io_req_complete(req, ret);
+	return 0;
+}
+
+static int io_mkdirat_prep(struct io_kiocb *req,
+			    const struct io_uring_sqe *sqe)
+{
+	struct io_mkdir *mkd = &req->mkdir;
+	const char __user *fname;
+
+	if (unlikely(req->ctx->flags & (IORING_SETUP_IOPOLL|IORING_SETUP_SQPOLL)))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->off || sqe->rw_flags || sqe->buf_index)
+		return -EINVAL;
+	if (unlikely(req->flags & REQ_F_FIXED_FILE))
+		return -EBADF;
+
+	mkd->dfd = READ_ONCE(sqe->fd);
+	mkd->mode = READ_ONCE(sqe->len);
+
+	fname = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	mkd->filename = getname(fname);
+	if (IS_ERR(mkd->filename))
+		return PTR_ERR(mkd->filename);
+
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return 0;
+}
+
+static int io_mkdirat(struct io_kiocb *req, bool force_nonblock)
+{
+	struct io_mkdir *mkd = &req->mkdir;
+	int ret;
+
+	if (force_nonblock) {
+		io_getname(mkd->filename);
+		ret = do_mkdirat(mkd->dfd, mkd->filename, mkd->mode,
+				 LOOKUP_CACHED);
+		if (ret == -EAGAIN)
+			return -EAGAIN;
+		putname(mkd->filename);
+	} else {
+		ret = do_mkdirat(mkd->dfd, mkd->filename, mkd->mode, 0);
+	}
+
+	req->flags &= ~REQ_F_NEED_CLEANUP;
+	if (ret < 0)
+		req_set_fail_links(req);
+	io_req_complete(req, ret);
+	return 0;
+}
+
+static int io_symlinkat_prep(struct io_kiocb *req,
+			    const struct io_uring_sqe *sqe)
+{
+	struct io_hardlink *sl = &req->hardlink;
+	const char __user *oldpath, *newpath;
+
+	if (unlikely(req->ctx->flags & (IORING_SETUP_IOPOLL|IORING_SETUP_SQPOLL)))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->len || sqe->rw_flags || sqe->buf_index)
+		return -EINVAL;
+	if (unlikely(req->flags & REQ_F_FIXED_FILE))
+		return -EBADF;
+
+	sl->new_dfd = READ_ONCE(sqe->fd);
+	oldpath = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	newpath = u64_to_user_ptr(READ_ONCE(sqe->addr2));
+
+	sl->oldpath = getname(oldpath);
+	if (IS_ERR(sl->oldpath))
+		return PTR_ERR(sl->oldpath);
+
+	sl->newpath = getname(newpath);
+	if (IS_ERR(sl->newpath)) {
+		putname(sl->oldpath);
+		return PTR_ERR(sl->newpath);
+	}
+
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return 0;
+}
+
+static int io_symlinkat(struct io_kiocb *req, bool force_nonblock)
+{
+	struct io_hardlink *sl = &req->hardlink;
+	int ret;
+
+	if (force_nonblock) {
+		io_getname(sl->oldpath);
+		io_getname(sl->newpath);
+		ret = do_symlinkat(sl->oldpath, sl->new_dfd, sl->newpath,
+				   LOOKUP_CACHED);
+		if (ret == -EAGAIN)
+			return -EAGAIN;
+		putname(sl->oldpath);
+		putname(sl->newpath);
+	} else {
+		ret = do_symlinkat(sl->oldpath, sl->new_dfd, sl->newpath, 0);
+	}
+
+	req->flags &= ~REQ_F_NEED_CLEANUP;
+	if (ret < 0)
+		req_set_fail_links(req);
+	io_req_complete(req, ret);
+	return 0;
+}
+
+static int io_linkat_prep(struct io_kiocb *req,
+			    const struct io_uring_sqe *sqe)
+{
+	struct io_hardlink *lnk = &req->hardlink;
+	const char __user *oldf, *newf;
+
+	if (unlikely(req->ctx->flags & (IORING_SETUP_IOPOLL|IORING_SETUP_SQPOLL)))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->buf_index)
+		return -EINVAL;
+	if (unlikely(req->flags & REQ_F_FIXED_FILE))
+		return -EBADF;
+
+	lnk->old_dfd = READ_ONCE(sqe->fd);
+	lnk->new_dfd = READ_ONCE(sqe->len);
+	oldf = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	newf = u64_to_user_ptr(READ_ONCE(sqe->addr2));
+	lnk->flags = READ_ONCE(sqe->hardlink_flags);
+
+	lnk->oldpath = getname_flags(oldf, (lnk->flags & AT_EMPTY_PATH) ?
+					   LOOKUP_EMPTY : 0, NULL);
+	if (IS_ERR(lnk->oldpath))
+		return PTR_ERR(lnk->oldpath);
+
+	lnk->newpath = getname(newf);
+	if (IS_ERR(lnk->newpath)) {
+		putname(lnk->oldpath);
+		return PTR_ERR(lnk->newpath);
+	}
+
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return 0;
+}
+
+static int io_linkat(struct io_kiocb *req, bool force_nonblock)
+{
+	struct io_hardlink *lnk = &req->hardlink;
+	int ret;
+
+	if (force_nonblock) {
+		io_getname(lnk->oldpath);
+		io_getname(lnk->newpath);
+		ret = do_linkat(lnk->old_dfd, lnk->oldpath, lnk->new_dfd,
+				lnk->newpath, lnk->flags, LOOKUP_CACHED);
+		if (ret == -EAGAIN)
+			return -EAGAIN;
+		putname(lnk->oldpath);
+		putname(lnk->newpath);
+	} else {
+		ret = do_linkat(lnk->old_dfd, lnk->oldpath, lnk->new_dfd,
+				lnk->newpath, lnk->flags, 0);
+	}
+
+	req->flags &= ~REQ_F_NEED_CLEANUP;
+	if (ret < 0)
+		req_set_fail_links(req);
+	io_req_complete(req, ret);
+	return 0;
+}
+
+static int io_close_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	/*
+	 * If we queue this for async, it must not be cancellable. That would
+	 * leave the 'file' in an undeterminate state, and here need to modify
+	 * io_wq_work.flags, so initialize io_wq_work firstly.
+	 */
+	io_req_init_async(req);
+
+	if (unlikely(req->ctx->flags & (IORING_SETUP_IOPOLL|IORING_SETUP_SQPOLL)))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->off || sqe->addr || sqe->len ||
+	    sqe->rw_flags || sqe->buf_index)
+		return -EINVAL;
+	if (req->flags & REQ_F_FIXED_FILE)
+		return -EBADF;
+
+	req->close.fd = READ_ONCE(sqe->fd);
+	if ((req->file && req->file->f_op == &io_uring_fops))
+		return -EBADF;
+
+	req->close.put_file = NULL;
+	return 0;
+}
+
+static int io_close(struct io_kiocb *req, bool force_nonblock,
+		    struct io_comp_state *cs)
+{
+	struct io_close *close = &req->close;
+	int ret;
+
+	/* might be already done during nonblock submission */
+	if (!close->put_file) {
+		ret = __close_fd_get_file(close->fd, &close->put_file);
+		if (ret < 0)
+			return (ret == -ENOENT) ? -EBADF : ret;
+	}
+
+	/* if the file has a flush method, be safe and punt to async */
+	if (close->put_file->f_op->flush && force_nonblock) {
+		/* not safe to cancel at this point */
+		req->work.flags |= IO_WQ_WORK_NO_CANCEL;
+		/* was never set, but play safe */
+		req->flags &= ~REQ_F_NOWAIT;
+		/* avoid grabbing files - we don't need the files */
+		req->flags |= REQ_F_NO_FILE_TABLE;
+		return -EAGAIN;
 	}
 
 	/* No ->flush() or already async, safely close from here */
@@ -4504,6 +5250,7 @@ static int io_send(struct io_kiocb *req, bool force_nonblock,
 	msg.msg_control = NULL;
 	msg.msg_controllen = 0;
 	msg.msg_namelen = 0;
+	msg.msg_ubuf = NULL;
 
 	flags = req->sr_msg.msg_flags;
 	if (flags & MSG_DONTWAIT)
@@ -4524,6 +5271,178 @@ static int io_send(struct io_kiocb *req, bool force_nonblock,
 	return 0;
 }
 
+static int io_sendzc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_sendzc *zc = &req->sendzc;
+	u16 buf_index;
+
+	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
+		return -EINVAL;
+	if (sqe->off || sqe->addr2)
+		return -EINVAL;
+
+	zc->flags = READ_ONCE(sqe->ioprio);
+	if (zc->flags & ~IORING_SEND_ZC_FIXED_BUF)
+		return -EINVAL;
+	buf_index = READ_ONCE(sqe->buf_index);
+	if (zc->flags & IORING_SEND_ZC_FIXED_BUF) {
+		if (unlikely(buf_index >= req->ctx->nr_user_bufs))
+			return -EFAULT;
+		req->buf_index = buf_index;
+	} else if (buf_index) {
+		return -EINVAL;
+	}
+
+	zc->buf = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	zc->len = READ_ONCE(sqe->len);
+	zc->msg_flags = READ_ONCE(sqe->msg_flags);
+	return 0;
+}
+
+/*
+ * Runs when the last skb referencing the pages of a zero-copy send is freed,
+ * possibly from softirq context. If the CQ ring is full, or other CQEs are
+ * already waiting, the notification is queued and posted by the next
+ * overflow flush, after any send CQE that overflowed before it.
+ */
+static void io_sendzc_notify(struct ubuf_info *uarg, bool success)
+{
+	struct io_sendzc_notif *notif;
+	struct io_ring_ctx *ctx;
+	struct io_uring_cqe *cqe = NULL;
+	unsigned long flags;
+
+	notif = container_of(uarg, struct io_sendzc_notif, uarg);
+	ctx = notif->ctx;
+	notif->res = success ? 0 : IORING_NOTIF_ZC_COPIED;
+	mm_unaccount_pinned_pages(&uarg->mmp);
+
+	spin_lock_irqsave(&ctx->completion_lock, flags);
+	trace_io_uring_complete(ctx, notif->user_data, notif->res);
+	if (!io_cqring_has_overflow(ctx))
+		cqe = io_get_cqring(ctx);
+	if (likely(cqe)) {
+		WRITE_ONCE(cqe->user_data, notif->user_data);
+		WRITE_ONCE(cqe->res, notif->res);
+		WRITE_ONCE(cqe->flags, IORING_CQE_F_NOTIF);
+		io_fill_cqe_extra(ctx, cqe, 0);
+	} else if (ctx->cq_overflow_flushed) {
+		/* the ring is going away, nobody will flush it */
+		ctx->cached_cq_overflow++;
+		WRITE_ONCE(ctx->rings->cq_overflow, ctx->cached_cq_overflow);
+	} else {
+		if (!io_cqring_has_overflow(ctx)) {
+			set_bit(0, &ctx->sq_check_overflow);
+			set_bit(0, &ctx->cq_check_overflow);
+			ctx->rings->sq_flags |= IORING_SQ_CQ_OVERFLOW;
+		}
+		list_add_tail(&notif->list, &ctx->cq_notif_overflow_list);
+		notif = NULL;
+	}
+	io_commit_cqring(ctx);
+	spin_unlock_irqrestore(&ctx->completion_lock, flags);
+
+	io_cqring_ev_posted(ctx);
+	if (notif) {
+		percpu_ref_put(&ctx->refs);
+		kfree(notif);
+	}
+}
+
+static int io_sendzc(struct io_kiocb *req, bool force_nonblock,
+		     struct io_comp_state *cs)
+{
+	struct io_sendzc *zc = &req->sendzc;
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_sendzc_notif *notif;
+	struct msghdr msg;
+	struct iovec iov;
+	struct socket *sock;
+	unsigned int cflags = 0;
+	unsigned flags;
+	int ret;
+
+	sock = sock_from_file(req->file, &ret);
+	if (unlikely(!sock))
+		return ret;
+
+	if (zc->flags & IORING_SEND_ZC_FIXED_BUF)
+		ret = __io_import_fixed(req, WRITE, &msg.msg_iter,
+					(u64) (unsigned long) zc->buf, zc->len);
+	else
+		ret = import_single_range(WRITE, zc->buf, zc->len, &iov,
+					  &msg.msg_iter);
+	if (unlikely(ret < 0))
+		return ret;
+
+	notif = kmalloc(sizeof(*notif), GFP_KERNEL);
+	if (unlikely(!notif))
+		return -ENOMEM;
+	notif->uarg.callback = io_sendzc_notify;
+	notif->uarg.zerocopy = 1;
+	notif->uarg.flags = UARG_F_REFCOUNTED;
+	notif->uarg.mmp.user = NULL;
+	/*
+	 * Registered buffers were charged when they were pinned, anything
+	 * else is charged to the ring owner like sock_zerocopy_alloc() does.
+	 */
+	if (ctx->limit_mem && !(zc->flags & IORING_SEND_ZC_FIXED_BUF)) {
+		notif->uarg.mmp.user = get_uid(ctx->user);
+		notif->uarg.mmp.num_pg = 0;
+		if (mm_account_pinned_pages(&notif->uarg.mmp, zc->len)) {
+			free_uid(notif->uarg.mmp.user);
+			kfree(notif);
+			return -ENOBUFS;
+		}
+	}
+	refcount_set(&notif->uarg.refcnt, 1);
+	notif->ctx = ctx;
+	notif->user_data = req->user_data;
+
+	msg.msg_name = NULL;
+	msg.msg_control = NULL;
+	msg.msg_controllen = 0;
+	msg.msg_namelen = 0;
+	msg.msg_ubuf = &notif->uarg;
+
+	flags = zc->msg_flags | MSG_ZEROCOPY;
+	if (flags & MSG_DONTWAIT)
+		req->flags |= REQ_F_NOWAIT;
+	else if (force_nonblock)
+		flags |= MSG_DONTWAIT;
+
+	msg.msg_flags = flags;
+	ret = sock_sendmsg(sock, &msg);
+
+	/*
+	 * Only skbs that still hold the pages take a reference, if there
+	 * are none the buffer can be reused right away and no notification
+	 * is posted. Otherwise the send CQE carries IORING_CQE_F_MORE and
+	 * the last reference put posts an IORING_CQE_F_NOTIF one.
+	 */
+	if (refcount_read(&notif->uarg.refcnt) == 1) {
+		mm_unaccount_pinned_pages(&notif->uarg.mmp);
+		kfree(notif);
+		notif = NULL;
+	} else {
+		percpu_ref_get(&ctx->refs);
+		cflags = IORING_CQE_F_MORE;
+	}
+
+	if (force_nonblock && ret == -EAGAIN && !notif)
+		return -EAGAIN;
+	if (ret == -ERESTARTSYS)
+		ret = -EINTR;
+
+	if (ret < 0)
+		req_set_fail_links(req);
+	/* post the send CQE now, it must not come after the notification */
+	__io_req_complete(req, ret, cflags, NULL);
+	if (notif)
+		sock_zerocopy_put(&notif->uarg);
+	return 0;
+}
+
 static int __io_recvmsg_copy_hdr(struct io_kiocb *req,
 				 struct io_async_msghdr *iomsg)
 {
@@ -4615,19 +5534,29 @@ static int io_recvmsg_copy_hdr(struct io_kiocb *req,
 	return __io_recvmsg_copy_hdr(req, iomsg);
 }
 
-static struct io_buffer *io_recv_buffer_select(struct io_kiocb *req,
-					       bool needs_lock)
+static void __user *io_recv_buffer_select(struct io_kiocb *req,
+					  bool needs_lock)
 {
 	struct io_sr_msg *sr = &req->sr_msg;
 	struct io_buffer *kbuf;
+	void __user *buf;
 
-	kbuf = io_buffer_select(req, &sr->len, sr->bgid, sr->kbuf, needs_lock);
-	if (IS_ERR(kbuf))
-		return kbuf;
+	if (req->flags & REQ_F_BUFFER_SELECTED) {
+		if (req->flags & REQ_F_BUFFER_RING)
+			return sr->ubuf;
+		return u64_to_user_ptr(sr->kbuf->addr);
+	}
 
-	sr->kbuf = kbuf;
+	buf = io_buffer_select(req, &sr->len, sr->bgid, &kbuf, needs_lock);
+	if (IS_ERR(buf))
+		return buf;
+
+	if (kbuf)
+		sr->kbuf = kbuf;
+	else
+		sr->ubuf = buf;
 	req->flags |= REQ_F_BUFFER_SELECTED;
-	return kbuf;
+	return buf;
 }
 
 static inline unsigned int io_put_recv_kbuf(struct io_kiocb *req)
@@ -4650,6 +5579,20 @@ static int io_recvmsg_prep(struct io_kiocb *req,
 	sr->len = READ_ONCE(sqe->len);
 	sr->bgid = READ_ONCE(sqe->buf_group);
 
+	if (req->opcode == IORING_OP_RECV) {
+		u16 recv_flags = READ_ONCE(sqe->ioprio);
+
+		if (recv_flags & ~IORING_RECV_MULTISHOT)
+			return -EINVAL;
+		if (recv_flags & IORING_RECV_MULTISHOT) {
+			/* every event needs a buffer of its own */
+			if (!(req->flags & REQ_F_BUFFER_SELECT) || sr->len ||
+			    (sr->msg_flags & MSG_WAITALL))
+				return -EINVAL;
+			req->flags |= REQ_F_APOLL_MULTISHOT;
+		}
+	}
+
 #ifdef CONFIG_COMPAT
 	if (req->ctx->compat)
 		sr->msg_flags |= MSG_CMSG_COMPAT;
@@ -4668,7 +5611,7 @@ static int io_recvmsg(struct io_kiocb *req, bool force_nonblock,
 {
 	struct io_async_msghdr iomsg, *kmsg;
 	struct socket *sock;
-	struct io_buffer *kbuf;
+	void __user *buf;
 	unsigned flags;
 	int ret, cflags = 0;
 
@@ -4691,10 +5634,10 @@ static int io_recvmsg(struct io_kiocb *req, bool force_nonblock,
 	}
 
 	if (req->flags & REQ_F_BUFFER_SELECT) {
-		kbuf = io_recv_buffer_select(req, !force_nonblock);
-		if (IS_ERR(kbuf))
-			return PTR_ERR(kbuf);
-		kmsg->fast_iov[0].iov_base = u64_to_user_ptr(kbuf->addr);
+		buf = io_recv_buffer_select(req, !force_nonblock);
+		if (IS_ERR(buf))
+			return PTR_ERR(buf);
+		kmsg->fast_iov[0].iov_base = buf;
 		iov_iter_init(&kmsg->msg.msg_iter, READ, kmsg->iov,
 				1, req->sr_msg.len);
 	}
@@ -4726,24 +5669,29 @@ static int io_recvmsg(struct io_kiocb *req, bool force_nonblock,
 static int io_recv(struct io_kiocb *req, bool force_nonblock,
 		   struct io_comp_state *cs)
 {
-	struct io_buffer *kbuf;
 	struct io_sr_msg *sr = &req->sr_msg;
 	struct msghdr msg;
 	void __user *buf = sr->buf;
 	struct socket *sock;
 	struct iovec iov;
-	unsigned flags;
+	unsigned flags, nr_posted = 0;
 	int ret, cflags = 0;
 
 	sock = sock_from_file(req->file, &ret);
 	if (unlikely(!sock))
 		return ret;
 
+retry:
 	if (req->flags & REQ_F_BUFFER_SELECT) {
-		kbuf = io_recv_buffer_select(req, !force_nonblock);
-		if (IS_ERR(kbuf))
-			return PTR_ERR(kbuf);
-		buf = u64_to_user_ptr(kbuf->addr);
+		/* multishot fills whatever buffer it gets */
+		if ((req->flags & REQ_F_APOLL_MULTISHOT) &&
+		    !(req->flags & REQ_F_BUFFER_SELECTED))
+			sr->len = MAX_RW_COUNT;
+		buf = io_recv_buffer_select(req, !force_nonblock);
+		if (IS_ERR(buf)) {
+			ret = PTR_ERR(buf);
+			goto out_free;
+		}
 	}
 
 	ret = import_single_range(READ, buf, sr->len, &iov, &msg.msg_iter);
@@ -4758,7 +5706,7 @@ static int io_recv(struct io_kiocb *req, bool force_nonblock,
 	msg.msg_flags = 0;
 
 	flags = req->sr_msg.msg_flags;
-	if (flags & MSG_DONTWAIT)
+	if ((flags & MSG_DONTWAIT) && !(req->flags & REQ_F_APOLL_MULTISHOT))
 		req->flags |= REQ_F_NOWAIT;
 	else if (force_nonblock)
 		flags |= MSG_DONTWAIT;
@@ -4771,6 +5719,19 @@ static int io_recv(struct io_kiocb *req, bool force_nonblock,
 out_free:
 	if (req->flags & REQ_F_BUFFER_SELECTED)
 		cflags = io_put_recv_kbuf(req);
+	/*
+	 * A multishot recv keeps going until the socket is drained, and is
+	 * then re-armed on poll. EOF, errors, running out of buffers and a
+	 * full CQ ring terminate it with a final CQE without F_MORE.
+	 */
+	if (ret > 0 && (req->flags & REQ_F_APOLL_MULTISHOT) &&
+	    force_nonblock && io_cqring_post_multishot(req, ret, cflags)) {
+		cflags = 0;
+		if (++nr_posted < IO_MULTISHOT_MAX_RETRY)
+			goto retry;
+		io_multishot_requeue(req);
+		return 0;
+	}
 	if (ret < 0)
 		req_set_fail_links(req);
 	__io_req_complete(req, ret, cflags, cs);
@@ -4780,16 +5741,22 @@ out_free:
 static int io_accept_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_accept *accept = &req->accept;
+	u16 ioprio;
 
 	if (unlikely(req->ctx->flags & (IORING_SETUP_IOPOLL|IORING_SETUP_SQPOLL)))
 		return -EINVAL;
-	if (sqe->ioprio || sqe->len || sqe->buf_index)
+	if (sqe->len || sqe->buf_index)
+		return -EINVAL;
+	ioprio = READ_ONCE(sqe->ioprio);
+	if (ioprio & ~IORING_ACCEPT_MULTISHOT)
 		return -EINVAL;
 
 	accept->addr = u64_to_user_ptr(READ_ONCE(sqe->addr));
 	accept->addr_len = u64_to_user_ptr(READ_ONCE(sqe->addr2));
 	accept->flags = READ_ONCE(sqe->accept_flags);
 	accept->nofile = rlimit(RLIMIT_NOFILE);
+	if (ioprio & IORING_ACCEPT_MULTISHOT)
+		req->flags |= REQ_F_APOLL_MULTISHOT;
 	return 0;
 }
 
@@ -4798,16 +5765,30 @@ static int io_accept(struct io_kiocb *req, bool force_nonblock,
 {
 	struct io_accept *accept = &req->accept;
 	unsigned int file_flags = force_nonblock ? O_NONBLOCK : 0;
+	unsigned int nr_posted = 0;
 	int ret;
 
-	if (req->file->f_flags & O_NONBLOCK)
+	if ((req->file->f_flags & O_NONBLOCK) &&
+	    !(req->flags & REQ_F_APOLL_MULTISHOT))
 		req->flags |= REQ_F_NOWAIT;
 
+retry:
 	ret = __sys_accept4_file(req->file, file_flags, accept->addr,
 					accept->addr_len, accept->flags,
 					accept->nofile);
 	if (ret == -EAGAIN && force_nonblock)
 		return -EAGAIN;
+	/*
+	 * Multishot accept drains the backlog and goes back to waiting on
+	 * poll. From io-wq, or with the CQ ring full, the request completes.
+	 */
+	if (ret >= 0 && (req->flags & REQ_F_APOLL_MULTISHOT) &&
+	    force_nonblock && io_cqring_post_multishot(req, ret, 0)) {
+		if (++nr_posted < IO_MULTISHOT_MAX_RETRY)
+			goto retry;
+		io_multishot_requeue(req);
+		return 0;
+	}
 	if (ret < 0) {
 		if (ret == -ERESTARTSYS)
 			ret = -EINTR;
@@ -5131,6 +6112,10 @@ static void io_async_task_func(struct callback_head *cb)
 	io_poll_remove_double(req);
 	spin_unlock_irq(&ctx->completion_lock);
 
+	/* let a multishot request arm poll again once it's drained */
+	if (req->flags & REQ_F_APOLL_MULTISHOT)
+		req->flags &= ~REQ_F_POLLED;
+
 	if (!READ_ONCE(apoll->poll.canceled))
 		__io_req_task_submit(req);
 	else
@@ -5707,44 +6692,286 @@ static int io_async_cancel(struct io_kiocb *req)
 	return 0;
 }
 
-static int io_files_update_prep(struct io_kiocb *req,
-				const struct io_uring_sqe *sqe)
+static int io_files_update_prep(struct io_kiocb *req,
+				const struct io_uring_sqe *sqe)
+{
+	if (unlikely(req->ctx->flags & IORING_SETUP_SQPOLL))
+		return -EINVAL;
+	if (unlikely(req->flags & (REQ_F_FIXED_FILE | REQ_F_BUFFER_SELECT)))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->rw_flags)
+		return -EINVAL;
+
+	req->files_update.offset = READ_ONCE(sqe->off);
+	req->files_update.nr_args = READ_ONCE(sqe->len);
+	if (!req->files_update.nr_args)
+		return -EINVAL;
+	req->files_update.arg = READ_ONCE(sqe->addr);
+	return 0;
+}
+
+static int io_files_update(struct io_kiocb *req, bool force_nonblock,
+			   struct io_comp_state *cs)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_uring_files_update up;
+	int ret;
+
+	if (force_nonblock)
+		return -EAGAIN;
+
+	up.offset = req->files_update.offset;
+	up.fds = req->files_update.arg;
+
+	mutex_lock(&ctx->uring_lock);
+	ret = __io_sqe_files_update(ctx, &up, req->files_update.nr_args);
+	mutex_unlock(&ctx->uring_lock);
+
+	if (ret < 0)
+		req_set_fail_links(req);
+	__io_req_complete(req, ret, 0, cs);
+	return 0;
+}
+
+static inline struct io_kiocb *cmd_to_io_kiocb(struct io_uring_cmd *ioucmd)
+{
+	return container_of(ioucmd, struct io_kiocb, uring_cmd);
+}
+
+static inline size_t io_uring_sqe_size(struct io_ring_ctx *ctx)
+{
+	if (ctx->flags & IORING_SETUP_SQE128)
+		return 2 * sizeof(struct io_uring_sqe);
+	return sizeof(struct io_uring_sqe);
+}
+
+static void __io_uring_cmd_done(struct io_kiocb *req, ssize_t ret, u64 res2,
+				struct io_comp_state *cs)
+{
+	io_uring_cmd_del_cancelable(&req->uring_cmd);
+	if (ret < 0)
+		req_set_fail_links(req);
+	req->cqe_extra = res2;
+
+	if (req->ctx->flags & IORING_SETUP_IOPOLL) {
+		WRITE_ONCE(req->result, ret);
+		/* order with io_iopoll_complete() checking ->result */
+		smp_wmb();
+		WRITE_ONCE(req->iopoll_completed, 1);
+	} else {
+		__io_req_complete(req, ret, 0, cs);
+	}
+}
+
+/*
+ * Called by the ->uring_cmd() provider when the command is done. res2 ends up
+ * in big_cqe[0] if the ring uses 32 byte CQEs.
+ */
+void io_uring_cmd_done(struct io_uring_cmd *ioucmd, ssize_t ret, u64 res2,
+		       unsigned issue_flags)
+{
+	__io_uring_cmd_done(cmd_to_io_kiocb(ioucmd), ret, res2, NULL);
+}
+EXPORT_SYMBOL_GPL(io_uring_cmd_done);
+
+/*
+ * Mark a command the driver returns -EIOCBQUEUED for, but may not complete
+ * until the application gives it a reason to, e.g. a FUSE daemon waiting for
+ * requests. On ring exit or task cancelation ->uring_cmd() is called again
+ * with IO_URING_F_CANCEL, the driver must then complete it if it still owns
+ * it.
+ */
+void io_uring_cmd_mark_cancelable(struct io_uring_cmd *ioucmd,
+				  unsigned int issue_flags)
+{
+	struct io_kiocb *req = cmd_to_io_kiocb(ioucmd);
+	struct io_ring_ctx *ctx = req->ctx;
+
+	spin_lock_irq(&ctx->completion_lock);
+	if (!(req->flags & REQ_F_CANCELABLE)) {
+		req->flags |= REQ_F_CANCELABLE;
+		hlist_add_head(&req->hash_node, &ctx->cancelable_uring_cmd);
+	}
+	spin_unlock_irq(&ctx->completion_lock);
+}
+EXPORT_SYMBOL_GPL(io_uring_cmd_mark_cancelable);
+
+void io_uring_cmd_del_cancelable(struct io_uring_cmd *ioucmd)
+{
+	struct io_kiocb *req = cmd_to_io_kiocb(ioucmd);
+	struct io_ring_ctx *ctx = req->ctx;
+	unsigned long flags;
+
+	if (!(READ_ONCE(req->flags) & REQ_F_CANCELABLE))
+		return;
+
+	spin_lock_irqsave(&ctx->completion_lock, flags);
+	if (req->flags & REQ_F_CANCELABLE) {
+		req->flags &= ~REQ_F_CANCELABLE;
+		hlist_del(&req->hash_node);
+	}
+	spin_unlock_irqrestore(&ctx->completion_lock, flags);
+}
+EXPORT_SYMBOL_GPL(io_uring_cmd_del_cancelable);
+
+/*
+ * Ask the drivers of parked uring_cmds of @task (all of them if NULL) to
+ * complete them. Returns true if any were found.
+ */
+static bool io_uring_try_cancel_uring_cmd(struct io_ring_ctx *ctx,
+					  struct task_struct *task)
+{
+	struct io_kiocb *req;
+	bool ret = false;
+
+	while (1) {
+		struct io_kiocb *cancel_req = NULL;
+
+		spin_lock_irq(&ctx->completion_lock);
+		hlist_for_each_entry(req, &ctx->cancelable_uring_cmd,
+				     hash_node) {
+			if (task && !io_task_match(req, task))
+				continue;
+			/* req is being completed, ignore */
+			if (!refcount_inc_not_zero(&req->refs))
+				continue;
+			/* the driver re-marks it if it doesn't complete it */
+			req->flags &= ~REQ_F_CANCELABLE;
+			hlist_del(&req->hash_node);
+			cancel_req = req;
+			break;
+		}
+		spin_unlock_irq(&ctx->completion_lock);
+
+		if (!cancel_req)
+			break;
+		cancel_req->file->f_op->uring_cmd(&cancel_req->uring_cmd,
+						  IO_URING_F_CANCEL);
+		io_put_req(cancel_req);
+		ret = true;
+	}
+
+	return ret;
+}
+
+static void io_uring_cmd_work(struct callback_head *cb)
+{
+	struct io_kiocb *req = container_of(cb, struct io_kiocb, task_work);
+	struct io_uring_cmd *ioucmd = &req->uring_cmd;
+	unsigned int issue_flags = 0;
+
+	if (current != req->task || (current->flags & PF_EXITING))
+		issue_flags |= IO_URING_F_TASK_DEAD;
+	ioucmd->task_work_cb(ioucmd, issue_flags);
+}
+
+/*
+ * Run task_work_cb from the context of the submitting task, for drivers that
+ * complete from irq context but need the task's mm to finish the command.
+ */
+void io_uring_cmd_do_in_task_lazy(struct io_uring_cmd *ioucmd,
+		void (*task_work_cb)(struct io_uring_cmd *, unsigned))
+{
+	struct io_kiocb *req = cmd_to_io_kiocb(ioucmd);
+	int ret;
+
+	ioucmd->task_work_cb = task_work_cb;
+	init_task_work(&req->task_work, io_uring_cmd_work);
+	ret = io_req_task_work_add(req, true);
+	if (unlikely(ret)) {
+		struct task_struct *tsk;
+
+		tsk = io_wq_get_task(req->ctx->io_wq);
+		task_work_add(tsk, &req->task_work, TWA_NONE);
+		wake_up_process(tsk);
+	}
+}
+EXPORT_SYMBOL_GPL(io_uring_cmd_do_in_task_lazy);
+
+int io_uring_cmd_import_fixed(u64 ubuf, unsigned long len, int rw,
+			      struct iov_iter *iter,
+			      struct io_uring_cmd *ioucmd)
+{
+	struct io_kiocb *req = cmd_to_io_kiocb(ioucmd);
+	ssize_t ret;
+
+	ret = __io_import_fixed(req, rw, iter, ubuf, len);
+	return ret < 0 ? ret : 0;
+}
+EXPORT_SYMBOL_GPL(io_uring_cmd_import_fixed);
+
+static void io_uring_cmd_copy_sqe(struct io_kiocb *req)
+{
+	struct io_uring_cmd *ioucmd = &req->uring_cmd;
+
+	memcpy(req->async_data, ioucmd->sqe, io_uring_sqe_size(req->ctx));
+	ioucmd->sqe = req->async_data;
+}
+
+static int io_uring_cmd_prep(struct io_kiocb *req,
+			     const struct io_uring_sqe *sqe)
 {
-	if (unlikely(req->ctx->flags & IORING_SETUP_SQPOLL))
-		return -EINVAL;
-	if (unlikely(req->flags & (REQ_F_FIXED_FILE | REQ_F_BUFFER_SELECT)))
-		return -EINVAL;
-	if (sqe->ioprio || sqe->rw_flags)
+	struct io_uring_cmd *ioucmd = &req->uring_cmd;
+	struct io_ring_ctx *ctx = req->ctx;
+
+	if (unlikely(sqe->ioprio || sqe->__pad1))
 		return -EINVAL;
+	if (!req->file->f_op->uring_cmd)
+		return -EOPNOTSUPP;
 
-	req->files_update.offset = READ_ONCE(sqe->off);
-	req->files_update.nr_args = READ_ONCE(sqe->len);
-	if (!req->files_update.nr_args)
+	ioucmd->flags = READ_ONCE(sqe->uring_cmd_flags);
+	if (ioucmd->flags & ~IORING_URING_CMD_FIXED)
 		return -EINVAL;
-	req->files_update.arg = READ_ONCE(sqe->addr);
+	if (ioucmd->flags & IORING_URING_CMD_FIXED)
+		req->buf_index = READ_ONCE(sqe->buf_index);
+
+	if (ctx->flags & IORING_SETUP_IOPOLL) {
+		if (!req->file->f_op->uring_cmd_iopoll)
+			return -EOPNOTSUPP;
+		req->iopoll_completed = 0;
+	}
+
+	ioucmd->cmd_op = READ_ONCE(sqe->cmd_op);
+	ioucmd->sqe = sqe;
+	/* deferred or linked, the SQ ring entry may be reused before issue */
+	if (req->async_data)
+		io_uring_cmd_copy_sqe(req);
 	return 0;
 }
 
-static int io_files_update(struct io_kiocb *req, bool force_nonblock,
-			   struct io_comp_state *cs)
+static int io_uring_cmd(struct io_kiocb *req, bool force_nonblock,
+			struct io_comp_state *cs)
 {
+	struct io_uring_cmd *ioucmd = &req->uring_cmd;
 	struct io_ring_ctx *ctx = req->ctx;
-	struct io_uring_files_update up;
+	unsigned int issue_flags = 0;
 	int ret;
 
 	if (force_nonblock)
-		return -EAGAIN;
-
-	up.offset = req->files_update.offset;
-	up.fds = req->files_update.arg;
+		issue_flags |= IO_URING_F_NONBLOCK;
+	if (ctx->flags & IORING_SETUP_SQE128)
+		issue_flags |= IO_URING_F_SQE128;
+	if (ctx->flags & IORING_SETUP_CQE32)
+		issue_flags |= IO_URING_F_CQE32;
+	if (ctx->flags & IORING_SETUP_IOPOLL)
+		issue_flags |= IO_URING_F_IOPOLL;
+	if (ctx->flags & IORING_SETUP_SQPOLL)
+		issue_flags |= IO_URING_F_SQPOLL;
 
-	mutex_lock(&ctx->uring_lock);
-	ret = __io_sqe_files_update(ctx, &up, req->files_update.nr_args);
-	mutex_unlock(&ctx->uring_lock);
+	ret = req->file->f_op->uring_cmd(ioucmd, issue_flags);
+	if (ret == -EAGAIN) {
+		/* retried from io-wq, after the SQ ring entry is consumed */
+		if (!req->async_data) {
+			if (__io_alloc_async_data(req))
+				return -ENOMEM;
+			io_uring_cmd_copy_sqe(req);
+		}
+		return -EAGAIN;
+	}
 
-	if (ret < 0)
-		req_set_fail_links(req);
-	__io_req_complete(req, ret, 0, cs);
+	/* -EIOCBQUEUED completes later through io_uring_cmd_done() */
+	if (ret != -EIOCBQUEUED)
+		__io_uring_cmd_done(req, ret, 0, cs);
 	return 0;
 }
 
@@ -5813,6 +7040,20 @@ static int io_req_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		return io_remove_buffers_prep(req, sqe);
 	case IORING_OP_TEE:
 		return io_tee_prep(req, sqe);
+	case IORING_OP_SEND_ZC:
+		return io_sendzc_prep(req, sqe);
+	case IORING_OP_URING_CMD:
+		return io_uring_cmd_prep(req, sqe);
+	case IORING_OP_RENAMEAT:
+		return io_renameat_prep(req, sqe);
+	case IORING_OP_UNLINKAT:
+		return io_unlinkat_prep(req, sqe);
+	case IORING_OP_MKDIRAT:
+		return io_mkdirat_prep(req, sqe);
+	case IORING_OP_SYMLINKAT:
+		return io_symlinkat_prep(req, sqe);
+	case IORING_OP_LINKAT:
+		return io_linkat_prep(req, sqe);
 	}
 
 	printk_once(KERN_WARNING "io_uring: unhandled opcode %d\n",
@@ -5905,6 +7146,10 @@ static void io_req_drop_files(struct io_kiocb *req)
 
 static void __io_clean_op(struct io_kiocb *req)
 {
+	/* ring mapped buffers are owned by the application */
+	if (req->flags & REQ_F_BUFFER_RING)
+		req->flags &= ~(REQ_F_BUFFER_SELECTED | REQ_F_BUFFER_RING);
+
 	if (req->flags & REQ_F_BUFFER_SELECTED) {
 		switch (req->opcode) {
 		case IORING_OP_READV:
@@ -5950,6 +7195,21 @@ static void __io_clean_op(struct io_kiocb *req)
 			if (req->open.filename)
 				putname(req->open.filename);
 			break;
+		case IORING_OP_RENAMEAT:
+			putname(req->rename.oldpath);
+			putname(req->rename.newpath);
+			break;
+		case IORING_OP_UNLINKAT:
+			putname(req->unlink.filename);
+			break;
+		case IORING_OP_MKDIRAT:
+			putname(req->mkdir.filename);
+			break;
+		case IORING_OP_SYMLINKAT:
+		case IORING_OP_LINKAT:
+			putname(req->hardlink.oldpath);
+			putname(req->hardlink.newpath);
+			break;
 		}
 		req->flags &= ~REQ_F_NEED_CLEANUP;
 	}
@@ -6053,6 +7313,27 @@ static int io_issue_sqe(struct io_kiocb *req, bool force_nonblock,
 	case IORING_OP_TEE:
 		ret = io_tee(req, force_nonblock);
 		break;
+	case IORING_OP_SEND_ZC:
+		ret = io_sendzc(req, force_nonblock, cs);
+		break;
+	case IORING_OP_URING_CMD:
+		ret = io_uring_cmd(req, force_nonblock, cs);
+		break;
+	case IORING_OP_RENAMEAT:
+		ret = io_renameat(req, force_nonblock);
+		break;
+	case IORING_OP_UNLINKAT:
+		ret = io_unlinkat(req, force_nonblock);
+		break;
+	case IORING_OP_MKDIRAT:
+		ret = io_mkdirat(req, force_nonblock);
+		break;
+	case IORING_OP_SYMLINKAT:
+		ret = io_symlinkat(req, force_nonblock);
+		break;
+	case IORING_OP_LINKAT:
+		ret = io_linkat(req, force_nonblock);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -6491,8 +7772,12 @@ static const struct io_uring_sqe *io_get_sqe(struct io_ring_ctx *ctx)
 	 *    though the application is the one updating it.
 	 */
 	head = READ_ONCE(sq_array[ctx->cached_sq_head & ctx->sq_mask]);
-	if (likely(head < ctx->sq_entries))
+	if (likely(head < ctx->sq_entries)) {
+		/* a 128 byte SQE takes up two slots of the array */
+		if (ctx->flags & IORING_SETUP_SQE128)
+			head <<= 1;
 		return &ctx->sq_sqes[head];
+	}
 
 	/* drop invalid entries */
 	ctx->cached_sq_dropped++;
@@ -6552,6 +7837,7 @@ static int io_init_req(struct io_ring_ctx *ctx, struct io_kiocb *req,
 	refcount_set(&req->refs, 2);
 	req->task = current;
 	req->result = 0;
+	req->cqe_extra = 0;
 
 	if (unlikely(req->opcode >= IORING_OP_LAST))
 		return -EINVAL;
@@ -6938,7 +8224,8 @@ static int io_wake_function(struct wait_queue_entry *curr, unsigned int mode,
 	 * Cannot safely flush overflowed CQEs from here, ensure we wake up
 	 * the task, and the next invocation will do it.
 	 */
-	if (io_should_wake(iowq) || test_bit(0, &iowq->ctx->cq_check_overflow))
+	if (io_should_wake(iowq) || test_bit(0, &iowq->ctx->cq_check_overflow) ||
+	    !llist_empty(&iowq->ctx->work_llist))
 		return autoremove_wake_function(curr, mode, wake_flags, key);
 	return -1;
 }
@@ -6979,6 +8266,7 @@ static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 	int ret = 0;
 
 	do {
+		io_run_local_work(ctx);
 		io_cqring_overflow_flush(ctx, false, NULL, NULL);
 		if (io_cqring_events(ctx) >= min_events)
 			return 0;
@@ -7011,6 +8299,8 @@ static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 			continue;
 		else if (ret < 0)
 			break;
+		if (io_run_local_work(ctx))
+			continue;
 		if (io_should_wake(&iowq))
 			break;
 		if (test_bit(0, &ctx->cq_check_overflow))
@@ -7870,6 +9160,7 @@ static int io_uring_alloc_task_context(struct task_struct *task)
 	tctx->last = NULL;
 	atomic_set(&tctx->in_idle, 0);
 	tctx->sqpoll = false;
+	memset(tctx->registered_rings, 0, sizeof(tctx->registered_rings));
 	io_init_identity(&tctx->__identity);
 	tctx->identity = &tctx->__identity;
     /**
@@ -8062,12 +9353,17 @@ static void *io_mem_alloc(size_t size)
 	return (void *) __get_free_pages(gfp_flags, get_order(size));
 }
 
-static unsigned long rings_size(unsigned sq_entries, unsigned cq_entries,
-				size_t *sq_offset)
+static unsigned long rings_size(unsigned int flags, unsigned sq_entries,
+				unsigned cq_entries, size_t *sq_offset)
 {
 	struct io_rings *rings;
 	size_t off, sq_array_size;
 
+	if (flags & IORING_SETUP_CQE32) {
+		if (check_shl_overflow(cq_entries, 1, &cq_entries))
+			return SIZE_MAX;
+	}
+
 	off = struct_size(rings, cqes, cq_entries);
 	if (off == SIZE_MAX)
 		return SIZE_MAX;
@@ -8091,14 +9387,23 @@ static unsigned long rings_size(unsigned sq_entries, unsigned cq_entries,
 	return off;
 }
 
-static unsigned long ring_pages(unsigned sq_entries, unsigned cq_entries)
+static unsigned long sqes_size(unsigned int flags, unsigned sq_entries)
+{
+	size_t sqe_size = sizeof(struct io_uring_sqe);
+
+	if (flags & IORING_SETUP_SQE128)
+		sqe_size *= 2;
+	return array_size(sqe_size, sq_entries);
+}
+
+static unsigned long ring_pages(unsigned int flags, unsigned sq_entries,
+				unsigned cq_entries)
 {
 	size_t pages;
 
 	pages = (size_t)1 << get_order(
-		rings_size(sq_entries, cq_entries, NULL));
-	pages += (size_t)1 << get_order(
-		array_size(sizeof(struct io_uring_sqe), sq_entries));
+		rings_size(flags, sq_entries, cq_entries, NULL));
+	pages += (size_t)1 << get_order(sqes_size(flags, sq_entries));
 
 	return pages;
 }
@@ -8402,16 +9707,129 @@ static int __io_destroy_buffers(int id, void *p, void *data)
 	return 0;
 }
 
+static void io_free_buf_ring(struct io_ring_ctx *ctx, struct io_buffer_ring *bl)
+{
+	vunmap(bl->br);
+	unpin_user_pages(bl->pages, bl->nr_pages);
+	io_unaccount_mem(ctx, bl->nr_pages, ACCT_PINNED);
+	kvfree(bl->pages);
+	kfree(bl);
+}
+
+static int __io_destroy_buf_ring(int id, void *p, void *data)
+{
+	io_free_buf_ring(data, p);
+	return 0;
+}
+
 static void io_destroy_buffers(struct io_ring_ctx *ctx)
 {
 	idr_for_each(&ctx->io_buffer_idr, __io_destroy_buffers, ctx);
 	idr_destroy(&ctx->io_buffer_idr);
+	idr_for_each(&ctx->io_buf_ring_idr, __io_destroy_buf_ring, ctx);
+	idr_destroy(&ctx->io_buf_ring_idr);
+}
+
+/*
+ * Map a ring of provided buffers from userspace as buffer group reg.bgid.
+ * The application then recycles buffers by writing entries and bumping the
+ * tail, without an IORING_OP_PROVIDE_BUFFERS submission per buffer.
+ */
+static int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_buf_reg reg;
+	struct io_buffer_ring *bl;
+	struct page **pages;
+	int nr_pages, pret, ret;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+		return -EINVAL;
+	if (!reg.ring_addr || (reg.ring_addr & ~PAGE_MASK))
+		return -EINVAL;
+	if (!is_power_of_2(reg.ring_entries) || reg.ring_entries > 32768)
+		return -EINVAL;
+	if (idr_find(&ctx->io_buffer_idr, reg.bgid) ||
+	    idr_find(&ctx->io_buf_ring_idr, reg.bgid))
+		return -EEXIST;
+
+	nr_pages = DIV_ROUND_UP(reg.ring_entries * sizeof(struct io_uring_buf),
+				PAGE_SIZE);
+	bl = kzalloc(sizeof(*bl), GFP_KERNEL);
+	pages = kvmalloc_array(nr_pages, sizeof(struct page *), GFP_KERNEL);
+	ret = -ENOMEM;
+	if (!bl || !pages)
+		goto err;
+
+	ret = io_account_mem(ctx, nr_pages, ACCT_PINNED);
+	if (ret)
+		goto err;
+
+	mmap_read_lock(current->mm);
+	pret = pin_user_pages(reg.ring_addr, nr_pages,
+			      FOLL_WRITE | FOLL_LONGTERM, pages, NULL);
+	mmap_read_unlock(current->mm);
+	if (pret != nr_pages) {
+		ret = pret < 0 ? pret : -EFAULT;
+		if (pret > 0)
+			unpin_user_pages(pages, pret);
+		goto err_unaccount;
+	}
+
+	/* one linear mapping, so entries can be indexed across pages */
+	bl->br = vmap(pages, nr_pages, VM_MAP, PAGE_KERNEL);
+	ret = -ENOMEM;
+	if (!bl->br)
+		goto err_unpin;
+	bl->pages = pages;
+	bl->nr_pages = nr_pages;
+	bl->mask = reg.ring_entries - 1;
+
+	ret = idr_alloc(&ctx->io_buf_ring_idr, bl, reg.bgid, reg.bgid + 1,
+			GFP_KERNEL);
+	if (ret < 0) {
+		io_free_buf_ring(ctx, bl);
+		return ret;
+	}
+	return 0;
+err_unpin:
+	unpin_user_pages(pages, nr_pages);
+err_unaccount:
+	io_unaccount_mem(ctx, nr_pages, ACCT_PINNED);
+err:
+	kvfree(pages);
+	kfree(bl);
+	return ret;
+}
+
+static int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_buf_reg reg;
+	struct io_buffer_ring *bl;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+		return -EINVAL;
+
+	/* requests only keep the bid of a selected buffer, no quiesce needed */
+	bl = idr_remove(&ctx->io_buf_ring_idr, reg.bgid);
+	if (!bl)
+		return -ENOENT;
+	io_free_buf_ring(ctx, bl);
+	return 0;
 }
 
 static void io_ring_ctx_free(struct io_ring_ctx *ctx)
 {
 	io_finish_async(ctx);
 	io_sqe_buffer_unregister(ctx);
+	/* buffer rings unaccount pinned_vm too, so before mm_account goes */
+	io_destroy_buffers(ctx);
+
+	if (ctx->submitter_task)
+		put_task_struct(ctx->submitter_task);
 
 	if (ctx->sqo_task) {
 		put_task_struct(ctx->sqo_task);
@@ -8427,7 +9845,6 @@ static void io_ring_ctx_free(struct io_ring_ctx *ctx)
 
 	io_sqe_files_unregister(ctx);
 	io_eventfd_unregister(ctx);
-	io_destroy_buffers(ctx);
 	idr_destroy(&ctx->personality_idr);
 
 #if defined(CONFIG_UNIX)
@@ -8462,7 +9879,8 @@ static __poll_t io_uring_poll(struct file *file, poll_table *wait)
 	if (!io_sqring_full(ctx))
 		mask |= EPOLLOUT | EPOLLWRNORM;
 	io_cqring_overflow_flush(ctx, false, NULL, NULL);
-	if (io_cqring_events(ctx))
+	/* deferred task_work needs io_uring_enter(2) to post its CQEs */
+	if (io_cqring_events(ctx) || !llist_empty(&ctx->work_llist))
 		mask |= EPOLLIN | EPOLLRDNORM;
 
 	return mask;
@@ -8502,6 +9920,8 @@ static void io_ring_exit_work(struct work_struct *work)
 	 */
 	do {
 		io_iopoll_try_reap_events(ctx);
+		/* drivers may have parked more commands since the kill */
+		io_uring_try_cancel_uring_cmd(ctx, NULL);
 	} while (!wait_for_completion_timeout(&ctx->ref_comp, HZ/20));
 	io_ring_ctx_free(ctx);
 }
@@ -8518,6 +9938,8 @@ static void io_ring_ctx_wait_and_kill(struct io_ring_ctx *ctx)
 	mutex_lock(&ctx->uring_lock);
 	percpu_ref_kill(&ctx->refs);
 	/* if force is set, the ring is going away. always drop after that */
+	if (ctx->flags & IORING_SETUP_DEFER_TASKRUN)
+		io_move_local_work(ctx);
 
 	if (WARN_ON_ONCE((ctx->flags & IORING_SETUP_SQPOLL) && !ctx->sqo_dead))
 		ctx->sqo_dead = 1;
@@ -8529,6 +9951,7 @@ static void io_ring_ctx_wait_and_kill(struct io_ring_ctx *ctx)
 
 	io_kill_timeouts(ctx, NULL);
 	io_poll_remove_all(ctx, NULL);
+	io_uring_try_cancel_uring_cmd(ctx, NULL);
 
 	if (ctx->io_wq)
 		io_wq_cancel_cb(ctx->io_wq, io_cancel_ctx_cb, ctx, true);
@@ -8542,8 +9965,8 @@ static void io_ring_ctx_wait_and_kill(struct io_ring_ctx *ctx)
 	 * is closed but resources aren't reaped yet. This can cause
 	 * spurious failure in setting up a new ring.
 	 */
-	io_unaccount_mem(ctx, ring_pages(ctx->sq_entries, ctx->cq_entries),
-			 ACCT_LOCKED);
+	io_unaccount_mem(ctx, ring_pages(ctx->flags, ctx->sq_entries,
+					 ctx->cq_entries), ACCT_LOCKED);
 
 	INIT_WORK(&ctx->exit_work, io_ring_exit_work);
 	/*
@@ -8780,6 +10203,7 @@ static bool __io_uring_cancel_task_requests(struct io_ring_ctx *ctx,
 
 		ret |= io_poll_remove_all(ctx, task);
 		ret |= io_kill_timeouts(ctx, task);
+		ret |= io_uring_try_cancel_uring_cmd(ctx, task);
 	}
 
 	return ret;
@@ -8819,6 +10243,8 @@ static void io_uring_cancel_task_requests(struct io_ring_ctx *ctx,
 	io_cqring_overflow_flush(ctx, true, task, files);
 
 	while (__io_uring_cancel_task_requests(ctx, task, files)) {
+		if (ctx->flags & IORING_SETUP_DEFER_TASKRUN)
+			io_move_local_work(ctx);
 		io_run_task_work();
 		cond_resched();
 	}
@@ -8898,6 +10324,18 @@ static void io_uring_remove_task_files(struct io_uring_task *tctx)
 		io_uring_del_task_file(file);
 }
 
+static void io_uring_unreg_ringfd(struct io_uring_task *tctx)
+{
+	int i;
+
+	for (i = 0; i < IO_RINGFD_REG_MAX; i++) {
+		if (tctx->registered_rings[i]) {
+			fput(tctx->registered_rings[i]);
+			tctx->registered_rings[i] = NULL;
+		}
+	}
+}
+
 void __io_uring_files_cancel(struct files_struct *files)
 {
 	struct io_uring_task *tctx = current->io_uring;
@@ -8910,8 +10348,10 @@ void __io_uring_files_cancel(struct files_struct *files)
 		io_uring_cancel_task_requests(file->private_data, files);
 	atomic_dec(&tctx->in_idle);
 
-	if (files)
+	if (files) {
+		io_uring_unreg_ringfd(tctx);
 		io_uring_remove_task_files(tctx);
+	}
 }
 
 static s64 tctx_inflight(struct io_uring_task *tctx)
@@ -8979,6 +10419,7 @@ void __io_uring_task_cancel(void)
 	finish_wait(&tctx->wait, &wait);
 	atomic_dec(&tctx->in_idle);
 
+	io_uring_unreg_ringfd(tctx);
 	io_uring_remove_task_files(tctx);
 }
 
@@ -9134,11 +10575,26 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 	io_run_task_work();
 
 	if (flags & ~(IORING_ENTER_GETEVENTS | IORING_ENTER_SQ_WAKEUP |
-			IORING_ENTER_SQ_WAIT))
+			IORING_ENTER_SQ_WAIT | IORING_ENTER_REGISTERED_RING))
 		return -EINVAL;
 
-	f = fdget(fd);
-	if (!f.file)
+	/*
+	 * Ring fd has been registered via IORING_REGISTER_RING_FDS, we hold
+	 * the file reference ourselves and only this task can drop it, so
+	 * skip fdget() and the shared file table refcount it may hit.
+	 */
+	if (flags & IORING_ENTER_REGISTERED_RING) {
+		struct io_uring_task *tctx = current->io_uring;
+
+		if (unlikely(!tctx || fd >= IO_RINGFD_REG_MAX))
+			return -EINVAL;
+		fd = array_index_nospec(fd, IO_RINGFD_REG_MAX);
+		f.file = tctx->registered_rings[fd];
+		f.flags = 0;
+	} else {
+		f = fdget(fd);
+	}
+	if (unlikely(!f.file))
 		return -EBADF;
 
 	ret = -EOPNOTSUPP;
@@ -9157,6 +10613,10 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 	if (ctx->flags & IORING_SETUP_R_DISABLED)
 		goto out;
 
+	ret = -EEXIST;
+	if (ctx->submitter_task && ctx->submitter_task != current)
+		goto out;
+
 	/*
 	 * For SQ polling, the thread will do all submissions and completions.
 	 * Just return the requested submit count, and wake the thread if
@@ -9279,6 +10739,8 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 
 	seq_printf(m, "SqThread:\t%d\n", sq ? task_pid_nr(sq->thread) : -1);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq ? task_cpu(sq->thread) : -1);
+	if (ctx->io_wq)
+		io_wq_show_fdinfo(ctx->io_wq, m);
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct fixed_file_table *table;
@@ -9357,7 +10819,8 @@ static int io_allocate_scq_urings(struct io_ring_ctx *ctx,
 	ctx->sq_entries = p->sq_entries;
 	ctx->cq_entries = p->cq_entries;
 
-	size = rings_size(p->sq_entries, p->cq_entries, &sq_array_offset);
+	size = rings_size(p->flags, p->sq_entries, p->cq_entries,
+			  &sq_array_offset);
 	if (size == SIZE_MAX)
 		return -EOVERFLOW;
 
@@ -9377,7 +10840,7 @@ static int io_allocate_scq_urings(struct io_ring_ctx *ctx,
 	ctx->sq_mask = rings->sq_ring_mask;
 	ctx->cq_mask = rings->cq_ring_mask;
 
-	size = array_size(sizeof(struct io_uring_sqe), p->sq_entries);
+	size = sqes_size(p->flags, p->sq_entries);
 	if (size == SIZE_MAX) {
 		io_mem_free(ctx->rings);
 		ctx->rings = NULL;
@@ -9514,7 +10977,7 @@ static int io_uring_create(unsigned entries, struct io_uring_params *p,
      */
 	if (limit_mem) {
 		ret = __io_account_mem(user,
-				ring_pages(p->sq_entries, p->cq_entries));
+				ring_pages(p->flags, p->sq_entries, p->cq_entries));
 		if (ret) {
 			free_uid(user);
 			return ret;
@@ -9527,8 +10990,8 @@ static int io_uring_create(unsigned entries, struct io_uring_params *p,
 	ctx = io_ring_ctx_alloc(p);
 	if (!ctx) {
 		if (limit_mem)
-			__io_unaccount_mem(user, ring_pages(p->sq_entries,
-								p->cq_entries));
+			__io_unaccount_mem(user, ring_pages(p->flags,
+						p->sq_entries, p->cq_entries));
 		free_uid(user);
 		return -ENOMEM;
 	}
@@ -9579,7 +11042,7 @@ static int io_uring_create(unsigned entries, struct io_uring_params *p,
 	 * do this before hitting the general error path, as ring freeing
 	 * will un-account as well.
 	 */
-	io_account_mem(ctx, ring_pages(p->sq_entries, p->cq_entries),
+	io_account_mem(ctx, ring_pages(p->flags, p->sq_entries, p->cq_entries),
 		       ACCT_LOCKED);
 	ctx->limit_mem = limit_mem;
 
@@ -9597,8 +11060,11 @@ static int io_uring_create(unsigned entries, struct io_uring_params *p,
 	if (ret)
 		goto err;
 
-	if (!(p->flags & IORING_SETUP_R_DISABLED))
+	if (!(p->flags & IORING_SETUP_R_DISABLED)) {
+		if (p->flags & IORING_SETUP_SINGLE_ISSUER)
+			ctx->submitter_task = get_task_struct(current);
 		io_sq_offload_start(ctx);
+	}
 
     /**
      *
@@ -9692,7 +11158,20 @@ static long io_uring_setup(u32 entries, struct io_uring_params __user *params)
 	if (p.flags & ~(IORING_SETUP_IOPOLL | IORING_SETUP_SQPOLL |
 			IORING_SETUP_SQ_AFF | IORING_SETUP_CQSIZE |
 			IORING_SETUP_CLAMP | IORING_SETUP_ATTACH_WQ |
-			IORING_SETUP_R_DISABLED))
+			IORING_SETUP_R_DISABLED | IORING_SETUP_SINGLE_ISSUER |
+			IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_SQE128 |
+			IORING_SETUP_CQE32))
+		return -EINVAL;
+
+	/*
+	 * Deferred task_work is run by the one task waiting on the ring, the
+	 * SQPOLL thread does its own completion handling.
+	 */
+	if ((p.flags & IORING_SETUP_DEFER_TASKRUN) &&
+	    !(p.flags & IORING_SETUP_SINGLE_ISSUER))
+		return -EINVAL;
+	if ((p.flags & IORING_SETUP_SINGLE_ISSUER) &&
+	    (p.flags & IORING_SETUP_SQPOLL))
 		return -EINVAL;
 
     /**
@@ -9863,6 +11342,9 @@ static int io_register_enable_rings(struct io_ring_ctx *ctx)
 	if (ctx->restrictions.registered)
 		ctx->restricted = 1;
 
+	if ((ctx->flags & IORING_SETUP_SINGLE_ISSUER) && !ctx->submitter_task)
+		ctx->submitter_task = get_task_struct(current);
+
 	ctx->flags &= ~IORING_SETUP_R_DISABLED;
 
 	io_sq_offload_start(ctx);
@@ -9870,6 +11352,178 @@ static int io_register_enable_rings(struct io_ring_ctx *ctx)
 	return 0;
 }
 
+static int io_register_iowq_aff(struct io_ring_ctx *ctx, void __user *arg,
+				unsigned len)
+{
+	cpumask_var_t new_mask;
+	int ret;
+
+	if (!ctx->io_wq)
+		return -EINVAL;
+	if (!alloc_cpumask_var(&new_mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	cpumask_clear(new_mask);
+	if (len > cpumask_size())
+		len = cpumask_size();
+
+	if (copy_from_user(new_mask, arg, len)) {
+		free_cpumask_var(new_mask);
+		return -EFAULT;
+	}
+
+	ret = io_wq_cpu_affinity(ctx->io_wq, new_mask);
+	free_cpumask_var(new_mask);
+	return ret;
+}
+
+static int io_unregister_iowq_aff(struct io_ring_ctx *ctx)
+{
+	if (!ctx->io_wq)
+		return -EINVAL;
+
+	return io_wq_cpu_affinity(ctx->io_wq, NULL);
+}
+
+/*
+ * Limits apply to the io-wq of the ring, which is shared with any ring
+ * attached to it through IORING_SETUP_ATTACH_WQ.
+ */
+static int io_register_iowq_max_workers(struct io_ring_ctx *ctx,
+					void __user *arg)
+{
+	__u32 new_count[2];
+	int i, ret;
+
+	if (!ctx->io_wq)
+		return -EINVAL;
+	if (copy_from_user(new_count, arg, sizeof(new_count)))
+		return -EFAULT;
+	for (i = 0; i < ARRAY_SIZE(new_count); i++)
+		if (new_count[i] > INT_MAX)
+			return -EINVAL;
+
+	ret = io_wq_max_workers(ctx->io_wq, new_count);
+	if (ret)
+		return ret;
+
+	if (copy_to_user(arg, new_count, sizeof(new_count)))
+		return -EFAULT;
+	return 0;
+}
+
+/*
+ * Stash ring files in the task's io_uring context, so io_uring_enter(2) can
+ * find them by index instead of going through the file table.
+ */
+static int io_ringfd_register(void __user *arg, unsigned nr_args)
+{
+	struct io_uring_rsrc_update __user *uarg = arg;
+	struct io_uring_rsrc_update reg;
+	struct io_uring_task *tctx;
+	int ret = 0, i;
+
+	if (!nr_args || nr_args > IO_RINGFD_REG_MAX)
+		return -EINVAL;
+
+	for (i = 0; i < nr_args; i++) {
+		unsigned start, end;
+		struct file *file;
+
+		if (copy_from_user(&reg, &uarg[i], sizeof(reg))) {
+			ret = -EFAULT;
+			break;
+		}
+		if (reg.resv) {
+			ret = -EINVAL;
+			break;
+		}
+
+		if (reg.offset == -1U) {
+			start = 0;
+			end = IO_RINGFD_REG_MAX;
+		} else {
+			if (reg.offset >= IO_RINGFD_REG_MAX) {
+				ret = -EINVAL;
+				break;
+			}
+			start = reg.offset;
+			end = start + 1;
+		}
+
+		file = fget(reg.data);
+		if (!file) {
+			ret = -EBADF;
+			break;
+		}
+		if (file->f_op != &io_uring_fops) {
+			fput(file);
+			ret = -EOPNOTSUPP;
+			break;
+		}
+		/* have the task cancelation drop the registration too */
+		ret = io_uring_add_task_file(file->private_data, file);
+		if (ret) {
+			fput(file);
+			break;
+		}
+
+		tctx = current->io_uring;
+		ret = -EBUSY;
+		for (reg.offset = start; reg.offset < end; reg.offset++) {
+			if (tctx->registered_rings[reg.offset])
+				continue;
+			tctx->registered_rings[reg.offset] = file;
+			ret = 0;
+			break;
+		}
+		if (ret) {
+			fput(file);
+			break;
+		}
+		if (copy_to_user(&uarg[i], &reg, sizeof(reg))) {
+			tctx->registered_rings[reg.offset] = NULL;
+			fput(file);
+			ret = -EFAULT;
+			break;
+		}
+	}
+
+	return i ? i : ret;
+}
+
+static int io_ringfd_unregister(void __user *arg, unsigned nr_args)
+{
+	struct io_uring_rsrc_update __user *uarg = arg;
+	struct io_uring_task *tctx = current->io_uring;
+	struct io_uring_rsrc_update reg;
+	int ret = 0, i;
+
+	if (!nr_args || nr_args > IO_RINGFD_REG_MAX)
+		return -EINVAL;
+	if (!tctx)
+		return 0;
+
+	for (i = 0; i < nr_args; i++) {
+		if (copy_from_user(&reg, &uarg[i], sizeof(reg))) {
+			ret = -EFAULT;
+			break;
+		}
+		if (reg.resv || reg.data || reg.offset >= IO_RINGFD_REG_MAX) {
+			ret = -EINVAL;
+			break;
+		}
+
+		reg.offset = array_index_nospec(reg.offset, IO_RINGFD_REG_MAX);
+		if (tctx->registered_rings[reg.offset]) {
+			fput(tctx->registered_rings[reg.offset]);
+			tctx->registered_rings[reg.offset] = NULL;
+		}
+	}
+
+	return i ? i : ret;
+}
+
 static bool io_register_op_must_quiesce(int op)
 {
 	switch (op) {
@@ -9878,6 +11532,13 @@ static bool io_register_op_must_quiesce(int op)
 	case IORING_REGISTER_PROBE:
 	case IORING_REGISTER_PERSONALITY:
 	case IORING_UNREGISTER_PERSONALITY:
+	case IORING_REGISTER_PBUF_RING:
+	case IORING_UNREGISTER_PBUF_RING:
+	case IORING_REGISTER_RING_FDS:
+	case IORING_UNREGISTER_RING_FDS:
+	case IORING_REGISTER_IOWQ_AFF:
+	case IORING_UNREGISTER_IOWQ_AFF:
+	case IORING_REGISTER_IOWQ_MAX_WORKERS:
 		return false;
 	default:
 		return true;
@@ -9903,6 +11564,8 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 
 	if (io_register_op_must_quiesce(opcode)) {
 		percpu_ref_kill(&ctx->refs);
+		if (ctx->flags & IORING_SETUP_DEFER_TASKRUN)
+			io_move_local_work(ctx);
 
 		/*
 		 * Drop uring mutex before waiting for references to exit. If
@@ -10039,6 +11702,42 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
     case IORING_REGISTER_RESTRICTIONS:
 		ret = io_register_restrictions(ctx, arg, nr_args);
 		break;
+	case IORING_REGISTER_PBUF_RING:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_pbuf_ring(ctx, arg);
+		break;
+	case IORING_UNREGISTER_PBUF_RING:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_unregister_pbuf_ring(ctx, arg);
+		break;
+	case IORING_REGISTER_RING_FDS:
+		ret = io_ringfd_register(arg, nr_args);
+		break;
+	case IORING_UNREGISTER_RING_FDS:
+		ret = io_ringfd_unregister(arg, nr_args);
+		break;
+	case IORING_REGISTER_IOWQ_AFF:
+		ret = -EINVAL;
+		if (!arg || !nr_args)
+			break;
+		ret = io_register_iowq_aff(ctx, arg, nr_args);
+		break;
+	case IORING_UNREGISTER_IOWQ_AFF:
+		ret = -EINVAL;
+		if (arg || nr_args)
+			break;
+		ret = io_unregister_iowq_aff(ctx);
+		break;
+	case IORING_REGISTER_IOWQ_MAX_WORKERS:
+		ret = -EINVAL;
+		if (!arg || nr_args != 2)
+			break;
+		ret = io_register_iowq_max_workers(ctx, arg);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -10080,6 +11779,10 @@ SYSCALL_DEFINE4(io_uring_register, unsigned int, fd, unsigned int, opcode,
      */
 	ctx = f.file->private_data;
 
+	ret = -EEXIST;
+	if (ctx->submitter_task && ctx->submitter_task != current)
+		goto out_fput;
+
 	mutex_lock(&ctx->uring_lock);
     /**
      *
@@ -10138,6 +11841,9 @@ static int __init io_uring_init(void)
 	BUILD_BUG_SQE_ELEM(40, __u16,  buf_index);
 	BUILD_BUG_SQE_ELEM(42, __u16,  personality);
 	BUILD_BUG_SQE_ELEM(44, __s32,  splice_fd_in);
+	BUILD_BUG_SQE_ELEM(8,  __u32,  cmd_op);
+	BUILD_BUG_SQE_ELEM(28, __u32,  uring_cmd_flags);
+	BUILD_BUG_ON(offsetof(struct io_uring_sqe, cmd) != 48);
 
 	BUILD_BUG_ON(ARRAY_SIZE(io_op_defs) != IORING_OP_LAST);
 	BUILD_BUG_ON(__REQ_F_LAST_BIT >= 8 * sizeof(int));
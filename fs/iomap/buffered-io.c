@@ -516,6 +516,12 @@ EXPORT_SYMBOL_GPL(iomap_migrate_page);
 
 enum {
 	IOMAP_WRITE_F_UNSHARE		= (1 << 0),
+	IOMAP_WRITE_F_NOWAIT		= (1 << 1),
+};
+
+struct iomap_write_ctx {
+	struct iov_iter		*iter;
+	unsigned		flags;
 };
 
 static void
@@ -576,7 +582,11 @@ __iomap_write_begin(struct inode *inode, loff_t pos, unsigned len, int flags,
 				return -EIO;
 			zero_user_segments(page, poff, from, to, poff + plen);
 		} else {
-			int status = iomap_read_page_sync(block_start, page,
+			int status;
+
+			if (flags & IOMAP_WRITE_F_NOWAIT)
+				return -EAGAIN;
+			status = iomap_read_page_sync(block_start, page,
 					poff, plen, srcmap);
 			if (status)
 				return status;
@@ -592,6 +602,7 @@ iomap_write_begin(struct inode *inode, loff_t pos, unsigned len, unsigned flags,
 		struct page **pagep, struct iomap *iomap, struct iomap *srcmap)
 {
 	const struct iomap_page_ops *page_ops = iomap->page_ops;
+	unsigned aop_flags = AOP_FLAG_NOFS;
 	struct page *page;
 	int status = 0;
 
@@ -608,18 +619,26 @@ iomap_write_begin(struct inode *inode, loff_t pos, unsigned len, unsigned flags,
 			return status;
 	}
 
+	if (flags & IOMAP_WRITE_F_NOWAIT)
+		aop_flags |= AOP_FLAG_NOWAIT;
+
 	page = grab_cache_page_write_begin(inode->i_mapping, pos >> PAGE_SHIFT,
-			AOP_FLAG_NOFS);
+			aop_flags);
 	if (!page) {
-		status = -ENOMEM;
+		status = (flags & IOMAP_WRITE_F_NOWAIT) ? -EAGAIN : -ENOMEM;
 		goto out_no_page;
 	}
 
 	if (srcmap->type == IOMAP_INLINE)
 		iomap_read_inline_data(inode, page, srcmap);
-	else if (iomap->flags & IOMAP_F_BUFFER_HEAD)
-		status = __block_write_begin_int(page, pos, len, NULL, srcmap);
-	else
+	else if (iomap->flags & IOMAP_F_BUFFER_HEAD) {
+		/* the buffer_head path may read the page synchronously */
+		if ((flags & IOMAP_WRITE_F_NOWAIT) && !PageUptodate(page))
+			status = -EAGAIN;
+		else
+			status = __block_write_begin_int(page, pos, len, NULL,
+					srcmap);
+	} else
 		status = __iomap_write_begin(inode, pos, len, flags, page,
 				srcmap);
 
@@ -770,16 +789,27 @@ static loff_t
 iomap_write_actor(struct inode *inode, loff_t pos, loff_t length, void *data,
 		struct iomap *iomap, struct iomap *srcmap)
 {
-	struct iov_iter *i = data;
+	struct iomap_write_ctx *ctx = data;
+	struct iov_iter *i = ctx->iter;
+	unsigned int bdp_flags = 0;
 	long status = 0;
 	ssize_t written = 0;
 
+	if (ctx->flags & IOMAP_WRITE_F_NOWAIT)
+		bdp_flags |= BDP_ASYNC;
+
 	do {
 		struct page *page;
 		unsigned long offset;	/* Offset into pagecache page */
 		unsigned long bytes;	/* Bytes to write to page */
 		size_t copied;		/* Bytes copied from user */
 
+		/* throttle up front so a nowait writer can bail out cleanly */
+		status = balance_dirty_pages_ratelimited_flags(inode->i_mapping,
+				bdp_flags);
+		if (unlikely(status))
+			break;
+
 		offset = offset_in_page(pos);
 		bytes = min_t(unsigned long, PAGE_SIZE - offset,
 						iov_iter_count(i));
@@ -802,8 +832,8 @@ again:
 			break;
 		}
 
-		status = iomap_write_begin(inode, pos, bytes, 0, &page, iomap,
-				srcmap);
+		status = iomap_write_begin(inode, pos, bytes, ctx->flags, &page,
+				iomap, srcmap);
 		if (unlikely(status))
 			break;
 
@@ -834,8 +864,6 @@ again:
 		pos += copied;
 		written += copied;
 		length -= copied;
-
-		balance_dirty_pages_ratelimited(inode->i_mapping);
 	} while (iov_iter_count(i) && length);
 
 	return written ? written : status;
@@ -855,6 +883,13 @@ iomap_file_buffered_write(struct kiocb *iocb, struct iov_iter *iter,
 {
 	struct inode *inode = iocb->ki_filp->f_mapping->host;
 	loff_t pos = iocb->ki_pos, ret = 0, written = 0;
+	struct iomap_write_ctx ctx = { .iter = iter };
+	unsigned flags = IOMAP_WRITE;
+
+	if (iocb->ki_flags & IOCB_NOWAIT) {
+		flags |= IOMAP_NOWAIT;
+		ctx.flags |= IOMAP_WRITE_F_NOWAIT;
+	}
 
 	/**
 	 * @brief
@@ -862,7 +897,7 @@ iomap_file_buffered_write(struct kiocb *iocb, struct iov_iter *iter,
 	 */
 	while (iov_iter_count(iter)) {
 		ret = iomap_apply(inode, pos, iov_iter_count(iter),
-				IOMAP_WRITE, ops, iter, iomap_write_actor);
+				flags, ops, &ctx, iomap_write_actor);
 		if (ret <= 0)
 			break;
 		pos += ret;
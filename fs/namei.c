@@ -39,6 +39,8 @@
 #include <linux/bitops.h>
 #include <linux/init_task.h>
 #include <linux/uaccess.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "internal.h"
 #include "mount.h"
@@ -268,6 +270,9 @@ struct filename *getname_kernel(const char * filename)
  */
 void putname(struct filename *name)
 {
+	if (IS_ERR(name))
+		return;
+
 	BUG_ON(name->refcnt <= 0);
 
 	if (--name->refcnt > 0)
@@ -312,22 +317,12 @@ static int check_acl(struct inode *inode, int mask)
 }
 
 /*
- * This does the basic UNIX permission checking.
- *
- * Note that the POSIX ACL check cares about the MAY_NOT_BLOCK bit,
- * for RCU walking.
+ * Group, other and ACL part of acl_permission_check(), for callers that
+ * aren't the owner of @inode.  @mode is the i_mode the check is based on.
  */
-static int acl_permission_check(struct inode *inode, int mask)
+static int group_permission_check(struct inode *inode, unsigned int mode,
+				  int mask)
 {
-	unsigned int mode = inode->i_mode;
-
-	/* Are we the owner? If so, ACL's don't matter */
-	if (likely(uid_eq(current_fsuid(), inode->i_uid))) {
-		mask &= 7;
-		mode >>= 6;
-		return (mask & ~mode) ? -EACCES : 0;
-	}
-
 	/* Do we have ACL's? */
 	if (IS_POSIXACL(inode) && (mode & S_IRWXG)) {
 		int error = check_acl(inode, mask);
@@ -352,6 +347,229 @@ static int acl_permission_check(struct inode *inode, int mask)
 	return (mask & ~mode) ? -EACCES : 0;
 }
 
+/*
+ * Every component of a path walk needs MAY_EXEC on its parent directory,
+ * and for directories with ACLs evaluating that is a large part of the
+ * cost of a lookup.  So a directory remembers the last identity (fsuid,
+ * fsgid and supplementary groups) that passed the check through its
+ * group/other bits or ACL, together with the mode, owner and ACL the result
+ * was computed from.  The identity is compared by value, as every execve()
+ * gets a new cred.  The entry pins the ACL, so comparing its pointer is
+ * enough and no invalidation is needed on chmod, chown or setfacl.  Only
+ * successes are cached, capabilities and the LSM hooks are checked every
+ * time.
+ *
+ * A valid entry is not replaced by another identity, so directories shared
+ * by many users don't bounce the cache line on every walk.
+ */
+struct inode_exec_cache {
+	kuid_t			fsuid;
+	kgid_t			fsgid;
+	struct group_info	*groups;
+	struct posix_acl	*acl;
+	umode_t			mode;
+	kuid_t			uid;
+	kgid_t			gid;
+	struct rcu_head		rcu;
+};
+
+/* can be switched off in debugfs, to compare against uncached walks */
+static bool exec_cache_enabled __read_mostly = true;
+
+static DEFINE_PER_CPU(unsigned long, exec_cache_hits);
+static DEFINE_PER_CPU(unsigned long, exec_cache_misses);
+static DEFINE_PER_CPU(unsigned long, exec_cache_fills);
+
+static void exec_cache_destroy(struct inode_exec_cache *cache)
+{
+	put_group_info(cache->groups);
+	posix_acl_release(cache->acl);
+	kfree(cache);
+}
+
+static void inode_exec_cache_rcu(struct rcu_head *head)
+{
+	exec_cache_destroy(container_of(head, struct inode_exec_cache, rcu));
+}
+
+void inode_exec_cache_free(struct inode *inode)
+{
+	struct inode_exec_cache *cache;
+
+	cache = rcu_dereference_protected(inode->i_exec_cache, 1);
+	if (cache) {
+		RCU_INIT_POINTER(inode->i_exec_cache, NULL);
+		call_rcu(&cache->rcu, inode_exec_cache_rcu);
+	}
+}
+
+/* The ACL group_permission_check() looks at for @mode, or NULL */
+static struct posix_acl *exec_cache_acl(struct inode *inode, umode_t mode)
+{
+#ifdef CONFIG_FS_POSIX_ACL
+	if (IS_POSIXACL(inode) && (mode & S_IRWXG))
+		return READ_ONCE(inode->i_acl);
+#endif
+	return NULL;
+}
+
+static bool exec_cache_match(const struct inode_exec_cache *cache,
+			     struct inode *inode)
+{
+	umode_t mode = READ_ONCE(inode->i_mode);
+
+	return cache->mode == mode &&
+	       uid_eq(cache->uid, inode->i_uid) &&
+	       gid_eq(cache->gid, inode->i_gid) &&
+	       cache->acl == exec_cache_acl(inode, mode);
+}
+
+static bool exec_cache_cred_match(const struct inode_exec_cache *cache,
+				  const struct cred *cred)
+{
+	const struct group_info *a = cache->groups, *b = cred->group_info;
+
+	if (!uid_eq(cache->fsuid, cred->fsuid) ||
+	    !gid_eq(cache->fsgid, cred->fsgid))
+		return false;
+	/* prepare_exec_creds() shares the group_info, set_groups() sorts it */
+	return a == b || (a->ngroups == b->ngroups &&
+			  !memcmp(a->gid, b->gid, a->ngroups * sizeof(kgid_t)));
+}
+
+/*
+ * MAY_EXEC on a directory with an ACL, by a caller that isn't the owner.
+ * Without an ACL the mode bits are cheaper to check than the cache.
+ */
+static int exec_permission_cached(struct inode *inode, int mask)
+{
+	const struct cred *cred = current_cred();
+	struct inode_exec_cache *cache, snap, *old;
+	bool valid;
+	int ret;
+
+	if (!READ_ONCE(exec_cache_enabled))
+		return group_permission_check(inode, READ_ONCE(inode->i_mode),
+					      mask);
+
+	rcu_read_lock();
+	cache = rcu_dereference(inode->i_exec_cache);
+	valid = cache && exec_cache_match(cache, inode);
+	if (valid && exec_cache_cred_match(cache, cred)) {
+		rcu_read_unlock();
+		this_cpu_inc(exec_cache_hits);
+		return 0;
+	}
+	this_cpu_inc(exec_cache_misses);
+
+	/* somebody else's entry is still good, leave it and don't pin */
+	snap.acl = NULL;
+	snap.mode = READ_ONCE(inode->i_mode);
+	snap.uid = inode->i_uid;
+	snap.gid = inode->i_gid;
+	if (!valid) {
+		snap.acl = exec_cache_acl(inode, snap.mode);
+		if (!snap.acl || is_uncached_acl(snap.acl) ||
+		    !refcount_inc_not_zero(&snap.acl->a_refcount))
+			snap.acl = NULL;
+	}
+	rcu_read_unlock();
+
+	ret = group_permission_check(inode, snap.mode, mask);
+	if (!snap.acl)
+		return ret;
+
+	/* don't cache a result that raced with a change of the inode */
+	cache = NULL;
+	if (!ret && exec_cache_match(&snap, inode))
+		/* MAY_NOT_BLOCK callers are in RCU walk, don't sleep */
+		cache = kmalloc(sizeof(*cache), mask & MAY_NOT_BLOCK ?
+				GFP_NOWAIT | __GFP_NOWARN : GFP_KERNEL);
+	if (!cache) {
+		posix_acl_release(snap.acl);
+		return ret;
+	}
+
+	*cache = snap;
+	cache->fsuid = cred->fsuid;
+	cache->fsgid = cred->fsgid;
+	cache->groups = get_group_info(cred->group_info);
+
+	spin_lock(&inode->i_lock);
+	old = rcu_dereference_protected(inode->i_exec_cache,
+					lockdep_is_held(&inode->i_lock));
+	/*
+	 * An RCU walker can get here after __destroy_inode() freed the cache,
+	 * and a racing walker may have installed a valid entry already.
+	 */
+	if ((inode->i_state & (I_FREEING | I_WILL_FREE)) ||
+	    (old && exec_cache_match(old, inode))) {
+		spin_unlock(&inode->i_lock);
+		exec_cache_destroy(cache);
+		return 0;
+	}
+	rcu_assign_pointer(inode->i_exec_cache, cache);
+	spin_unlock(&inode->i_lock);
+	this_cpu_inc(exec_cache_fills);
+	if (old)
+		call_rcu(&old->rcu, inode_exec_cache_rcu);
+	return 0;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int exec_cache_stats_show(struct seq_file *m, void *v)
+{
+	unsigned long hits = 0, misses = 0, fills = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		hits += per_cpu(exec_cache_hits, cpu);
+		misses += per_cpu(exec_cache_misses, cpu);
+		fills += per_cpu(exec_cache_fills, cpu);
+	}
+	seq_printf(m, "hits: %lu\nmisses: %lu\nfills: %lu\n",
+		   hits, misses, fills);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(exec_cache_stats);
+
+static int __init exec_cache_debugfs_init(void)
+{
+	struct dentry *dir = debugfs_create_dir("namei", NULL);
+
+	debugfs_create_file("exec_cache_stats", 0400, dir, NULL,
+			    &exec_cache_stats_fops);
+	debugfs_create_bool("exec_cache", 0600, dir, &exec_cache_enabled);
+	return 0;
+}
+late_initcall(exec_cache_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
+
+/*
+ * This does the basic UNIX permission checking.
+ *
+ * Note that the POSIX ACL check cares about the MAY_NOT_BLOCK bit,
+ * for RCU walking.
+ */
+static int acl_permission_check(struct inode *inode, int mask)
+{
+	unsigned int mode = inode->i_mode;
+
+	/* Are we the owner? If so, ACL's don't matter */
+	if (likely(uid_eq(current_fsuid(), inode->i_uid))) {
+		mask &= 7;
+		mode >>= 6;
+		return (mask & ~mode) ? -EACCES : 0;
+	}
+
+	/* Searching a directory during path walk, try the cached result */
+	if ((mask & ~MAY_NOT_BLOCK) == MAY_EXEC && S_ISDIR(mode) &&
+	    exec_cache_acl(inode, mode))
+		return exec_permission_cached(inode, mask);
+
+	return group_permission_check(inode, mode, mask);
+}
+
 /**
  * generic_permission -  check for access rights on a Posix-like filesystem
  * @inode:	inode to check access rights for
@@ -556,6 +774,7 @@ struct nameidata {
 	struct nameidata *saved;
 	unsigned	root_seq;
 	int		dfd;
+	const struct path *dir;	/* pinned starting point instead of dfd */
 	kuid_t		dir_uid;
 	umode_t		dir_mode;
 } __randomize_layout;
@@ -568,6 +787,7 @@ static void set_nameidata(struct nameidata *p, int dfd, struct filename *name)
 	struct nameidata *old = current->nameidata;
 	p->stack = p->internal;
 	p->dfd = dfd;
+	p->dir = NULL;
 	p->name = name;
 	p->total_link_count = old ? old->total_link_count : 0;
 	p->saved = old;
@@ -675,6 +895,13 @@ static inline bool legitimize_path(struct nameidata *nd,
 static bool legitimize_links(struct nameidata *nd)
 {
 	int i;
+
+	/* leaving RCU mode may sleep, LOOKUP_CACHED callers retry instead */
+	if (unlikely(nd->flags & LOOKUP_CACHED)) {
+		drop_links(nd);
+		nd->depth = 0;
+		return false;
+	}
 	for (i = 0; i < nd->depth; i++) {
 		struct saved *last = nd->stack + i;
 		if (unlikely(!legitimize_path(nd, &last->link, last->seq))) {
@@ -837,6 +1064,7 @@ static int complete_walk(struct nameidata *nd)
 		 */
 		if (!(nd->flags & (LOOKUP_ROOT | LOOKUP_IS_SCOPED)))
 			nd->root.mnt = NULL;
+		nd->flags &= ~LOOKUP_CACHED;
 		if (unlikely(unlazy_walk(nd)))
 			return -ECHILD;
 	}
@@ -1479,6 +1707,10 @@ static struct dentry *__lookup_hash(const struct qstr *name,
 	if (dentry)
 		return dentry;
 
+	/* ->lookup() may have to go to disk */
+	if (flags & LOOKUP_CACHED)
+		return ERR_PTR(-EAGAIN);
+
 	/* Don't create child dentry for a dead directory. */
 	if (unlikely(IS_DEADDIR(dir)))
 		return ERR_PTR(-ENOENT);
@@ -2263,6 +2495,16 @@ static const char *path_init(struct nameidata *nd, unsigned flags)
 	nd->flags = flags | LOOKUP_JUMPED;
 	nd->depth = 0;
 
+	/*
+	 * LOOKUP_CACHED requires RCU, ask caller to retry.  Clear nd->path
+	 * first, so the terminate_walk() of our caller has nothing to drop.
+	 */
+	if (unlikely((flags & (LOOKUP_RCU | LOOKUP_CACHED)) == LOOKUP_CACHED)) {
+		nd->path.mnt = NULL;
+		nd->path.dentry = NULL;
+		return ERR_PTR(-EAGAIN);
+	}
+
 	nd->m_seq = __read_seqcount_begin(&mount_lock.seqcount);
 	nd->r_seq = __read_seqcount_begin(&rename_lock.seqcount);
 	smp_rmb();
@@ -2296,7 +2538,15 @@ static const char *path_init(struct nameidata *nd, unsigned flags)
 	}
 
 	/* Relative pathname -- get the starting-point it is relative to. */
-	if (nd->dfd == AT_FDCWD) {
+	if (nd->dir) {
+		/* The caller holds a reference and checked it is a directory */
+		nd->path = *nd->dir;
+		nd->inode = nd->path.dentry->d_inode;
+		if (flags & LOOKUP_RCU)
+			nd->seq = read_seqcount_begin(&nd->path.dentry->d_seq);
+		else
+			path_get(&nd->path);
+	} else if (nd->dfd == AT_FDCWD) {
 		if (flags & LOOKUP_RCU) {
 			struct fs_struct *fs = current->fs;
 			unsigned seq;
@@ -2409,8 +2659,8 @@ static int path_lookupat(struct nameidata *nd, unsigned flags, struct path *path
 /**
  *
  */
-int filename_lookup(int dfd, struct filename *name, unsigned flags,
-		    struct path *path, struct path *root)
+static int __filename_lookup(int dfd, struct filename *name, unsigned flags,
+			     struct path *path, struct path *root)
 {
 	int retval;
 	/**
@@ -2442,6 +2692,50 @@ int filename_lookup(int dfd, struct filename *name, unsigned flags,
 		audit_inode(name, path->dentry,
 			    flags & LOOKUP_MOUNTPOINT ? AUDIT_INODE_NOEVAL : 0);
 	restore_nameidata();
+	return retval;
+}
+
+int filename_lookup(int dfd, struct filename *name, unsigned flags,
+		    struct path *path, struct path *root)
+{
+	int retval = __filename_lookup(dfd, name, flags, path, root);
+
+	putname(name);
+	return retval;
+}
+
+/**
+ * filename_lookup_in - look up a name relative to a pinned directory
+ * @dir: starting directory, referenced by the caller
+ * @name: name to look up, consumed
+ * @flags: LOOKUP_* flags
+ * @path: result
+ *
+ * Like filename_lookup() with a dfd, but for callers resolving many names
+ * in the same directory: the directory is looked up and pinned once by the
+ * caller instead of going through the file table for every name.
+ */
+int filename_lookup_in(const struct path *dir, struct filename *name,
+		       unsigned flags, struct path *path)
+{
+	struct nameidata nd;
+	int retval;
+
+	if (IS_ERR(name))
+		return PTR_ERR(name);
+
+	set_nameidata(&nd, AT_FDCWD, name);
+	nd.dir = dir;
+
+	retval = path_lookupat(&nd, flags | LOOKUP_RCU, path);
+	if (unlikely(retval == -ECHILD))
+		retval = path_lookupat(&nd, flags, path);
+	if (unlikely(retval == -ESTALE))
+		retval = path_lookupat(&nd, flags | LOOKUP_REVAL, path);
+
+	if (likely(!retval))
+		audit_inode(name, path->dentry, 0);
+	restore_nameidata();
 	putname(name);
 	return retval;
 }
@@ -2463,15 +2757,15 @@ static int path_parentat(struct nameidata *nd, unsigned flags,
 	return err;
 }
 
-static struct filename *filename_parentat(int dfd, struct filename *name,
-				unsigned int flags, struct path *parent,
-				struct qstr *last, int *type)
+static int filename_parentat(int dfd, struct filename *name,
+			     unsigned int flags, struct path *parent,
+			     struct qstr *last, int *type)
 {
 	int retval;
 	struct nameidata nd;
 
 	if (IS_ERR(name))
-		return name;
+		return PTR_ERR(name);
 	set_nameidata(&nd, dfd, name);
 
 	/**
@@ -2486,30 +2780,28 @@ static struct filename *filename_parentat(int dfd, struct filename *name,
 		*last = nd.last;
 		*type = nd.last_type;
 		audit_inode(name, parent->dentry, AUDIT_INODE_PARENT);
-	} else {
-		putname(name);
-		name = ERR_PTR(retval);
 	}
 	restore_nameidata();
-	return name;
+	return retval;
 }
 
 /* does lookup, returns the object with parent locked */
 struct dentry *kern_path_locked(const char *name, struct path *path)
 {
-	struct filename *filename;
+	struct filename *filename = getname_kernel(name);
 	struct dentry *d;
 	struct qstr last;
-	int type;
+	int type, error;
 
-	filename = filename_parentat(AT_FDCWD, getname_kernel(name), 0, path,
-				    &last, &type);
-	if (IS_ERR(filename))
-		return ERR_CAST(filename);
+	error = filename_parentat(AT_FDCWD, filename, 0, path, &last, &type);
+	if (error) {
+		d = ERR_PTR(error);
+		goto out;
+	}
 	if (unlikely(type != LAST_NORM)) {
 		path_put(path);
-		putname(filename);
-		return ERR_PTR(-EINVAL);
+		d = ERR_PTR(-EINVAL);
+		goto out;
 	}
 	inode_lock_nested(path->dentry->d_inode, I_MUTEX_PARENT);
 	d = __lookup_hash(&last, path->dentry, 0);
@@ -2517,6 +2809,7 @@ struct dentry *kern_path_locked(const char *name, struct path *path)
 		inode_unlock(path->dentry->d_inode);
 		path_put(path);
 	}
+out:
 	putname(filename);
 	return d;
 }
@@ -3566,6 +3859,34 @@ struct file *do_file_open_root(struct dentry *dentry, struct vfsmount *mnt,
 	return file;
 }
 
+/*
+ * LOOKUP_CACHED callers must not sleep on a frozen superblock or on the
+ * parent's i_rwsem; -EAGAIN tells them to retry without the flag.
+ */
+static int mnt_want_write_flags(struct vfsmount *mnt, unsigned int lookup_flags)
+{
+	int ret;
+
+	if (!(lookup_flags & LOOKUP_CACHED))
+		return mnt_want_write(mnt);
+	if (!sb_start_write_trylock(mnt->mnt_sb))
+		return -EAGAIN;
+	ret = __mnt_want_write(mnt);
+	if (ret)
+		sb_end_write(mnt->mnt_sb);
+	return ret;
+}
+
+static int lock_parent_flags(struct inode *dir, unsigned int lookup_flags)
+{
+	if (!(lookup_flags & LOOKUP_CACHED)) {
+		inode_lock_nested(dir, I_MUTEX_PARENT);
+		return 0;
+	}
+	return inode_trylock(dir) ? 0 : -EAGAIN;
+}
+
+/* does not consume @name */
 static struct dentry *filename_create(int dfd, struct filename *name,
 				struct path *path, unsigned int lookup_flags)
 {
@@ -3577,17 +3898,17 @@ static struct dentry *filename_create(int dfd, struct filename *name,
 	bool is_dir = (lookup_flags & LOOKUP_DIRECTORY);
 
 	/*
-	 * Note that only LOOKUP_REVAL and LOOKUP_DIRECTORY matter here. Any
-	 * other flags passed in are ignored!
+	 * Note that only LOOKUP_REVAL, LOOKUP_CACHED and LOOKUP_DIRECTORY
+	 * matter here. Any other flags passed in are ignored!
 	 */
-	lookup_flags &= LOOKUP_REVAL;
+	lookup_flags &= LOOKUP_REVAL | LOOKUP_CACHED;
 
 	/**
 	 *
 	 */
-	name = filename_parentat(dfd, name, lookup_flags, path, &last, &type);
-	if (IS_ERR(name))
-		return ERR_CAST(name);
+	error = filename_parentat(dfd, name, lookup_flags, path, &last, &type);
+	if (error)
+		return ERR_PTR(error);
 
 	/*
 	 * Yucky last component or no last component at all?
@@ -3597,12 +3918,16 @@ static struct dentry *filename_create(int dfd, struct filename *name,
 		goto out;
 
 	/* don't fail immediately if it's r/o, at least try to report other errors */
-	err2 = mnt_want_write(path->mnt);
+	err2 = mnt_want_write_flags(path->mnt, lookup_flags);
 	/*
 	 * Do the final lookup.
 	 */
 	lookup_flags |= LOOKUP_CREATE | LOOKUP_EXCL;
-	inode_lock_nested(path->dentry->d_inode, I_MUTEX_PARENT);
+	error = lock_parent_flags(path->dentry->d_inode, lookup_flags);
+	if (error) {
+		dentry = ERR_PTR(error);
+		goto drop_write;
+	}
 	dentry = __lookup_hash(&last, path->dentry, lookup_flags);
 	if (IS_ERR(dentry))
 		goto unlock;
@@ -3625,26 +3950,28 @@ static struct dentry *filename_create(int dfd, struct filename *name,
 		error = err2;
 		goto fail;
 	}
-	putname(name);
 	return dentry;
 fail:
 	dput(dentry);
 	dentry = ERR_PTR(error);
 unlock:
 	inode_unlock(path->dentry->d_inode);
+drop_write:
 	if (!err2)
 		mnt_drop_write(path->mnt);
 out:
 	path_put(path);
-	putname(name);
 	return dentry;
 }
 
 struct dentry *kern_path_create(int dfd, const char *pathname,
 				struct path *path, unsigned int lookup_flags)
 {
-	return filename_create(dfd, getname_kernel(pathname),
-				path, lookup_flags);
+	struct filename *filename = getname_kernel(pathname);
+	struct dentry *res = filename_create(dfd, filename, path, lookup_flags);
+
+	putname(filename);
+	return res;
 }
 EXPORT_SYMBOL(kern_path_create);
 
@@ -3660,7 +3987,11 @@ EXPORT_SYMBOL(done_path_create);
 inline struct dentry *user_path_create(int dfd, const char __user *pathname,
 				struct path *path, unsigned int lookup_flags)
 {
-	return filename_create(dfd, getname(pathname), path, lookup_flags);
+	struct filename *filename = getname(pathname);
+	struct dentry *res = filename_create(dfd, filename, path, lookup_flags);
+
+	putname(filename);
+	return res;
 }
 EXPORT_SYMBOL(user_path_create);
 
@@ -3798,20 +4129,22 @@ EXPORT_SYMBOL(vfs_mkdir);
 /**
  * 创建目录
  */
-static long do_mkdirat(int dfd, const char __user *pathname, umode_t mode)
+long do_mkdirat(int dfd, struct filename *name, umode_t mode,
+		unsigned int lookup_flags)
 {
 	struct dentry *dentry;
 	struct path path;
 	int error;
-	unsigned int lookup_flags = LOOKUP_DIRECTORY;
 
+	lookup_flags |= LOOKUP_DIRECTORY;
 retry:
 	/**
 	 * 创建一个目录 dentry
 	 */
-	dentry = user_path_create(dfd, pathname, &path, lookup_flags);
+	dentry = filename_create(dfd, name, &path, lookup_flags);
+	error = PTR_ERR(dentry);
 	if (IS_ERR(dentry))
-		return PTR_ERR(dentry);
+		goto out_putname;
 
 	if (!IS_POSIXACL(path.dentry->d_inode))
 		mode &= ~current_umask();
@@ -3827,12 +4160,14 @@ retry:
 		lookup_flags |= LOOKUP_REVAL;
 		goto retry;
 	}
+out_putname:
+	putname(name);
 	return error;
 }
 
 SYSCALL_DEFINE3(mkdirat, int, dfd, const char __user *, pathname, umode_t, mode)
 {
-	return do_mkdirat(dfd, pathname, mode);
+	return do_mkdirat(dfd, getname(pathname), mode, 0);
 }
 
 /**
@@ -3840,7 +4175,7 @@ SYSCALL_DEFINE3(mkdirat, int, dfd, const char __user *, pathname, umode_t, mode)
  */
 SYSCALL_DEFINE2(mkdir, const char __user *, pathname, umode_t, mode)
 {
-	return do_mkdirat(AT_FDCWD, pathname, mode);
+	return do_mkdirat(AT_FDCWD, getname(pathname), mode, 0);
 }
 
 int vfs_rmdir(struct inode *dir, struct dentry *dentry)
@@ -3883,19 +4218,18 @@ out:
 }
 EXPORT_SYMBOL(vfs_rmdir);
 
-long do_rmdir(int dfd, struct filename *name)
+long do_rmdir(int dfd, struct filename *name, unsigned int lookup_flags)
 {
-	int error = 0;
+	int error;
 	struct dentry *dentry;
 	struct path path;
 	struct qstr last;
 	int type;
-	unsigned int lookup_flags = 0;
 retry:
-	name = filename_parentat(dfd, name, lookup_flags,
-				&path, &last, &type);
-	if (IS_ERR(name))
-		return PTR_ERR(name);
+	error = filename_parentat(dfd, name, lookup_flags,
+				  &path, &last, &type);
+	if (error)
+		goto exit0;
 
 	switch (type) {
 	case LAST_DOTDOT:
@@ -3909,27 +4243,30 @@ retry:
 		goto exit1;
 	}
 
-	error = mnt_want_write(path.mnt);
+	error = mnt_want_write_flags(path.mnt, lookup_flags);
 	if (error)
 		goto exit1;
 
-	inode_lock_nested(path.dentry->d_inode, I_MUTEX_PARENT);
+	error = lock_parent_flags(path.dentry->d_inode, lookup_flags);
+	if (error)
+		goto exit2;
 	dentry = __lookup_hash(&last, path.dentry, lookup_flags);
 	error = PTR_ERR(dentry);
 	if (IS_ERR(dentry))
-		goto exit2;
+		goto exit3;
 	if (!dentry->d_inode) {
 		error = -ENOENT;
-		goto exit3;
+		goto exit4;
 	}
 	error = security_path_rmdir(&path, dentry);
 	if (error)
-		goto exit3;
+		goto exit4;
 	error = vfs_rmdir(path.dentry->d_inode, dentry);
-exit3:
+exit4:
 	dput(dentry);
-exit2:
+exit3:
 	inode_unlock(path.dentry->d_inode);
+exit2:
 	mnt_drop_write(path.mnt);
 exit1:
 	path_put(&path);
@@ -3937,13 +4274,14 @@ exit1:
 		lookup_flags |= LOOKUP_REVAL;
 		goto retry;
 	}
+exit0:
 	putname(name);
 	return error;
 }
 
 SYSCALL_DEFINE1(rmdir, const char __user *, pathname)
 {
-	return do_rmdir(AT_FDCWD, getname(pathname));
+	return do_rmdir(AT_FDCWD, getname(pathname), 0);
 }
 
 /**
@@ -4011,7 +4349,7 @@ EXPORT_SYMBOL(vfs_unlink);
  * writeout happening, and we don't want to prevent access to the directory
  * while waiting on the I/O.
  */
-long do_unlinkat(int dfd, struct filename *name)
+long do_unlinkat(int dfd, struct filename *name, unsigned int lookup_flags)
 {
 	int error;
 	struct dentry *dentry;
@@ -4020,21 +4358,22 @@ long do_unlinkat(int dfd, struct filename *name)
 	int type;
 	struct inode *inode = NULL;
 	struct inode *delegated_inode = NULL;
-	unsigned int lookup_flags = 0;
 retry:
-	name = filename_parentat(dfd, name, lookup_flags, &path, &last, &type);
-	if (IS_ERR(name))
-		return PTR_ERR(name);
+	error = filename_parentat(dfd, name, lookup_flags, &path, &last, &type);
+	if (error)
+		goto exit0;
 
 	error = -EISDIR;
 	if (type != LAST_NORM)
 		goto exit1;
 
-	error = mnt_want_write(path.mnt);
+	error = mnt_want_write_flags(path.mnt, lookup_flags);
 	if (error)
 		goto exit1;
 retry_deleg:
-	inode_lock_nested(path.dentry->d_inode, I_MUTEX_PARENT);
+	error = lock_parent_flags(path.dentry->d_inode, lookup_flags);
+	if (error)
+		goto exit3;
 	dentry = __lookup_hash(&last, path.dentry, lookup_flags);
 	error = PTR_ERR(dentry);
 	if (!IS_ERR(dentry)) {
@@ -4044,6 +4383,13 @@ retry_deleg:
 		inode = dentry->d_inode;
 		if (d_is_negative(dentry))
 			goto slashes;
+		/* dropping the last link would truncate the file in iput() */
+		if ((lookup_flags & LOOKUP_CACHED) && inode->i_nlink <= 1 &&
+		    inode->i_size) {
+			inode = NULL;
+			error = -EAGAIN;
+			goto exit2;
+		}
 		ihold(inode);
 		error = security_path_unlink(&path, dentry);
 		if (error)
@@ -4057,10 +4403,16 @@ exit2:
 		iput(inode);	/* truncate the inode here */
 	inode = NULL;
 	if (delegated_inode) {
+		if (lookup_flags & LOOKUP_CACHED) {
+			iput(delegated_inode);
+			error = -EAGAIN;
+			goto exit3;
+		}
 		error = break_deleg_wait(&delegated_inode);
 		if (!error)
 			goto retry_deleg;
 	}
+exit3:
 	mnt_drop_write(path.mnt);
 exit1:
 	path_put(&path);
@@ -4069,6 +4421,7 @@ exit1:
 		inode = NULL;
 		goto retry;
 	}
+exit0:
 	putname(name);
 	return error;
 
@@ -4088,8 +4441,8 @@ SYSCALL_DEFINE3(unlinkat, int, dfd, const char __user *, pathname, int, flag)
 		return -EINVAL;
 
 	if (flag & AT_REMOVEDIR)
-		return do_rmdir(dfd, getname(pathname));
-	return do_unlinkat(dfd, getname(pathname));
+		return do_rmdir(dfd, getname(pathname), 0);
+	return do_unlinkat(dfd, getname(pathname), 0);
 }
 
 /**
@@ -4097,7 +4450,7 @@ SYSCALL_DEFINE3(unlinkat, int, dfd, const char __user *, pathname, int, flag)
  */
 SYSCALL_DEFINE1(unlink, const char __user *, pathname)
 {
-	return do_unlinkat(AT_FDCWD, getname(pathname));
+	return do_unlinkat(AT_FDCWD, getname(pathname), 0);
 }
 
 int vfs_symlink(struct inode *dir, struct dentry *dentry, const char *oldname)
@@ -4121,23 +4474,22 @@ int vfs_symlink(struct inode *dir, struct dentry *dentry, const char *oldname)
 }
 EXPORT_SYMBOL(vfs_symlink);
 
-static long do_symlinkat(const char __user *oldname, int newdfd,
-		  const char __user *newname)
+long do_symlinkat(struct filename *from, int newdfd, struct filename *to,
+		  unsigned int lookup_flags)
 {
 	int error;
-	struct filename *from;
 	struct dentry *dentry;
 	struct path path;
-	unsigned int lookup_flags = 0;
 
-	from = getname(oldname);
-	if (IS_ERR(from))
-		return PTR_ERR(from);
+	if (IS_ERR(from)) {
+		error = PTR_ERR(from);
+		goto out_putnames;
+	}
 retry:
-	dentry = user_path_create(newdfd, newname, &path, lookup_flags);
+	dentry = filename_create(newdfd, to, &path, lookup_flags);
 	error = PTR_ERR(dentry);
 	if (IS_ERR(dentry))
-		goto out_putname;
+		goto out_putnames;
 
 	error = security_path_symlink(&path, dentry, from->name);
 	if (!error)
@@ -4147,7 +4499,8 @@ retry:
 		lookup_flags |= LOOKUP_REVAL;
 		goto retry;
 	}
-out_putname:
+out_putnames:
+	putname(to);
 	putname(from);
 	return error;
 }
@@ -4155,12 +4508,12 @@ out_putname:
 SYSCALL_DEFINE3(symlinkat, const char __user *, oldname,
 		int, newdfd, const char __user *, newname)
 {
-	return do_symlinkat(oldname, newdfd, newname);
+	return do_symlinkat(getname(oldname), newdfd, getname(newname), 0);
 }
 
 SYSCALL_DEFINE2(symlink, const char __user *, oldname, const char __user *, newname)
 {
-	return do_symlinkat(oldname, AT_FDCWD, newname);
+	return do_symlinkat(getname(oldname), AT_FDCWD, getname(newname), 0);
 }
 
 /**
@@ -4252,40 +4605,42 @@ EXPORT_SYMBOL(vfs_link);
  * with linux 2.0, and to avoid hard-linking to directories
  * and other special files.  --ADM
  */
-static int do_linkat(int olddfd, const char __user *oldname, int newdfd,
-	      const char __user *newname, int flags)
+int do_linkat(int olddfd, struct filename *old, int newdfd,
+	      struct filename *new, int flags, unsigned int lookup_flags)
 {
 	struct dentry *new_dentry;
 	struct path old_path, new_path;
 	struct inode *delegated_inode = NULL;
-	int how = 0;
+	int how = lookup_flags;
 	int error;
 
+	error = -EINVAL;
 	if ((flags & ~(AT_SYMLINK_FOLLOW | AT_EMPTY_PATH)) != 0)
-		return -EINVAL;
+		goto out_putnames;
 	/*
 	 * To use null names we require CAP_DAC_READ_SEARCH
 	 * This ensures that not everyone will be able to create
 	 * handlink using the passed filedescriptor.
 	 */
 	if (flags & AT_EMPTY_PATH) {
+		error = -ENOENT;
 		if (!capable(CAP_DAC_READ_SEARCH))
-			return -ENOENT;
-		how = LOOKUP_EMPTY;
+			goto out_putnames;
+		how |= LOOKUP_EMPTY;
 	}
 
 	if (flags & AT_SYMLINK_FOLLOW)
 		how |= LOOKUP_FOLLOW;
 retry:
-	error = user_path_at(olddfd, oldname, how, &old_path);
+	error = __filename_lookup(olddfd, old, how, &old_path, NULL);
 	if (error)
-		return error;
+		goto out_putnames;
 
-	new_dentry = user_path_create(newdfd, newname, &new_path,
-					(how & LOOKUP_REVAL));
+	new_dentry = filename_create(newdfd, new, &new_path,
+					(how & (LOOKUP_REVAL | LOOKUP_CACHED)));
 	error = PTR_ERR(new_dentry);
 	if (IS_ERR(new_dentry))
-		goto out;
+		goto out_putpath;
 
 	error = -EXDEV;
 	if (old_path.mnt != new_path.mnt)
@@ -4300,6 +4655,11 @@ retry:
 out_dput:
 	done_path_create(&new_path, new_dentry);
 	if (delegated_inode) {
+		if (how & LOOKUP_CACHED) {
+			iput(delegated_inode);
+			error = -EAGAIN;
+			goto out_putpath;
+		}
 		error = break_deleg_wait(&delegated_inode);
 		if (!error) {
 			path_put(&old_path);
@@ -4311,21 +4671,27 @@ out_dput:
 		how |= LOOKUP_REVAL;
 		goto retry;
 	}
-out:
+out_putpath:
 	path_put(&old_path);
-
+out_putnames:
+	putname(old);
+	putname(new);
 	return error;
 }
 
 SYSCALL_DEFINE5(linkat, int, olddfd, const char __user *, oldname,
 		int, newdfd, const char __user *, newname, int, flags)
 {
-	return do_linkat(olddfd, oldname, newdfd, newname, flags);
+	int how = (flags & AT_EMPTY_PATH) ? LOOKUP_EMPTY : 0;
+
+	return do_linkat(olddfd, getname_flags(oldname, how, NULL),
+			 newdfd, getname(newname), flags, 0);
 }
 
 SYSCALL_DEFINE2(link, const char __user *, oldname, const char __user *, newname)
 {
-	return do_linkat(AT_FDCWD, oldname, AT_FDCWD, newname, 0);
+	return do_linkat(AT_FDCWD, getname(oldname), AT_FDCWD,
+			 getname(newname), 0, 0);
 }
 
 /**
@@ -4503,8 +4869,9 @@ out:
 }
 EXPORT_SYMBOL(vfs_rename);
 
-static int do_renameat2(int olddfd, const char __user *oldname, int newdfd,
-			const char __user *newname, unsigned int flags)
+int do_renameat2(int olddfd, struct filename *from, int newdfd,
+		 struct filename *to, unsigned int flags,
+		 unsigned int lookup_flags)
 {
 	struct dentry *old_dentry, *new_dentry;
 	struct dentry *trap;
@@ -4512,36 +4879,30 @@ static int do_renameat2(int olddfd, const char __user *oldname, int newdfd,
 	struct qstr old_last, new_last;
 	int old_type, new_type;
 	struct inode *delegated_inode = NULL;
-	struct filename *from;
-	struct filename *to;
-	unsigned int lookup_flags = 0, target_flags = LOOKUP_RENAME_TARGET;
+	unsigned int target_flags = LOOKUP_RENAME_TARGET;
 	bool should_retry = false;
-	int error;
+	int error = -EINVAL;
 
 	if (flags & ~(RENAME_NOREPLACE | RENAME_EXCHANGE | RENAME_WHITEOUT))
-		return -EINVAL;
+		goto put_names;
 
 	if ((flags & (RENAME_NOREPLACE | RENAME_WHITEOUT)) &&
 	    (flags & RENAME_EXCHANGE))
-		return -EINVAL;
+		goto put_names;
 
 	if (flags & RENAME_EXCHANGE)
 		target_flags = 0;
 
 retry:
-	from = filename_parentat(olddfd, getname(oldname), lookup_flags,
-				&old_path, &old_last, &old_type);
-	if (IS_ERR(from)) {
-		error = PTR_ERR(from);
-		goto exit;
-	}
+	error = filename_parentat(olddfd, from, lookup_flags,
+				  &old_path, &old_last, &old_type);
+	if (error)
+		goto put_names;
 
-	to = filename_parentat(newdfd, getname(newname), lookup_flags,
-				&new_path, &new_last, &new_type);
-	if (IS_ERR(to)) {
-		error = PTR_ERR(to);
+	error = filename_parentat(newdfd, to, lookup_flags,
+				  &new_path, &new_last, &new_type);
+	if (error)
 		goto exit1;
-	}
 
 	error = -EXDEV;
 	if (old_path.mnt != new_path.mnt)
@@ -4556,12 +4917,24 @@ retry:
 	if (new_type != LAST_NORM)
 		goto exit2;
 
-	error = mnt_want_write(old_path.mnt);
+	error = mnt_want_write_flags(old_path.mnt, lookup_flags);
 	if (error)
 		goto exit2;
 
 retry_deleg:
-	trap = lock_rename(new_path.dentry, old_path.dentry);
+	if (lookup_flags & LOOKUP_CACHED) {
+		/* lock_rename() across directories takes s_vfs_rename_mutex */
+		error = -EAGAIN;
+		if (old_path.dentry != new_path.dentry)
+			goto exit_write;
+		error = lock_parent_flags(new_path.dentry->d_inode,
+					  lookup_flags);
+		if (error)
+			goto exit_write;
+		trap = NULL;
+	} else {
+		trap = lock_rename(new_path.dentry, old_path.dentry);
+	}
 
 	old_dentry = __lookup_hash(&old_last, old_path.dentry, lookup_flags);
 	error = PTR_ERR(old_dentry);
@@ -4621,43 +4994,52 @@ exit4:
 exit3:
 	unlock_rename(new_path.dentry, old_path.dentry);
 	if (delegated_inode) {
+		if (lookup_flags & LOOKUP_CACHED) {
+			iput(delegated_inode);
+			error = -EAGAIN;
+			goto exit_write;
+		}
 		error = break_deleg_wait(&delegated_inode);
 		if (!error)
 			goto retry_deleg;
 	}
+exit_write:
 	mnt_drop_write(old_path.mnt);
 exit2:
 	if (retry_estale(error, lookup_flags))
 		should_retry = true;
 	path_put(&new_path);
-	putname(to);
 exit1:
 	path_put(&old_path);
-	putname(from);
 	if (should_retry) {
 		should_retry = false;
 		lookup_flags |= LOOKUP_REVAL;
 		goto retry;
 	}
-exit:
+put_names:
+	putname(from);
+	putname(to);
 	return error;
 }
 
 SYSCALL_DEFINE5(renameat2, int, olddfd, const char __user *, oldname,
 		int, newdfd, const char __user *, newname, unsigned int, flags)
 {
-	return do_renameat2(olddfd, oldname, newdfd, newname, flags);
+	return do_renameat2(olddfd, getname(oldname), newdfd, getname(newname),
+			    flags, 0);
 }
 
 SYSCALL_DEFINE4(renameat, int, olddfd, const char __user *, oldname,
 		int, newdfd, const char __user *, newname)
 {
-	return do_renameat2(olddfd, oldname, newdfd, newname, 0);
+	return do_renameat2(olddfd, getname(oldname), newdfd, getname(newname),
+			    0, 0);
 }
 
 SYSCALL_DEFINE2(rename, const char __user *, oldname, const char __user *, newname)
 {
-	return do_renameat2(AT_FDCWD, oldname, AT_FDCWD, newname, 0);
+	return do_renameat2(AT_FDCWD, getname(oldname), AT_FDCWD,
+			    getname(newname), 0, 0);
 }
 
 int readlink_copy(char __user *buffer, int buflen, const char *link)
@@ -22,6 +22,9 @@
 
 #define OVL_COPY_UP_CHUNK_SIZE (1 << 20)
 
+/* Metacopy data copy-up is checkpointed after each piece of this size */
+#define OVL_DATACOPY_CHUNK_SIZE (64 << 20)
+
 static int ovl_ccup_set(const char *buf, const struct kernel_param *param)
 {
 	pr_warn("\"check_copy_up\" module option is obsolete\n");
@@ -130,12 +133,12 @@ out:
 }
 
 static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
-			    struct path *new, loff_t len)
+			    struct path *new, loff_t pos, loff_t len)
 {
 	struct file *old_file;
 	struct file *new_file;
-	loff_t old_pos = 0;
-	loff_t new_pos = 0;
+	loff_t old_pos = pos;
+	loff_t new_pos = pos;
 	loff_t cloned;
 	loff_t data_pos = -1;
 	loff_t hole_len;
@@ -156,7 +159,7 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 	}
 
 	/* Try to use clone_file_range to clone up within the same fs */
-	cloned = do_clone_file_range(old_file, 0, new_file, 0, len, 0);
+	cloned = do_clone_file_range(old_file, pos, new_file, pos, len, 0);
 	if (cloned == len)
 		goto out;
 	/* Couldn't clone, so now we try to copy the data */
@@ -198,6 +201,9 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 			data_pos = vfs_llseek(old_file, old_pos, SEEK_DATA);
 			if (data_pos > old_pos) {
 				hole_len = data_pos - old_pos;
+				/* the rest of a partial copy-up range is a hole */
+				if (hole_len >= len)
+					break;
 				len -= hole_len;
 				old_pos = new_pos = data_pos;
 				continue;
@@ -444,6 +450,8 @@ struct ovl_copy_up_ctx {
 	bool origin;
 	bool indexed;
 	bool metacopy;
+	/* bytes of metacopy data to copy up in this call */
+	loff_t batch;
 };
 
 static int ovl_link_up(struct ovl_copy_up_ctx *c)
@@ -503,7 +511,7 @@ static int ovl_copy_up_inode(struct ovl_copy_up_ctx *c, struct dentry *temp)
 		upperpath.dentry = temp;
 
 		ovl_path_lowerdata(c->dentry, &datapath);
-		err = ovl_copy_up_data(ofs, &datapath, &upperpath,
+		err = ovl_copy_up_data(ofs, &datapath, &upperpath, 0,
 				       c->stat.size);
 		if (err)
 			return err;
@@ -809,7 +817,28 @@ static ssize_t ovl_getxattr(struct dentry *dentry, char *name, char **value)
 	return res;
 }
 
-/* Copy up data of an inode which was copied up metadata only in the past. */
+static loff_t ovl_get_datacopy(struct ovl_fs *ofs, struct dentry *upper)
+{
+	__le64 copied;
+	ssize_t res;
+
+	res = ovl_do_getxattr(ofs, upper, OVL_XATTR_DATACOPY, &copied,
+			      sizeof(copied));
+	if (res != sizeof(copied))
+		return 0;
+
+	return le64_to_cpu(copied);
+}
+
+/*
+ * Copy up data of an inode which was copied up metadata only in the past.
+ *
+ * Large files are copied in OVL_DATACOPY_CHUNK_SIZE pieces, and the offset
+ * reached is stored in the "datacopy" xattr after each piece.  An
+ * interrupted copy-up resumes from there, and the lazy copy-up worker uses
+ * it to copy c->batch bytes per call.  Returns 0 with the data still
+ * partially copied once the batch is used up.
+ */
 static int ovl_copy_up_meta_inode_data(struct ovl_copy_up_ctx *c)
 {
 	struct ovl_fs *ofs = OVL_FS(c->dentry->d_sb);
@@ -817,6 +846,7 @@ static int ovl_copy_up_meta_inode_data(struct ovl_copy_up_ctx *c)
 	int err;
 	char *capability = NULL;
 	ssize_t cap_size;
+	loff_t pos, end, batch = c->batch;
 
 	ovl_path_upper(c->dentry, &upperpath);
 	if (WARN_ON(upperpath.dentry == NULL))
@@ -833,35 +863,61 @@ static int ovl_copy_up_meta_inode_data(struct ovl_copy_up_ctx *c)
 			goto out;
 	}
 
-	err = ovl_copy_up_data(ofs, &datapath, &upperpath, c->stat.size);
-	if (err)
-		goto out_free;
+	pos = min(ovl_get_datacopy(ofs, upperpath.dentry), c->stat.size);
+	err = 0;
+	while (pos < c->stat.size && batch > 0) {
+		__le64 copied;
+
+		end = pos + min_t(loff_t, batch, OVL_DATACOPY_CHUNK_SIZE);
+		end = min(end, c->stat.size);
+		err = ovl_copy_up_data(ofs, &datapath, &upperpath, pos,
+				       end - pos);
+		if (err)
+			break;
+		batch -= end - pos;
+		pos = end;
+		if (pos == c->stat.size)
+			break;
+
+		/* ovl_copy_up_data() synced the data this covers */
+		copied = cpu_to_le64(pos);
+		err = ovl_do_setxattr(ofs, upperpath.dentry,
+				      OVL_XATTR_DATACOPY, &copied,
+				      sizeof(copied));
+		if (err)
+			break;
+	}
 
 	/*
 	 * Writing to upper file will clear security.capability xattr. We
 	 * don't want that to happen for normal copy-up operation.
 	 */
 	if (capability) {
-		err = vfs_setxattr(upperpath.dentry, XATTR_NAME_CAPS,
-				   capability, cap_size, 0);
-		if (err)
-			goto out_free;
+		int cap_err = vfs_setxattr(upperpath.dentry, XATTR_NAME_CAPS,
+					   capability, cap_size, 0);
+		if (!err)
+			err = cap_err;
 	}
-
+	if (err || pos < c->stat.size)
+		goto out_free;
 
 	err = ovl_do_removexattr(ofs, upperpath.dentry, OVL_XATTR_METACOPY);
 	if (err)
 		goto out_free;
 
 	ovl_set_upperdata(d_inode(c->dentry));
+	/* stale progress is harmless without metacopy, just tidy up */
+	ovl_do_removexattr(ofs, upperpath.dentry, OVL_XATTR_DATACOPY);
 out_free:
 	kfree(capability);
 out:
 	return err;
 }
 
+static void ovl_queue_lazy_copy_up(struct dentry *dentry);
+
 static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
-			   int flags)
+			   int flags, loff_t batch)
 {
 	int err;
 	DEFINE_DELAYED_CALL(done);
@@ -870,7 +926,9 @@ static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 		.parent = parent,
 		.dentry = dentry,
 		.workdir = ovl_workdir(dentry),
+		.batch = batch,
 	};
+	bool lazy = false;
 
 	if (WARN_ON(!ctx.workdir))
 		return -EROFS;
@@ -911,8 +969,10 @@ static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 		if (err > 0)
 			err = 0;
 	} else {
-		if (!ovl_dentry_upper(dentry))
+		if (!ovl_dentry_upper(dentry)) {
 			err = ovl_do_copy_up(&ctx);
+			lazy = !err && ctx.metacopy && ctx.stat.size;
+		}
 		if (!err && parent && !ovl_dentry_has_upper_alias(dentry))
 			err = ovl_link_up(&ctx);
 		if (!err && ovl_dentry_needs_data_copy_up_locked(dentry, flags))
@@ -921,9 +981,72 @@ static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 	}
 	do_delayed_call(&done);
 
+	if (lazy && !err)
+		ovl_queue_lazy_copy_up(dentry);
+
 	return err;
 }
 
+struct ovl_lazy_copy_up {
+	struct work_struct work;
+	struct dentry *dentry;
+};
+
+/*
+ * metacopy=lazy: fill in the data of a metacopy file in the background, one
+ * OVL_DATACOPY_CHUNK_SIZE piece per copy-up lock hold.  An open for write
+ * meanwhile takes the lock between two pieces and copies the rest itself.
+ */
+static void ovl_lazy_copy_up_work(struct work_struct *work)
+{
+	struct ovl_lazy_copy_up *lc = container_of(work, struct ovl_lazy_copy_up,
+						   work);
+	struct dentry *dentry = lc->dentry;
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+	const struct cred *old_cred;
+	int err = 0;
+
+	old_cred = ovl_override_creds(dentry->d_sb);
+	while (!err && !READ_ONCE(ofs->copy_up_stop) && !d_unhashed(dentry) &&
+	       !ovl_already_copied_up(dentry, O_WRONLY)) {
+		struct dentry *parent = dget_parent(dentry);
+
+		err = ovl_want_write(dentry);
+		if (!err) {
+			err = ovl_copy_up_one(parent, dentry, O_WRONLY,
+					      OVL_DATACOPY_CHUNK_SIZE);
+			ovl_drop_write(dentry);
+		}
+		dput(parent);
+		cond_resched();
+	}
+	revert_creds(old_cred);
+
+	if (err)
+		pr_warn_ratelimited("lazy data copy-up of %pd2 failed (%i)\n",
+				    dentry, err);
+	dput(dentry);
+	kfree(lc);
+}
+
+static void ovl_queue_lazy_copy_up(struct dentry *dentry)
+{
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+	struct ovl_lazy_copy_up *lc;
+
+	if (!ofs->config.metacopy || !ofs->copy_up_wq)
+		return;
+
+	/* best effort, the data is copied up on open for write anyway */
+	lc = kmalloc(sizeof(*lc), GFP_KERNEL);
+	if (!lc)
+		return;
+
+	INIT_WORK(&lc->work, ovl_lazy_copy_up_work);
+	lc->dentry = dget(dentry);
+	queue_work(ofs->copy_up_wq, &lc->work);
+}
+
 static int ovl_copy_up_flags(struct dentry *dentry, int flags)
 {
 	int err = 0;
@@ -957,7 +1080,7 @@ static int ovl_copy_up_flags(struct dentry *dentry, int flags)
 			next = parent;
 		}
 
-		err = ovl_copy_up_one(parent, next, flags);
+		err = ovl_copy_up_one(parent, next, flags, LLONG_MAX);
 
 		dput(parent);
 		dput(next);
@@ -32,6 +32,7 @@ enum ovl_xattr {
 	OVL_XATTR_NLINK,
 	OVL_XATTR_UPPER,
 	OVL_XATTR_METACOPY,
+	OVL_XATTR_DATACOPY,
 };
 
 enum ovl_inode_flag {
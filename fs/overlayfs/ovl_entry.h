@@ -17,6 +17,8 @@ struct ovl_config {
 	bool nfs_export;
 	int xino;
 	bool metacopy;
+	/* metacopy=lazy: copy data up in the background after metacopy */
+	bool metacopy_lazy;
 	bool ovl_volatile;
 };
 
@@ -79,6 +81,9 @@ struct ovl_fs {
 	atomic_long_t last_ino;
 	/* Whiteout dentry cache */
 	struct dentry *whiteout;
+	/* Background data copy-up for metacopy=lazy */
+	struct workqueue_struct *copy_up_wq;
+	bool copy_up_stop;
 };
 
 static inline struct vfsmount *ovl_upper_mnt(struct ovl_fs *ofs)
@@ -242,6 +242,8 @@ static void ovl_free_fs(struct ovl_fs *ofs)
 	kfree(ofs->config.upperdir);
 	kfree(ofs->config.workdir);
 	kfree(ofs->config.redirect_mode);
+	if (ofs->copy_up_wq)
+		destroy_workqueue(ofs->copy_up_wq);
 	if (ofs->creator_cred)
 		put_cred(ofs->creator_cred);
 	kfree(ofs);
@@ -361,7 +363,9 @@ static int ovl_show_options(struct seq_file *m, struct dentry *dentry)
 						"on" : "off");
 	if (ofs->config.xino != ovl_xino_def() && !ovl_same_fs(sb))
 		seq_printf(m, ",xino=%s", ovl_xino_str[ofs->config.xino]);
-	if (ofs->config.metacopy != ovl_metacopy_def)
+	if (ofs->config.metacopy && ofs->config.metacopy_lazy)
+		seq_puts(m, ",metacopy=lazy");
+	else if (ofs->config.metacopy != ovl_metacopy_def)
 		seq_printf(m, ",metacopy=%s",
 			   ofs->config.metacopy ? "on" : "off");
 	if (ofs->config.ovl_volatile)
@@ -417,6 +421,7 @@ enum {
 	OPT_XINO_AUTO,
 	OPT_METACOPY_ON,
 	OPT_METACOPY_OFF,
+	OPT_METACOPY_LAZY,
 	OPT_VOLATILE,
 	OPT_ERR,
 };
@@ -436,6 +441,7 @@ static const match_table_t ovl_tokens = {
 	{OPT_XINO_AUTO,			"xino=auto"},
 	{OPT_METACOPY_ON,		"metacopy=on"},
 	{OPT_METACOPY_OFF,		"metacopy=off"},
+	{OPT_METACOPY_LAZY,		"metacopy=lazy"},
 	{OPT_VOLATILE,			"volatile"},
 	{OPT_ERR,			NULL}
 };
@@ -578,6 +584,13 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 
 		case OPT_METACOPY_OFF:
 			config->metacopy = false;
+			config->metacopy_lazy = false;
+			metacopy_opt = true;
+			break;
+
+		case OPT_METACOPY_LAZY:
+			config->metacopy = true;
+			config->metacopy_lazy = true;
 			metacopy_opt = true;
 			break;
 
@@ -1987,6 +2000,13 @@ static int ovl_fill_super(struct super_block *sb, void *data, int silent)
 	if (ofs->config.nfs_export)
 		sb->s_export_op = &ovl_export_operations;
 
+	if (ofs->config.metacopy && ofs->config.metacopy_lazy) {
+		err = -ENOMEM;
+		ofs->copy_up_wq = alloc_workqueue("ovl-copy-up", WQ_UNBOUND, 0);
+		if (!ofs->copy_up_wq)
+			goto out_err;
+	}
+
 	/* Never override disk quota limits or use reserved space */
 	cap_lower(cred->cap_effective, CAP_SYS_RESOURCE);
 
@@ -2025,11 +2045,26 @@ static struct dentry *ovl_mount(struct file_system_type *fs_type, int flags,
 	return mount_nodev(fs_type, flags, raw_data, ovl_fill_super);
 }
 
+static void ovl_kill_sb(struct super_block *sb)
+{
+	struct ovl_fs *ofs = sb->s_fs_info;
+
+	/*
+	 * Lazy data copy-ups hold dentries, finish them before the shrink.
+	 * No s_root means fill_super failed and ofs is gone already.
+	 */
+	if (sb->s_root && ofs->copy_up_wq) {
+		WRITE_ONCE(ofs->copy_up_stop, true);
+		drain_workqueue(ofs->copy_up_wq);
+	}
+	kill_anon_super(sb);
+}
+
 static struct file_system_type ovl_fs_type = {
 	.owner		= THIS_MODULE,
 	.name		= "overlay",
 	.mount		= ovl_mount,
-	.kill_sb	= kill_anon_super,
+	.kill_sb	= ovl_kill_sb,
 };
 MODULE_ALIAS_FS("overlay");
 
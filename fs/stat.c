@@ -17,6 +17,7 @@
 #include <linux/syscalls.h>
 #include <linux/pagemap.h>
 #include <linux/compat.h>
+#include <linux/fs_struct.h>
 
 #include <linux/uaccess.h>
 #include <asm/unistd.h>
@@ -181,24 +182,48 @@ int vfs_fstat(int fd, struct kstat *stat)
  *
  * 获取文件属性
  */
+static unsigned int statx_lookup_flags(int flags)
+{
+	unsigned int lookup_flags = 0;
+
+	if (!(flags & AT_SYMLINK_NOFOLLOW))
+		lookup_flags |= LOOKUP_FOLLOW;
+	if (!(flags & AT_NO_AUTOMOUNT))
+		lookup_flags |= LOOKUP_AUTOMOUNT;
+	if (flags & AT_EMPTY_PATH)
+		lookup_flags |= LOOKUP_EMPTY;
+
+	return lookup_flags;
+}
+
+/*
+ * vfs_getattr() plus the mount information statx() reports, on a path that
+ * was already looked up.
+ */
+static int vfs_statx_path(struct path *path, int flags, struct kstat *stat,
+			  u32 request_mask)
+{
+	int error = vfs_getattr(path, stat, request_mask, flags);
+
+	stat->mnt_id = real_mount(path->mnt)->mnt_id;
+	stat->result_mask |= STATX_MNT_ID;
+	if (path->mnt->mnt_root == path->dentry)
+		stat->attributes |= STATX_ATTR_MOUNT_ROOT;
+	stat->attributes_mask |= STATX_ATTR_MOUNT_ROOT;
+	return error;
+}
+
 static int vfs_statx(int dfd, const char __user *filename, int flags,
 	      struct kstat *stat, u32 request_mask)
 {
 	struct path _path;
-	unsigned lookup_flags = 0;
+	unsigned lookup_flags = statx_lookup_flags(flags);
 	int error;
 
 	if (flags & ~(AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | AT_EMPTY_PATH |
 		      AT_STATX_SYNC_TYPE))
 		return -EINVAL;
 
-	if (!(flags & AT_SYMLINK_NOFOLLOW))
-		lookup_flags |= LOOKUP_FOLLOW;
-	if (!(flags & AT_NO_AUTOMOUNT))
-		lookup_flags |= LOOKUP_AUTOMOUNT;
-	if (flags & AT_EMPTY_PATH)
-		lookup_flags |= LOOKUP_EMPTY;
-
 retry:
 	/**
 	 *  找到这个文件
@@ -210,12 +235,7 @@ retry:
 	/**
 	 *  获取属性信息
 	 */
-	error = vfs_getattr(&_path, stat, request_mask, flags);
-	stat->mnt_id = real_mount(_path.mnt)->mnt_id;
-	stat->result_mask |= STATX_MNT_ID;
-	if (_path.mnt->mnt_root == _path.dentry)
-		stat->attributes |= STATX_ATTR_MOUNT_ROOT;
-	stat->attributes_mask |= STATX_ATTR_MOUNT_ROOT;
+	error = vfs_statx_path(&_path, flags, stat, request_mask);
 	path_put(&_path);
 	if (retry_estale(error, lookup_flags)) {
 		lookup_flags |= LOOKUP_REVAL;
@@ -633,6 +653,119 @@ SYSCALL_DEFINE5(statx,
 	return do_statx(dfd, filename, flags, mask, buffer);
 }
 
+/* Pin the directory every name of a statx_batch() call is relative to */
+static int statx_batch_get_dir(int dfd, struct path *dir)
+{
+	if (dfd == AT_FDCWD) {
+		get_fs_pwd(current->fs, dir);
+	} else {
+		struct fd f = fdget_raw(dfd);
+
+		if (!f.file)
+			return -EBADF;
+		*dir = f.file->f_path;
+		path_get(dir);
+		fdput(f);
+	}
+
+	if (unlikely(!d_can_lookup(dir->dentry))) {
+		path_put(dir);
+		return -ENOTDIR;
+	}
+	return 0;
+}
+
+static int statx_batch_one(const struct path *dir,
+			   const struct statx_batch_entry *ent,
+			   unsigned int flags, unsigned int mask)
+{
+	const char __user *filename = u64_to_user_ptr(ent->name);
+	unsigned int lookup_flags = statx_lookup_flags(flags);
+	struct kstat stat;
+	struct path path;
+	int error;
+
+	if (ent->__reserved)
+		return -EINVAL;
+
+retry:
+	error = filename_lookup_in(dir, getname(filename), lookup_flags, &path);
+	if (error)
+		return error;
+
+	error = vfs_statx_path(&path, flags, &stat, mask);
+	path_put(&path);
+	if (retry_estale(error, lookup_flags)) {
+		lookup_flags |= LOOKUP_REVAL;
+		goto retry;
+	}
+	if (error)
+		return error;
+
+	return cp_statx(&stat, u64_to_user_ptr(ent->buffer));
+}
+
+/**
+ * sys_statx_batch - statx() many names relative to one directory
+ * @dfd: Base directory of every name, or AT_FDCWD.
+ * @entries: Array of names, result buffers and per-name results.
+ * @nr: Number of entries.
+ * @flags: AT_* flags applied to every name.
+ * @mask: Parts of statx struct actually required.
+ *
+ * The base directory is resolved and pinned once, then each name is walked
+ * from it.  A name that fails does not stop the batch; its -errno goes to
+ * the entry's result field.  Returns the number of entries processed, which
+ * is less than @nr only if a fatal signal or a fault on @entries cut the
+ * batch short, or -errno if no entry was processed.
+ */
+SYSCALL_DEFINE5(statx_batch,
+		int, dfd, struct statx_batch_entry __user *, entries,
+		unsigned int, nr, unsigned int, flags,
+		unsigned int, mask)
+{
+	struct path dir;
+	unsigned int done;
+	int error;
+
+	if (flags & ~(AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT |
+		      AT_STATX_SYNC_TYPE))
+		return -EINVAL;
+	if ((flags & AT_STATX_SYNC_TYPE) == AT_STATX_SYNC_TYPE)
+		return -EINVAL;
+	if (mask & STATX__RESERVED)
+		return -EINVAL;
+	if (nr > INT_MAX)
+		return -EINVAL;
+
+	error = statx_batch_get_dir(dfd, &dir);
+	if (error)
+		return error;
+
+	for (done = 0; done < nr; done++) {
+		struct statx_batch_entry ent;
+		int res;
+
+		if (copy_from_user(&ent, &entries[done], sizeof(ent))) {
+			error = -EFAULT;
+			break;
+		}
+		res = statx_batch_one(&dir, &ent, flags, mask);
+		if (put_user(res, &entries[done].result)) {
+			error = -EFAULT;
+			break;
+		}
+		if (fatal_signal_pending(current)) {
+			done++;
+			break;
+		}
+		cond_resched();
+	}
+
+	path_put(&dir);
+	return done ? done : error;
+}
+
 #ifdef CONFIG_COMPAT
 static int cp_compat_stat(struct kstat *stat, struct compat_stat __user *ubuf)
 {
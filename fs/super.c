@@ -194,6 +194,7 @@ static void destroy_unused_super(struct super_block *s)
 	up_write(&s->s_umount);
 	list_lru_destroy(&s->s_dentry_lru);
 	list_lru_destroy(&s->s_inode_lru);
+	percpu_counter_destroy(&s->s_nr_dentry_negative);
 	security_sb_free(s);
 	put_user_ns(s->s_user_ns);
 	kfree(s->s_subtype);
@@ -202,6 +203,26 @@ static void destroy_unused_super(struct super_block *s)
 	destroy_super_work(&s->destroy_work);
 }
 
+static void put_super(struct super_block *sb);
+
+/*
+ * Reclaim the oldest negative dentries of a superblock that went over
+ * fs.negative-dentry-limit.  Like the shrinker, back off if the superblock
+ * is being set up or torn down.
+ */
+static void super_negative_dentry_prune(struct work_struct *work)
+{
+	struct super_block *sb = container_of(work, struct super_block,
+					      s_negative_prune_work);
+
+	if (trylock_super(sb)) {
+		prune_negative_dentries(sb);
+		up_read(&sb->s_umount);
+	}
+	/* drop the passive reference taken when the work was queued */
+	put_super(sb);
+}
+
 /**
  *	alloc_super	-	create new superblock
  *	@type:	filesystem type superblock should belong to
@@ -287,6 +308,9 @@ static struct super_block *alloc_super(struct file_system_type *type, int flags,
 		goto fail;
 	if (list_lru_init_memcg(&s->s_inode_lru, &s->s_shrink))
 		goto fail;
+	if (percpu_counter_init(&s->s_nr_dentry_negative, 0, GFP_KERNEL))
+		goto fail;
+	INIT_WORK(&s->s_negative_prune_work, super_negative_dentry_prune);
 	return s;
 
 fail:
@@ -329,6 +353,24 @@ static void put_super(struct super_block *sb)
 }
 
 
+/*
+ * Called from d_lru_add() with d_lock held once the superblock keeps more
+ * negative dentries than allowed.  The passive reference keeps the
+ * superblock around until the work has run, even across umount.
+ */
+void sb_queue_negative_dentry_prune(struct super_block *sb)
+{
+	if (work_pending(&sb->s_negative_prune_work))
+		return;
+
+	spin_lock(&sb_lock);
+	sb->s_count++;
+	spin_unlock(&sb_lock);
+
+	if (!queue_work(system_unbound_wq, &sb->s_negative_prune_work))
+		put_super(sb);
+}
+
 /**
  *	deactivate_locked_super	-	drop an active reference to superblock
  *	@s: superblock to deactivate
@@ -355,6 +397,7 @@ void deactivate_locked_super(struct super_block *s)
 		 */
 		list_lru_destroy(&s->s_dentry_lru);
 		list_lru_destroy(&s->s_inode_lru);
+		percpu_counter_destroy(&s->s_nr_dentry_negative);
 
 		put_filesystem(fs);
 		put_super(s);
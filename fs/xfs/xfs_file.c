@@ -368,6 +368,9 @@ restart:
 	isize = i_size_read(inode);
 	if (iocb->ki_pos > isize) {
 		spin_unlock(&ip->i_flags_lock);
+		/* zeroing the gap to the old EOF can block */
+		if (iocb->ki_flags & IOCB_NOWAIT)
+			return -EAGAIN;
 		if (!drained_dio) {
 			if (*iolock == XFS_IOLOCK_SHARED) {
 				xfs_iunlock(ip, *iolock);
@@ -402,7 +405,7 @@ restart:
 	 * lock above.  Eventually we should look into a way to avoid
 	 * the pointless lock roundtrip.
 	 */
-	return file_modified(file);
+	return kiocb_modified(iocb);
 }
 
 static int
@@ -669,12 +672,14 @@ xfs_file_buffered_aio_write(
 	int			enospc = 0;
 	int			iolock;
 
-	if (iocb->ki_flags & IOCB_NOWAIT)
-		return -EOPNOTSUPP;
-
 write_retry:
 	iolock = XFS_IOLOCK_EXCL;
-	xfs_ilock(ip, iolock);
+	if (iocb->ki_flags & IOCB_NOWAIT) {
+		if (!xfs_ilock_nowait(ip, iolock))
+			return -EAGAIN;
+	} else {
+		xfs_ilock(ip, iolock);
+	}
 
 	ret = xfs_file_aio_write_checks(iocb, from, &iolock);
 	if (ret)
@@ -689,6 +694,11 @@ write_retry:
 	if (likely(ret >= 0))
 		iocb->ki_pos += ret;
 
+	/* freeing space below blocks, leave that to a blocking retry */
+	if ((ret == -EDQUOT || ret == -ENOSPC) &&
+	    (iocb->ki_flags & IOCB_NOWAIT))
+		ret = -EAGAIN;
+
 	/*
 	 * If we hit a space limit, try to free up some lingering preallocated
 	 * space before returning an error. In the case of ENOSPC, first try to
@@ -1162,7 +1172,7 @@ xfs_file_open(
 		return -EFBIG;
 	if (XFS_FORCED_SHUTDOWN(XFS_M(inode->i_sb)))
 		return -EIO;
-	file->f_mode |= FMODE_NOWAIT | FMODE_BUF_RASYNC;
+	file->f_mode |= FMODE_NOWAIT | FMODE_BUF_RASYNC | FMODE_BUF_WASYNC;
 	return 0;
 }
 
@@ -942,6 +942,9 @@ blk_status_t errno_to_blk_status(int errno);
 
 int blk_poll(struct request_queue *q, blk_qc_t cookie, bool spin);
 
+/* poll_flags for file_operations->uring_cmd_iopoll() */
+#define BLK_POLL_ONESHOT	(1 << 0)	/* check once, don't spin */
+
 static inline struct request_queue *bdev_get_queue(struct block_device *bdev)
 {
 	return bdev->bd_disk->queue;	/* this is never NULL */
@@ -70,7 +70,8 @@ struct dentry_stat_t {
 	long age_limit;		/* age in seconds */
 	long want_pages;	/* pages requested by system */
 	long nr_negative;	/* # of unused negative dentries */
-	long dummy;		/* Reserved for future use */
+	long nr_negative_pruned;	/* # of negative dentries reclaimed
+					   over negative-dentry-limit */
 };
 extern struct dentry_stat_t dentry_stat;
 
@@ -581,6 +582,7 @@ static inline bool d_is_fallthru(const struct dentry *dentry)
 
 
 extern int sysctl_vfs_cache_pressure;
+extern unsigned long sysctl_negative_dentry_limit;
 
 /**
  * @brief vm.vfs_cache_pressure
@@ -49,6 +49,15 @@ static inline bool fd_is_open(unsigned int fd, const struct fdtable *fdt)
 	return test_bit(fd, fdt->open_fds);
 }
 
+/*
+ * fds this CPU took from the bitmap for PR_FD_ALLOC_PERCPU: they are marked
+ * in open_fds but have no file, like an fd between alloc and fd_install().
+ */
+struct fd_reserve {
+	unsigned int base;	/* first fd of the open_fds word */
+	unsigned long mask;	/* reserved fds not handed out yet */
+};
+
 /*
  * Open file table structure
  */
@@ -65,12 +74,17 @@ struct files_struct {/* 打开的文件 */
      */
 	struct fdtable __rcu *fdt;
 	struct fdtable fdtab;
+	/* per-CPU reservations, NULL unless PR_FD_ALLOC_PERCPU is set */
+	struct fd_reserve __percpu __rcu *fd_reserve;
 
     /*
      * written part on a separate cache line in SMP
      */
 	spinlock_t ____cacheline_aligned_in_smp file_lock ;
 	unsigned int next_fd;
+	/* table expand_fdtable() is filling and how many slots it has copied */
+	struct fdtable *resize_fdt;
+	unsigned int resize_copied;
 	unsigned long close_on_exec_init[1];
 	unsigned long open_fds_init[1];
 	unsigned long full_fds_bits_init[1];
@@ -137,6 +151,8 @@ extern int __close_fd(struct files_struct *files,
 		      unsigned int fd);
 extern int __close_range(unsigned int fd, unsigned int max_fd, unsigned int flags);
 extern int __close_fd_get_file(unsigned int fd, struct file **res);
+extern int files_set_fd_alloc(struct files_struct *files, unsigned long mode);
+extern int files_get_fd_alloc(struct files_struct *files);
 extern int unshare_fd(unsigned long unshare_flags, unsigned int max_fds,
 		      struct files_struct **new_fdp);
 
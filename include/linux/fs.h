@@ -31,6 +31,7 @@
 #include <linux/uidgid.h>
 #include <linux/lockdep.h>
 #include <linux/percpu-rwsem.h>
+#include <linux/percpu_counter.h>
 #include <linux/workqueue.h>
 #include <linux/delayed_call.h>
 #include <linux/uuid.h>
@@ -68,6 +69,8 @@ struct fsverity_info;
 struct fsverity_operations;
 struct fs_context;
 struct fs_parameter_spec;
+struct io_uring_cmd;
+struct io_comp_batch;
 
 extern void __init inode_init(void);
 extern void __init inode_init_early(void);
@@ -181,6 +184,9 @@ typedef int (*dio_iodone_t)(struct kiocb *iocb, loff_t offset,
 /* File supports async buffered reads */
 #define FMODE_BUF_RASYNC	((__force fmode_t)0x40000000)
 
+/* File supports async nowait buffered writes */
+#define FMODE_BUF_WASYNC	((__force fmode_t)0x80000000)
+
 /*
  * Attribute flags.  These should be or-ed together to figure out what
  * has been changed!
@@ -283,6 +289,8 @@ enum positive_aop_returns {
 #define AOP_FLAG_NOFS			0x0002 /* used by filesystem to direct
 						* helper code (eg buffer layer)
 						* to clear GFP_FS from alloc */
+#define AOP_FLAG_NOWAIT			0x0004 /* don't block on page lock,
+						* page allocation or writeback */
 
 /*
  * oh the beauties of C type declarations.
@@ -642,6 +650,7 @@ static inline void mapping_allow_writable(struct address_space *mapping)
 #endif
 
 struct posix_acl;
+struct inode_exec_cache;
 #define ACL_NOT_CACHED ((void *)(-1))
 #define ACL_DONT_CACHE ((void *)(-3))
 
@@ -683,6 +692,8 @@ struct inode {
 	struct posix_acl	*i_acl;
 	struct posix_acl	*i_default_acl;
 #endif
+	/* last cred that passed MAY_EXEC on this directory, see namei.c */
+	struct inode_exec_cache __rcu *i_exec_cache;
 
 	/**
 	 *  socket(2) => sockfs_inode_ops
@@ -741,6 +752,7 @@ struct inode {
 	unsigned long		dirtied_time_when;
 
 	struct hlist_node	i_hash;
+	unsigned long		i_hashval;	/* i_hash key, for hash resizing */
 	struct list_head	i_io_list;	/* backing dev IO list */
 #ifdef CONFIG_CGROUP_WRITEBACK
 	struct bdi_writeback	*i_wb;		/* the associated cgroup wb */
@@ -1607,6 +1619,11 @@ struct super_block {
 	 */
 	struct list_lru		s_dentry_lru;
 	struct list_lru		s_inode_lru;
+
+	/* Negative dentries on s_dentry_lru, bounded by negative-dentry-limit */
+	struct percpu_counter	s_nr_dentry_negative;
+	struct work_struct	s_negative_prune_work;
+
 	struct rcu_head		rcu;
 	struct work_struct	destroy_work;
 
@@ -2053,6 +2070,11 @@ struct file_operations {    /* 文件操作符 */
 				   struct file *file_out, loff_t pos_out,
 				   loff_t len, unsigned int remap_flags);
 	int (*fadvise)(struct file *, loff_t, loff_t, int);
+	/* IORING_OP_URING_CMD, see <linux/io_uring/cmd.h> */
+	int (*uring_cmd)(struct io_uring_cmd *ioucmd, unsigned int issue_flags);
+	int (*uring_cmd_iopoll)(struct io_uring_cmd *ioucmd,
+				struct io_comp_batch *iob,
+				unsigned int poll_flags);
 } __randomize_layout;
 
 /**
@@ -2475,6 +2497,7 @@ static inline void file_accessed(struct file *file)
 }
 
 extern int file_modified(struct file *file);
+extern int kiocb_modified(struct kiocb *iocb);
 
 int sync_inode(struct inode *inode, struct writeback_control *wbc);
 int sync_inode_metadata(struct inode *inode, int wait);
@@ -22,6 +22,9 @@ struct io_identity {
 	refcount_t			count;
 };
 
+/* ring fds a task can register with IORING_REGISTER_RING_FDS */
+#define IO_RINGFD_REG_MAX	16
+
 /**
  *  struct task_struct.io_uring
  */
@@ -35,6 +38,8 @@ struct io_uring_task {
 	struct io_identity	*identity;
 	atomic_t		in_idle;
 	bool			sqpoll;
+	/* io_uring_enter(2) with IORING_ENTER_REGISTERED_RING */
+	struct file		*registered_rings[IO_RINGFD_REG_MAX];
 };
 
 #if defined(CONFIG_IO_URING)
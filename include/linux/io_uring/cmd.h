@@ -0,0 +1,95 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef _LINUX_IO_URING_CMD_H
+#define _LINUX_IO_URING_CMD_H
+
+#include <uapi/linux/io_uring.h>
+#include <linux/uio.h>
+
+/* issue_flags passed to ->uring_cmd() */
+enum io_uring_cmd_flags {
+	/* may not block, return -EAGAIN to be retried from io-wq */
+	IO_URING_F_NONBLOCK		= (1 << 0),
+	/* ring is IORING_SETUP_SQE128, the command has 80 bytes */
+	IO_URING_F_SQE128		= (1 << 1),
+	/* ring is IORING_SETUP_CQE32, res2 is passed back to userspace */
+	IO_URING_F_CQE32		= (1 << 2),
+	/* ring is IORING_SETUP_IOPOLL, completions are reaped via ->uring_cmd_iopoll() */
+	IO_URING_F_IOPOLL		= (1 << 3),
+	/* ring or task is going away, complete the parked command */
+	IO_URING_F_CANCEL		= (1 << 4),
+	/* ring is IORING_SETUP_SQPOLL, issued from the SQ thread */
+	IO_URING_F_SQPOLL		= (1 << 5),
+	/* task_work_cb runs from the fallback, the submitter is exiting */
+	IO_URING_F_TASK_DEAD		= (1 << 6),
+};
+
+/*
+ * Request handed to file_operations->uring_cmd() for IORING_OP_URING_CMD. It
+ * overlays the per-opcode data of the io_uring request, the driver may keep
+ * its own state in pdu[] until it completes the command.
+ */
+struct io_uring_cmd {
+	struct file	*file;
+	const struct io_uring_sqe *sqe;
+	/* callback to run from task context, see io_uring_cmd_do_in_task_lazy() */
+	void (*task_work_cb)(struct io_uring_cmd *cmd, unsigned issue_flags);
+	u32		cmd_op;
+	u32		flags;
+	u8		pdu[32];	/* available inline for free use */
+};
+
+static inline const void *io_uring_sqe_cmd(const struct io_uring_sqe *sqe)
+{
+	return sqe->cmd;
+}
+
+#define io_uring_cmd_to_pdu(cmd, pdu_type) ({			\
+	BUILD_BUG_ON(sizeof(pdu_type) > sizeof((cmd)->pdu));	\
+	((pdu_type *) &(cmd)->pdu);				\
+})
+
+#if defined(CONFIG_IO_URING)
+int io_uring_cmd_import_fixed(u64 ubuf, unsigned long len, int rw,
+			      struct iov_iter *iter,
+			      struct io_uring_cmd *ioucmd);
+void io_uring_cmd_done(struct io_uring_cmd *cmd, ssize_t ret, u64 res2,
+		       unsigned issue_flags);
+void io_uring_cmd_do_in_task_lazy(struct io_uring_cmd *ioucmd,
+		void (*task_work_cb)(struct io_uring_cmd *, unsigned));
+void io_uring_cmd_mark_cancelable(struct io_uring_cmd *cmd,
+				  unsigned int issue_flags);
+void io_uring_cmd_del_cancelable(struct io_uring_cmd *cmd);
+#else
+static inline int io_uring_cmd_import_fixed(u64 ubuf, unsigned long len,
+		int rw, struct iov_iter *iter, struct io_uring_cmd *ioucmd)
+{
+	return -EOPNOTSUPP;
+}
+static inline void io_uring_cmd_done(struct io_uring_cmd *cmd, ssize_t ret,
+		u64 res2, unsigned issue_flags)
+{
+}
+static inline void io_uring_cmd_do_in_task_lazy(struct io_uring_cmd *ioucmd,
+		void (*task_work_cb)(struct io_uring_cmd *, unsigned))
+{
+}
+static inline void io_uring_cmd_mark_cancelable(struct io_uring_cmd *cmd,
+		unsigned int issue_flags)
+{
+}
+static inline void io_uring_cmd_del_cancelable(struct io_uring_cmd *cmd)
+{
+}
+#endif
+
+/*
+ * Completion from the ->uring_cmd_iopoll() path of an IORING_SETUP_IOPOLL
+ * ring, which runs with the ring locked, so it can be completed directly.
+ */
+static inline void io_uring_cmd_iopoll_done(struct io_uring_cmd *ioucmd,
+					    ssize_t ret, u64 res2)
+{
+	io_uring_cmd_done(ioucmd, ret, res2, 0);
+}
+
+#endif
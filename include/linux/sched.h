@@ -752,6 +752,12 @@ struct sched_entity {
 	 */
 	u64				nr_migrations;
 
+	/*
+	 * Wakeup preemption bias derived from the latency nice of the task
+	 * or of the task group, see calc_latency_offset().
+	 */
+	long				latency_offset;
+
 	/**
 	 *  调度统计
 	 */
@@ -1144,6 +1150,12 @@ struct task_struct {    /* PCB */
 	 */
 	unsigned int			rt_priority;
 
+	/*
+	 * latency_nice: tolerance to scheduling latency, [-20, 19], see
+	 * SCHED_FLAG_LATENCY_NICE.
+	 */
+	int				latency_nice;
+
 	/**
 	 *  操作函数 - 调度类
 	 *
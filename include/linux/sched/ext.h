@@ -32,12 +32,14 @@ enum scx_public_consts {
  *
  * Built-in IDs:
  *
- *   Bits: [63] [62] [61..32] [31 ..  0]
- *         [ 1] [ L] [   R  ] [    V   ]
+ *   Bits: [63] [62] [61] [60..32] [31 ..  0]
+ *         [ 1] [ L] [ C] [   R  ] [    V   ]
  *
  *    1: 1 for built-in DSQs.
  *    L: 1 for LOCAL_ON DSQ IDs, 0 for others
- *    V: For LOCAL_ON DSQ IDs, a CPU number. For others, a pre-defined value.
+ *    C: 1 for LLC_ON DSQ IDs, 0 for others
+ *    V: For LOCAL_ON and LLC_ON DSQ IDs, a CPU number. For others, a
+ *       pre-defined value.
  */
 enum scx_dsq_id_flags {
 	/**
@@ -46,6 +48,7 @@ enum scx_dsq_id_flags {
 	 */
 	SCX_DSQ_FLAG_BUILTIN	= 1LLU << 63,
 	SCX_DSQ_FLAG_LOCAL_ON	= 1LLU << 62,
+	SCX_DSQ_FLAG_LLC_ON	= 1LLU << 61,
 
 	SCX_DSQ_INVALID		= SCX_DSQ_FLAG_BUILTIN | 0,
 	/**
@@ -58,6 +61,12 @@ enum scx_dsq_id_flags {
 	SCX_DSQ_LOCAL		= SCX_DSQ_FLAG_BUILTIN | 2,
 	SCX_DSQ_LOCAL_ON	= SCX_DSQ_FLAG_BUILTIN | SCX_DSQ_FLAG_LOCAL_ON,
 	SCX_DSQ_LOCAL_CPU_MASK	= 0xffffffffLLU,
+	/**
+	 * llc_dsq 每个 LLC 一个，由同一 LLC 内的 CPU 共享；SCX_DSQ_LLC 表示
+	 * 任务当前 CPU 所在的 LLC，SCX_DSQ_LLC_ON | cpu 表示 @cpu 所在的 LLC
+	 */
+	SCX_DSQ_LLC		= SCX_DSQ_FLAG_BUILTIN | 3,
+	SCX_DSQ_LLC_ON		= SCX_DSQ_FLAG_BUILTIN | SCX_DSQ_FLAG_LLC_ON,
 };
 
 /*
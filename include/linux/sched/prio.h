@@ -6,6 +6,17 @@
 #define MIN_NICE	-20
 #define NICE_WIDTH	(MAX_NICE - MIN_NICE + 1)   /* 40 */
 
+/*
+ * Latency nice is a hint on how much scheduling latency a task can tolerate.
+ * It uses the same range as nice but doesn't change the task's share of CPU
+ * time: a negative value asks for quicker wakeup preemption and a wider idle
+ * CPU search, a positive one tolerates waiting and keeps the task packed.
+ */
+#define MAX_LATENCY_NICE	19
+#define MIN_LATENCY_NICE	-20
+#define LATENCY_NICE_WIDTH	(MAX_LATENCY_NICE - MIN_LATENCY_NICE + 1)
+#define DEFAULT_LATENCY_NICE	0
+
 /*
  * Priority of a process goes from 0..MAX_PRIO-1, valid RT
  * priority is 0..MAX_RT_PRIO-1, and SCHED_NORMAL/SCHED_BATCH
@@ -485,6 +485,7 @@ struct ubuf_info {
 		};
 	};
 	refcount_t refcnt;
+	u8 flags;
 
 	struct mmpin {
 		struct user_struct *user;
@@ -492,6 +493,9 @@ struct ubuf_info {
 	} mmp;
 };
 
+/* ubuf_info->flags */
+#define UARG_F_REFCOUNTED	0x1	/* callback runs when the last ref is put */
+
 #define skb_uarg(SKB)	((struct ubuf_info *)(skb_shinfo(SKB)->destructor_arg))
 
 int mm_account_pinned_pages(struct mmpin *mmp, size_t size);
@@ -511,6 +515,16 @@ void sock_zerocopy_put_abort(struct ubuf_info *uarg, bool have_uref);
 
 void sock_zerocopy_callback(struct ubuf_info *uarg, bool success);
 
+/*
+ * True if skbs pin @uarg through its refcount, as for MSG_ZEROCOPY, rather
+ * than having its callback run for each of them.
+ */
+static inline bool sock_zerocopy_refcounted(const struct ubuf_info *uarg)
+{
+	return uarg->callback == sock_zerocopy_callback ||
+	       (uarg->flags & UARG_F_REFCOUNTED);
+}
+
 int skb_zerocopy_iter_dgram(struct sk_buff *skb, struct msghdr *msg, int len);
 int skb_zerocopy_iter_stream(struct sock *sk, struct sk_buff *skb,
 			     struct msghdr *msg, int len,
@@ -1669,7 +1683,7 @@ static inline void skb_zcopy_clear(struct sk_buff *skb, bool zerocopy)
 	if (uarg) {
 		if (skb_zcopy_is_nouarg(skb)) {
 			/* no notification callback */
-		} else if (uarg->callback == sock_zerocopy_callback) {
+		} else if (sock_zerocopy_refcounted(uarg)) {
 			uarg->zerocopy = uarg->zerocopy && zerocopy;
 			sock_zerocopy_put(uarg);
 		} else {
@@ -2974,7 +2988,7 @@ static inline int skb_orphan_frags(struct sk_buff *skb, gfp_t gfp_mask)
 	if (likely(!skb_zcopy(skb)))
 		return 0;
 	if (!skb_zcopy_is_nouarg(skb) &&
-	    skb_uarg(skb)->callback == sock_zerocopy_callback)
+	    sock_zerocopy_refcounted(skb_uarg(skb)))
 		return 0;
 	return skb_copy_ubufs(skb, gfp_mask);
 }
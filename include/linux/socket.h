@@ -14,6 +14,7 @@ struct file;
 struct pid;
 struct cred;
 struct socket;
+struct ubuf_info;
 
 #define __sockaddr_check_size(size)	\
 	BUILD_BUG_ON(((size) > sizeof(struct __kernel_sockaddr_storage)))
@@ -65,6 +66,7 @@ struct msghdr {
 	__kernel_size_t	msg_controllen;	/* ancillary data buffer length */
 	unsigned int	msg_flags;	/* flags on received message */
 	struct kiocb	*msg_iocb;	/* ptr to iocb for async requests */
+	struct ubuf_info *msg_ubuf;	/* caller owned MSG_ZEROCOPY state */
 };
 
 struct user_msghdr {
@@ -36,7 +36,8 @@ struct partial_cluster;
 	{ EXT4_MB_STREAM_ALLOC,		"STREAM_ALLOC" },	\
 	{ EXT4_MB_USE_ROOT_BLOCKS,	"USE_ROOT_BLKS" },	\
 	{ EXT4_MB_USE_RESERVED,		"USE_RESV" },		\
-	{ EXT4_MB_STRICT_CHECK,		"STRICT_CHECK" })
+	{ EXT4_MB_STRICT_CHECK,		"STRICT_CHECK" },	\
+	{ EXT4_MB_CR_OPTIMIZED,		"CR_OPTIMIZED" })
 
 #define show_map_flags(flags) __print_flags(flags, "|",			\
 	{ EXT4_GET_BLOCKS_CREATE,		"CREATE" },		\
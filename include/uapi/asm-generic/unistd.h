@@ -859,9 +859,11 @@ __SYSCALL(__NR_pidfd_getfd, sys_pidfd_getfd)
 __SYSCALL(__NR_faccessat2, sys_faccessat2)
 #define __NR_process_madvise 440
 __SYSCALL(__NR_process_madvise, sys_process_madvise)
+#define __NR_statx_batch 471
+__SYSCALL(__NR_statx_batch, sys_statx_batch)
 
 #undef __NR_syscalls
-#define __NR_syscalls 441
+#define __NR_syscalls 472
 
 /*
  * 32 bit systems traditionally used different
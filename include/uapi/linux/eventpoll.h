@@ -18,6 +18,7 @@
 /* For O_CLOEXEC */
 #include <linux/fcntl.h>
 #include <linux/types.h>
+#include <linux/ioctl.h>
 
 /* Flags for epoll_create1.  */
 #define EPOLL_CLOEXEC O_CLOEXEC
@@ -100,6 +101,20 @@ struct epoll_event {
 };
 #endif
 
+/* Per epoll instance busy poll parameters, see EPIOCSPARAMS */
+struct epoll_params {
+	__u32 busy_poll_usecs;	/* busy poll timeout, 0 uses net.core.busy_poll */
+	__u16 busy_poll_budget;	/* packets per napi poll, 0 is the default */
+	__u8 prefer_busy_poll;	/* defer device irqs while busy polling */
+
+	/* pad the struct to a multiple of 64bits */
+	__u8 __pad;		/* must be zero */
+};
+
+#define EPOLL_IOC_TYPE 0x8A
+#define EPIOCSPARAMS _IOW(EPOLL_IOC_TYPE, 0x01, struct epoll_params)
+#define EPIOCGPARAMS _IOR(EPOLL_IOC_TYPE, 0x02, struct epoll_params)
+
 #ifdef CONFIG_PM_SLEEP
 /**
  *  
@@ -175,6 +175,14 @@
  *
  *  7.32
  *  - add flags to fuse_attr, add FUSE_ATTR_SUBMOUNT, add FUSE_SUBMOUNTS
+ *
+ *  7.33
+ *  - add FUSE_PASSTHROUGH, FOPEN_PASSTHROUGH and backing_id to fuse_open_out
+ *  - add max_stack_depth to fuse_init_out
+ *  - add FUSE_DEV_IOC_BACKING_OPEN and FUSE_DEV_IOC_BACKING_CLOSE
+ *
+ *  7.34
+ *  - add FUSE_OVER_IO_URING and the io_uring command interface
  */
 
 #ifndef _LINUX_FUSE_H
@@ -210,7 +218,7 @@
 #define FUSE_KERNEL_VERSION 7
 
 /** Minor version number of this interface */
-#define FUSE_KERNEL_MINOR_VERSION 32
+#define FUSE_KERNEL_MINOR_VERSION 34
 
 /** The node ID of the root inode */
 #define FUSE_ROOT_ID 1
@@ -280,12 +288,15 @@ struct fuse_file_lock {
  * FOPEN_NONSEEKABLE: the file is not seekable
  * FOPEN_CACHE_DIR: allow caching this directory
  * FOPEN_STREAM: the file is stream-like (no file position at all)
+ * FOPEN_PASSTHROUGH: read/write/mmap go straight to the backing file
+ *		      registered as fuse_open_out.backing_id
  */
 #define FOPEN_DIRECT_IO		(1 << 0)
 #define FOPEN_KEEP_CACHE	(1 << 1)
 #define FOPEN_NONSEEKABLE	(1 << 2)
 #define FOPEN_CACHE_DIR		(1 << 3)
 #define FOPEN_STREAM		(1 << 4)
+#define FOPEN_PASSTHROUGH	(1 << 5)
 
 /**
  * INIT request/reply flags
@@ -320,6 +331,10 @@ struct fuse_file_lock {
  *		       foffset and moffset fields in struct
  *		       fuse_setupmapping_out and fuse_removemapping_one.
  * FUSE_SUBMOUNTS: kernel supports auto-mounting directory submounts
+ * FUSE_PASSTHROUGH: passthrough I/O to backing files, init_out.max_stack_depth
+ *		     holds the stacking depth of the fuse filesystem
+ * FUSE_OVER_IO_URING: requests and replies may be exchanged through
+ *		       IORING_OP_URING_CMD on /dev/fuse
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -349,6 +364,8 @@ struct fuse_file_lock {
 #define FUSE_EXPLICIT_INVAL_DATA (1 << 25)
 #define FUSE_MAP_ALIGNMENT	(1 << 26)
 #define FUSE_SUBMOUNTS		(1 << 27)
+#define FUSE_PASSTHROUGH	(1 << 28)
+#define FUSE_OVER_IO_URING	(1 << 29)
 
 /**
  * CUSE INIT request/reply flags
@@ -605,7 +622,7 @@ struct fuse_create_in {
 struct fuse_open_out {
 	uint64_t	fh;
 	uint32_t	open_flags;
-	uint32_t	padding;
+	int32_t		backing_id;
 };
 
 struct fuse_release_in {
@@ -714,7 +731,8 @@ struct fuse_init_out {
 	uint32_t	time_gran;
 	uint16_t	max_pages;
 	uint16_t	map_alignment;
-	uint32_t	unused[8];
+	uint32_t	max_stack_depth;
+	uint32_t	unused[7];
 };
 
 #define CUSE_INIT_INFO_MAX 4096
@@ -882,8 +900,18 @@ struct fuse_notify_retrieve_in {
 	uint64_t	dummy4;
 };
 
+struct fuse_backing_map {
+	int32_t		fd;
+	uint32_t	flags;
+	uint64_t	padding;
+};
+
 /* Device ioctls: */
-#define FUSE_DEV_IOC_CLONE	_IOR(229, 0, uint32_t)
+#define FUSE_DEV_IOC_MAGIC		229
+#define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, uint32_t)
+#define FUSE_DEV_IOC_BACKING_OPEN	_IOW(FUSE_DEV_IOC_MAGIC, 1, \
+					     struct fuse_backing_map)
+#define FUSE_DEV_IOC_BACKING_CLOSE	_IOW(FUSE_DEV_IOC_MAGIC, 2, uint32_t)
 
 struct fuse_lseek_in {
 	uint64_t	fh;
@@ -936,4 +964,64 @@ struct fuse_removemapping_one {
 #define FUSE_REMOVEMAPPING_MAX_ENTRY   \
 		(PAGE_SIZE / sizeof(struct fuse_removemapping_one))
 
+/*
+ * io_uring transport
+ *
+ * The server registers each of its buffers on the queue of a CPU with
+ * FUSE_IO_URING_CMD_REGISTER, an IORING_OP_URING_CMD on /dev/fuse from a ring
+ * set up with IORING_SETUP_SQE128.  sqe->addr points to two iovecs
+ * (sqe->len == 2): a struct fuse_uring_req_header and a payload buffer of at
+ * least max(FUSE_MIN_READ_BUFFER, max_write, max_pages * page size) bytes.
+ *
+ * The command completes when a request was copied into the buffer: the
+ * fuse_in_header into in_out and the arguments into the payload.  The server
+ * puts the fuse_out_header into in_out and the reply arguments into the
+ * payload and submits FUSE_IO_URING_CMD_COMMIT_AND_FETCH for the buffer,
+ * which sends the reply and waits for the next request.
+ */
+#define FUSE_URING_IN_OUT_HEADER_SZ 128
+
+enum fuse_uring_cmd {
+	FUSE_IO_URING_CMD_INVALID = 0,
+
+	/* register a buffer and wait for a request */
+	FUSE_IO_URING_CMD_REGISTER = 1,
+
+	/* commit the reply in the buffer and wait for the next request */
+	FUSE_IO_URING_CMD_COMMIT_AND_FETCH = 2,
+};
+
+struct fuse_uring_ent_in_out {
+	uint64_t	flags;
+
+	/* id to commit the reply with, the unique of the request */
+	uint64_t	commit_id;
+
+	/* bytes of arguments in the payload buffer */
+	uint32_t	payload_sz;
+	uint32_t	padding;
+
+	uint64_t	reserved;
+};
+
+/* Header buffer of a ring entry */
+struct fuse_uring_req_header {
+	/* struct fuse_in_header for a request, fuse_out_header for a reply */
+	char		in_out[FUSE_URING_IN_OUT_HEADER_SZ];
+
+	struct fuse_uring_ent_in_out ring_ent_in_out;
+};
+
+/* sqe->cmd of the io_uring commands */
+struct fuse_uring_cmd_req {
+	uint64_t	flags;
+
+	/* commit_id of the request replied to, FUSE_IO_URING_CMD_COMMIT_AND_FETCH */
+	uint64_t	commit_id;
+
+	/* queue the buffer belongs to, the CPU id */
+	uint16_t	qid;
+	uint8_t		padding[6];
+};
+
 #endif /* _LINUX_FUSE_H */
@@ -39,6 +39,10 @@ struct io_uring_sqe {
 	union {
 		__u64	off;	/* offset into file */
 		__u64	addr2;
+		struct {
+			__u32	cmd_op;
+			__u32	__pad1;
+		};
 	};
     /**
      *  对于读取文件来说，这里指的是读取到的数据将要存放的目标地址
@@ -65,6 +69,10 @@ struct io_uring_sqe {
 		__u32		statx_flags;
 		__u32		fadvise_advice;
 		__u32		splice_flags;
+		__u32		uring_cmd_flags;
+		__u32		rename_flags;
+		__u32		unlink_flags;
+		__u32		hardlink_flags;
 	};
     /**
      *  一个用户将 SQE 和 CQE(completion queue entry)关联起来的标识符。
@@ -82,6 +90,11 @@ struct io_uring_sqe {
 			/* personality to use, if used */
 			__u16	personality;
 			__s32	splice_fd_in;
+			/*
+			 * IORING_OP_URING_CMD payload, runs into the second
+			 * half of the entry with IORING_SETUP_SQE128.
+			 */
+			__u8	cmd[0];
 		};
 		__u64	__pad2[3];
 	};
@@ -122,6 +135,16 @@ enum {
 #define IORING_SETUP_CLAMP	(1U << 4)	/* clamp SQ/CQ ring sizes */
 #define IORING_SETUP_ATTACH_WQ	(1U << 5)	/* attach to existing wq */
 #define IORING_SETUP_R_DISABLED	(1U << 6)	/* start with ring disabled */
+#define IORING_SETUP_SINGLE_ISSUER	(1U << 7)	/* only one task submits */
+/*
+ * Defer completion task_work until the task waits in io_uring_enter(2) with
+ * IORING_ENTER_GETEVENTS, instead of interrupting it when a request finishes.
+ * Requires IORING_SETUP_SINGLE_ISSUER, completions are only posted to the CQ
+ * ring from within io_uring_enter(2).
+ */
+#define IORING_SETUP_DEFER_TASKRUN	(1U << 8)
+#define IORING_SETUP_SQE128	(1U << 9)	/* SQEs are 128 bytes */
+#define IORING_SETUP_CQE32	(1U << 10)	/* CQEs are 32 bytes */
 
 enum {
 	IORING_OP_NOP,
@@ -158,6 +181,13 @@ enum {
 	IORING_OP_PROVIDE_BUFFERS,
 	IORING_OP_REMOVE_BUFFERS,
 	IORING_OP_TEE,
+	IORING_OP_SEND_ZC,
+	IORING_OP_URING_CMD,
+	IORING_OP_RENAMEAT,
+	IORING_OP_UNLINKAT,
+	IORING_OP_MKDIRAT,
+	IORING_OP_SYMLINKAT,
+	IORING_OP_LINKAT,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -179,6 +209,40 @@ enum {
  */
 #define SPLICE_F_FD_IN_FIXED	(1U << 31) /* the last bit of __u32 */
 
+/*
+ * accept flags stored in sqe->ioprio
+ *
+ * IORING_ACCEPT_MULTISHOT	Keep accepting connections, posting a CQE with
+ *				IORING_CQE_F_MORE set for each of them.
+ */
+#define IORING_ACCEPT_MULTISHOT	(1U << 0)
+
+/*
+ * IORING_OP_RECV flags stored in sqe->ioprio
+ *
+ * IORING_RECV_MULTISHOT	Keep receiving into buffers picked from the
+ *				provided buffer group, posting a CQE with
+ *				IORING_CQE_F_MORE set for each of them.
+ *				Needs IOSQE_BUFFER_SELECT and sqe->len == 0.
+ */
+#define IORING_RECV_MULTISHOT	(1U << 0)
+
+/*
+ * IORING_OP_SEND_ZC flags stored in sqe->ioprio
+ *
+ * IORING_SEND_ZC_FIXED_BUF	Send from the registered buffer sqe->buf_index,
+ *				sqe->addr must point inside of it.
+ */
+#define IORING_SEND_ZC_FIXED_BUF	(1U << 0)
+
+/*
+ * sqe->uring_cmd_flags
+ *
+ * IORING_URING_CMD_FIXED	The command's data buffer is within the
+ *				registered buffer sqe->buf_index.
+ */
+#define IORING_URING_CMD_FIXED	(1U << 0)
+
 /*
  * IO completion data structure (Completion Queue Entry)
  *  内核生产，应用消费
@@ -187,14 +251,34 @@ struct io_uring_cqe {
 	__u64	user_data;	/* sqe->data submission passed back */
 	__s32	res;		/* result code for this event */
 	__u32	flags;
+
+	/*
+	 * If the ring is set up with IORING_SETUP_CQE32, 16 more bytes of
+	 * command specific data follow.
+	 */
+	__u64	big_cqe[];
 };
 
 /*
  * cqe->flags
  *
  * IORING_CQE_F_BUFFER	If set, the upper 16 bits are the buffer ID
+ * IORING_CQE_F_MORE	If set, the request stays armed and more CQEs
+ *			will be posted for it
+ * IORING_CQE_F_NOTIF	Zero-copy send notification: the pages of the send
+ *			with the same user_data, whose CQE had
+ *			IORING_CQE_F_MORE set, may be reused
  */
 #define IORING_CQE_F_BUFFER		(1U << 0)
+#define IORING_CQE_F_MORE		(1U << 1)
+#define IORING_CQE_F_NOTIF		(1U << 2)
+
+/*
+ * cqe->res of an IORING_CQE_F_NOTIF CQE
+ *
+ * IORING_NOTIF_ZC_COPIED	The stack had to copy the data after all
+ */
+#define IORING_NOTIF_ZC_COPIED		(1U << 0)
 
 enum {
 	IORING_CQE_BUFFER_SHIFT		= 16,
@@ -253,6 +337,8 @@ struct io_cqring_offsets {
 #define IORING_ENTER_GETEVENTS	(1U << 0)
 #define IORING_ENTER_SQ_WAKEUP	(1U << 1)
 #define IORING_ENTER_SQ_WAIT	(1U << 2)
+/* fd is an index registered with IORING_REGISTER_RING_FDS */
+#define IORING_ENTER_REGISTERED_RING	(1U << 3)
 
 /*
  * Passed in for io_uring_setup(2). Copied back with updated info on success
@@ -308,6 +394,17 @@ enum {
 	IORING_UNREGISTER_PERSONALITY		= 10,
 	IORING_REGISTER_RESTRICTIONS		= 11,
 	IORING_REGISTER_ENABLE_RINGS		= 12,
+	IORING_REGISTER_PBUF_RING		= 13,
+	IORING_UNREGISTER_PBUF_RING		= 14,
+	IORING_REGISTER_RING_FDS		= 15,
+	IORING_UNREGISTER_RING_FDS		= 16,
+
+	/* set/clear io-wq worker CPU affinity, arg is a cpu_set_t */
+	IORING_REGISTER_IOWQ_AFF		= 17,
+	IORING_UNREGISTER_IOWQ_AFF		= 18,
+
+	/* set/get max number of io-wq workers, arg is __u32[2] */
+	IORING_REGISTER_IOWQ_MAX_WORKERS	= 19,
 
 	/* this goes last */
 	IORING_REGISTER_LAST
@@ -319,6 +416,17 @@ struct io_uring_files_update {
 	__aligned_u64 /* __s32 * */ fds;
 };
 
+/*
+ * Argument for IORING_(UN)REGISTER_RING_FDS, an array of nr_args. data is the
+ * ring fd to register, offset the slot to use, -1U for the first free one.
+ * The slot used is written back to offset.
+ */
+struct io_uring_rsrc_update {
+	__u32 offset;
+	__u32 resv;
+	__aligned_u64 data;
+};
+
 #define IO_URING_OP_SUPPORTED	(1U << 0)
 
 struct io_uring_probe_op {
@@ -366,4 +474,41 @@ enum {
 	IORING_RESTRICTION_LAST
 };
 
+/*
+ * Entry of a ring mapped provided buffer group, filled in by the application
+ */
+struct io_uring_buf {
+	__u64	addr;
+	__u32	len;
+	__u16	bid;
+	__u16	resv;
+};
+
+/*
+ * Ring of provided buffers shared with the kernel. The application adds
+ * buffers at tail and publishes them with a store-release of tail, the kernel
+ * consumes them from its private head. The tail overlays bufs[0].resv so that
+ * the ring takes no more memory than its entries.
+ */
+struct io_uring_buf_ring {
+	union {
+		struct {
+			__u64	resv1;
+			__u32	resv2;
+			__u16	resv3;
+			__u16	tail;
+		};
+		struct io_uring_buf	bufs[0];
+	};
+};
+
+/* argument for IORING_(UN)REGISTER_PBUF_RING */
+struct io_uring_buf_reg {
+	__u64	ring_addr;	/* page aligned */
+	__u32	ring_entries;	/* power of two, at most 32768 */
+	__u16	bgid;
+	__u16	pad;
+	__u64	resv[3];
+};
+
 #endif
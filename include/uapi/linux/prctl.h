@@ -255,4 +255,15 @@ struct prctl_mm_map {
 #define PR_SET_IO_FLUSHER		57
 #define PR_GET_IO_FLUSHER		58
 
+/*
+ * fd allocation policy of the calling process's file table, inherited
+ * across fork() and reset to PR_FD_ALLOC_LOWEST by execve().  With
+ * PR_FD_ALLOC_PERCPU, dup2() and dup3() onto an fd reserved by another CPU
+ * take it back, they only fail with -EBUSY while an open() is installing it.
+ */
+#define PR_SET_FD_ALLOC			59
+#define PR_GET_FD_ALLOC			60
+# define PR_FD_ALLOC_LOWEST		0	/* POSIX: lowest free fd */
+# define PR_FD_ALLOC_PERCPU		1	/* any free fd, from a per-CPU reserve */
+
 #endif /* _LINUX_PRCTL_H */
@@ -189,4 +189,15 @@ struct statx {
 #define STATX_ATTR_DAX			0x00200000 /* File is currently in DAX state */
 
 
+/*
+ * One name of a statx_batch() call.  @name and @buffer are user pointers
+ * stored as __u64 so the layout is the same for 32 and 64-bit callers.
+ */
+struct statx_batch_entry {
+	__u64	name;		/* Name relative to the batch's dfd */
+	__u64	buffer;		/* struct statx to fill in */
+	__s32	result;		/* 0 or -errno for this name [out] */
+	__u32	__reserved;	/* Must be zero */
+};
+
 #endif /* _UAPI_LINUX_STAT_H */
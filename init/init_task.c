@@ -81,6 +81,7 @@ struct task_struct init_task
 	init_task.prio		= MAX_PRIO/* 140 */ - 20,/* 120 */
 	init_task.static_prio	= MAX_PRIO - 20,/* 120 */
 	init_task.normal_prio	= MAX_PRIO - 20,/* 120 */
+	init_task.latency_nice	= DEFAULT_LATENCY_NICE,
 	init_task.policy		= SCHED_NORMAL,/* NORMAL - CFS?? */
 	init_task.cpus_ptr	= &init_task.cpus_mask,/* CPU 亲和性 */
 	init_task.cpus_mask	= CPU_MASK_ALL,/* 所有 CPU */
@@ -3022,6 +3022,142 @@ static void __ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags
 	__smp_call_single_queue(cpu, &p->wake_entry.llist);
 }
 
+/*
+ * Cross-LLC wakeup coalescing (TTWU_QUEUE_LLC).
+ *
+ * A message passing workload can generate a stream of wakeups from one LLC to
+ * many different CPUs of another, and __ttwu_queue_wakelist() sends an IPI to
+ * each of them. Instead, queue such wakeups on a list per target LLC and have
+ * only the waker which finds the list empty kick a CPU of that LLC, right away
+ * or once sysctl_sched_wake_coalesce_ns has passed to let more wakeups pile
+ * up. The kicked CPU activates all queued tasks, taking the rq locks of its
+ * LLC siblings as needed, which is much cheaper than the IPIs it replaces.
+ *
+ * Waking a busy sibling still needs a resched IPI, but at most one per rq and
+ * batch, as resched_curr() doesn't send another while TIF_NEED_RESCHED is set.
+ * The schedstats count the IPIs the wakeups would have needed on the waker's
+ * rq and the IPIs actually sent on the sending one; the IPIs saved are the
+ * difference of their sums over all CPUs.
+ */
+const_debug unsigned int sysctl_sched_wake_coalesce_ns;
+
+/* would an IPI to @rq be elided because its idle task polls? */
+static inline bool ttwu_llc_rq_polls(struct rq *rq)
+{
+#ifdef TIF_POLLING_NRFLAG
+	struct task_struct *curr = READ_ONCE(rq->curr);
+
+	return is_idle_task(curr) &&
+	       test_tsk_thread_flag(curr, TIF_POLLING_NRFLAG);
+#else
+	return false;
+#endif
+}
+
+static void sched_ttwu_llc_pending(void *arg)
+{
+	struct rq *llc_rq = arg, *rq = NULL, *this = this_rq();
+	struct llist_node *llist;
+	struct task_struct *p, *t;
+	unsigned int nr_sent = 0;
+	struct rq_flags rf;
+	u64 queued_at;
+	bool resched;
+
+	lockdep_assert_irqs_disabled();
+
+	queued_at = READ_ONCE(llc_rq->ttwu_llc_queued_at);
+	llist = llist_del_all(&llc_rq->ttwu_llc_list);
+	if (!llist)
+		return;
+
+	/* wake up in queueing order, batching consecutive tasks of one rq */
+	llist = llist_reverse_order(llist);
+	llist_for_each_entry_safe(p, t, llist, wake_entry.llist) {
+		struct rq *task_rq = cpu_rq(task_cpu(p));
+
+		if (task_rq != rq) {
+			if (rq)
+				rq_unlock(rq, &rf);
+			rq = task_rq;
+			rq_lock(rq, &rf);
+			update_rq_clock(rq);
+			WRITE_ONCE(rq->ttwu_pending, 0);
+		}
+
+		/* resched_curr() IPIs a remote rq unless it polls or already has to */
+		resched = rq != this && !test_tsk_need_resched(rq->curr) &&
+			  !ttwu_llc_rq_polls(rq);
+		ttwu_do_activate(rq, p, p->sched_remote_wakeup ? WF_MIGRATED : 0, &rf);
+		if (resched && test_tsk_need_resched(rq->curr))
+			nr_sent++;
+	}
+	rq_unlock(rq, &rf);
+
+	schedstat_inc(this->ttwu_llc_ipi);
+	schedstat_add(this->ttwu_llc_ipi_sent, nr_sent);
+	schedstat_add(this->ttwu_llc_delay, local_clock() - queued_at);
+}
+
+static void ttwu_llc_kick(struct rq *llc_rq)
+{
+	int target = READ_ONCE(llc_rq->ttwu_llc_target);
+	bool polls = ttwu_llc_rq_polls(cpu_rq(target));
+	int ret;
+
+	/*
+	 * -EBUSY means the previous kick hasn't been handled yet and will pick
+	 * up the tasks queued since. If the target went offline, drain here.
+	 */
+	ret = smp_call_function_single_async(target, &llc_rq->ttwu_llc_csd);
+	if (ret == -ENXIO)
+		sched_ttwu_llc_pending(llc_rq);
+	else if (!ret && target != smp_processor_id() && !polls)
+		schedstat_inc(this_rq()->ttwu_llc_ipi_sent);
+}
+
+static enum hrtimer_restart ttwu_llc_timer_fn(struct hrtimer *timer)
+{
+	ttwu_llc_kick(container_of(timer, struct rq, ttwu_llc_timer));
+
+	return HRTIMER_NORESTART;
+}
+
+static void __ttwu_queue_llc(struct task_struct *p, int cpu, int wake_flags)
+{
+	struct rq *llc_rq = cpu_rq(per_cpu(sd_llc_id, cpu));
+	unsigned int window = READ_ONCE(sysctl_sched_wake_coalesce_ns);
+
+	p->sched_remote_wakeup = !!(wake_flags & WF_MIGRATED);
+	/* __ttwu_queue_wakelist() would IPI a target with nothing pending */
+	if (!READ_ONCE(cpu_rq(cpu)->ttwu_pending) &&
+	    !ttwu_llc_rq_polls(cpu_rq(cpu)))
+		schedstat_inc(this_rq()->ttwu_llc_ipi_needed);
+	WRITE_ONCE(cpu_rq(cpu)->ttwu_pending, 1);
+
+	/* someone else is already kicking the LLC */
+	if (!llist_add(&p->wake_entry.llist, &llc_rq->ttwu_llc_list))
+		return;
+
+	WRITE_ONCE(llc_rq->ttwu_llc_target, cpu);
+	WRITE_ONCE(llc_rq->ttwu_llc_queued_at, local_clock());
+
+	if (window)
+		hrtimer_start(&llc_rq->ttwu_llc_timer, ns_to_ktime(window),
+			      HRTIMER_MODE_REL_PINNED_HARD);
+	else
+		ttwu_llc_kick(llc_rq);
+}
+
+static void ttwu_llc_rq_init(struct rq *rq)
+{
+	init_llist_head(&rq->ttwu_llc_list);
+	rq_csd_init(rq, &rq->ttwu_llc_csd, sched_ttwu_llc_pending);
+	hrtimer_init(&rq->ttwu_llc_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_HARD);
+	rq->ttwu_llc_timer.function = ttwu_llc_timer_fn;
+	rq->ttwu_llc_target = cpu_of(rq);
+}
+
 void wake_up_if_idle(int cpu)
 {
 	struct rq *rq = cpu_rq(cpu);
@@ -3097,7 +3233,11 @@ static bool ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags)
 		 * 接收到 IPI 的唤醒 CPU 将通过 sched_ttwu_wakeup() 对任务进行排队以进行激活，
 		 * 因此 wakee 会产生唤醒成本，而不是 waker 。
 		 */
-		__ttwu_queue_wakelist(p, cpu, wake_flags);
+		if (sched_feat(TTWU_QUEUE_LLC) && !(wake_flags & WF_ON_CPU) &&
+		    !cpus_share_cache(smp_processor_id(), cpu))
+			__ttwu_queue_llc(p, cpu, wake_flags);
+		else
+			__ttwu_queue_wakelist(p, cpu, wake_flags);
 
 		return true;
 	}
@@ -3949,6 +4089,10 @@ int sched_fork(unsigned long clone_flags, struct task_struct *p)
 		} else if (PRIO_TO_NICE(p->static_prio) < 0)
 			p->static_prio = NICE_TO_PRIO(0);
 
+		if (p->latency_nice < DEFAULT_LATENCY_NICE)
+			p->latency_nice = DEFAULT_LATENCY_NICE;
+		p->se.latency_offset = calc_latency_offset(p->latency_nice);
+
 		/**
 		 *
 		 */
@@ -6485,6 +6629,16 @@ static void __setscheduler_params(struct task_struct *p,
 	set_load_weight(p, true);
 }
 
+static void __setscheduler_latency(struct task_struct *p,
+				   const struct sched_attr *attr)
+{
+	if (!(attr->sched_flags & SCHED_FLAG_LATENCY_NICE))
+		return;
+
+	p->latency_nice = attr->sched_latency_nice;
+	p->se.latency_offset = calc_latency_offset(p->latency_nice);
+}
+
 /* Actually do priority change: must hold pi & rq lock. */
 static void __setscheduler(struct rq *rq, struct task_struct *p,
 			   const struct sched_attr *attr, bool keep_boost)
@@ -6589,6 +6743,11 @@ recheck:
 	    (rt_policy(policy) != (attr->sched_priority != 0)))
 		return -EINVAL;
 
+	if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+	    (attr->sched_latency_nice > MAX_LATENCY_NICE ||
+	     attr->sched_latency_nice < MIN_LATENCY_NICE))
+		return -EINVAL;
+
 	/*
 	 * Allow unprivileged RT tasks to decrease priority:
 	 */
@@ -6599,6 +6758,11 @@ recheck:
 			    !can_nice(p, attr->sched_nice))
 				return -EPERM;
 		}
+
+		/* Lowering latency nice is a request for preferential treatment: */
+		if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+		    attr->sched_latency_nice < p->latency_nice)
+			return -EPERM;
 		/* 实时调度 */
 		if (rt_policy(policy)) {
 			unsigned long rlim_rtprio =
@@ -6694,6 +6858,9 @@ recheck:
 			goto change;
 		if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP)
 			goto change;
+		if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+		    attr->sched_latency_nice != p->latency_nice)
+			goto change;
 
 		p->sched_reset_on_fork = reset_on_fork;
 		retval = 0;
@@ -6782,6 +6949,7 @@ change:
 	 */
 	__setscheduler(rq, p, attr, pi);    /* 根据优先级设置调度类 */
 	__setscheduler_uclamp(p, attr);     /* 利用率管制 */
+	__setscheduler_latency(p, attr);
 
 	if (queued) {   /* 如果在队列中，改变调度类后应该将其加入就绪队列中 */
 		/*
@@ -7013,6 +7181,10 @@ static int sched_copy_attr(struct sched_attr __user *uattr, struct sched_attr *a
 	    size < SCHED_ATTR_SIZE_VER1)
 		return -EINVAL;
 
+	if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+	    size < SCHED_ATTR_SIZE_VER2)
+		return -EINVAL;
+
 	/*
 	 * XXX: Do we want to be lenient like existing syscalls; or do we want
 	 * to be strict and return an error on out-of-bounds values?
@@ -7292,6 +7464,8 @@ SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
 	kattr.sched_util_max = p->uclamp_req[UCLAMP_MAX].value;
 #endif
 
+	kattr.sched_latency_nice = p->latency_nice;
+
 	rcu_read_unlock();
 
 	/**
@@ -8740,6 +8914,11 @@ void __init sched_init(void)    /* 调度初始化 */
 		rq->max_idle_balance_cost = sysctl_sched_migration_cost;
 
 		INIT_LIST_HEAD(&rq->cfs_tasks);
+#ifdef CONFIG_CFS_BANDWIDTH
+		rq_csd_init(rq, &rq->cfsb_csd, __cfsb_csd_unthrottle);
+		INIT_LIST_HEAD(&rq->cfsb_csd_list);
+#endif
+		ttwu_llc_rq_init(rq);
 
 		rq_attach_root(rq, &def_root_domain);
 #ifdef CONFIG_NO_HZ_COMMON
@@ -10002,6 +10181,21 @@ static int cpu_weight_nice_write_s64(struct cgroup_subsys_state *css,
 
 	return sched_group_set_shares(css_tg(css), scale_load(weight));
 }
+
+static s64 cpu_latency_nice_read_s64(struct cgroup_subsys_state *css,
+				     struct cftype *cft)
+{
+	return css_tg(css)->latency_nice;
+}
+
+static int cpu_latency_nice_write_s64(struct cgroup_subsys_state *css,
+				      struct cftype *cft, s64 latency_nice)
+{
+	if (latency_nice < MIN_LATENCY_NICE || latency_nice > MAX_LATENCY_NICE)
+		return -ERANGE;
+
+	return sched_group_set_latency(css_tg(css), latency_nice);
+}
 #endif
 
 static void __maybe_unused cpu_period_quota_print(struct seq_file *sf,
@@ -10074,6 +10268,12 @@ static struct cftype cpu_files[] = {
 		.read_s64 = cpu_weight_nice_read_s64,
 		.write_s64 = cpu_weight_nice_write_s64,
 	},
+	{
+		.name = "latency.nice",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -853,9 +853,17 @@ do {									\
 		P(sched_goidle);
 		P(ttwu_count);
 		P(ttwu_local);
+		P(ttwu_llc_ipi);
+		P(ttwu_llc_ipi_needed);
+		P(ttwu_llc_ipi_sent);
 	}
 #undef P
 
+#define PN(n) SEQ_printf(m, "  .%-30s: %Ld.%06ld\n", #n, SPLIT_NS(schedstat_val(rq->n)));
+	if (schedstat_enabled())
+		PN(ttwu_llc_delay);
+#undef PN
+
 	spin_lock_irqsave(&sched_debug_lock, flags);
 
 	print_cfs_stats(m, cpu);
@@ -1231,6 +1239,7 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 #endif
 	P(policy);
 	P(prio);
+	P(latency_nice);
 	if (task_has_dl_policy(p)) {
 		P(dl.runtime);
 		P(dl.deadline);
@@ -44,6 +44,7 @@ static int scx_bypass_depth;
 static bool scx_init_task_enabled;
 static bool scx_switching_all;
 DEFINE_STATIC_KEY_FALSE(__scx_switched_all);
+static DEFINE_STATIC_KEY_FALSE(scx_ops_prof_enabled);
 
 static atomic_long_t scx_nr_rejected = ATOMIC_LONG_INIT(0);
 static atomic_long_t scx_hotplug_seq = ATOMIC_LONG_INIT(0);
@@ -109,6 +110,7 @@ struct scx_dsp_buf_ent {
 	unsigned long		qseq;
 	u64			dsq_id;
 	u64			enq_flags;
+	u64			slice;		/* set once claimed, 0 to keep */
 };
 
 static u32 scx_dsp_max_batch;
@@ -211,6 +213,11 @@ static struct scx_dispatch_q *find_user_dsq(struct scx_sched *sch, u64 dsq_id)
 	return rhashtable_lookup_fast(&sch->dsq_hash, &dsq_id, dsq_hash_params);
 }
 
+static struct scx_dispatch_q *find_llc_dsq(struct scx_sched *sch, s32 cpu)
+{
+	return &per_cpu_ptr(sch->pcpu, per_cpu(sd_llc_id, cpu))->llc_dsq;
+}
+
 /*
  * scx_kf_mask enforcement. Some kfuncs can only be called from specific SCX
  * ops. When invoking SCX ops, SCX_CALL_OP[_RET]() should be used to indicate
@@ -255,8 +262,34 @@ static inline void update_locked_rq(struct rq *rq)
 	__this_cpu_write(scx_locked_rq_state, rq);
 }
 
+/*
+ * Callback overhead accounting for /sys/kernel/debug/sched_ext/ops_prof. Off by
+ * default, when disabled the cost is a patched out branch per callback. The
+ * counters may be updated from a preemptible context and land on a CPU other
+ * than the one which made the call, which is fine for statistics.
+ */
+static __always_inline u64 scx_op_prof_start(void)
+{
+	if (static_branch_unlikely(&scx_ops_prof_enabled))
+		return local_clock();
+	return 0;
+}
+
+static __always_inline void scx_op_prof_end(struct scx_sched *sch, u32 opi,
+					    u64 started_at)
+{
+	/* ops.init() and ops.exit() are outside the profiled range */
+	if (!started_at || opi >= SCX_OPI_END)
+		return;
+
+	this_cpu_inc(sch->pcpu->op_prof[opi].nr_calls);
+	this_cpu_add(sch->pcpu->op_prof[opi].nsecs, local_clock() - started_at);
+}
+
 #define SCX_CALL_OP(sch, mask, op, rq, args...)					\
 do {										\
+	u64 __prof_at = scx_op_prof_start();					\
+										\
 	if (rq)									\
 		update_locked_rq(rq);						\
 	if (mask) {								\
@@ -268,11 +301,13 @@ do {										\
 	}									\
 	if (rq)									\
 		update_locked_rq(NULL);						\
+	scx_op_prof_end((sch), SCX_OP_IDX(op), __prof_at);			\
 } while (0)
 
 #define SCX_CALL_OP_RET(sch, mask, op, rq, args...)				\
 ({										\
 	__typeof__((sch)->ops.op(args)) __ret;					\
+	u64 __prof_at = scx_op_prof_start();					\
 										\
 	if (rq)									\
 		update_locked_rq(rq);						\
@@ -285,6 +320,7 @@ do {										\
 	}									\
 	if (rq)									\
 		update_locked_rq(NULL);						\
+	scx_op_prof_end((sch), SCX_OP_IDX(op), __prof_at);			\
 	__ret;									\
 })
 
@@ -914,8 +950,12 @@ static void refill_task_slice_dfl(struct scx_sched *sch, struct task_struct *p)
 	__scx_add_event(sch, SCX_EV_REFILL_SLICE_DFL, 1);
 }
 
-static void dispatch_enqueue(struct scx_sched *sch, struct scx_dispatch_q *dsq,
-			     struct task_struct *p, u64 enq_flags)
+/*
+ * Queue @p on @dsq. If @dsq is not a local DSQ, the caller must be holding
+ * @dsq->lock and must have verified that @dsq hasn't been destroyed.
+ */
+static void __dispatch_enqueue(struct scx_sched *sch, struct scx_dispatch_q *dsq,
+			       struct task_struct *p, u64 enq_flags)
 {
 	bool is_local = dsq->id == SCX_DSQ_LOCAL;
 
@@ -923,16 +963,8 @@ static void dispatch_enqueue(struct scx_sched *sch, struct scx_dispatch_q *dsq,
 	WARN_ON_ONCE((p->scx.dsq_flags & SCX_TASK_DSQ_ON_PRIQ) ||
 		     !RB_EMPTY_NODE(&p->scx.dsq_priq));
 
-	if (!is_local) {
-		raw_spin_lock(&dsq->lock);
-		if (unlikely(dsq->id == SCX_DSQ_INVALID)) {
-			scx_error(sch, "attempting to dispatch to a destroyed dsq");
-			/* fall back to the global dsq */
-			raw_spin_unlock(&dsq->lock);
-			dsq = find_global_dsq(sch, p);
-			raw_spin_lock(&dsq->lock);
-		}
-	}
+	if (!is_local)
+		lockdep_assert_held(&dsq->lock);
 
 	if (unlikely((dsq->id & SCX_DSQ_FLAG_BUILTIN) &&
 		     (enq_flags & SCX_ENQ_DSQ_PRIQ))) {
@@ -1024,9 +1056,28 @@ static void dispatch_enqueue(struct scx_sched *sch, struct scx_dispatch_q *dsq,
 		if (preempt || sched_class_above(&ext_sched_class,
 						 rq->curr->sched_class))
 			resched_curr(rq);
-	} else {
+	}
+}
+
+static void dispatch_enqueue(struct scx_sched *sch, struct scx_dispatch_q *dsq,
+			     struct task_struct *p, u64 enq_flags)
+{
+	if (dsq->id == SCX_DSQ_LOCAL) {
+		__dispatch_enqueue(sch, dsq, p, enq_flags);
+		return;
+	}
+
+	raw_spin_lock(&dsq->lock);
+	if (unlikely(dsq->id == SCX_DSQ_INVALID)) {
+		scx_error(sch, "attempting to dispatch to a destroyed dsq");
+		/* fall back to the global dsq */
 		raw_spin_unlock(&dsq->lock);
+		dsq = find_global_dsq(sch, p);
+		raw_spin_lock(&dsq->lock);
 	}
+
+	__dispatch_enqueue(sch, dsq, p, enq_flags);
+	raw_spin_unlock(&dsq->lock);
 }
 
 static void task_unlink_from_dsq(struct task_struct *p,
@@ -1113,6 +1164,18 @@ static struct scx_dispatch_q *find_dsq_for_dispatch(struct scx_sched *sch,
 		return &cpu_rq(cpu)->scx.local_dsq;
 	}
 
+	if ((dsq_id & SCX_DSQ_LLC_ON) == SCX_DSQ_LLC_ON) {
+		s32 cpu = dsq_id & SCX_DSQ_LOCAL_CPU_MASK;
+
+		if (!ops_cpu_valid(sch, cpu, "in SCX_DSQ_LLC_ON dispatch verdict"))
+			return find_global_dsq(sch, p);
+
+		return find_llc_dsq(sch, cpu);
+	}
+
+	if (dsq_id == SCX_DSQ_LLC)
+		return find_llc_dsq(sch, task_cpu(p));
+
 	if (dsq_id == SCX_DSQ_GLOBAL)
 		dsq = find_global_dsq(sch, p);
 	else
@@ -1839,6 +1902,64 @@ static bool consume_global_dsq(struct scx_sched *sch, struct rq *rq)
 	return consume_dispatch_q(sch, rq, sch->global_dsqs[node]);
 }
 
+/*
+ * Steal a task from the LLC DSQs of the CPUs in @span, skipping the one of
+ * @rq's own LLC. Every CPU owns a DSQ slot, so walking @span by CPU also
+ * drains DSQs left behind by a topology change. The walk starts after the
+ * current CPU so that the idle CPUs of a node don't all pile onto the same
+ * victim.
+ */
+static bool steal_llc_dsqs(struct scx_sched *sch, struct rq *rq,
+			   const struct cpumask *span)
+{
+	s32 this_cpu = cpu_of(rq), own_llc = per_cpu(sd_llc_id, this_cpu);
+	s32 cpu;
+
+	for_each_cpu_wrap(cpu, span, this_cpu + 1) {
+		struct scx_dispatch_q *dsq = &per_cpu_ptr(sch->pcpu, cpu)->llc_dsq;
+
+		if (cpu == own_llc || !READ_ONCE(dsq->nr))
+			continue;
+
+		if (consume_dispatch_q(sch, rq, dsq)) {
+			__scx_add_event(sch, SCX_EV_LLC_STEAL, 1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Consume from the current CPU's LLC DSQ, then steal as allowed by
+ * %SCX_LLC_STEAL_* @flags: first within the NUMA node, then from the other
+ * nodes in order of node id.
+ */
+static bool consume_llc_dsqs(struct scx_sched *sch, struct rq *rq, u64 flags)
+{
+	int node = cpu_to_node(cpu_of(rq));
+	int n;
+
+	if (consume_dispatch_q(sch, rq, find_llc_dsq(sch, cpu_of(rq))))
+		return true;
+
+	if (!(flags & __SCX_LLC_STEAL_ALL_FLAGS))
+		return false;
+
+	if (steal_llc_dsqs(sch, rq, cpumask_of_node(node)))
+		return true;
+
+	if (!(flags & SCX_LLC_STEAL_ALL))
+		return false;
+
+	for_each_node_state(n, N_CPU) {
+		if (n != node && steal_llc_dsqs(sch, rq, cpumask_of_node(n)))
+			return true;
+	}
+
+	return false;
+}
+
 /**
  * dispatch_to_local_dsq - Dispatch a task to a local dsq
  * @sch: scx_sched being operated on
@@ -1935,34 +2056,15 @@ static void dispatch_to_local_dsq(struct scx_sched *sch, struct rq *rq,
 	}
 }
 
-/**
- * finish_dispatch - Asynchronously finish dispatching a task
- * @rq: current rq which is locked
- * @p: task to finish dispatching
- * @qseq_at_dispatch: qseq when @p started getting dispatched
- * @dsq_id: destination DSQ ID
- * @enq_flags: %SCX_ENQ_*
- *
- * Dispatching to local DSQs may need to wait for queueing to complete or
- * require rq lock dancing. As we don't wanna do either while inside
- * ops.dispatch() to avoid locking order inversion, we split dispatching into
- * two parts. scx_bpf_dsq_insert() which is called by ops.dispatch() records the
- * task and its qseq. Once ops.dispatch() returns, this function is called to
- * finish up.
- *
- * There is no guarantee that @p is still valid for dispatching or even that it
- * was valid in the first place. Make sure that the task is still owned by the
- * BPF scheduler and claim the ownership before dispatching.
+/*
+ * Try to claim @p for dispatching by transitioning it from QUEUED to
+ * DISPATCHING. Returns %false if @p is no longer ours to dispatch.
  */
-static void finish_dispatch(struct scx_sched *sch, struct rq *rq,
-			    struct task_struct *p,
-			    unsigned long qseq_at_dispatch,
-			    u64 dsq_id, u64 enq_flags)
+static bool claim_dispatch(struct task_struct *p,
+			   unsigned long qseq_at_dispatch)
 {
-	struct scx_dispatch_q *dsq;
 	unsigned long opss;
 
-	touch_core_sched_dispatch(rq, p);
 retry:
 	/*
 	 * No need for _acquire here. @p is accessed only after a successful
@@ -1974,7 +2076,7 @@ retry:
 	case SCX_OPSS_DISPATCHING:
 	case SCX_OPSS_NONE:
 		/* someone else already got to it */
-		return;
+		return false;
 	case SCX_OPSS_QUEUED:
 		/*
 		 * If qseq doesn't match, @p has gone through at least one
@@ -1982,7 +2084,7 @@ retry:
 		 * scx_bpf_dsq_insert() and here and we have no claim on it.
 		 */
 		if ((opss & SCX_OPSS_QSEQ_MASK) != qseq_at_dispatch)
-			return;
+			return false;
 
 		/*
 		 * While we know @p is accessible, we don't yet have a claim on
@@ -2007,6 +2109,54 @@ retry:
 	}
 
 	BUG_ON(!(p->scx.flags & SCX_TASK_QUEUED));
+	return true;
+}
+
+/*
+ * Apply the slice of a buffered dispatch. Only valid after claim_dispatch()
+ * succeeded, before that @p may not be ours to touch.
+ */
+static void dispatch_set_slice(struct task_struct *p, u64 slice)
+{
+	if (slice)
+		p->scx.slice = slice;
+	else if (!p->scx.slice)
+		p->scx.slice = 1;
+}
+
+/**
+ * finish_dispatch - Asynchronously finish dispatching a task
+ * @rq: current rq which is locked
+ * @p: task to finish dispatching
+ * @qseq_at_dispatch: qseq when @p started getting dispatched
+ * @dsq_id: destination DSQ ID
+ * @enq_flags: %SCX_ENQ_*
+ * @slice: slice to set once @p is claimed, 0 to keep the current one
+ *
+ * Dispatching to local DSQs may need to wait for queueing to complete or
+ * require rq lock dancing. As we don't wanna do either while inside
+ * ops.dispatch() to avoid locking order inversion, we split dispatching into
+ * two parts. scx_bpf_dsq_insert() which is called by ops.dispatch() records the
+ * task and its qseq. Once ops.dispatch() returns, this function is called to
+ * finish up.
+ *
+ * There is no guarantee that @p is still valid for dispatching or even that it
+ * was valid in the first place. Make sure that the task is still owned by the
+ * BPF scheduler and claim the ownership before dispatching.
+ */
+static void finish_dispatch(struct scx_sched *sch, struct rq *rq,
+			    struct task_struct *p,
+			    unsigned long qseq_at_dispatch,
+			    u64 dsq_id, u64 enq_flags, u64 slice)
+{
+	struct scx_dispatch_q *dsq;
+
+	touch_core_sched_dispatch(rq, p);
+
+	if (!claim_dispatch(p, qseq_at_dispatch))
+		return;
+
+	dispatch_set_slice(p, slice);
 
 	dsq = find_dsq_for_dispatch(sch, this_rq(), dsq_id, p);
 
@@ -2016,16 +2166,80 @@ retry:
 		dispatch_enqueue(sch, dsq, p, enq_flags | SCX_ENQ_CLEAR_OPSS);
 }
 
+/*
+ * Dispatch @nr buffered entries which all target the same user DSQ. The tasks
+ * are claimed first and then queued under a single acquisition of the DSQ lock
+ * instead of one per task. Claimed tasks stay in DISPATCHING until they're
+ * queued, which is no different from finish_dispatch() holding one while
+ * waiting for the DSQ lock.
+ */
+static void finish_dispatch_batch(struct scx_sched *sch, struct rq *rq,
+				  struct scx_dsp_buf_ent *ents, u32 nr)
+{
+	struct scx_dispatch_q *dsq;
+	u32 u, nr_claimed = 0;
+
+	for (u = 0; u < nr; u++) {
+		touch_core_sched_dispatch(rq, ents[u].task);
+		if (claim_dispatch(ents[u].task, ents[u].qseq)) {
+			dispatch_set_slice(ents[u].task, ents[u].slice);
+			nr_claimed++;
+		} else
+			ents[u].task = NULL;
+	}
+
+	if (!nr_claimed)
+		return;
+
+	dsq = find_user_dsq(sch, ents[0].dsq_id);
+	if (likely(dsq)) {
+		raw_spin_lock(&dsq->lock);
+		if (likely(dsq->id != SCX_DSQ_INVALID)) {
+			for (u = 0; u < nr; u++)
+				if (ents[u].task)
+					__dispatch_enqueue(sch, dsq, ents[u].task,
+							   ents[u].enq_flags | SCX_ENQ_CLEAR_OPSS);
+			raw_spin_unlock(&dsq->lock);
+			__scx_add_event(sch, SCX_EV_DISPATCH_BATCHED, nr_claimed);
+			return;
+		}
+		raw_spin_unlock(&dsq->lock);
+	}
+
+	/* missing or destroyed DSQ, let the per-task path report and fall back */
+	for (u = 0; u < nr; u++) {
+		struct task_struct *p = ents[u].task;
+
+		if (p)
+			dispatch_enqueue(sch, find_dsq_for_dispatch(sch, this_rq(),
+								    ents[u].dsq_id, p),
+					 p, ents[u].enq_flags | SCX_ENQ_CLEAR_OPSS);
+	}
+}
+
 static void flush_dispatch_buf(struct scx_sched *sch, struct rq *rq)
 {
 	struct scx_dsp_ctx *dspc = this_cpu_ptr(scx_dsp_ctx);
-	u32 u;
+	u32 u, v;
 
-	for (u = 0; u < dspc->cursor; u++) {
+	for (u = 0; u < dspc->cursor; u = v) {
 		struct scx_dsp_buf_ent *ent = &dspc->buf[u];
 
-		finish_dispatch(sch, rq, ent->task, ent->qseq, ent->dsq_id,
-				ent->enq_flags);
+		/*
+		 * Runs of entries targeting the same user DSQ are queued under
+		 * one lock acquisition. Built-in DSQs may resolve to a different
+		 * queue for each task and are dispatched one by one.
+		 */
+		v = u + 1;
+		if (!(ent->dsq_id & SCX_DSQ_FLAG_BUILTIN))
+			while (v < dspc->cursor && dspc->buf[v].dsq_id == ent->dsq_id)
+				v++;
+
+		if (v - u > 1)
+			finish_dispatch_batch(sch, rq, ent, v - u);
+		else
+			finish_dispatch(sch, rq, ent->task, ent->qseq,
+					ent->dsq_id, ent->enq_flags, ent->slice);
 	}
 
 	dspc->nr_tasks += dspc->cursor;
@@ -2097,6 +2311,10 @@ static int balance_one(struct rq *rq, struct task_struct *prev)
 	if (consume_global_dsq(sch, rq))
 		goto has_tasks;
 
+	if ((sch->ops.flags & SCX_OPS_BUILTIN_LLC_DSQ) && scx_rq_online(rq) &&
+	    consume_llc_dsqs(sch, rq, 0))
+		goto has_tasks;
+
 	if (unlikely(!SCX_HAS_OP(sch, dispatch)) ||
 	    scx_rq_bypassing(rq) || !scx_rq_online(rq))
 		goto no_tasks;
@@ -2126,6 +2344,9 @@ static int balance_one(struct rq *rq, struct task_struct *prev)
 			goto has_tasks;
 		if (consume_global_dsq(sch, rq))
 			goto has_tasks;
+		if ((sch->ops.flags & SCX_OPS_BUILTIN_LLC_DSQ) &&
+		    consume_llc_dsqs(sch, rq, 0))
+			goto has_tasks;
 
 		/*
 		 * ops.dispatch() can trap us in this loop by repeatedly
@@ -2143,6 +2364,14 @@ static int balance_one(struct rq *rq, struct task_struct *prev)
 	} while (dspc->nr_tasks);
 
 no_tasks:
+	/*
+	 * Neither the BPF scheduler nor our own LLC had anything. Before going
+	 * idle, look for work queued on the other LLCs of this node.
+	 */
+	if ((sch->ops.flags & SCX_OPS_BUILTIN_LLC_DSQ) && scx_rq_online(rq) &&
+	    consume_llc_dsqs(sch, rq, SCX_LLC_STEAL_NODE))
+		goto has_tasks;
+
 	/*
 	 * Didn't find another task to run. Keep running @prev unless
 	 * %SCX_OPS_ENQ_LAST is in effect.
@@ -3576,6 +3805,8 @@ static ssize_t scx_attr_events_show(struct kobject *kobj,
 	at += scx_attr_event_show(buf, at, &events, SCX_EV_BYPASS_DURATION);
 	at += scx_attr_event_show(buf, at, &events, SCX_EV_BYPASS_DISPATCH);
 	at += scx_attr_event_show(buf, at, &events, SCX_EV_BYPASS_ACTIVATE);
+	at += scx_attr_event_show(buf, at, &events, SCX_EV_LLC_STEAL);
+	at += scx_attr_event_show(buf, at, &events, SCX_EV_DISPATCH_BATCHED);
 	return at;
 }
 SCX_ATTR(events);
@@ -4376,6 +4607,8 @@ static void scx_dump_state(struct scx_exit_info *ei, size_t dump_len)
 	scx_dump_event(s, &events, SCX_EV_BYPASS_DURATION);
 	scx_dump_event(s, &events, SCX_EV_BYPASS_DISPATCH);
 	scx_dump_event(s, &events, SCX_EV_BYPASS_ACTIVATE);
+	scx_dump_event(s, &events, SCX_EV_LLC_STEAL);
+	scx_dump_event(s, &events, SCX_EV_DISPATCH_BATCHED);
 
 	if (seq_buf_has_overflowed(&s) && dump_len >= sizeof(trunc_marker))
 		memcpy(ei->dump + dump_len - sizeof(trunc_marker),
@@ -4452,7 +4685,7 @@ static int alloc_kick_pseqs(void)
 static struct scx_sched *scx_alloc_and_add_sched(struct sched_ext_ops *ops)
 {
 	struct scx_sched *sch;
-	int node, ret;
+	int node, cpu, ret;
 
 	sch = kzalloc(sizeof(*sch), GFP_KERNEL);
 	if (!sch)
@@ -4492,6 +4725,9 @@ static struct scx_sched *scx_alloc_and_add_sched(struct sched_ext_ops *ops)
 	if (!sch->pcpu)
 		goto err_free_gdsqs;
 
+	for_each_possible_cpu(cpu)
+		init_dsq(&per_cpu_ptr(sch->pcpu, cpu)->llc_dsq, SCX_DSQ_LLC);
+
 	sch->helper = kthread_run_worker(0, "sched_ext_helper");
 	if (IS_ERR(sch->helper)) {
 		ret = PTR_ERR(sch->helper);
@@ -5655,6 +5891,75 @@ __bpf_kfunc void scx_bpf_dispatch_cancel(void)
 		scx_error(sch, "dispatch buffer underflow");
 }
 
+/**
+ * scx_bpf_dsq_insert_pids - Insert a batch of tasks into the FIFO queue of a DSQ
+ * @dsq_id: DSQ to insert into
+ * @pids: PIDs of the tasks to insert
+ * @pids__sz: size of @pids in bytes
+ * @slice: duration the tasks can run for in nsecs, 0 to keep the current value
+ * @enq_flags: SCX_ENQ_*
+ *
+ * Insert the tasks identified by @pids into the DSQ identified by @dsq_id in
+ * array order, as if scx_bpf_dsq_insert() was called on each of them. This
+ * allows a BPF scheduler which keeps its queues as PIDs in a map to drain a
+ * whole batch with one kfunc call instead of a bpf_task_from_pid() and
+ * scx_bpf_dsq_insert() pair per task. PIDs which don't resolve to a task are
+ * skipped. Can only be called from ops.dispatch().
+ *
+ * This function flushes the in-flight dispatches whenever the dispatch buffer
+ * fills up, so @pids may hold more entries than ops.dispatch_max_batch. It may
+ * thus grab rq and DSQ locks and can't be called under any BPF locks. When the
+ * buffer is flushed, consecutive insertions into the same user DSQ are queued
+ * under one acquisition of the DSQ lock. The slice is only applied to tasks
+ * that are still owned by the BPF scheduler when their dispatch is finished.
+ *
+ * Returns the number of tasks inserted.
+ */
+__bpf_kfunc u32 scx_bpf_dsq_insert_pids(u64 dsq_id, const s32 *pids,
+					u32 pids__sz, u64 slice, u64 enq_flags)
+{
+	struct scx_dsp_ctx *dspc = this_cpu_ptr(scx_dsp_ctx);
+	u32 i, nr = pids__sz / sizeof(pids[0]), nr_inserted = 0;
+	struct scx_sched *sch;
+
+	guard(rcu)();
+
+	sch = rcu_dereference(scx_root);
+	if (unlikely(!sch))
+		return 0;
+
+	if (!scx_kf_allowed(sch, SCX_KF_DISPATCH))
+		return 0;
+
+	if (unlikely(enq_flags & __SCX_ENQ_INTERNAL_MASK)) {
+		scx_error(sch, "invalid enq_flags 0x%llx", enq_flags);
+		return 0;
+	}
+
+	for (i = 0; i < nr; i++) {
+		struct task_struct *p;
+
+		if (dspc->cursor >= scx_dsp_max_batch)
+			flush_dispatch_buf(sch, dspc->rq);
+
+		p = find_task_by_pid_ns(pids[i], &init_pid_ns);
+		if (!p)
+			continue;
+
+		/* @p isn't claimed yet, the slice is applied by finish_dispatch() */
+		dspc->buf[dspc->cursor++] = (struct scx_dsp_buf_ent){
+			.task = p,
+			.qseq = atomic_long_read(&p->scx.ops_state) & SCX_OPSS_QSEQ_MASK,
+			.dsq_id = dsq_id,
+			.enq_flags = enq_flags,
+			.slice = slice,
+		};
+		nr_inserted++;
+	}
+
+	return nr_inserted;
+}
+
 /**
  * scx_bpf_dsq_move_to_local - move a task from a DSQ to the current CPU's local DSQ
  * @dsq_id: DSQ to move task from
@@ -5706,6 +6011,51 @@ __bpf_kfunc bool scx_bpf_dsq_move_to_local(u64 dsq_id)
 	}
 }
 
+/**
+ * scx_bpf_llc_move_to_local - move a task from the LLC DSQs to the local DSQ
+ * @flags: %SCX_LLC_STEAL_* flags
+ *
+ * Move a task from the current CPU's %SCX_DSQ_LLC to its local DSQ. If that is
+ * empty, steal from the LLC DSQs of the same NUMA node if @flags has
+ * %SCX_LLC_STEAL_NODE, and from all other nodes as well with
+ * %SCX_LLC_STEAL_ALL. Can only be called from ops.dispatch().
+ *
+ * Like scx_bpf_dsq_move_to_local(), this flushes the in-flight dispatches and
+ * may grab rq locks, so it can't be called under any BPF locks.
+ *
+ * Returns %true if a task has been moved, %false if there isn't any task to
+ * move.
+ */
+__bpf_kfunc bool scx_bpf_llc_move_to_local(u64 flags)
+{
+	struct scx_dsp_ctx *dspc = this_cpu_ptr(scx_dsp_ctx);
+	struct scx_sched *sch;
+
+	guard(rcu)();
+
+	sch = rcu_dereference(scx_root);
+	if (unlikely(!sch))
+		return false;
+
+	if (!scx_kf_allowed(sch, SCX_KF_DISPATCH))
+		return false;
+
+	if (unlikely(flags & ~__SCX_LLC_STEAL_ALL_FLAGS)) {
+		scx_error(sch, "invalid LLC steal flags 0x%llx", flags);
+		return false;
+	}
+
+	flush_dispatch_buf(sch, dspc->rq);
+
+	if (consume_llc_dsqs(sch, dspc->rq, flags)) {
+		/* see scx_bpf_dsq_move_to_local() */
+		dspc->nr_tasks++;
+		return true;
+	} else {
+		return false;
+	}
+}
+
 /**
  * scx_bpf_dsq_move_set_slice - Override slice when moving between DSQs
  * @it__iter: DSQ iterator in progress
@@ -5805,7 +6155,9 @@ __bpf_kfunc_end_defs();
 BTF_KFUNCS_START(scx_kfunc_ids_dispatch)
 BTF_ID_FLAGS(func, scx_bpf_dispatch_nr_slots)
 BTF_ID_FLAGS(func, scx_bpf_dispatch_cancel)
+BTF_ID_FLAGS(func, scx_bpf_dsq_insert_pids)
 BTF_ID_FLAGS(func, scx_bpf_dsq_move_to_local)
+BTF_ID_FLAGS(func, scx_bpf_llc_move_to_local)
 BTF_ID_FLAGS(func, scx_bpf_dsq_move_set_slice, KF_RCU)
 BTF_ID_FLAGS(func, scx_bpf_dsq_move_set_vtime, KF_RCU)
 BTF_ID_FLAGS(func, scx_bpf_dsq_move, KF_RCU)
@@ -6058,6 +6410,16 @@ __bpf_kfunc s32 scx_bpf_dsq_nr_queued(u64 dsq_id)
 			ret = READ_ONCE(cpu_rq(cpu)->scx.local_dsq.nr);
 			goto out;
 		}
+	} else if (dsq_id == SCX_DSQ_LLC) {
+		ret = READ_ONCE(find_llc_dsq(sch, smp_processor_id())->nr);
+		goto out;
+	} else if ((dsq_id & SCX_DSQ_LLC_ON) == SCX_DSQ_LLC_ON) {
+		s32 cpu = dsq_id & SCX_DSQ_LOCAL_CPU_MASK;
+
+		if (ops_cpu_valid(sch, cpu, NULL)) {
+			ret = READ_ONCE(find_llc_dsq(sch, cpu)->nr);
+			goto out;
+		}
 	} else {
 		dsq = find_user_dsq(sch, dsq_id);
 		if (dsq) {
@@ -6125,7 +6487,16 @@ __bpf_kfunc int bpf_iter_scx_dsq_new(struct bpf_iter_scx_dsq *it, u64 dsq_id,
 	if (flags & ~__SCX_DSQ_ITER_USER_FLAGS)
 		return -EINVAL;
 
-	kit->dsq = find_user_dsq(sch, dsq_id);
+	/* LLC DSQs can be walked so that BPF can pick its own steal victims */
+	if ((dsq_id & SCX_DSQ_LLC_ON) == SCX_DSQ_LLC_ON) {
+		s32 cpu = dsq_id & SCX_DSQ_LOCAL_CPU_MASK;
+
+		if (!__cpu_valid(cpu))
+			return -EINVAL;
+		kit->dsq = find_llc_dsq(sch, cpu);
+	} else {
+		kit->dsq = find_user_dsq(sch, dsq_id);
+	}
 	if (!kit->dsq)
 		return -ENOENT;
 
@@ -6485,6 +6856,22 @@ __bpf_kfunc u32 scx_bpf_nr_cpu_ids(void)
 	return nr_cpu_ids;
 }
 
+/**
+ * scx_bpf_cpu_llc - Return the LLC ID of a CPU
+ * @cpu: target CPU
+ *
+ * The LLC ID is the lowest numbered CPU sharing the last level cache with
+ * @cpu, so %SCX_DSQ_LLC_ON | scx_bpf_cpu_llc(@cpu) names the LLC DSQ @cpu
+ * consumes from. Returns -%EINVAL if @cpu is invalid.
+ */
+__bpf_kfunc s32 scx_bpf_cpu_llc(s32 cpu)
+{
+	if (!__cpu_valid(cpu))
+		return -EINVAL;
+
+	return per_cpu(sd_llc_id, cpu);
+}
+
 /**
  * scx_bpf_get_possible_cpumask - Get a referenced kptr to cpu_possible_mask
  */
@@ -6723,6 +7110,8 @@ static void scx_read_events(struct scx_sched *sch, struct scx_event_stats *event
 		scx_agg_event(events, e_cpu, SCX_EV_BYPASS_DURATION);
 		scx_agg_event(events, e_cpu, SCX_EV_BYPASS_DISPATCH);
 		scx_agg_event(events, e_cpu, SCX_EV_BYPASS_ACTIVATE);
+		scx_agg_event(events, e_cpu, SCX_EV_LLC_STEAL);
+		scx_agg_event(events, e_cpu, SCX_EV_DISPATCH_BATCHED);
 	}
 }
 
@@ -6773,6 +7162,7 @@ BTF_ID_FLAGS(func, scx_bpf_cpuperf_cur)
 BTF_ID_FLAGS(func, scx_bpf_cpuperf_set)
 BTF_ID_FLAGS(func, scx_bpf_nr_node_ids)
 BTF_ID_FLAGS(func, scx_bpf_nr_cpu_ids)
+BTF_ID_FLAGS(func, scx_bpf_cpu_llc)
 BTF_ID_FLAGS(func, scx_bpf_get_possible_cpumask, KF_ACQUIRE)
 BTF_ID_FLAGS(func, scx_bpf_get_online_cpumask, KF_ACQUIRE)
 BTF_ID_FLAGS(func, scx_bpf_put_cpumask, KF_RELEASE)
@@ -6793,6 +7183,153 @@ static const struct btf_kfunc_id_set scx_kfunc_set_any = {
 	.set			= &scx_kfunc_ids_any,
 };
 
+/*
+ * /sys/kernel/debug/sched_ext/ops_prof
+ *
+ * Write 1 to reset the counters and start accounting the time the current BPF
+ * scheduler spends in its callbacks, 0 to stop. Reading shows the totals for
+ * each callback and for each CPU.
+ */
+#define SCX_OP_NAME(op)		[SCX_OP_IDX(op)] = #op
+
+static const char *scx_op_names[SCX_OPI_END] = {
+	SCX_OP_NAME(select_cpu),
+	SCX_OP_NAME(enqueue),
+	SCX_OP_NAME(dequeue),
+	SCX_OP_NAME(dispatch),
+	SCX_OP_NAME(tick),
+	SCX_OP_NAME(runnable),
+	SCX_OP_NAME(running),
+	SCX_OP_NAME(stopping),
+	SCX_OP_NAME(quiescent),
+	SCX_OP_NAME(yield),
+	SCX_OP_NAME(core_sched_before),
+	SCX_OP_NAME(set_weight),
+	SCX_OP_NAME(set_cpumask),
+	SCX_OP_NAME(update_idle),
+	SCX_OP_NAME(cpu_acquire),
+	SCX_OP_NAME(cpu_release),
+	SCX_OP_NAME(init_task),
+	SCX_OP_NAME(exit_task),
+	SCX_OP_NAME(enable),
+	SCX_OP_NAME(disable),
+	SCX_OP_NAME(dump),
+	SCX_OP_NAME(dump_cpu),
+	SCX_OP_NAME(dump_task),
+#ifdef CONFIG_EXT_GROUP_SCHED
+	SCX_OP_NAME(cgroup_init),
+	SCX_OP_NAME(cgroup_exit),
+	SCX_OP_NAME(cgroup_prep_move),
+	SCX_OP_NAME(cgroup_move),
+	SCX_OP_NAME(cgroup_cancel_move),
+	SCX_OP_NAME(cgroup_set_weight),
+	SCX_OP_NAME(cgroup_set_bandwidth),
+#endif
+	SCX_OP_NAME(cpu_online),
+	SCX_OP_NAME(cpu_offline),
+};
+
+#undef SCX_OP_NAME
+
+static int scx_ops_prof_show(struct seq_file *m, void *v)
+{
+	struct scx_sched *sch;
+	int cpu, opi;
+
+	guard(mutex)(&scx_enable_mutex);
+
+	seq_printf(m, "enabled: %d\n", static_key_enabled(&scx_ops_prof_enabled));
+
+	sch = rcu_dereference_protected(scx_root,
+					lockdep_is_held(&scx_enable_mutex));
+	if (!sch)
+		return 0;
+
+	seq_printf(m, "sched: %s\n\n", sch->ops.name);
+	seq_printf(m, "%-24s %14s %18s %10s\n",
+		   "op", "calls", "nsecs", "avg");
+
+	for (opi = 0; opi < SCX_OPI_END; opi++) {
+		u64 nr_calls = 0, nsecs = 0;
+
+		for_each_possible_cpu(cpu) {
+			struct scx_op_prof *prof =
+				&per_cpu_ptr(sch->pcpu, cpu)->op_prof[opi];
+
+			nr_calls += READ_ONCE(prof->nr_calls);
+			nsecs += READ_ONCE(prof->nsecs);
+		}
+
+		if (!nr_calls || !scx_op_names[opi])
+			continue;
+
+		seq_printf(m, "%-24s %14llu %18llu %10llu\n", scx_op_names[opi],
+			   nr_calls, nsecs, div64_u64(nsecs, nr_calls));
+	}
+
+	seq_printf(m, "\n%-24s %14s %18s\n", "cpu", "calls", "nsecs");
+
+	for_each_possible_cpu(cpu) {
+		u64 nr_calls = 0, nsecs = 0;
+
+		for (opi = 0; opi < SCX_OPI_END; opi++) {
+			struct scx_op_prof *prof =
+				&per_cpu_ptr(sch->pcpu, cpu)->op_prof[opi];
+
+			nr_calls += READ_ONCE(prof->nr_calls);
+			nsecs += READ_ONCE(prof->nsecs);
+		}
+
+		if (nr_calls)
+			seq_printf(m, "%-24d %14llu %18llu\n", cpu, nr_calls, nsecs);
+	}
+
+	return 0;
+}
+
+static ssize_t scx_ops_prof_write(struct file *file, const char __user *ubuf,
+				  size_t cnt, loff_t *ppos)
+{
+	struct scx_sched *sch;
+	bool enable;
+	int cpu, ret;
+
+	ret = kstrtobool_from_user(ubuf, cnt, &enable);
+	if (ret)
+		return ret;
+
+	guard(mutex)(&scx_enable_mutex);
+
+	if (!enable) {
+		static_branch_disable(&scx_ops_prof_enabled);
+		return cnt;
+	}
+
+	sch = rcu_dereference_protected(scx_root,
+					lockdep_is_held(&scx_enable_mutex));
+	if (sch) {
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(sch->pcpu, cpu)->op_prof, 0,
+			       sizeof(per_cpu_ptr(sch->pcpu, cpu)->op_prof));
+	}
+
+	static_branch_enable(&scx_ops_prof_enabled);
+	return cnt;
+}
+
+static int scx_ops_prof_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, scx_ops_prof_show, NULL);
+}
+
+static const struct file_operations scx_ops_prof_fops = {
+	.open		= scx_ops_prof_open,
+	.read		= seq_read,
+	.write		= scx_ops_prof_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /**
  * sched-ext 初始化
  */
@@ -6861,6 +7398,9 @@ static int __init scx_init(void)
 		return ret;
 	}
 
+	debugfs_create_file("ops_prof", 0644, debugfs_create_dir("sched_ext", NULL),
+			    NULL, &scx_ops_prof_fops);
+
 	return 0;
 }
 __initcall(scx_init);
@@ -169,6 +169,15 @@ enum scx_ops_flags {
 	 */
 	SCX_OPS_BUILTIN_IDLE_PER_NODE	= 1LLU << 6,
 
+	/*
+	 * If set, the per-LLC DSQs (%SCX_DSQ_LLC) are consumed by the core
+	 * without help from ops.dispatch(): a CPU takes from its own LLC's DSQ
+	 * before calling ops.dispatch() and, if it is still left without a
+	 * task, steals from the other LLC DSQs of its NUMA node. If clear, the
+	 * BPF scheduler consumes them with scx_bpf_llc_move_to_local().
+	 */
+	SCX_OPS_BUILTIN_LLC_DSQ		= 1LLU << 7,
+
 	/*
 	 * CPU cgroup support flags
 	 */
@@ -181,6 +190,7 @@ enum scx_ops_flags {
 					  SCX_OPS_ALLOW_QUEUED_WAKEUP |
 					  SCX_OPS_SWITCH_PARTIAL |
 					  SCX_OPS_BUILTIN_IDLE_PER_NODE |
+					  SCX_OPS_BUILTIN_LLC_DSQ |
 					  SCX_OPS_HAS_CGROUP_WEIGHT,
 
 	/* high 8 bits are internal, don't include in SCX_OPS_ALL_FLAGS */
@@ -879,6 +889,27 @@ struct scx_event_stats {
 	 * The number of times the bypassing mode has been activated.
 	 */
 	s64		SCX_EV_BYPASS_ACTIVATE;
+
+	/*
+	 * The number of tasks a CPU moved to its local DSQ from the per-LLC
+	 * DSQ of another LLC because its own was empty.
+	 */
+	s64		SCX_EV_LLC_STEAL;
+
+	/*
+	 * The number of tasks which were moved to a user DSQ as part of a run
+	 * of dispatches queued under a single acquisition of the DSQ lock.
+	 */
+	s64		SCX_EV_DISPATCH_BATCHED;
+};
+
+/*
+ * Time spent in one scx_ops callback on a CPU. Only updated while
+ * /sys/kernel/debug/sched_ext/ops_prof is enabled, see SCX_CALL_OP().
+ */
+struct scx_op_prof {
+	u64			nr_calls;
+	u64			nsecs;
 };
 
 struct scx_sched_pcpu {
@@ -888,6 +919,18 @@ struct scx_sched_pcpu {
 	 * constructed when requested by scx_bpf_events().
 	 */
 	struct scx_event_stats	event_stats;
+
+	/* BPF callback overhead, indexed by SCX_OP_IDX() */
+	struct scx_op_prof	op_prof[SCX_OPI_END];
+
+	/*
+	 * Per-LLC DSQ (%SCX_DSQ_LLC). Every CPU has one but only the one of the
+	 * CPU named by sd_llc_id is used, see find_llc_dsq(). Keeping one per
+	 * CPU means a topology change never leaves a DSQ without storage. It is
+	 * locked by every CPU of the LLC, keep it off the event counters'
+	 * cacheline.
+	 */
+	struct scx_dispatch_q	llc_dsq ____cacheline_aligned_in_smp;
 };
 
 struct scx_sched {
@@ -990,6 +1033,22 @@ enum scx_pick_idle_cpu_flags {
 	SCX_PICK_IDLE_IN_NODE	= 1LLU << 1,	/* pick a CPU in the same target NUMA node */
 };
 
+enum scx_llc_steal_flags {
+	/*
+	 * Let scx_bpf_llc_move_to_local() steal from the other LLC DSQs of the
+	 * current CPU's NUMA node when its own LLC DSQ is empty.
+	 */
+	SCX_LLC_STEAL_NODE	= 1LLU << 0,
+
+	/*
+	 * After the NUMA node, also steal from the LLC DSQs of other nodes.
+	 * Implies %SCX_LLC_STEAL_NODE.
+	 */
+	SCX_LLC_STEAL_ALL	= 1LLU << 1,
+
+	__SCX_LLC_STEAL_ALL_FLAGS = SCX_LLC_STEAL_NODE | SCX_LLC_STEAL_ALL,
+};
+
 enum scx_kick_flags {
 	/*
 	 * Kick the target CPU if idle. Guarantees that the target CPU goes
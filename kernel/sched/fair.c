@@ -5164,6 +5164,9 @@ void __refill_cfs_bandwidth_runtime(struct cfs_bandwidth *cfs_b)
 {
 	if (cfs_b->quota != RUNTIME_INF)
 		cfs_b->runtime = cfs_b->quota;
+
+	/* whatever the node pools still hold belongs to the previous period */
+	WRITE_ONCE(cfs_b->pool_gen, cfs_b->pool_gen + 1);
 }
 
 static inline struct cfs_bandwidth *tg_cfs_bandwidth(struct task_group *tg)
@@ -5199,12 +5202,143 @@ static int __assign_cfs_rq_runtime(struct cfs_bandwidth *cfs_b,
 	return cfs_rq->runtime_remaining > 0;
 }
 
+static inline struct cfs_bandwidth_pool *cfs_rq_bw_pool(struct cfs_rq *cfs_rq)
+{
+	if (!sched_feat(CFS_BW_POOL))
+		return NULL;
+
+	return cfs_rq->bw_pool;
+}
+
+/* drop runtime a pool cached during an earlier period; requires pool->lock */
+static inline void cfs_pool_expire(struct cfs_bandwidth_pool *pool,
+				   unsigned int gen)
+{
+	if (pool->gen != gen) {
+		pool->runtime = 0;
+		pool->gen = gen;
+	}
+}
+
+/*
+ * How much runtime a node pool pulls out of cfs_b->runtime at once: enough
+ * for each CPU of the node to take one slice, but no more than the node's
+ * share of the quota so that small quotas are not stranded on one node.
+ *
+ * requires cfs_b->lock
+ */
+static u64 cfs_pool_batch(struct cfs_bandwidth *cfs_b, int node)
+{
+	u64 slice = sched_cfs_bandwidth_slice();
+	u64 batch = slice * max_t(unsigned int, nr_cpus_node(node), 1);
+	u64 share = div_u64(cfs_b->quota, num_online_nodes());
+
+	return max(min(batch, share), slice);
+}
+
+/*
+ * Same as __assign_cfs_rq_runtime() but served from the node pool, so that
+ * cfs_b->lock is only taken once per batch instead of once per slice.
+ *
+ * returns 0 on failure to allocate runtime
+ */
+static int __assign_cfs_rq_runtime_pool(struct cfs_bandwidth *cfs_b,
+					struct cfs_bandwidth_pool *pool,
+					struct cfs_rq *cfs_rq, u64 target_runtime)
+{
+	u64 min_amount, amount;
+
+	lockdep_assert_held(&pool->lock);
+
+	/* note: this is a positive sum as runtime_remaining <= 0 */
+	min_amount = target_runtime - cfs_rq->runtime_remaining;
+
+	cfs_pool_expire(pool, READ_ONCE(cfs_b->pool_gen));
+
+	if (pool->runtime < min_amount) {
+		raw_spin_lock(&cfs_b->lock);
+		if (cfs_b->quota == RUNTIME_INF) {
+			raw_spin_unlock(&cfs_b->lock);
+			cfs_rq->runtime_remaining += min_amount;
+			return 1;
+		}
+
+		start_cfs_bandwidth(cfs_b);
+
+		/* the period may have been refilled since we looked */
+		cfs_pool_expire(pool, cfs_b->pool_gen);
+		pool->batch = cfs_pool_batch(cfs_b, pool->node);
+
+		if (cfs_b->runtime > 0) {
+			amount = max(pool->batch, min_amount - pool->runtime);
+			amount = min(cfs_b->runtime, amount);
+			cfs_b->runtime -= amount;
+			cfs_b->idle = 0;
+			pool->runtime += amount;
+		}
+		raw_spin_unlock(&cfs_b->lock);
+	} else if (READ_ONCE(cfs_b->idle)) {
+		/*
+		 * Being served from the pool is activity as well; keep the
+		 * period timer from going idle. Racing with the timer setting
+		 * it again at most costs one extra period.
+		 */
+		WRITE_ONCE(cfs_b->idle, 0);
+	}
+
+	amount = min(pool->runtime, min_amount);
+	pool->runtime -= amount;
+	cfs_rq->runtime_remaining += amount;
+
+	return cfs_rq->runtime_remaining > 0;
+}
+
+/*
+ * Pull whatever the node pools cached during this period back into
+ * cfs_b->runtime so that distribute_cfs_runtime() can hand it to throttled
+ * cfs_rqs on any node.
+ */
+static void reclaim_cfs_pool_runtime(struct cfs_bandwidth *cfs_b)
+{
+	struct cfs_bandwidth_pool *pool;
+	unsigned long flags;
+	int node;
+
+	if (!cfs_b->pools)
+		return;
+
+	for_each_node(node) {
+		pool = cfs_b->pools[node];
+		if (!pool || !READ_ONCE(pool->runtime))
+			continue;
+
+		raw_spin_lock_irqsave(&pool->lock, flags);
+		raw_spin_lock(&cfs_b->lock);
+		cfs_pool_expire(pool, cfs_b->pool_gen);
+		if (cfs_b->quota != RUNTIME_INF)
+			cfs_b->runtime += pool->runtime;
+		pool->runtime = 0;
+		raw_spin_unlock(&cfs_b->lock);
+		raw_spin_unlock_irqrestore(&pool->lock, flags);
+	}
+}
+
 /* returns 0 on failure to allocate runtime */
 static int assign_cfs_rq_runtime(struct cfs_rq *cfs_rq)
 {
 	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
+	struct cfs_bandwidth_pool *pool = cfs_rq_bw_pool(cfs_rq);
 	int ret;
 
+	if (pool) {
+		raw_spin_lock(&pool->lock);
+		ret = __assign_cfs_rq_runtime_pool(cfs_b, pool, cfs_rq,
+						   sched_cfs_bandwidth_slice());
+		raw_spin_unlock(&pool->lock);
+
+		return ret;
+	}
+
 	raw_spin_lock(&cfs_b->lock);
 	ret = __assign_cfs_rq_runtime(cfs_b, cfs_rq, sched_cfs_bandwidth_slice());
 	raw_spin_unlock(&cfs_b->lock);
@@ -5304,9 +5438,22 @@ static bool throttle_cfs_rq(struct cfs_rq *cfs_rq)
 {
 	struct rq *rq = rq_of(cfs_rq);
 	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
+	struct cfs_bandwidth_pool *pool = cfs_rq_bw_pool(cfs_rq);
 	struct sched_entity *se;
 	long task_delta, idle_task_delta, dequeue = 1;
 
+	if (pool) {
+		int ret;
+
+		/* same 1ns request as below, see the comment there */
+		raw_spin_lock(&pool->lock);
+		ret = __assign_cfs_rq_runtime_pool(cfs_b, pool, cfs_rq, 1);
+		raw_spin_unlock(&pool->lock);
+
+		if (ret)
+			return false;
+	}
+
 	raw_spin_lock(&cfs_b->lock);
 	/* This will start the period timer if necessary */
 	if (__assign_cfs_rq_runtime(cfs_b, cfs_rq, 1)) {
@@ -5396,6 +5543,12 @@ void unthrottle_cfs_rq(struct cfs_rq *cfs_rq)
 
 	cfs_rq->throttled = 0;
 
+#ifdef CONFIG_SMP
+	/* unthrottled directly while an async unthrottle was still pending */
+	if (!list_empty(&cfs_rq->throttled_csd_list))
+		list_del_init(&cfs_rq->throttled_csd_list);
+#endif
+
 	update_rq_clock(rq);
 
 	raw_spin_lock(&cfs_b->lock);
@@ -5484,6 +5637,68 @@ unthrottle_throttle:
 		resched_curr(rq);
 }
 
+#ifdef CONFIG_SMP
+/*
+ * IPI handler: unthrottle every cfs_rq that distribute_cfs_runtime() already
+ * funded for this CPU, for all task groups, with a single rq->lock round.
+ */
+void __cfsb_csd_unthrottle(void *arg)
+{
+	struct cfs_rq *cursor, *tmp;
+	struct rq *rq = arg;
+	struct rq_flags rf;
+
+	rq_lock(rq, &rf);
+
+	/*
+	 * Pairs with sched_free_group_rcu(): the group cannot be freed
+	 * between unlinking a cfs_rq and advancing to the next one.
+	 */
+	rcu_read_lock();
+	list_for_each_entry_safe(cursor, tmp, &rq->cfsb_csd_list,
+				 throttled_csd_list) {
+		list_del_init(&cursor->throttled_csd_list);
+
+		if (cfs_rq_throttled(cursor))
+			unthrottle_cfs_rq(cursor);
+	}
+	rcu_read_unlock();
+
+	rq_unlock(rq, &rf);
+}
+
+/*
+ * Hand a funded cfs_rq to its own CPU. Only the first cfs_rq queued on an
+ * empty list sends the IPI; the rest ride along in the same batch.
+ *
+ * requires rq->lock of the cfs_rq
+ */
+static inline void __unthrottle_cfs_rq_async(struct cfs_rq *cfs_rq)
+{
+	struct rq *rq = rq_of(cfs_rq);
+	bool first;
+
+	if (rq == this_rq()) {
+		unthrottle_cfs_rq(cfs_rq);
+		return;
+	}
+
+	/* Already enqueued */
+	if (SCHED_WARN_ON(!list_empty(&cfs_rq->throttled_csd_list)))
+		return;
+
+	first = list_empty(&rq->cfsb_csd_list);
+	list_add_tail(&cfs_rq->throttled_csd_list, &rq->cfsb_csd_list);
+	if (first)
+		smp_call_function_single_async(cpu_of(rq), &rq->cfsb_csd);
+}
+#else
+static inline void __unthrottle_cfs_rq_async(struct cfs_rq *cfs_rq)
+{
+	unthrottle_cfs_rq(cfs_rq);
+}
+#endif
+
 /**
  * 用于分发 tg->cfs_b 的全局运行时间 runtime，用于在该 task_group 中平衡
  * 各个CPU上的 cfs_rq 的运行时间 runtime，示意图：
@@ -5504,11 +5719,18 @@ unthrottle_throttle:
  * * 系统中两个CPU，因此 task_group 针对每个cpu都维护了一个 cfs_rq，这些 cfs_rq
  *   来共享该 task_group 的限额运行时间；
  * * CPU0上的运行时间，超额了，那么在下一个周期的定时器点上会进行弥补处理；
+ * * 这里只在远端 rq->lock 下分配 runtime，真正的 enqueue 由目标 CPU 在
+ *   __cfsb_csd_unthrottle() 中完成，各 CPU 并行解除限流；
+ *
+ * Returns true if some cfs_rq is still waiting for runtime.
  */
-static void distribute_cfs_runtime(struct cfs_bandwidth *cfs_b)
+static bool distribute_cfs_runtime(struct cfs_bandwidth *cfs_b)
 {
 	struct cfs_rq *cfs_rq;
 	u64 runtime, remaining = 1;
+	bool throttled = false;
+
+	reclaim_cfs_pool_runtime(cfs_b);
 
 	rcu_read_lock();
 	list_for_each_entry_rcu(cfs_rq, &cfs_b->throttled_cfs_rq,
@@ -5516,11 +5738,22 @@ static void distribute_cfs_runtime(struct cfs_bandwidth *cfs_b)
 		struct rq *rq = rq_of(cfs_rq);
 		struct rq_flags rf;
 
+		if (!remaining) {
+			throttled = true;
+			break;
+		}
+
 		rq_lock_irqsave(rq, &rf);
 		if (!cfs_rq_throttled(cfs_rq))
 			goto next;
 
-		/* By the above check, this should never be true */
+#ifdef CONFIG_SMP
+		/* Already funded and queued for its CPU to unthrottle */
+		if (!list_empty(&cfs_rq->throttled_csd_list))
+			goto next;
+#endif
+
+		/* By the above checks, this should never be true */
 		SCHED_WARN_ON(cfs_rq->runtime_remaining > 0);
 
 		raw_spin_lock(&cfs_b->lock);
@@ -5535,15 +5768,16 @@ static void distribute_cfs_runtime(struct cfs_bandwidth *cfs_b)
 
 		/* we check whether we're throttled above */
 		if (cfs_rq->runtime_remaining > 0)
-			unthrottle_cfs_rq(cfs_rq);
+			__unthrottle_cfs_rq_async(cfs_rq);
+		else
+			throttled = true;
 
 next:
 		rq_unlock_irqrestore(rq, &rf);
-
-		if (!remaining)
-			break;
 	}
 	rcu_read_unlock();
+
+	return throttled;
 }
 
 /*
@@ -5591,10 +5825,8 @@ static int do_sched_cfs_period_timer(struct cfs_bandwidth *cfs_b,
 	while (throttled && cfs_b->runtime > 0) {
 		raw_spin_unlock_irqrestore(&cfs_b->lock, flags);
 		/* we can't nest cfs_b->lock while distributing bandwidth */
-		distribute_cfs_runtime(cfs_b);
+		throttled = distribute_cfs_runtime(cfs_b);
 		raw_spin_lock_irqsave(&cfs_b->lock, flags);
-
-		throttled = !list_empty(&cfs_b->throttled_cfs_rq);
 	}
 
 	/*
@@ -5663,15 +5895,59 @@ static void start_cfs_slack_bandwidth(struct cfs_bandwidth *cfs_b)
 			HRTIMER_MODE_REL);
 }
 
+/*
+ * Slack goes back to the node pool first. Only what exceeds one batch, or
+ * all of it while some cfs_rq sits on the throttled list, is pushed on to
+ * cfs_b where the slack timer can redistribute it.
+ */
+static void __return_pool_runtime(struct cfs_bandwidth *cfs_b,
+				  struct cfs_bandwidth_pool *pool,
+				  u64 slack_runtime)
+{
+	u64 excess = 0;
+
+	raw_spin_lock(&pool->lock);
+	cfs_pool_expire(pool, READ_ONCE(cfs_b->pool_gen));
+	pool->runtime += slack_runtime;
+
+	/* racy peek, the slack timer re-checks under cfs_b->lock */
+	if (!list_empty(&cfs_b->throttled_cfs_rq))
+		excess = pool->runtime;
+	else if (pool->runtime > pool->batch)
+		excess = pool->runtime - pool->batch;
+
+	if (excess) {
+		raw_spin_lock(&cfs_b->lock);
+		if (cfs_b->quota != RUNTIME_INF) {
+			cfs_b->runtime += excess;
+
+			/* we are under rq->lock, defer unthrottling using a timer */
+			if (cfs_b->runtime > sched_cfs_bandwidth_slice() &&
+			    !list_empty(&cfs_b->throttled_cfs_rq))
+				start_cfs_slack_bandwidth(cfs_b);
+		}
+		raw_spin_unlock(&cfs_b->lock);
+		pool->runtime -= excess;
+	}
+	raw_spin_unlock(&pool->lock);
+}
+
 /* we know any runtime found here is valid as update_curr() precedes return */
 static void __return_cfs_rq_runtime(struct cfs_rq *cfs_rq)
 {
 	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
+	struct cfs_bandwidth_pool *pool = cfs_rq_bw_pool(cfs_rq);
 	s64 slack_runtime = cfs_rq->runtime_remaining - min_cfs_rq_runtime;
 
 	if (slack_runtime <= 0)
 		return;
 
+	if (pool) {
+		__return_pool_runtime(cfs_b, pool, slack_runtime);
+		cfs_rq->runtime_remaining -= slack_runtime;
+		return;
+	}
+
 	raw_spin_lock(&cfs_b->lock);
 	if (cfs_b->quota != RUNTIME_INF) {
 		cfs_b->runtime += slack_runtime;
@@ -5913,6 +6189,50 @@ static void init_cfs_rq_runtime(struct cfs_rq *cfs_rq)
 {
 	cfs_rq->runtime_enabled = 0;
 	INIT_LIST_HEAD(&cfs_rq->throttled_list);
+	cfs_rq->bw_pool = NULL;
+#ifdef CONFIG_SMP
+	INIT_LIST_HEAD(&cfs_rq->throttled_csd_list);
+#endif
+}
+
+/**
+ * 为任务组的每个 NUMA 节点分配运行时间池，root_task_group 不需要
+ */
+static int alloc_cfs_bandwidth_pools(struct cfs_bandwidth *cfs_b)
+{
+	struct cfs_bandwidth_pool *pool;
+	int node;
+
+	cfs_b->pools = kcalloc(nr_node_ids, sizeof(*cfs_b->pools), GFP_KERNEL);
+	if (!cfs_b->pools)
+		return 0;
+
+	for_each_node(node) {
+		pool = kzalloc_node(sizeof(*pool), GFP_KERNEL,
+				    node_state(node, N_NORMAL_MEMORY) ?
+				    node : NUMA_NO_NODE);
+		if (!pool)
+			return 0;
+
+		raw_spin_lock_init(&pool->lock);
+		pool->node = node;
+		cfs_b->pools[node] = pool;
+	}
+
+	return 1;
+}
+
+static void free_cfs_bandwidth_pools(struct cfs_bandwidth *cfs_b)
+{
+	int node;
+
+	if (!cfs_b->pools)
+		return;
+
+	for_each_node(node)
+		kfree(cfs_b->pools[node]);
+	kfree(cfs_b->pools);
+	cfs_b->pools = NULL;
 }
 
 /**
@@ -5932,12 +6252,35 @@ void start_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
 
 static void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
 {
+	int __maybe_unused i;
+
 	/* init_cfs_bandwidth() was not called */
 	if (!cfs_b->throttled_cfs_rq.next)
 		return;
 
 	hrtimer_cancel(&cfs_b->period_timer);
 	hrtimer_cancel(&cfs_b->slack_timer);
+
+#ifdef CONFIG_SMP
+	/*
+	 * A cfs_rq of this group may still sit on some CPU's csd list if the
+	 * last task left while the period timer had just queued it. No new
+	 * ones can be queued now, so flush whatever is pending inline.
+	 */
+	for_each_possible_cpu(i) {
+		struct rq *rq = cpu_rq(i);
+		unsigned long flags;
+
+		if (list_empty(&rq->cfsb_csd_list))
+			continue;
+
+		local_irq_save(flags);
+		__cfsb_csd_unthrottle(rq);
+		local_irq_restore(flags);
+	}
+#endif
+
+	free_cfs_bandwidth_pools(cfs_b);
 }
 
 /*
@@ -6851,6 +7194,22 @@ static int select_idle_smt(struct task_struct *p, struct sched_domain *sd, int t
 
 #endif /* CONFIG_SCHED_SMT */
 
+/*
+ * Scale the number of CPUs select_idle_cpu() scans by the latency nice of @p:
+ * latency sensitive tasks look up to three times further for an idle CPU,
+ * latency tolerant ones give up to twice sooner and stay packed on the busy
+ * CPUs they were woken on.
+ */
+static inline int latency_scan_depth(struct task_struct *p, int nr)
+{
+	int latency_nice = p->latency_nice;
+
+	if (latency_nice < 0)
+		return nr + nr * -latency_nice / (-MIN_LATENCY_NICE / 2);
+
+	return max(nr - nr * latency_nice / LATENCY_NICE_WIDTH, 2);
+}
+
 /*
  * Scan the LLC domain for idle CPUs; this is dynamically regulated by
  * comparing the average scan cost (tracked in sd->avg_scan_cost) against the
@@ -6876,15 +7235,18 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 	avg_idle = this_rq()->avg_idle / 512;
 	avg_cost = this_sd->avg_scan_cost + 1;
 
-	if (sched_feat(SIS_AVG_CPU) && avg_idle < avg_cost)
+	if (sched_feat(SIS_AVG_CPU) && avg_idle < avg_cost &&
+	    p->latency_nice >= DEFAULT_LATENCY_NICE)
 		return -1;
 
 	if (sched_feat(SIS_PROP)) {
 		u64 span_avg = sd->span_weight * avg_idle;
 		if (span_avg > 4*avg_cost)
-			nr = div_u64(span_avg, avg_cost);
+			nr = min_t(u64, div_u64(span_avg, avg_cost),
+				   sd->span_weight + 1);
 		else
 			nr = 4;
+		nr = latency_scan_depth(p, nr);
 	}
 
 	time = cpu_clock(this);
@@ -7691,6 +8053,23 @@ static unsigned long wakeup_gran(struct sched_entity *se)
 	return calc_delta_fair(gran, se);
 }
 
+/*
+ * Latency nice bias of the wakeup preemption of @curr by @se. If either entity
+ * is latency sensitive, their offsets are compared so that a sensitive @se
+ * preempts sooner and a sensitive @curr is preempted later. Otherwise only the
+ * tolerance of @se is accounted, which delays the preemption.
+ */
+static long wakeup_latency_gran(struct sched_entity *curr,
+				struct sched_entity *se)
+{
+	long latency_offset = se->latency_offset;
+
+	if (latency_offset < 0 || curr->latency_offset < 0)
+		latency_offset -= curr->latency_offset;
+
+	return min_t(long, latency_offset, sysctl_sched_latency);
+}
+
 /*
  * Should 'se' preempt 'curr'.
  * 判断 se 是否应该抢占 curr
@@ -7711,6 +8090,9 @@ wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
 {
 	s64 gran, vdiff = curr->vruntime - se->vruntime;
 
+	/* Take the latency nice of both entities into account */
+	vdiff -= wakeup_latency_gran(curr, se);
+
 	/**
 	 * se "抢占" curr 是有条件的，第一个自然是 se->vruntime 要小于 curr->vruntime.
 	 * 如果 curr 比 se 有更小的 vruntime，那么无法抢占。
@@ -12278,6 +12660,8 @@ int alloc_fair_sched_group(struct task_group *tg, struct task_group *parent)
 	tg->shares = NICE_0_LOAD;
 
 	init_cfs_bandwidth(tg_cfs_bandwidth(tg));
+	if (!alloc_cfs_bandwidth_pools(tg_cfs_bandwidth(tg)))
+		goto err;
 
 	for_each_possible_cpu(i) {
 		cfs_rq = kzalloc_node(sizeof(struct cfs_rq),
@@ -12292,6 +12676,7 @@ int alloc_fair_sched_group(struct task_group *tg, struct task_group *parent)
 
 		init_cfs_rq(cfs_rq);
 		init_tg_cfs_entry(tg, cfs_rq, se, i, parent->se[i]);
+		cfs_rq->bw_pool = tg_cfs_bandwidth(tg)->pools[cpu_to_node(i)];
 		init_entity_runnable_average(se);
 	}
 
@@ -12374,6 +12759,7 @@ void init_tg_cfs_entry(struct task_group *tg, struct cfs_rq *cfs_rq,
 	se->my_q = cfs_rq;
 	/* guarantee group entities always have weight */
 	update_load_set(&se->load, NICE_0_LOAD);
+	se->latency_offset = calc_latency_offset(tg->latency_nice);
 	se->parent = parent;
 }
 
@@ -12418,6 +12804,33 @@ int sched_group_set_shares(struct task_group *tg, unsigned long shares)
 	mutex_unlock(&shares_mutex);
 	return 0;
 }
+
+int sched_group_set_latency(struct task_group *tg, int latency_nice)
+{
+	long latency_offset;
+	int i;
+
+	/* The root group has no entities to bias */
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	if (latency_nice < MIN_LATENCY_NICE || latency_nice > MAX_LATENCY_NICE)
+		return -ERANGE;
+
+	latency_offset = calc_latency_offset(latency_nice);
+
+	mutex_lock(&shares_mutex);
+	if (tg->latency_nice != latency_nice) {
+		tg->latency_nice = latency_nice;
+
+		/* only read by wakeup_preempt_entity(), no need for the rq lock */
+		for_each_possible_cpu(i)
+			WRITE_ONCE(tg->se[i]->latency_offset, latency_offset);
+	}
+	mutex_unlock(&shares_mutex);
+
+	return 0;
+}
 #else /* CONFIG_FAIR_GROUP_SCHED */
 
 #endif /* CONFIG_FAIR_GROUP_SCHED */
@@ -53,6 +53,18 @@ SCHED_FEAT(NONTASK_CAPACITY, true)
  */
 SCHED_FEAT(TTWU_QUEUE, true)
 
+/*
+ * Coalesce wakeups sent to another LLC on a per-LLC list drained by a single
+ * IPI, see __ttwu_queue_llc().
+ */
+SCHED_FEAT(TTWU_QUEUE_LLC, false)
+
+/*
+ * Hand out CFS bandwidth slices from per-NUMA-node runtime pools so that
+ * cfs_b->lock is only taken once per node batch instead of once per slice.
+ */
+SCHED_FEAT(CFS_BW_POOL, true)
+
 /*
  * When doing wakeups, attempt to limit superfluous scans of the LLC domain.
  */
@@ -470,9 +470,44 @@ struct cfs_bandwidth {
 	int			nr_periods;
 	int			nr_throttled;
 	u64			throttled_time;
+
+	/**
+	 * 每个 NUMA 节点一个的运行时间池，按 nr_node_ids 索引，root_task_group
+	 * 没有（为 NULL）；cfs_rq 从本节点的池中取 slice，只有池耗尽时才需要
+	 * 获取 cfs_b->lock。
+	 */
+	struct cfs_bandwidth_pool **pools;
+	/**
+	 * 每次 __refill_cfs_bandwidth_runtime() 加一，使各节点池中旧周期的
+	 * 运行时间失效；
+	 */
+	unsigned int		pool_gen;
 #endif
 };
 
+#ifdef CONFIG_CFS_BANDWIDTH
+/*
+ * Per-node slice cache sitting between cfs_b->runtime and the cfs_rqs of one
+ * NUMA node. Lock ordering: pool->lock nests outside cfs_b->lock.
+ */
+struct cfs_bandwidth_pool {
+	raw_spinlock_t		lock;
+	/**
+	 * 本节点已从 cfs_b->runtime 中取出、尚未分给 cfs_rq 的运行时间；
+	 */
+	u64			runtime;
+	/**
+	 * 每次从 cfs_b 批量补充的量，补充时在 cfs_b->lock 下重新计算；
+	 */
+	u64			batch;
+	/**
+	 * runtime 所属的周期，与 cfs_b->pool_gen 不同时说明是上个周期剩下的；
+	 */
+	unsigned int		gen;
+	int			node;
+} ____cacheline_aligned_in_smp;
+#endif
+
 /**
  *  Task group related information
  *  内核使用struct task_group来描述任务组
@@ -546,6 +581,9 @@ struct task_group {
 	struct cfs_rq		**cfs_rq;
 	unsigned long		shares;
 
+	/* latency nice of the group entities, see cpu.latency.nice */
+	int			latency_nice;
+
 #ifdef	CONFIG_SMP
 	/*
 	 * load_avg can be heavily contended at clock tick time, so put
@@ -652,6 +690,7 @@ extern void init_cfs_bandwidth(struct cfs_bandwidth *cfs_b);
 extern void __refill_cfs_bandwidth_runtime(struct cfs_bandwidth *cfs_b);
 extern void start_cfs_bandwidth(struct cfs_bandwidth *cfs_b);
 extern void unthrottle_cfs_rq(struct cfs_rq *cfs_rq);
+extern void __cfsb_csd_unthrottle(void *arg);
 
 extern void free_rt_sched_group(struct task_group *tg);
 extern int alloc_rt_sched_group(struct task_group *tg, struct task_group *parent);
@@ -674,6 +713,7 @@ extern void sched_move_task(struct task_struct *tsk);
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 extern int sched_group_set_shares(struct task_group *tg, unsigned long shares);
+extern int sched_group_set_latency(struct task_group *tg, int latency_nice);
 
 #ifdef CONFIG_SMP
 extern void set_task_rq_fair(struct sched_entity *se,
@@ -833,6 +873,16 @@ struct cfs_rq {
 	int			throttled;
 	int			throttle_count;
 	struct list_head	throttled_list;
+	/**
+	 * 本 cfs_rq 所在 NUMA 节点的运行时间池，root_task_group 为 NULL；
+	 */
+	struct cfs_bandwidth_pool *bw_pool;
+#ifdef CONFIG_SMP
+	/**
+	 * 挂在 rq->cfsb_csd_list 上，等待目标 CPU 在 IPI 中解除限流；
+	 */
+	struct list_head	throttled_csd_list;
+#endif
 #endif /* CONFIG_CFS_BANDWIDTH */
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 };
@@ -1251,6 +1301,26 @@ struct rq {
 
 #ifdef CONFIG_SMP
 	unsigned int		ttwu_pending;
+
+	/*
+	 * Cross-LLC wakeups coalesced per target LLC, see __ttwu_queue_llc().
+	 * Every rq has one but only the one of the CPU named by sd_llc_id is
+	 * used.
+	 */
+	struct llist_head	ttwu_llc_list;
+	call_single_data_t	ttwu_llc_csd;
+	struct hrtimer		ttwu_llc_timer;
+	int			ttwu_llc_target;
+	u64			ttwu_llc_queued_at;
+#endif
+
+#if defined(CONFIG_CFS_BANDWIDTH) && defined(CONFIG_SMP)
+	/**
+	 * distribute_cfs_runtime() 把需要在本 CPU 上解除限流的 cfs_rq 挂到
+	 * cfsb_csd_list 上，一个 IPI 批量处理所有任务组的 cfs_rq；
+	 */
+	call_single_data_t	cfsb_csd;
+	struct list_head	cfsb_csd_list;
 #endif
 
 	/**
@@ -1464,6 +1534,16 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int		ttwu_count;
 	unsigned int		ttwu_local;
+
+	/*
+	 * coalesced cross-LLC wakeups: kicks handled on this CPU, IPIs the
+	 * wakeups queued here would have sent without coalescing, and kick and
+	 * resched IPIs this CPU sent for them
+	 */
+	unsigned int		ttwu_llc_ipi;
+	unsigned int		ttwu_llc_ipi_needed;
+	unsigned int		ttwu_llc_ipi_sent;
+	u64			ttwu_llc_delay;
 #endif
 
 #ifdef CONFIG_CPU_IDLE
@@ -2192,6 +2272,17 @@ static inline int task_on_rq_migrating(struct task_struct *p)
 extern const int		sched_prio_to_weight[40];
 extern const u32		sched_prio_to_wmult[40];
 
+/*
+ * Convert a latency nice into the vruntime bias applied on wakeup preemption:
+ * a linear mapping of [MIN_LATENCY_NICE, MAX_LATENCY_NICE] onto roughly
+ * [-sysctl_sched_latency, sysctl_sched_latency].
+ */
+static inline long calc_latency_offset(int latency_nice)
+{
+	return div_s64((s64)sysctl_sched_latency * latency_nice,
+		       LATENCY_NICE_WIDTH / 2);
+}
+
 /*
  * {de,en}queue flags:
  *
@@ -37,6 +37,7 @@
 #include <linux/ptrace.h>
 #include <linux/fs_struct.h>
 #include <linux/file.h>
+#include <linux/fdtable.h>
 #include <linux/mount.h>
 #include <linux/gfp.h>
 #include <linux/syscore_ops.h>
@@ -2605,6 +2606,16 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 
 		error = (current->flags & PR_IO_FLUSHER) == PR_IO_FLUSHER;
 		break;
+	case PR_SET_FD_ALLOC:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = files_set_fd_alloc(current->files, arg2);
+		break;
+	case PR_GET_FD_ALLOC:
+		if (arg2 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = files_get_fd_alloc(current->files);
+		break;
 	default:
 		error = -EINVAL;
 		break;
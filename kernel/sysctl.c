@@ -192,6 +192,7 @@ static int max_wakeup_granularity_ns = NSEC_PER_SEC;	/* 1 second */
 #ifdef CONFIG_SMP
 static int min_sched_tunable_scaling = SCHED_TUNABLESCALING_NONE;
 static int max_sched_tunable_scaling = SCHED_TUNABLESCALING_END-1;
+static int max_wake_coalesce_ns = NSEC_PER_MSEC;	/* 1 msec */
 #endif /* CONFIG_SMP */
 #endif /* CONFIG_SCHED_DEBUG */
 
@@ -1708,6 +1709,21 @@ static struct ctl_table kern_table[] = {    /* /proc/sys/kernel/ */
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+	{
+		/**
+		 *  /proc/sys/kernel/sched_wake_coalesce_ns
+		 *
+		 *  How long to hold back the IPI of a cross-LLC wakeup so that
+		 *  more wakeups to the same LLC can share it, see TTWU_QUEUE_LLC.
+		 */
+		.procname	= "sched_wake_coalesce_ns",
+		.data		= &sysctl_sched_wake_coalesce_ns,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= &max_wake_coalesce_ns,
+	},
 #ifdef CONFIG_SCHEDSTATS
 	{
 		/**
@@ -3404,6 +3420,13 @@ static struct ctl_table fs_table[] = {  /* /proc/sys/fs/xxx */
 		.mode		= 0444,
 		.proc_handler	= proc_nr_dentry,
 	},
+	{
+		.procname	= "negative-dentry-limit",
+		.data		= &sysctl_negative_dentry_limit,
+		.maxlen		= sizeof(sysctl_negative_dentry_limit),
+		.mode		= 0644,
+		.proc_handler	= proc_doulongvec_minmax,
+	},
 	{
 		.procname	= "overflowuid",
 		.data		= &fs_overflowuid,
@@ -1941,6 +1941,10 @@ no_page:
 			gfp_mask |= __GFP_WRITE;
 		if (fgp_flags & FGP_NOFS)
 			gfp_mask &= ~__GFP_FS;
+		if (fgp_flags & FGP_NOWAIT) {
+			gfp_mask &= ~GFP_KERNEL;
+			gfp_mask |= GFP_NOWAIT | __GFP_NOWARN;
+		}
 
 		/**
 		 * 分配新的 page cache
@@ -3444,11 +3448,22 @@ struct page *grab_cache_page_write_begin(struct address_space *mapping,
 
 	if (flags & AOP_FLAG_NOFS)
 		fgp_flags |= FGP_NOFS;
+	if (flags & AOP_FLAG_NOWAIT)
+		fgp_flags |= FGP_NOWAIT;
 
 	page = pagecache_get_page(mapping, index, fgp_flags,
 			mapping_gfp_mask(mapping));
-	if (page)
-		wait_for_stable_page(page);
+	if (!page)
+		return NULL;
+
+	/* waiting for a stable page would block on writeback */
+	if ((flags & AOP_FLAG_NOWAIT) && PageWriteback(thp_head(page)) &&
+	    (mapping->host->i_sb->s_iflags & SB_I_STABLE_WRITES)) {
+		unlock_page(page);
+		put_page(page);
+		return NULL;
+	}
+	wait_for_stable_page(page);
 
 	return page;
 }
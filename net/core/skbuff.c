@@ -1144,6 +1144,7 @@ struct ubuf_info *sock_zerocopy_alloc(struct sock *sk, size_t size)
 	uarg->len = 1;
 	uarg->bytelen = size;
 	uarg->zerocopy = 1;
+	uarg->flags = 0;
 	refcount_set(&uarg->refcnt, 1);
 	sock_hold(sk);
 
@@ -1159,7 +1160,8 @@ static inline struct sk_buff *skb_from_uarg(struct ubuf_info *uarg)
 struct ubuf_info *sock_zerocopy_realloc(struct sock *sk, size_t size,
 					struct ubuf_info *uarg)
 {
-	if (uarg) {
+	/* a caller owned uarg (msghdr->msg_ubuf) is never extended */
+	if (uarg && uarg->callback == sock_zerocopy_callback) {
 		const u32 byte_limit = 1 << 19;		/* limit to a few TSO */
 		u32 bytelen, next;
 
@@ -1283,10 +1285,12 @@ EXPORT_SYMBOL_GPL(sock_zerocopy_put);
 void sock_zerocopy_put_abort(struct ubuf_info *uarg, bool have_uref)
 {
 	if (uarg) {
-		struct sock *sk = skb_from_uarg(uarg)->sk;
+		if (uarg->callback == sock_zerocopy_callback) {
+			struct sock *sk = skb_from_uarg(uarg)->sk;
 
-		atomic_dec(&sk->sk_zckey);
-		uarg->len--;
+			atomic_dec(&sk->sk_zckey);
+			uarg->len--;
+		}
 
 		if (have_uref)
 			sock_zerocopy_put(uarg);
@@ -1219,7 +1219,14 @@ int tcp_sendmsg_locked(struct sock *sk, struct msghdr *msg, size_t size)
 	/**
 	 *  零拷贝
 	 */
-	if (flags & MSG_ZEROCOPY && size && sock_flag(sk, SOCK_ZEROCOPY)) {
+	if (flags & MSG_ZEROCOPY && size && msg->msg_ubuf) {
+		/* the caller owns uarg and is notified through its callback */
+		uarg = msg->msg_ubuf;
+		sock_zerocopy_get(uarg);
+		zc = sk->sk_route_caps & NETIF_F_SG;
+		if (!zc)
+			uarg->zerocopy = 0;
+	} else if (flags & MSG_ZEROCOPY && size && sock_flag(sk, SOCK_ZEROCOPY)) {
 		/**
 		 *
 		 */
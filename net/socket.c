@@ -2267,6 +2267,7 @@ int __sys_sendto(int fd, void __user *buff, size_t len, unsigned int flags,
 	if (sock->file->f_flags & O_NONBLOCK)   /* 是否阻塞 */
 		flags |= MSG_DONTWAIT;  /* 根据是否阻塞，设定 MSG_DONTWAIT 标志位 */
 	msg.msg_flags = flags;
+	msg.msg_ubuf = NULL;
 
 	/* 发送 */
 	err = sock_sendmsg(sock, &msg);
@@ -2595,6 +2596,7 @@ int __copy_msghdr_from_user(struct msghdr *kmsg,
 		return -EMSGSIZE;
 
 	kmsg->msg_iocb = NULL;
+	kmsg->msg_ubuf = NULL;
 	*uiov = msg.msg_iov;
 	*nsegs = msg.msg_iovlen;
 	return 0;
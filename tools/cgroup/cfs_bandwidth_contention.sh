@@ -0,0 +1,115 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Reproduce cfs_b->lock contention of CFS bandwidth control: one cgroup that
+# spans every online CPU, a small quota, and a CPU hog pinned to each CPU so
+# that every cfs_rq keeps coming back for a new slice and most of them sit
+# throttled at each period boundary.
+#
+# The run is repeated with and without the per-node runtime pools
+# (sched_features CFS_BW_POOL) and the throttling statistics of the group
+# are printed for both.  Run it under "perf lock" or with lock_stat enabled
+# to see where cfs_b->lock is taken.
+#
+# Usage: cfs_bandwidth_contention.sh [-q quota_us] [-p period_us] [-t secs]
+#
+# Needs root, cgroup v2 mounted on /sys/fs/cgroup with the cpu controller
+# available, and debugfs on /sys/kernel/debug to toggle the feature.
+
+CGROOT=/sys/fs/cgroup
+CG=$CGROOT/cfs_bw_contention
+FEATURES=/sys/kernel/debug/sched_features
+
+NR_CPUS=$(nproc)
+PERIOD=100000
+QUOTA=$((NR_CPUS * 2000))
+DURATION=10
+
+usage()
+{
+	echo "usage: $0 [-q quota_us] [-p period_us] [-t secs]" >&2
+	exit 1
+}
+
+while getopts "q:p:t:h" opt; do
+	case $opt in
+	q) QUOTA=$OPTARG ;;
+	p) PERIOD=$OPTARG ;;
+	t) DURATION=$OPTARG ;;
+	*) usage ;;
+	esac
+done
+
+if [ "$(id -u)" -ne 0 ]; then
+	echo "must be run as root" >&2
+	exit 1
+fi
+
+if ! grep -qw cpu $CGROOT/cgroup.controllers 2>/dev/null; then
+	echo "cgroup v2 cpu controller not available on $CGROOT" >&2
+	exit 1
+fi
+
+PIDS=()
+
+cleanup()
+{
+	[ ${#PIDS[@]} -gt 0 ] && kill "${PIDS[@]}" 2>/dev/null
+	wait 2>/dev/null
+	rmdir $CG 2>/dev/null
+}
+trap cleanup EXIT
+
+set_feature()
+{
+	[ -w $FEATURES ] && echo "$1" > $FEATURES
+}
+
+stat_field()
+{
+	awk -v k="$1" '$1 == k { print $2 }' $CG/cpu.stat
+}
+
+run_once()
+{
+	local label=$1 cpu p0 t0 u0
+
+	mkdir -p $CG
+	echo "$QUOTA $PERIOD" > $CG/cpu.max
+
+	PIDS=()
+	for ((cpu = 0; cpu < NR_CPUS; cpu++)); do
+		taskset -c $cpu sh -c "echo \$\$ > $CG/cgroup.procs; \
+			exec sh -c 'while :; do :; done'" &
+		PIDS+=($!)
+	done
+
+	sleep 1
+	p0=$(stat_field nr_periods)
+	t0=$(stat_field throttled_usec)
+	u0=$(stat_field usage_usec)
+
+	sleep "$DURATION"
+
+	printf "%-14s periods %6d  throttled %10d us  usage %12d us\n" \
+		"$label" \
+		$(($(stat_field nr_periods) - p0)) \
+		$(($(stat_field throttled_usec) - t0)) \
+		$(($(stat_field usage_usec) - u0))
+
+	kill "${PIDS[@]}" 2>/dev/null
+	wait 2>/dev/null
+	PIDS=()
+	rmdir $CG
+}
+
+echo "+cpu" > $CGROOT/cgroup.subtree_control 2>/dev/null
+
+echo "cpus $NR_CPUS, quota ${QUOTA}us / period ${PERIOD}us, ${DURATION}s"
+
+if [ -w $FEATURES ]; then
+	set_feature NO_CFS_BW_POOL
+	run_once "global lock"
+	set_feature CFS_BW_POOL
+fi
+run_once "node pools"
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Test of IORING_OP_LINKAT with an empty old path and AT_EMPTY_PATH. The
+ * inline LOOKUP_CACHED attempt can't walk an empty name in RCU mode and
+ * must fail cleanly with -EAGAIN, so the request is retried from io-wq and
+ * creates the link.
+ *
+ * Usage: io_uring-linkat [loops]
+ *
+ * Exits 0 on success, 1 on failure and 2 if the kernel lacks the opcode.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "liburing.h"
+
+static int linkat_empty(struct io_uring *ring, int fd, const char *newpath)
+{
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	int ret;
+
+	sqe = io_uring_get_sqe(ring);
+	io_uring_prep_rw(IORING_OP_LINKAT, sqe, fd, "", AT_FDCWD, 0);
+	sqe->addr2 = (unsigned long) newpath;
+	sqe->hardlink_flags = AT_EMPTY_PATH;
+
+	ret = io_uring_submit(ring);
+	if (ret < 0)
+		return ret;
+	ret = io_uring_wait_cqe(ring, &cqe);
+	if (ret < 0)
+		return ret;
+	ret = cqe->res;
+	io_uring_cqe_seen(ring, cqe);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	char dir[] = "/tmp/io_uring-linkat.XXXXXX";
+	char src[64], dst[64];
+	struct io_uring ring;
+	int fd, i, loops = 64, ret;
+
+	if (argc > 1)
+		loops = atoi(argv[1]);
+
+	ret = io_uring_queue_init(4, &ring, 0);
+	if (ret < 0) {
+		fprintf(stderr, "queue_init: %s\n", strerror(-ret));
+		return 1;
+	}
+
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return 1;
+	}
+	snprintf(src, sizeof(src), "%s/src", dir);
+	snprintf(dst, sizeof(dst), "%s/dst", dir);
+	fd = open(src, O_CREAT | O_RDWR, 0600);
+	if (fd < 0) {
+		perror("open");
+		ret = 1;
+		goto out;
+	}
+
+	for (i = 0; i < loops; i++) {
+		struct stat st;
+
+		ret = linkat_empty(&ring, fd, dst);
+		if (ret == -EINVAL) {
+			fprintf(stderr, "IORING_OP_LINKAT not supported\n");
+			ret = 2;
+			goto out;
+		}
+		/* AT_EMPTY_PATH needs CAP_DAC_READ_SEARCH */
+		if (ret == -ENOENT && geteuid())
+			continue;
+		if (ret) {
+			fprintf(stderr, "linkat(fd, \"\", AT_EMPTY_PATH): %s\n",
+				strerror(-ret));
+			ret = 1;
+			goto out;
+		}
+		if (stat(dst, &st) || st.st_nlink != 2) {
+			fprintf(stderr, "link was not created\n");
+			ret = 1;
+			goto out;
+		}
+		unlink(dst);
+	}
+	printf("%d linkat requests ok%s\n", loops,
+	       geteuid() ? " (not root, links not created)" : "");
+	ret = 0;
+out:
+	if (fd >= 0)
+		close(fd);
+	unlink(dst);
+	unlink(src);
+	rmdir(dir);
+	io_uring_queue_exit(&ring);
+	return ret;
+}
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Measure io_uring_enter() overhead by submitting batches of IORING_OP_NOP
+ * requests, once with the ring fd and once with the ring registered through
+ * IORING_REGISTER_RING_FDS. Each thread runs its own ring, all threads share
+ * the file table so the plain fd lookup takes a file reference every call.
+ *
+ * Usage: io_uring-nop [-b batch] [-t threads] [-r runtime]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "liburing.h"
+
+static unsigned batch = 1;
+static unsigned nr_threads = 2;
+static unsigned runtime = 5;
+
+struct thread_data {
+	pthread_t thread;
+	int use_reg;
+	unsigned long long calls;
+	unsigned long long nops;
+	unsigned long long ns;
+	int err;
+};
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *run(void *data)
+{
+	struct thread_data *td = data;
+	unsigned long long start, elapsed;
+	struct io_uring ring;
+	unsigned i;
+	int ret;
+
+	ret = io_uring_queue_init(batch * 2, &ring, 0);
+	if (ret < 0) {
+		fprintf(stderr, "queue_init: %s\n", strerror(-ret));
+		td->err = 1;
+		return NULL;
+	}
+	if (td->use_reg && io_uring_register_ring_fd(&ring) != 1) {
+		perror("register ring fd");
+		td->err = 1;
+		goto out;
+	}
+
+	start = now_ns();
+	do {
+		struct io_uring_cqe *cqe;
+
+		for (i = 0; i < batch; i++)
+			io_uring_prep_nop(io_uring_get_sqe(&ring));
+
+		ret = io_uring_submit(&ring);
+		if (ret != (int) batch) {
+			fprintf(stderr, "submit: %d\n", ret);
+			td->err = 1;
+			goto out;
+		}
+		td->calls++;
+
+		/* nops complete inline, no need to wait */
+		for (i = 0; i < batch; i++) {
+			ret = io_uring_peek_cqe(&ring, &cqe);
+			if (ret || !cqe) {
+				fprintf(stderr, "missing cqe\n");
+				td->err = 1;
+				goto out;
+			}
+			io_uring_cqe_seen(&ring, cqe);
+		}
+		td->nops += batch;
+		elapsed = now_ns() - start;
+	} while (elapsed < runtime * 1000000000ULL);
+
+	td->ns = elapsed;
+out:
+	io_uring_queue_exit(&ring);
+	return NULL;
+}
+
+static int run_mode(int use_reg)
+{
+	unsigned long long calls = 0, nops = 0, ns = 0;
+	struct thread_data *td;
+	unsigned i;
+	int err = 0;
+
+	td = calloc(nr_threads, sizeof(*td));
+	if (!td) {
+		perror("calloc");
+		return 1;
+	}
+
+	for (i = 0; i < nr_threads; i++) {
+		td[i].use_reg = use_reg;
+		if (pthread_create(&td[i].thread, NULL, run, &td[i])) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(td[i].thread, NULL);
+		err |= td[i].err;
+		calls += td[i].calls;
+		nops += td[i].nops;
+		ns += td[i].ns;
+	}
+	free(td);
+	if (err)
+		return 1;
+
+	printf("%-10s %12llu nops/sec %8llu ns/enter\n",
+	       use_reg ? "registered" : "fd",
+	       nops * 1000000000ULL * nr_threads / ns, ns / calls);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "b:t:r:h")) != -1) {
+		switch (opt) {
+		case 'b':
+			batch = atoi(optarg);
+			break;
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 'r':
+			runtime = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-b batch] [-t threads] "
+				"[-r runtime]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (!batch || !nr_threads || !runtime) {
+		fprintf(stderr, "batch, threads and runtime must be > 0\n");
+		return 1;
+	}
+
+	printf("batch %u, threads %u, %us\n", batch, nr_threads, runtime);
+	if (run_mode(0) || run_mode(1))
+		return 1;
+	return 0;
+}
@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Compare the two ways of handing buffers to io_uring for buffer selection:
+ * re-providing each consumed buffer with an IORING_OP_PROVIDE_BUFFERS sqe,
+ * and recycling it through a ring mapped buffer group registered with
+ * IORING_REGISTER_PBUF_RING. Keeps QD buffer selecting reads from /dev/zero
+ * (or the given file) in flight and reports reads per second for each mode.
+ */
+#include <stdio.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "liburing.h"
+
+#define QD		64
+#define NR_BUFS		256
+#define BS		4096
+#define BGID		1
+#define RUNTIME		5
+
+#define PBUF_DATA	((void *) -1UL)
+
+static int fd;
+static char *bufs;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void prep_read(struct io_uring *ring)
+{
+	struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+
+	io_uring_prep_rw(IORING_OP_READ, sqe, fd, NULL, BS, 0);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = BGID;
+}
+
+static void prep_provide(struct io_uring *ring, int bid, int nr)
+{
+	struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+
+	io_uring_prep_rw(IORING_OP_PROVIDE_BUFFERS, sqe, nr,
+			 bufs + bid * BS, BS, bid);
+	sqe->buf_group = BGID;
+	io_uring_sqe_set_data(sqe, PBUF_DATA);
+}
+
+static void ring_add(struct io_uring_buf_ring *br, unsigned short *tail,
+		     int bid)
+{
+	struct io_uring_buf *buf = &br->bufs[*tail & (NR_BUFS - 1)];
+
+	buf->addr = (unsigned long) (bufs + bid * BS);
+	buf->len = BS;
+	buf->bid = bid;
+	(*tail)++;
+}
+
+static int run(struct io_uring *ring, struct io_uring_buf_ring *br)
+{
+	unsigned long long start, reads = 0, elapsed;
+	unsigned short tail = 0;
+	int i, ret, inflight = 0;
+
+	if (br) {
+		for (i = 0; i < NR_BUFS; i++)
+			ring_add(br, &tail, i);
+		__atomic_store_n(&br->tail, tail, __ATOMIC_RELEASE);
+	} else {
+		prep_provide(ring, 0, NR_BUFS);
+		inflight++;
+	}
+
+	start = now_ns();
+	do {
+		struct io_uring_cqe *cqe;
+
+		while (inflight < QD) {
+			prep_read(ring);
+			inflight++;
+		}
+		ret = io_uring_submit(ring);
+		if (ret < 0) {
+			fprintf(stderr, "submit: %s\n", strerror(-ret));
+			return 1;
+		}
+
+		ret = io_uring_wait_cqe(ring, &cqe);
+		if (ret < 0) {
+			fprintf(stderr, "wait_cqe: %s\n", strerror(-ret));
+			return 1;
+		}
+		do {
+			inflight--;
+			if (io_uring_cqe_get_data(cqe) == PBUF_DATA) {
+				if (cqe->res < 0) {
+					fprintf(stderr, "provide: %s\n",
+						strerror(-cqe->res));
+					return 1;
+				}
+			} else if (cqe->flags & IORING_CQE_F_BUFFER) {
+				int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+				reads++;
+				if (br) {
+					ring_add(br, &tail, bid);
+				} else {
+					prep_provide(ring, bid, 1);
+					inflight++;
+				}
+			} else if (cqe->res != -ENOBUFS) {
+				fprintf(stderr, "read: %s\n",
+					strerror(-cqe->res));
+				return 1;
+			}
+			io_uring_cqe_seen(ring, cqe);
+			io_uring_peek_cqe(ring, &cqe);
+		} while (cqe);
+
+		/* one release store publishes the whole batch */
+		if (br)
+			__atomic_store_n(&br->tail, tail, __ATOMIC_RELEASE);
+		elapsed = now_ns() - start;
+	} while (elapsed < RUNTIME * 1000000000ULL);
+
+	printf("%-8s %llu reads/sec\n", br ? "ring" : "provide",
+	       reads * 1000000000ULL / elapsed);
+	return 0;
+}
+
+static int run_mode(int use_ring)
+{
+	struct io_uring_buf_ring *br = NULL;
+	struct io_uring_buf_reg reg;
+	struct io_uring ring;
+	int ret;
+
+	ret = io_uring_queue_init(QD * 2, &ring, 0);
+	if (ret < 0) {
+		fprintf(stderr, "queue_init: %s\n", strerror(-ret));
+		return 1;
+	}
+
+	if (use_ring) {
+		br = mmap(NULL, NR_BUFS * sizeof(struct io_uring_buf),
+			  PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+			  -1, 0);
+		if (br == MAP_FAILED) {
+			perror("mmap");
+			return 1;
+		}
+		memset(&reg, 0, sizeof(reg));
+		reg.ring_addr = (unsigned long) br;
+		reg.ring_entries = NR_BUFS;
+		reg.bgid = BGID;
+		ret = io_uring_register(ring.ring_fd, IORING_REGISTER_PBUF_RING,
+					&reg, 1);
+		if (ret < 0) {
+			perror("register pbuf ring");
+			return 1;
+		}
+	}
+
+	ret = run(&ring, br);
+	io_uring_queue_exit(&ring);
+	if (br)
+		munmap(br, NR_BUFS * sizeof(struct io_uring_buf));
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	fd = open(argc > 1 ? argv[1] : "/dev/zero", O_RDONLY);
+	if (fd < 0) {
+		perror("open");
+		return 1;
+	}
+
+	bufs = malloc(NR_BUFS * BS);
+	if (!bufs) {
+		perror("malloc");
+		return 1;
+	}
+
+	if (run_mode(0) || run_mode(1))
+		return 1;
+
+	close(fd);
+	return 0;
+}
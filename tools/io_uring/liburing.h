@@ -47,6 +47,10 @@ struct io_uring {
 	struct io_uring_sq sq;
 	struct io_uring_cq cq;
 	int ring_fd;
+
+	/* what io_uring_enter() is called with, see io_uring_register_ring_fd() */
+	int enter_ring_fd;
+	unsigned enter_flags;
 };
 
 /*
@@ -66,6 +70,7 @@ extern int io_uring_queue_init(unsigned entries, struct io_uring *ring,
 extern int io_uring_queue_mmap(int fd, struct io_uring_params *p,
 	struct io_uring *ring);
 extern void io_uring_queue_exit(struct io_uring *ring);
+extern int io_uring_register_ring_fd(struct io_uring *ring);
 extern int io_uring_peek_cqe(struct io_uring *ring,
 	struct io_uring_cqe **cqe_ptr);
 extern int io_uring_wait_cqe(struct io_uring *ring,
@@ -33,8 +33,9 @@ static int __io_uring_get_cqe(struct io_uring *ring,
 		}
 		if (!wait)
 			break;
-		ret = io_uring_enter(ring->ring_fd, 0, 1,
-					IORING_ENTER_GETEVENTS, NULL);
+		ret = io_uring_enter(ring->enter_ring_fd, 0, 1,
+				IORING_ENTER_GETEVENTS | ring->enter_flags,
+				NULL);
 		if (ret < 0)
 			return -errno;
 	} while (1);
@@ -123,8 +124,8 @@ int io_uring_submit(struct io_uring *ring)
 	}
 
 submit:
-	ret = io_uring_enter(ring->ring_fd, submitted, 0,
-				IORING_ENTER_GETEVENTS, NULL);
+	ret = io_uring_enter(ring->enter_ring_fd, submitted, 0,
+				IORING_ENTER_GETEVENTS | ring->enter_flags, NULL);
 	if (ret < 0)
 		return -errno;
 
@@ -67,8 +67,10 @@ int io_uring_queue_mmap(int fd, struct io_uring_params *p, struct io_uring *ring
 
 	memset(ring, 0, sizeof(*ring));
 	ret = io_uring_mmap(fd, p, &ring->sq, &ring->cq);
-	if (!ret)
+	if (!ret) {
 		ring->ring_fd = fd;
+		ring->enter_ring_fd = fd;
+	}
 	return ret;
 }
 
@@ -95,11 +97,42 @@ int io_uring_queue_init(unsigned entries, struct io_uring *ring, unsigned flags)
 	return ret;
 }
 
+/*
+ * Register the ring fd with the calling thread, io_uring_enter() then finds
+ * the ring by index instead of looking up the fd. The registration belongs
+ * to the thread, other threads using the ring must not call this.
+ * Returns 1 on success, -1 on error.
+ */
+int io_uring_register_ring_fd(struct io_uring *ring)
+{
+	struct io_uring_rsrc_update up = {
+		.offset		= -1U,
+		.data		= ring->ring_fd,
+	};
+	int ret;
+
+	ret = io_uring_register(ring->ring_fd, IORING_REGISTER_RING_FDS, &up, 1);
+	if (ret == 1) {
+		ring->enter_ring_fd = up.offset;
+		ring->enter_flags = IORING_ENTER_REGISTERED_RING;
+	}
+	return ret;
+}
+
 void io_uring_queue_exit(struct io_uring *ring)
 {
 	struct io_uring_sq *sq = &ring->sq;
 	struct io_uring_cq *cq = &ring->cq;
 
+	if (ring->enter_flags & IORING_ENTER_REGISTERED_RING) {
+		struct io_uring_rsrc_update up = {
+			.offset		= ring->enter_ring_fd,
+		};
+
+		io_uring_register(ring->ring_fd, IORING_UNREGISTER_RING_FDS,
+				  &up, 1);
+	}
+
 	munmap(sq->sqes, *sq->kring_entries * sizeof(struct io_uring_sqe));
 	munmap(sq->khead, sq->ring_sz);
 	munmap(cq->khead, cq->ring_sz);
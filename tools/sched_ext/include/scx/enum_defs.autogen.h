@@ -23,11 +23,14 @@
 #define HAVE_SCX_DEQ_CORE_SCHED_EXEC
 #define HAVE_SCX_DSQ_FLAG_BUILTIN
 #define HAVE_SCX_DSQ_FLAG_LOCAL_ON
+#define HAVE_SCX_DSQ_FLAG_LLC_ON
 #define HAVE_SCX_DSQ_INVALID
 #define HAVE_SCX_DSQ_GLOBAL
 #define HAVE_SCX_DSQ_LOCAL
 #define HAVE_SCX_DSQ_LOCAL_ON
 #define HAVE_SCX_DSQ_LOCAL_CPU_MASK
+#define HAVE_SCX_DSQ_LLC
+#define HAVE_SCX_DSQ_LLC_ON
 #define HAVE_SCX_DSQ_ITER_REV
 #define HAVE___SCX_DSQ_ITER_HAS_SLICE
 #define HAVE___SCX_DSQ_ITER_HAS_VTIME
@@ -43,6 +43,9 @@ const volatile u64 __SCX_DSQ_FLAG_BUILTIN __weak;
 const volatile u64 __SCX_DSQ_FLAG_LOCAL_ON __weak;
 #define SCX_DSQ_FLAG_LOCAL_ON __SCX_DSQ_FLAG_LOCAL_ON
 
+const volatile u64 __SCX_DSQ_FLAG_LLC_ON __weak;
+#define SCX_DSQ_FLAG_LLC_ON __SCX_DSQ_FLAG_LLC_ON
+
 const volatile u64 __SCX_DSQ_INVALID __weak;
 #define SCX_DSQ_INVALID __SCX_DSQ_INVALID
 
@@ -58,6 +61,12 @@ const volatile u64 __SCX_DSQ_LOCAL_ON __weak;
 const volatile u64 __SCX_DSQ_LOCAL_CPU_MASK __weak;
 #define SCX_DSQ_LOCAL_CPU_MASK __SCX_DSQ_LOCAL_CPU_MASK
 
+const volatile u64 __SCX_DSQ_LLC __weak;
+#define SCX_DSQ_LLC __SCX_DSQ_LLC
+
+const volatile u64 __SCX_DSQ_LLC_ON __weak;
+#define SCX_DSQ_LLC_ON __SCX_DSQ_LLC_ON
+
 const volatile u64 __SCX_TASK_QUEUED __weak;
 #define SCX_TASK_QUEUED __SCX_TASK_QUEUED
 
@@ -0,0 +1,312 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Benchmark of stat() on a deep tree of directories carrying ACLs, with the
+ * per-directory MAY_EXEC cache switched off and on.
+ *
+ * For each setting a child drops to an unprivileged user and re-executes
+ * itself a number of times, walking the tree after each exec, then times
+ * stat() on the deepest file. Every exec gets a new cred, so this also
+ * checks that the cache keeps hitting across execve(). The cache is
+ * switched with <debugfs>/namei/exec_cache and its counters are read from
+ * <debugfs>/namei/exec_cache_stats.
+ *
+ * Usage: exec_cache_bench [-d depth] [-e execs] [-n stats]
+ *
+ * Exits 0 on success, 1 if the hit rate is off and 4 if it can't run.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/xattr.h>
+
+#define KSFT_SKIP	4
+
+#define WALKS		16
+#define TEST_UID	65534
+#define TEST_GID	65534
+/* the first walk after the tree is built fills the cache */
+#define MIN_HIT_RATE	90
+
+static const char *knob_path = "/sys/kernel/debug/namei/exec_cache";
+static const char *stats_path = "/sys/kernel/debug/namei/exec_cache_stats";
+
+static int depth = 32;
+static int execs = 32;
+static int nr_stats = 200000;
+
+/* include/linux/posix_acl_xattr.h isn't exported */
+#define ACL_XATTR_VERSION	2
+#define ACL_USER_OBJ		0x01
+#define ACL_USER		0x02
+#define ACL_GROUP_OBJ		0x04
+#define ACL_MASK		0x10
+#define ACL_OTHER		0x20
+
+struct acl_entry {
+	uint16_t tag;
+	uint16_t perm;
+	uint32_t id;
+};
+
+struct acl {
+	uint32_t version;
+	struct acl_entry e[5];
+};
+
+struct stats {
+	unsigned long hits, misses, fills;
+};
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int read_stats(struct stats *s)
+{
+	FILE *f = fopen(stats_path, "r");
+	int n;
+
+	if (!f)
+		return -1;
+	n = fscanf(f, "hits: %lu misses: %lu fills: %lu",
+		   &s->hits, &s->misses, &s->fills);
+	fclose(f);
+	return n == 3 ? 0 : -1;
+}
+
+static int write_knob(const char *val)
+{
+	int fd = open(knob_path, O_WRONLY);
+	int ret;
+
+	if (fd < 0)
+		return -1;
+	ret = write(fd, val, 1) == 1 ? 0 : -1;
+	close(fd);
+	return ret;
+}
+
+/* owner rwx, TEST_UID x through a named entry, nobody else */
+static int set_acl(const char *path)
+{
+	struct acl acl = {
+		.version = ACL_XATTR_VERSION,
+		.e = {
+			{ ACL_USER_OBJ,  7, -1 },
+			{ ACL_USER,      1, TEST_UID },
+			{ ACL_GROUP_OBJ, 0, -1 },
+			{ ACL_MASK,      1, -1 },
+			{ ACL_OTHER,     0, -1 },
+		},
+	};
+
+	return setxattr(path, "system.posix_acl_access", &acl, sizeof(acl), 0);
+}
+
+/* the unprivileged child may not reach our binary, e.g. under /root */
+static int copy_self(const char *dst)
+{
+	struct stat st;
+	int in, out, ret = -1;
+
+	in = open("/proc/self/exe", O_RDONLY);
+	if (in < 0)
+		return -1;
+	out = open(dst, O_WRONLY | O_CREAT | O_EXCL, 0755);
+	if (out >= 0 && !fstat(in, &st) &&
+	    sendfile(out, in, NULL, st.st_size) == st.st_size)
+		ret = 0;
+	if (out >= 0)
+		close(out);
+	close(in);
+	return ret;
+}
+
+static int child(const char *self, const char *leaf, int left, int n)
+{
+	unsigned long long t;
+	struct stat st;
+	char arg[16], narg[16];
+	int i;
+
+	for (i = 0; i < WALKS; i++) {
+		if (stat(leaf, &st)) {
+			perror("stat");
+			return 1;
+		}
+	}
+	if (left) {
+		snprintf(arg, sizeof(arg), "%d", left - 1);
+		snprintf(narg, sizeof(narg), "%d", n);
+		execl(self, self, "--child", leaf, arg, narg, NULL);
+		perror("execl");
+		return 1;
+	}
+
+	t = now_ns();
+	for (i = 0; i < n; i++)
+		stat(leaf, &st);
+	printf("%llu\n", (now_ns() - t) / n);
+	return 0;
+}
+
+/* one run with the cache set to @on, returns ns per stat() or 0 */
+static unsigned long long run(const char *self, const char *leaf, int on,
+			      struct stats *delta)
+{
+	unsigned long long ns = 0;
+	struct stats before, after;
+	int pfd[2], status;
+	char arg[16], narg[16];
+	FILE *f;
+	pid_t pid;
+
+	if (write_knob(on ? "1" : "0") || read_stats(&before) || pipe(pfd))
+		return 0;
+
+	pid = fork();
+	if (!pid) {
+		dup2(pfd[1], STDOUT_FILENO);
+		close(pfd[0]);
+		if (setgroups(0, NULL) || setgid(TEST_GID) || setuid(TEST_UID))
+			_exit(1);
+		snprintf(arg, sizeof(arg), "%d", execs - 1);
+		snprintf(narg, sizeof(narg), "%d", nr_stats);
+		execl(self, self, "--child", leaf, arg, narg, NULL);
+		_exit(1);
+	}
+	close(pfd[1]);
+	f = fdopen(pfd[0], "r");
+	if (!f || fscanf(f, "%llu", &ns) != 1)
+		ns = 0;
+	if (f)
+		fclose(f);
+	if (pid < 0 || waitpid(pid, &status, 0) < 0 ||
+	    !WIFEXITED(status) || WEXITSTATUS(status) || read_stats(&after))
+		return 0;
+
+	delta->hits = after.hits - before.hits;
+	delta->misses = after.misses - before.misses;
+	delta->fills = after.fills - before.fills;
+	return ns;
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/exec_cache_XXXXXX";
+	char path[PATH_MAX], self[PATH_MAX];
+	unsigned long long ns_off, ns_on;
+	struct stats off, on;
+	unsigned long rate;
+	int i, opt, made = 0, ret = 1;
+
+	if (argc == 5 && !strcmp(argv[1], "--child"))
+		return child(argv[0], argv[2], atoi(argv[3]), atoi(argv[4]));
+
+	while ((opt = getopt(argc, argv, "d:e:n:")) != -1) {
+		switch (opt) {
+		case 'd':
+			depth = atoi(optarg);
+			break;
+		case 'e':
+			execs = atoi(optarg);
+			break;
+		case 'n':
+			nr_stats = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-d depth] [-e execs] [-n stats]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (depth < 1 || execs < 1 || nr_stats < 1 ||
+	    depth * 2 + sizeof(dir) + 8 > sizeof(path)) {
+		fprintf(stderr, "bad arguments\n");
+		return 1;
+	}
+
+	if (geteuid()) {
+		fprintf(stderr, "needs root\n");
+		return KSFT_SKIP;
+	}
+	if (read_stats(&on) || access(knob_path, W_OK)) {
+		fprintf(stderr, "no %s\n", knob_path);
+		return KSFT_SKIP;
+	}
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return 1;
+	}
+	chmod(dir, 0755);
+	snprintf(self, sizeof(self), "%s/bench", dir);
+	if (copy_self(self)) {
+		perror("copy");
+		goto out;
+	}
+
+	strcpy(path, dir);
+	for (i = 0; i < depth; i++) {
+		strcat(path, "/d");
+		if (mkdir(path, 0700)) {
+			perror("mkdir");
+			*strrchr(path, '/') = '\0';
+			goto out;
+		}
+		made++;
+		if (set_acl(path)) {
+			if (errno == EOPNOTSUPP) {
+				fprintf(stderr, "no ACL support on %s\n", dir);
+				ret = KSFT_SKIP;
+			} else {
+				perror("setxattr");
+			}
+			goto out;
+		}
+	}
+	ns_off = run(self, path, 0, &off);
+	ns_on = run(self, path, 1, &on);
+	if (!ns_off || !ns_on) {
+		fprintf(stderr, "child failed\n");
+		goto out;
+	}
+
+	rate = on.hits + on.misses ? on.hits * 100 / (on.hits + on.misses) : 0;
+	printf("depth %d, %d execs\n", depth, execs);
+	printf("cache off: %6llu ns/stat\n", ns_off);
+	printf("cache on:  %6llu ns/stat, %lu hits, %lu misses, %lu fills, hit rate %lu%%\n",
+	       ns_on, on.hits, on.misses, on.fills, rate);
+
+	ret = 0;
+	if (off.hits || off.misses) {
+		fprintf(stderr, "FAIL: cache used while switched off\n");
+		ret = 1;
+	}
+	if (rate < MIN_HIT_RATE) {
+		fprintf(stderr, "FAIL: hit rate below %d%%\n", MIN_HIT_RATE);
+		ret = 1;
+	}
+out:
+	write_knob("1");
+	for (i = made; i > 0; i--) {
+		rmdir(path);
+		*strrchr(path, '/') = '\0';
+	}
+	unlink(self);
+	rmdir(dir);
+	return ret;
+}
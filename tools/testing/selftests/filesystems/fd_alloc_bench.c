@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Benchmark of fd allocation in a file table shared by many threads, with
+ * the POSIX lowest-fd policy and with PR_FD_ALLOC_PERCPU.
+ *
+ * Each thread opens and closes /dev/null (or creates and closes a socket
+ * with -s) for the given time, and the rate is reported for both policies.
+ * Then the table is grown past 1M fds by dup() from all threads, which
+ * exercises expand_fdtable() while allocations keep going. Each policy runs
+ * in its own process, so both start with a small table.
+ *
+ * Usage: fd_alloc_bench [-t threads] [-r runtime] [-g fds] [-s]
+ *
+ * Exits 0 on success, 1 on errors and 4 if PR_SET_FD_ALLOC is missing.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define KSFT_SKIP	4
+
+#ifndef PR_SET_FD_ALLOC
+#define PR_SET_FD_ALLOC		59
+#define PR_GET_FD_ALLOC		60
+# define PR_FD_ALLOC_LOWEST	0
+# define PR_FD_ALLOC_PERCPU	1
+#endif
+
+static unsigned int nr_threads = 8;
+static unsigned int runtime = 5;
+static unsigned int grow_fds = (1U << 20) + 4096;
+static int use_socket;
+
+static volatile int stop;
+static pthread_barrier_t barrier;
+
+struct thread_data {
+	pthread_t thread;
+	unsigned long long ops;
+	unsigned int nr_fds;
+	int *fds;
+	int err;
+};
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *open_close_fn(void *arg)
+{
+	struct thread_data *td = arg;
+	int fd;
+
+	pthread_barrier_wait(&barrier);
+	while (!stop) {
+		if (use_socket)
+			fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+		else
+			fd = open("/dev/null", O_RDONLY);
+		if (fd < 0) {
+			td->err = errno;
+			break;
+		}
+		close(fd);
+		td->ops++;
+	}
+	return NULL;
+}
+
+static void *grow_fn(void *arg)
+{
+	struct thread_data *td = arg;
+	unsigned int i;
+
+	pthread_barrier_wait(&barrier);
+	for (i = 0; i < td->nr_fds; i++) {
+		td->fds[i] = dup(STDIN_FILENO);
+		if (td->fds[i] < 0) {
+			td->err = errno;
+			break;
+		}
+	}
+	td->nr_fds = i;
+	return NULL;
+}
+
+static int run_threads(struct thread_data *td, void *(*fn)(void *),
+		       unsigned int secs, unsigned long long *ns)
+{
+	unsigned long long start;
+	unsigned int i;
+	int err = 0;
+
+	stop = 0;
+	pthread_barrier_init(&barrier, NULL, nr_threads + 1);
+	for (i = 0; i < nr_threads; i++)
+		pthread_create(&td[i].thread, NULL, fn, &td[i]);
+	pthread_barrier_wait(&barrier);
+	start = now_ns();
+	if (secs) {
+		sleep(secs);
+		stop = 1;
+	}
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(td[i].thread, NULL);
+		if (td[i].err)
+			err = td[i].err;
+	}
+	*ns = now_ns() - start;
+	pthread_barrier_destroy(&barrier);
+	return err;
+}
+
+static int bench_open_close(const char *name)
+{
+	struct thread_data *td = calloc(nr_threads, sizeof(*td));
+	unsigned long long ns, ops = 0;
+	unsigned int i;
+	int err;
+
+	if (!td)
+		return ENOMEM;
+	err = run_threads(td, open_close_fn, runtime, &ns);
+	for (i = 0; i < nr_threads; i++)
+		ops += td[i].ops;
+	printf("%-7s %s/close: %12llu ops/s\n", name,
+	       use_socket ? "socket" : "open", ops * 1000000000ULL / ns);
+	free(td);
+	return err;
+}
+
+static int bench_grow(const char *name)
+{
+	struct thread_data *td = calloc(nr_threads, sizeof(*td));
+	unsigned long long ns;
+	unsigned int i, j, total = 0;
+	int err;
+
+	if (!td)
+		return ENOMEM;
+	for (i = 0; i < nr_threads; i++) {
+		td[i].nr_fds = grow_fds / nr_threads;
+		td[i].fds = malloc(td[i].nr_fds * sizeof(int));
+		if (!td[i].fds) {
+			while (i--)
+				free(td[i].fds);
+			free(td);
+			return ENOMEM;
+		}
+	}
+	err = run_threads(td, grow_fn, 0, &ns);
+	for (i = 0; i < nr_threads; i++) {
+		total += td[i].nr_fds;
+		for (j = 0; j < td[i].nr_fds; j++)
+			close(td[i].fds[j]);
+		free(td[i].fds);
+	}
+	printf("%-7s grow to %u fds: %8llu ms, %6llu ns/fd\n", name, total,
+	       ns / 1000000, total ? ns / total : 0);
+	free(td);
+	return err;
+}
+
+static int bench_mode(const char *name, int mode)
+{
+	int err;
+
+	if (prctl(PR_SET_FD_ALLOC, mode, 0, 0, 0)) {
+		perror("PR_SET_FD_ALLOC");
+		return 1;
+	}
+	err = bench_open_close(name);
+	if (!err && grow_fds)
+		err = bench_grow(name);
+	fflush(stdout);
+	if (err) {
+		fprintf(stderr, "%s: %s\n", name, strerror(err));
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct {
+		const char *name;
+		int mode;
+	} modes[] = {
+		{ "lowest", PR_FD_ALLOC_LOWEST },
+		{ "percpu", PR_FD_ALLOC_PERCPU },
+	};
+	struct rlimit rlim;
+	unsigned int i;
+	FILE *f;
+	int opt, err;
+
+	while ((opt = getopt(argc, argv, "t:r:g:s")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 'r':
+			runtime = atoi(optarg);
+			break;
+		case 'g':
+			grow_fds = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			use_socket = 1;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-t threads] [-r runtime] [-g fds] [-s]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (!nr_threads || !runtime) {
+		fprintf(stderr, "bad arguments\n");
+		return 1;
+	}
+
+	/* probe with the getter, the numbers may mean something else */
+	err = prctl(PR_GET_FD_ALLOC, 0, 0, 0, 0);
+	if (err != PR_FD_ALLOC_LOWEST && err != PR_FD_ALLOC_PERCPU) {
+		fprintf(stderr, "PR_GET_FD_ALLOC: %s\n", strerror(errno));
+		return KSFT_SKIP;
+	}
+
+	/* room for the table growth, as far as fs.nr_open allows */
+	rlim.rlim_cur = rlim.rlim_max = grow_fds + 1024;
+	f = fopen("/proc/sys/fs/nr_open", "r");
+	if (f) {
+		unsigned long nr_open;
+
+		if (fscanf(f, "%lu", &nr_open) == 1 && nr_open < rlim.rlim_max)
+			rlim.rlim_cur = rlim.rlim_max = nr_open;
+		fclose(f);
+	}
+	if (setrlimit(RLIMIT_NOFILE, &rlim) && !getrlimit(RLIMIT_NOFILE, &rlim))
+		fprintf(stderr, "RLIMIT_NOFILE stays at %lu\n",
+			(unsigned long)rlim.rlim_cur);
+	if (grow_fds + 1024 > rlim.rlim_cur) {
+		grow_fds = rlim.rlim_cur > 1024 ? rlim.rlim_cur - 1024 : 0;
+		fprintf(stderr, "growing to %u fds only\n", grow_fds);
+	}
+
+	printf("%u threads, %u s per run\n", nr_threads, runtime);
+	fflush(stdout);
+	for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+		int status;
+		pid_t pid;
+
+		pid = fork();
+		if (!pid)
+			_exit(bench_mode(modes[i].name, modes[i].mode));
+		if (pid < 0 || waitpid(pid, &status, 0) < 0 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status))
+			return 1;
+	}
+	return 0;
+}